@@ -62,6 +62,19 @@
 #include <linux/stat.h>
 #include <linux/sysfs.h>
 #include <linux/kobject.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0)
+#include <linux/sched/mm.h>
+#include <linux/sched/task.h>
+#include <linux/sched/signal.h>
+#endif
+
+#include "fpga_pfa.h"
+#include "fpga_cmem.h"
+#include "fpga_hist.h"
 
 /**
  * @brief Args
@@ -77,6 +90,14 @@ extern char *ip_addr_q1;
 extern char *mac_addr_q0;
 extern char *mac_addr_q1;
 extern long int eost;
+extern int pfa_en;
+extern int pfa_win_min;
+extern int pfa_win_max;
+extern int pfa_stride_depth;
+extern int cmem_quota;
+extern int tlb_inv_batch;
+extern int irq_coal_cnt;
+extern int irq_coal_time;
 
 /**
  * @brief Info
@@ -246,6 +267,13 @@ extern long int eost;
 /* FPGA dynamic control config */
 #define FPGA_CNFG_CTRL_IRQ_RESTART 0x100
 
+/* IRQ coalescing, register index (64-bit words) */
+#define FPGA_CNFG_IRQ_COAL_REG 15
+#define FPGA_CNFG_AVX_IRQ_COAL_REG (16 * 4)
+#define IRQ_COAL_TIME_MASK 0xffffffff
+#define IRQ_COAL_CNT_SHFT 32
+#define IRQ_COAL_CNT_MASK 0xffff
+
 /* Maximum transfer size */
 #define TRANSFER_MAX_BYTES (8 * 1024 * 1024)
 
@@ -265,11 +293,22 @@ extern long int eost;
 #define TLBF_CTRL_ID_SHFT 0x3
 #define TLBF_STAT_DONE 0x1
 
+/* TLB invalidation commands (unmap entries) */
+#define TLB_CMD_SHFT 62
+#define TLB_CMD_INV_RANGE 0x1
+#define TLB_CMD_INV_CPID 0x2
+#define TLB_CMD_LEN_MASK 0xffffffff
+#define TLB_INV_CNT_REG 2 // completed commands, TLB slave
+#define TLB_INV_POLL_NS 100
+#define TLB_INV_TIMEOUT_NS 10000000 // sweeps take ~3 x TLB size cycles
+
 /* Memory allocation */
 #define MAX_BUFF_NUM 64    // maximum number of huge pages allowed
 #define MAX_PR_BUFF_NUM 64 // maximum number of huge pages allowed
 #define MAX_N_MAP_PAGES 128             // TODO: link to params, max no pfault 1M
 #define MAX_N_MAP_HUGE_PAGES (16 * 512) // max no pfault 32M
+#define TLB_BATCH_PAGES 4096            // entries per bulk TLB transfer
+#define MAX_N_MAP_RANGES 256            // ranges copied per vectored map step
 
 /* Max card pages */
 #define N_LARGE_CHUNKS 512
@@ -317,6 +356,8 @@ extern long int eost;
 #define IOCTL_WRITE_CTX _IOW('D', 13, unsigned long)     // qp context
 #define IOCTL_WRITE_CONN _IOW('D', 14, unsigned long)   // qp connection
 #define IOCTL_SET_TCP_OFFS _IOW('D', 15, unsigned long) // tcp mem offsets
+#define IOCTL_MAP_USER_VEC _IOW('D', 16, unsigned long) // vectored map
+#define IOCTL_SET_DCQCN _IOW('D', 17, unsigned long) // dcqcn parameters
 
 #define IOCTL_READ_CNFG _IOR('D', 32, unsigned long)       // status cnfg
 #define IOCTL_XDMA_STATS _IOR('D', 33, unsigned long)        // status xdma
@@ -340,7 +381,7 @@ extern long int eost;
 
 /* Network */
 #define EN_LOWSPEED 0x5
-#define N_NET_STAT_REGS 10
+#define N_NET_STAT_REGS 11
 
 /* Copy */
 #define MAX_USER_WORDS 32
@@ -446,7 +487,9 @@ struct fpga_stat_cnfg_regs {
     uint64_t net_drop_clr_0; // 46
     uint64_t net_drop_1[2]; // 47-48
     uint64_t net_drop_clr_1; // 49
-    uint64_t reserved_2[16]; // 51-65
+    uint64_t rdma_0_dcqcn; // 50
+    uint64_t rdma_1_dcqcn; // 51
+    uint64_t reserved_2[14]; // 52-65
     uint64_t xdma_debug[N_STAT_REGS]; // 66-98
     uint64_t net_0_debug[N_STAT_REGS]; // 98-130
     uint64_t net_1_debug[N_STAT_REGS]; // 130-162
@@ -549,6 +592,50 @@ struct user_pages {
     uint64_t *cpages;
 };
 
+/* Vectored map range, shared with user space */
+struct tlb_map_range {
+    uint64_t vaddr;
+    uint64_t len;
+    int64_t status; // mapped length or -errno
+};
+
+/* Batched TLB entries (small, large) */
+struct tlb_batch {
+    uint64_t *map_array[2];
+    uint32_t n_pages[2];
+};
+
+/* Page fault timestamps, in miss path order */
+#define PF_TS_ISR 0
+#define PF_TS_THREAD 1
+#define PF_TS_PINNED 2
+#define PF_TS_MAPPED 3
+#define PF_TS_RESTART 4
+#define PF_N_TS 5
+
+/* Page fault latency stages (wake, pin, map, restart, total) */
+#define PF_N_STAGES 5
+
+/* Pending page fault */
+struct fpga_pfault {
+    uint64_t vaddr;
+    uint32_t len;
+    int32_t cpid;
+    uint64_t ts_isr; // ns
+};
+
+/* Page fault trace, kept by the fault path only */
+struct fpga_pf_trace {
+    int huge;
+    uint64_t ts[PF_N_TS]; // ns
+};
+
+/* Page fault latencies, small and huge pages */
+struct fpga_pf_stats {
+    struct lat_hist stage[2][PF_N_STAGES];
+    uint64_t n_failed;
+};
+
 /* Mapped large PR pages */
 struct pr_pages {
     struct hlist_node entry;
@@ -652,6 +739,21 @@ struct fpga_dev {
     // Lock
     spinlock_t lock; // protects concurrent accesses
 
+    // Page faults
+    struct mutex mmu_lock; // serializes fault servicing and explicit mappings
+    struct fpga_pfault pf; // pending fault, handed to the IRQ thread
+    struct pfa_state pfa[N_CPID_MAX]; // fault-around history
+    spinlock_t pf_stats_lock;
+    struct fpga_pf_stats pf_stats; // latencies
+    struct dentry *dbg_dir;
+
+    // IRQ
+    int irq; // vector
+    int irq_cpu; // affinity (-1 none)
+    char irq_name[16];
+    uint32_t irq_coal_cnt; // events
+    uint32_t irq_coal_time; // cycles
+
     // Allocated buffers
     struct user_pages curr_user_buff;
 };
@@ -680,6 +782,9 @@ struct bus_drvdata {
     // Sysfs
     struct kobject cyt_kobj;
 
+    // Debugfs
+    struct dentry *dbg_dir;
+
     // FPGA static config
     uint probe;
     int n_fpga_chan;
@@ -725,14 +830,15 @@ struct bus_drvdata {
 
     // Card memory
     spinlock_t card_l_lock;
-    struct chunk *lchunks;
-    int num_free_lchunks;
-    struct chunk *lalloc;
+    struct cmem_pool card_l;
+    void *card_l_meta;
 
     spinlock_t card_s_lock;
-    struct chunk *schunks;
-    int num_free_schunks;
-    struct chunk *salloc;
+    struct cmem_pool card_s;
+    void *card_s_meta;
+
+    uint64_t card_used[2][MAX_N_REGIONS]; // pages, per vFPGA
+    uint64_t card_quota[2][MAX_N_REGIONS];
 };
 
 
@@ -94,8 +94,8 @@ err_init_fpga_dev:
     kfree(pd->fpga_dev);
     class_destroy(fpga_class);
 err_create_fpga_dev:
-    vfree(pd->schunks);
-    vfree(pd->lchunks);
+    vfree(pd->card_s_meta);
+    vfree(pd->card_l_meta);
 err_card_alloc:
 err_alloc:
 end:
@@ -0,0 +1,434 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "fpga_cmem.h"
+
+/*
+  ____ __  __ _____ __  __
+ / ___|  \/  | ____|  \/  |
+| |   | |\/| |  _| | |\/| |
+| |___| |  | | |___| |  | |
+ \____|_|  |_|_____|_|  |_|
+*/
+
+/* Order of the smallest block holding n pages */
+static uint32_t cmem_order_up(uint32_t n)
+{
+    uint32_t ord = 0;
+
+    while ((1U << ord) < n)
+        ord++;
+    return ord;
+}
+
+/* Free list ops */
+static void cmem_push(struct cmem_pool *p, uint32_t blk, uint32_t ord)
+{
+    p->order[blk] = (uint8_t)ord;
+    p->prev[blk] = CMEM_NONE;
+    p->next[blk] = p->free_head[ord];
+    if (p->free_head[ord] != CMEM_NONE)
+        p->prev[p->free_head[ord]] = blk;
+    p->free_head[ord] = blk;
+    p->n_free_blocks[ord]++;
+}
+
+static void cmem_unlink(struct cmem_pool *p, uint32_t blk, uint32_t ord)
+{
+    if (p->prev[blk] != CMEM_NONE)
+        p->next[p->prev[blk]] = p->next[blk];
+    else
+        p->free_head[ord] = p->next[blk];
+    if (p->next[blk] != CMEM_NONE)
+        p->prev[p->next[blk]] = p->prev[blk];
+
+    p->order[blk] = CMEM_USED;
+    p->n_free_blocks[ord]--;
+}
+
+/* Free an aligned block, coalesce with free buddies */
+static void cmem_free_block(struct cmem_pool *p, uint32_t blk, uint32_t ord)
+{
+    uint32_t buddy;
+
+    while (ord < p->max_order) {
+        buddy = blk ^ (1U << ord);
+        if (buddy + (1U << ord) > p->n_pages || p->order[buddy] != ord)
+            break;
+
+        cmem_unlink(p, buddy, ord);
+        if (buddy < blk)
+            blk = buddy;
+        ord++;
+    }
+
+    cmem_push(p, blk, ord);
+}
+
+/* Free a range as maximal aligned blocks */
+static void cmem_free_range(struct cmem_pool *p, uint32_t first, uint32_t n_pages)
+{
+    uint32_t ord;
+
+    while (n_pages) {
+        ord = 0;
+        while (ord < p->max_order && !(first & (1U << ord)) && (2U << ord) <= n_pages)
+            ord++;
+
+        cmem_free_block(p, first, ord);
+        first += 1U << ord;
+        n_pages -= 1U << ord;
+    }
+}
+
+/* Allocation record, the pages handed out and not freed yet */
+static void cmem_mark(struct cmem_pool *p, uint32_t first, uint32_t n_pages, int alloc)
+{
+    uint32_t i;
+
+    for (i = first; i < first + n_pages; i++) {
+        if (alloc)
+            p->alloc[i >> 3] |= 1U << (i & 7);
+        else
+            p->alloc[i >> 3] &= ~(1U << (i & 7));
+    }
+}
+
+static int cmem_allocated(struct cmem_pool *p, uint32_t first, uint32_t n_pages)
+{
+    uint32_t i;
+
+    for (i = first; i < first + n_pages; i++)
+        if (!(p->alloc[i >> 3] & (1U << (i & 7))))
+            return 0;
+    return 1;
+}
+
+/* Take a free block of at least order ord, split down to ord */
+static int cmem_take(struct cmem_pool *p, uint32_t ord, uint32_t *blk)
+{
+    uint32_t i;
+
+    for (i = ord; i <= p->max_order; i++)
+        if (p->free_head[i] != CMEM_NONE)
+            break;
+    if (i > p->max_order)
+        return -1;
+
+    *blk = p->free_head[i];
+    cmem_unlink(p, *blk, i);
+
+    // upper halves go back
+    while (i > ord) {
+        i--;
+        cmem_push(p, *blk + (1U << i), i);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Metadata size of a pool
+ * 
+ * @param n_pages - pool size
+ */
+size_t cmem_meta_size(uint32_t n_pages)
+{
+    return (size_t)n_pages * (2 * sizeof(uint32_t) + sizeof(uint8_t)) + (n_pages + 7) / 8;
+}
+
+/**
+ * @brief Init a pool, all pages free
+ * 
+ * @param p - pool
+ * @param n_pages - pool size, does not have to be a power of 2
+ * @param meta - cmem_meta_size(n_pages) bytes
+ */
+int cmem_init(struct cmem_pool *p, uint32_t n_pages, void *meta)
+{
+    uint32_t i;
+
+    if (!n_pages || !meta || cmem_order_up(n_pages) > CMEM_MAX_ORDER + 1)
+        return -1;
+
+    p->n_pages = n_pages;
+    p->n_free = n_pages;
+    p->max_order = cmem_order_up(n_pages);
+    if ((1U << p->max_order) > n_pages)
+        p->max_order--;
+
+    p->next = (uint32_t *)meta;
+    p->prev = p->next + n_pages;
+    p->order = (uint8_t *)(p->prev + n_pages);
+    p->alloc = p->order + n_pages;
+
+    for (i = 0; i <= CMEM_MAX_ORDER; i++) {
+        p->free_head[i] = CMEM_NONE;
+        p->n_free_blocks[i] = 0;
+    }
+    for (i = 0; i < n_pages; i++)
+        p->order[i] = CMEM_USED;
+    for (i = 0; i < (n_pages + 7) / 8; i++)
+        p->alloc[i] = 0;
+
+    cmem_free_range(p, 0, n_pages);
+
+    return 0;
+}
+
+/**
+ * @brief Contiguous allocation
+ * 
+ * The block is rounded up to a power of 2 and the unused tail is returned to the pool.
+ * 
+ * @param p - pool
+ * @param n_pages - number of pages
+ * @param first - first allocated page
+ */
+int cmem_alloc(struct cmem_pool *p, uint32_t n_pages, uint32_t *first)
+{
+    uint32_t ord, blk;
+
+    if (!n_pages || n_pages > p->n_free)
+        return -1;
+
+    ord = cmem_order_up(n_pages);
+    if (ord > p->max_order || cmem_take(p, ord, &blk))
+        return -1;
+
+    if ((1U << ord) > n_pages)
+        cmem_free_range(p, blk + n_pages, (1U << ord) - n_pages);
+
+    cmem_mark(p, blk, n_pages, 1);
+    p->n_free -= n_pages;
+    *first = blk;
+
+    return 0;
+}
+
+/**
+ * @brief Largest contiguous run, used when the pool is too fragmented for cmem_alloc
+ * 
+ * @param p - pool
+ * @param n_pages - max number of pages
+ * @param first - first allocated page
+ * @return run length
+ */
+uint32_t cmem_alloc_run(struct cmem_pool *p, uint32_t n_pages, uint32_t *first)
+{
+    int32_t ord;
+
+    if (!n_pages)
+        return 0;
+
+    ord = cmem_order_up(n_pages);
+    if (ord > (int32_t)p->max_order)
+        ord = p->max_order;
+
+    for (; ord >= 0; ord--) {
+        if (p->free_head[ord] == CMEM_NONE)
+            continue;
+
+        if (n_pages > (1U << ord))
+            n_pages = 1U << ord;
+        return cmem_alloc(p, n_pages, first) ? 0 : n_pages;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Free a contiguous range
+ * 
+ * Every page of the range has to be allocated, a range may span several allocations or part of one.
+ * 
+ * @param p - pool
+ * @param first - first page
+ * @param n_pages - number of pages
+ */
+int cmem_free(struct cmem_pool *p, uint32_t first, uint32_t n_pages)
+{
+    if (!n_pages || first >= p->n_pages || n_pages > p->n_pages - first)
+        return -1;
+
+    // double free, range not (entirely) allocated
+    if (!cmem_allocated(p, first, n_pages))
+        return -1;
+
+    cmem_mark(p, first, n_pages, 0);
+    cmem_free_range(p, first, n_pages);
+    p->n_free += n_pages;
+
+    return 0;
+}
+
+/**
+ * @brief Fragmentation stats
+ * 
+ * @param p - pool
+ * @param st - stats
+ */
+void cmem_get_stats(struct cmem_pool *p, struct cmem_stats *st)
+{
+    uint32_t i;
+
+    st->n_pages = p->n_pages;
+    st->n_free = p->n_free;
+    st->largest = 0;
+
+    for (i = 0; i <= CMEM_MAX_ORDER; i++) {
+        st->n_free_blocks[i] = p->n_free_blocks[i];
+        if (p->n_free_blocks[i])
+            st->largest = 1U << i;
+    }
+
+    st->frag = p->n_free ? (uint32_t)(100ULL * (p->n_free - st->largest) / p->n_free) : 0;
+}
+
+/*
+ * User space test harness
+ */
+#ifdef CMEM_TEST_HARNESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T_PAGES (256 * 1024 + 77)
+#define T_ALLOCS 4096
+#define T_ITERS 200000
+
+static uint8_t owner[T_PAGES];
+
+static int check(struct cmem_pool *p)
+{
+    uint32_t i, j, n = 0;
+    struct cmem_stats st;
+
+    for (i = 0; i <= CMEM_MAX_ORDER; i++) {
+        for (j = p->free_head[i]; j != CMEM_NONE; j = p->next[j]) {
+            if (p->order[j] != i || (j & ((1U << i) - 1)) || j + (1U << i) > p->n_pages)
+                return -1;
+            n += 1U << i;
+        }
+    }
+    cmem_get_stats(p, &st);
+    return (n == p->n_free && st.frag <= 100) ? 0 : -1;
+}
+
+int main(void)
+{
+    struct cmem_pool p;
+    struct { uint32_t first, n; } a[T_ALLOCS];
+    uint32_t i, k, len, first, got, n_fail = 0;
+    void *meta = malloc(cmem_meta_size(T_PAGES));
+
+    memset(a, 0, sizeof(a));
+    srand(1);
+
+    if (cmem_init(&p, T_PAGES, meta) || check(&p)) {
+        printf("FAIL init\n");
+        return 1;
+    }
+
+    for (i = 0; i < T_ITERS; i++) {
+        k = rand() % T_ALLOCS;
+
+        if (a[k].n) {
+            for (len = 0; len < a[k].n; len++)
+                owner[a[k].first + len] = 0;
+            if (cmem_free(&p, a[k].first, a[k].n)) {
+                printf("FAIL free %u\n", i);
+                return 1;
+            }
+            a[k].n = 0;
+        } else {
+            len = (rand() % 8) ? 1 + rand() % 64 : 1 + rand() % 4096;
+            if (cmem_alloc(&p, len, &first)) {
+                n_fail++;
+                continue;
+            }
+            for (got = 0; got < len; got++) {
+                if (owner[first + got]) {
+                    printf("FAIL overlap %u\n", i);
+                    return 1;
+                }
+                owner[first + got] = 1;
+            }
+            a[k].first = first;
+            a[k].n = len;
+        }
+
+        if (!(i % 10000) && check(&p)) {
+            printf("FAIL invariants %u\n", i);
+            return 1;
+        }
+    }
+
+    for (k = 0; k < T_ALLOCS; k++)
+        if (a[k].n)
+            cmem_free(&p, a[k].first, a[k].n);
+
+    // everything coalesced back
+    if (check(&p) || p.n_free != T_PAGES || cmem_alloc(&p, 1U << p.max_order, &first) || first != 0) {
+        printf("FAIL coalesce\n");
+        return 1;
+    }
+    cmem_free(&p, first, 1U << p.max_order);
+
+    // double free is refused, also when the head page was handed out again
+    if (cmem_alloc(&p, 4, &first) || cmem_free(&p, first, 4) || !cmem_free(&p, first, 4)) {
+        printf("FAIL double free\n");
+        return 1;
+    }
+    if (cmem_alloc(&p, 1, &got) || (got == first && !cmem_free(&p, first, 4))) {
+        printf("FAIL double free of a reused head\n");
+        return 1;
+    }
+
+    // ranges reaching into free pages are refused, the buddy of got is free
+    if (!cmem_free(&p, got, 2) || !cmem_free(&p, got ^ 1, 1) || cmem_free(&p, got, 1) || check(&p) || p.n_free != T_PAGES) {
+        printf("FAIL free of unallocated pages\n");
+        return 1;
+    }
+
+    // fragmented runs
+    for (i = 0; i < T_PAGES; i += 2)
+        if (cmem_alloc(&p, 2, &first) == 0)
+            cmem_free(&p, first + 1, 1);
+    got = cmem_alloc_run(&p, 16, &first);
+    if (got != 1) {
+        printf("FAIL run %u\n", got);
+        return 1;
+    }
+
+    printf("OK, %u failed allocations\n", n_fail);
+    free(meta);
+    return 0;
+}
+
+#endif /* CMEM_TEST_HARNESS */
@@ -0,0 +1,88 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef __FPGA_CMEM_H__
+#define __FPGA_CMEM_H__
+
+/*
+ * Card memory buddy allocator. No kernel dependencies, the same file builds
+ * a user space test harness (cc -DCMEM_TEST_HARNESS fpga_cmem.c).
+ */
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+#define CMEM_MAX_ORDER 24
+#define CMEM_NONE 0xffffffffU
+#define CMEM_USED 0xff
+
+/* Buddy pool, pages are pool relative */
+struct cmem_pool {
+    uint32_t n_pages;
+    uint32_t n_free;
+    uint32_t max_order;
+    uint32_t free_head[CMEM_MAX_ORDER + 1];
+    uint32_t n_free_blocks[CMEM_MAX_ORDER + 1];
+
+    // metadata, per page
+    uint32_t *next; // free list links (block heads)
+    uint32_t *prev;
+    uint8_t *order; // order of a free block head, CMEM_USED otherwise
+    uint8_t *alloc; // allocated pages, bitmap
+};
+
+/* Fragmentation stats */
+struct cmem_stats {
+    uint32_t n_pages;
+    uint32_t n_free;
+    uint32_t largest; // largest free block (pages)
+    uint32_t frag; // free memory outside the largest free block (%)
+    uint32_t n_free_blocks[CMEM_MAX_ORDER + 1];
+};
+
+/* Metadata size of a pool, memory provided by the caller */
+size_t cmem_meta_size(uint32_t n_pages);
+
+/* Init, all pages free */
+int cmem_init(struct cmem_pool *p, uint32_t n_pages, void *meta);
+
+/* Contiguous allocation of n_pages, 0 on success */
+int cmem_alloc(struct cmem_pool *p, uint32_t n_pages, uint32_t *first);
+
+/* Largest contiguous run up to n_pages, returns the run length (0 if empty) */
+uint32_t cmem_alloc_run(struct cmem_pool *p, uint32_t n_pages, uint32_t *first);
+
+/* Free a contiguous range, 0 on success */
+int cmem_free(struct cmem_pool *p, uint32_t first, uint32_t n_pages);
+
+/* Stats */
+void cmem_get_stats(struct cmem_pool *p, struct cmem_stats *st);
+
+#endif /* FPGA CMEM */
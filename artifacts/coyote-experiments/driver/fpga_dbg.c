@@ -0,0 +1,196 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "fpga_dbg.h"
+
+/*
+ ____  ____   ____
+|  _ \| __ ) / ___|
+| | | |  _ \| |  _
+| |_| | |_) | |_| |
+|____/|____/ \____|
+*/
+
+static const char *pf_stage_name[PF_N_STAGES] = { "wake", "pin", "map", "restart", "total" };
+
+/**
+ * @brief Clear the page fault latencies
+ * 
+ * @param d - vFPGA
+ */
+void pf_stats_reset(struct fpga_dev *d)
+{
+    int i, j;
+    unsigned long flags;
+
+    spin_lock_irqsave(&d->pf_stats_lock, flags);
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < PF_N_STAGES; j++)
+            hist_reset(&d->pf_stats.stage[i][j]);
+    d->pf_stats.n_failed = 0;
+    spin_unlock_irqrestore(&d->pf_stats_lock, flags);
+}
+
+/**
+ * @brief Account a page fault
+ * 
+ * Stages: wake (hard IRQ to thread), pin (fault-around and pinning),
+ * map (TLB programming), restart (engine restart), total.
+ * 
+ * @param d - vFPGA
+ * @param trace - timestamps of the fault
+ * @param mapped - fault serviced
+ */
+void pf_stats_add(struct fpga_dev *d, struct fpga_pf_trace *trace, int mapped)
+{
+    int i;
+    unsigned long flags;
+    uint64_t *ts = trace->ts;
+    struct lat_hist *h = d->pf_stats.stage[trace->huge ? LARGE_CHUNK_ALLOC : SMALL_CHUNK_ALLOC];
+
+    spin_lock_irqsave(&d->pf_stats_lock, flags);
+    if (mapped) {
+        for (i = 0; i < PF_N_STAGES - 1; i++)
+            hist_add(&h[i], ts[i + 1] - ts[i]);
+        hist_add(&h[PF_N_STAGES - 1], ts[PF_TS_RESTART] - ts[PF_TS_ISR]);
+    } else {
+        d->pf_stats.n_failed++;
+    }
+    spin_unlock_irqrestore(&d->pf_stats_lock, flags);
+}
+
+/**
+ * @brief Debugfs read page fault latencies
+ * 
+ */
+static int pf_lat_show(struct seq_file *s, void *unused)
+{
+    int i, j, k;
+    unsigned long flags;
+    struct fpga_dev *d = (struct fpga_dev *)s->private;
+    struct fpga_pf_stats *st;
+    struct lat_hist *h;
+
+    // snapshot, not printed under the lock
+    st = kmalloc(sizeof(struct fpga_pf_stats), GFP_KERNEL);
+    if (!st)
+        return -ENOMEM;
+
+    spin_lock_irqsave(&d->pf_stats_lock, flags);
+    memcpy(st, &d->pf_stats, sizeof(struct fpga_pf_stats));
+    spin_unlock_irqrestore(&d->pf_stats_lock, flags);
+
+    seq_printf(s, "failed: %llu\n", st->n_failed);
+    for (i = 0; i < 2; i++) {
+        seq_printf(s, "\n%s PAGES:\n", i == SMALL_CHUNK_ALLOC ? "SMALL" : "HUGE");
+        seq_printf(s, "%-8s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "min_ns", "mean_ns", "p50_ns", "p99_ns", "max_ns");
+
+        for (j = 0; j < PF_N_STAGES; j++) {
+            h = &st->stage[i][j];
+            seq_printf(s, "%-8s %10llu %10llu %10llu %10llu %10llu %10llu\n", pf_stage_name[j], h->cnt,
+                h->cnt ? h->min : 0, h->cnt ? div64_u64(h->sum, h->cnt) : 0,
+                hist_percentile(h, 50), hist_percentile(h, 99), h->max);
+        }
+
+        // log2 bins of the totals
+        h = &st->stage[i][PF_N_STAGES - 1];
+        for (k = 0; k < HIST_N_BINS; k++)
+            if (h->bins[k])
+                seq_printf(s, "total <= %llu ns: %llu\n", hist_bin_max(k), h->bins[k]);
+    }
+
+    kfree(st);
+    return 0;
+}
+
+static int pf_lat_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, pf_lat_show, inode->i_private);
+}
+
+static const struct file_operations pf_lat_fops = {
+    .owner = THIS_MODULE,
+    .open = pf_lat_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/**
+ * @brief Debugfs write page fault latencies reset (any value)
+ * 
+ */
+static ssize_t pf_reset_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct fpga_dev *d = (struct fpga_dev *)file->private_data;
+
+    pf_stats_reset(d);
+    return count;
+}
+
+static const struct file_operations pf_reset_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .write = pf_reset_write,
+    .llseek = noop_llseek,
+};
+
+/**
+ * @brief Create debugfs entry (coyote/vfpga<id>), failures are not fatal
+ * 
+ */
+void create_debugfs_entry(struct bus_drvdata *d)
+{
+    int i;
+    char name[16];
+
+    pr_info("creating debugfs entry - coyote\n");
+
+    d->dbg_dir = debugfs_create_dir("coyote", NULL);
+    if (IS_ERR_OR_NULL(d->dbg_dir)) {
+        pr_info("debugfs entry could not be created\n");
+        d->dbg_dir = NULL;
+        return;
+    }
+
+    for (i = 0; i < d->n_fpga_reg; i++) {
+        snprintf(name, sizeof(name), "vfpga%d", i);
+        d->fpga_dev[i].dbg_dir = debugfs_create_dir(name, d->dbg_dir);
+        debugfs_create_file("pfault_lat", 0444, d->fpga_dev[i].dbg_dir, &d->fpga_dev[i], &pf_lat_fops);
+        debugfs_create_file("pfault_reset", 0200, d->fpga_dev[i].dbg_dir, &d->fpga_dev[i], &pf_reset_fops);
+    }
+}
+
+/**
+ * @brief Remove debugfs entry
+ * 
+ */
+void remove_debugfs_entry(struct bus_drvdata *d)
+{
+    debugfs_remove_recursive(d->dbg_dir);
+    d->dbg_dir = NULL;
+}
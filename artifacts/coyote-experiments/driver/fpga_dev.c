@@ -56,6 +56,8 @@ static struct kobj_attribute kobj_attr_nstats_q1 = __ATTR_RO(cyt_attr_nstats_q1)
 static struct kobj_attribute kobj_attr_xstats = __ATTR_RO(cyt_attr_xstats);
 static struct kobj_attribute kobj_attr_cnfg = __ATTR_RO(cyt_attr_cnfg);
 static struct kobj_attribute kobj_attr_eost = __ATTR(cyt_attr_eost, 0664, cyt_attr_eost_show, cyt_attr_eost_store);
+static struct kobj_attribute kobj_attr_cmem = __ATTR(cyt_attr_cmem, 0664, cyt_attr_cmem_show, cyt_attr_cmem_store);
+static struct kobj_attribute kobj_attr_irq = __ATTR(cyt_attr_irq, 0664, cyt_attr_irq_show, cyt_attr_irq_store);
 
 static struct attribute *attrs[] = {
     &kobj_attr_ip_q0.attr,
@@ -67,6 +69,8 @@ static struct attribute *attrs[] = {
     &kobj_attr_xstats.attr,
     &kobj_attr_cnfg.attr,
     &kobj_attr_eost.attr,
+    &kobj_attr_cmem.attr,
+    &kobj_attr_irq.attr,
     NULL,
 };
 static struct attribute_group attr_group = {
@@ -192,38 +196,36 @@ int alloc_card_resources(struct bus_drvdata *d)
     int ret_val = 0;
     int i;
 
-    // init chunks card
-    d->num_free_lchunks = N_LARGE_CHUNKS;
-    d->num_free_schunks = N_SMALL_CHUNKS;
-
-    d->lchunks = vzalloc(N_LARGE_CHUNKS * sizeof(struct chunk));
-    if (!d->lchunks) {
+    // buddy pools
+    d->card_l_meta = vzalloc(cmem_meta_size(N_LARGE_CHUNKS));
+    if (!d->card_l_meta) {
         pr_err("memory region for cmem structs not obtained\n");
         goto err_alloc_lchunks; // ERR_ALLOC_LCHUNKS
     }
-    d->schunks = vzalloc(N_SMALL_CHUNKS * sizeof(struct chunk));
-    if (!d->schunks) {
+    d->card_s_meta = vzalloc(cmem_meta_size(N_SMALL_CHUNKS));
+    if (!d->card_s_meta) {
         pr_err("memory region for cmem structs not obtained\n");
         goto err_alloc_schunks; // ERR_ALLOC_SCHUNKS
     }
 
-    for (i = 0; i < N_LARGE_CHUNKS - 1; i++) {
-        d->lchunks[i].used = false;
-        d->lchunks[i].id = i;
-        d->lchunks[i].next = &d->lchunks[i + 1];
-    }
-    for (i = 0; i < N_SMALL_CHUNKS - 1; i++) {
-        d->schunks[i].used = false;
-        d->schunks[i].id = i;
-        d->schunks[i].next = &d->schunks[i + 1];
+    cmem_init(&d->card_l, N_LARGE_CHUNKS, d->card_l_meta);
+    cmem_init(&d->card_s, N_SMALL_CHUNKS, d->card_s_meta);
+
+    // quotas
+    if (cmem_quota <= 0 || cmem_quota > 100)
+        cmem_quota = 100;
+
+    for (i = 0; i < MAX_N_REGIONS; i++) {
+        d->card_used[SMALL_CHUNK_ALLOC][i] = 0;
+        d->card_used[LARGE_CHUNK_ALLOC][i] = 0;
+        d->card_quota[SMALL_CHUNK_ALLOC][i] = (uint64_t)N_SMALL_CHUNKS * cmem_quota / 100;
+        d->card_quota[LARGE_CHUNK_ALLOC][i] = (uint64_t)N_LARGE_CHUNKS * cmem_quota / 100;
     }
-    d->lalloc = &d->lchunks[0];
-    d->salloc = &d->schunks[0];
 
     goto end;
 
 err_alloc_schunks:
-    vfree(d->lchunks);
+    vfree(d->card_l_meta);
 err_alloc_lchunks: 
     ret_val = -ENOMEM;
 end: 
@@ -237,8 +239,8 @@ end:
 void free_card_resources(struct bus_drvdata *d) 
 {
     // free card memory structs
-    vfree(d->schunks);
-    vfree(d->lchunks);
+    vfree(d->card_s_meta);
+    vfree(d->card_l_meta);
 
     pr_info("card resources deallocated\n");
 }
@@ -411,6 +413,15 @@ int init_fpga_devices(struct bus_drvdata *d)
         // initialize device spinlock
         spin_lock_init(&d->fpga_dev[i].lock);
         spin_lock_init(&d->fpga_dev[i].card_pid_lock);
+        mutex_init(&d->fpga_dev[i].mmu_lock);
+        spin_lock_init(&d->fpga_dev[i].pf_stats_lock);
+        pf_stats_reset(&d->fpga_dev[i]);
+        d->fpga_dev[i].dbg_dir = NULL;
+
+        // interrupts, vectors are attached on IRQ setup
+        d->fpga_dev[i].irq = 0;
+        d->fpga_dev[i].irq_cpu = -1;
+        fpga_irq_coal_set(&d->fpga_dev[i], irq_coal_cnt, irq_coal_time);
 
         // writeback setup
         if(d->en_wb) {
@@ -455,6 +466,9 @@ int init_fpga_devices(struct bus_drvdata *d)
     }
     pr_info("all virtual FPGA devices added\n");
 
+    // Debugfs entry
+    create_debugfs_entry(d);
+
     goto end;
 
 err_char_reg:
@@ -492,6 +506,8 @@ end:
 void free_fpga_devices(struct bus_drvdata *d) {
     int i;
 
+    remove_debugfs_entry(d);
+
     for(i = 0; i < d->n_fpga_reg; i++) {
         device_destroy(fpga_class, MKDEV(fpga_major, i));
         cdev_del(&d->fpga_dev[i].cdev);
@@ -30,6 +30,7 @@
 
 #include "coyote_dev.h"
 #include "fpga_fops.h"
+#include "fpga_isr.h"
 
 /**
  * @brief Global
@@ -33,6 +33,14 @@ char *ip_addr_q1 = "0B01D4D2";
 char *mac_addr_q0 = "000A35029DE5";
 char *mac_addr_q1 = "000A35029DE6";
 long int eost = 1000000;
+int pfa_en = 1;
+int pfa_win_min = PFA_DEF_WIN_MIN;
+int pfa_win_max = PFA_DEF_WIN_MAX;
+int pfa_stride_depth = PFA_DEF_STRIDE_DEPTH;
+int cmem_quota = 100;
+int tlb_inv_batch = 1;
+int irq_coal_cnt = 0;
+int irq_coal_time = 0;
 
 module_param(cyt_arch, int, S_IRUSR);
 MODULE_PARM_DESC(cyt_arch, "target architecture");
@@ -44,6 +52,22 @@ module_param(mac_addr_q0, charp, 0000);
 MODULE_PARM_DESC(mac_addr_q0, "mac address QSFP0 (hex)");
 module_param(eost, long, 0000);
 MODULE_PARM_DESC(eost, "EOS time");
+module_param(pfa_en, int, 0644);
+MODULE_PARM_DESC(pfa_en, "page fault-around");
+module_param(pfa_win_min, int, 0644);
+MODULE_PARM_DESC(pfa_win_min, "fault-around window on random faults (pages)");
+module_param(pfa_win_max, int, 0644);
+MODULE_PARM_DESC(pfa_win_max, "max fault-around window (pages)");
+module_param(pfa_stride_depth, int, 0644);
+MODULE_PARM_DESC(pfa_stride_depth, "strides mapped ahead on strided faults");
+module_param(cmem_quota, int, S_IRUSR);
+MODULE_PARM_DESC(cmem_quota, "card memory quota per vFPGA (percent)");
+module_param(tlb_inv_batch, int, 0644);
+MODULE_PARM_DESC(tlb_inv_batch, "range and cpid TLB invalidation commands (requires shell support)");
+module_param(irq_coal_cnt, int, S_IRUSR);
+MODULE_PARM_DESC(irq_coal_cnt, "user interrupt coalescing, events (0 - off)");
+module_param(irq_coal_time, int, S_IRUSR);
+MODULE_PARM_DESC(irq_coal_time, "user interrupt coalescing, shell cycles (0 - off)");
 
 static int __init coyote_init(void) 
 {
@@ -79,7 +79,9 @@ int fpga_release(struct inode *inode, struct file *file)
             cpid = tmp_cid->cpid;
 
             // unamp all leftover user pages
+            mutex_lock(&d->mmu_lock);
             tlb_put_user_pages_cpid(d, cpid, 1);
+            mutex_unlock(&d->mmu_lock);
 
             // unregister (if registered)
             unregister_pid(d, cpid);
@@ -131,6 +133,8 @@ long fpga_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     uint64_t cpid;
     pid_t pid;
     struct cid_entry *tmp_cid;
+    struct tlb_map_range *ranges;
+    uint32_t n_ranges;
 
     struct fpga_dev *d = (struct fpga_dev *)file->private_data;
     struct bus_drvdata *pd;
@@ -207,10 +211,56 @@ long fpga_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             pr_info("user data could not be coppied, return %d\n", ret_val);
         } else {
             cpid = (uint32_t)tmp[2];
+            mutex_lock(&d->mmu_lock);
             tlb_get_user_pages(d, tmp[0], tmp[1], (int32_t)tmp[2], d->pid_array[cpid]);
+            mutex_unlock(&d->mmu_lock);
         }
         break;
 
+    // vectored mapping
+    case IOCTL_MAP_USER_VEC:
+        // read ranges + n_ranges + cpid
+        ret_val = copy_from_user(&tmp, (unsigned long *)arg, 3 * sizeof(unsigned long));
+        if (ret_val != 0) {
+            pr_info("user data could not be coppied, return %d\n", ret_val);
+            return -EFAULT;
+        }
+
+        cpid = tmp[2];
+        if (cpid >= N_CPID_MAX)
+            return -EINVAL;
+
+        ranges = kmalloc(MAX_N_MAP_RANGES * sizeof(struct tlb_map_range), GFP_KERNEL);
+        if (ranges == NULL)
+            return -ENOMEM;
+
+        // chunks, statuses returned in place
+        for (i = 0; i < tmp[1]; i += n_ranges) {
+            n_ranges = min_t(uint64_t, tmp[1] - i, MAX_N_MAP_RANGES);
+            ret_val = copy_from_user(ranges, (struct tlb_map_range *)tmp[0] + i, n_ranges * sizeof(struct tlb_map_range));
+            if (ret_val != 0) {
+                pr_info("user ranges could not be coppied, return %d\n", ret_val);
+                ret_val = -EFAULT;
+                break;
+            }
+
+            mutex_lock(&d->mmu_lock);
+            ret_val = tlb_get_user_pages_vec(d, ranges, n_ranges, (int32_t)cpid, d->pid_array[cpid]);
+            mutex_unlock(&d->mmu_lock);
+            if (ret_val < 0)
+                break;
+
+            ret_val = copy_to_user((struct tlb_map_range *)tmp[0] + i, ranges, n_ranges * sizeof(struct tlb_map_range));
+            if (ret_val != 0) {
+                pr_info("range statuses could not be coppied, return %d\n", ret_val);
+                ret_val = -EFAULT;
+                break;
+            }
+        }
+
+        kfree(ranges);
+        return ret_val < 0 ? ret_val : 0;
+
     // explicit unmapping
     case IOCTL_UNMAP_USER:
         // read vaddr + cpid
@@ -219,7 +269,9 @@ long fpga_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             pr_info("user data could not be coppied, return %d\n", ret_val);
         } else {
             dbg_info("unmapping user pages\n");
+            mutex_lock(&d->mmu_lock);
             tlb_put_user_pages(d, tmp[0], (int32_t)tmp[1], 1);
+            mutex_unlock(&d->mmu_lock);
         }
         break;
 
@@ -271,7 +323,9 @@ long fpga_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             hash_for_each_possible(pid_cpid_map[d->id], tmp_cid, entry, pid) {
                 if(tmp_cid->pid == pid && tmp_cid->cpid == cpid) {
                     // unamp all leftover user pages
+                    mutex_lock(&d->mmu_lock);
                     tlb_put_user_pages_cpid(d, cpid, 1);
+                    mutex_unlock(&d->mmu_lock);
 
                     // Free from hash
                     hash_del(&tmp_cid->entry);
@@ -504,6 +558,28 @@ long fpga_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         }
         break;
 
+    // dcqcn parameters
+    case IOCTL_SET_DCQCN:
+        ret_val = copy_from_user(&tmp, (unsigned long*) arg, 2 * sizeof(unsigned long));
+        if (ret_val != 0) {
+            dbg_info("user data could not be coppied, return %d\n", ret_val);
+        } else {
+            // tmp[0] - qsfp, tmp[1] - parameters
+            if ((tmp[0] && !pd->en_rdma_1) || (!tmp[0] && !pd->en_rdma_0)) {
+                dbg_info("RDMA not enabled\n");
+                return -1;
+            }
+
+            dbg_info("writing dcqcn parameters qsfp%llx, cnfg %llx\n", tmp[0], tmp[1]);
+            spin_lock(&pd->stat_lock);
+
+            tmp[0] ? (pd->fpga_stat_cnfg->rdma_1_dcqcn = tmp[1]) :
+                (pd->fpga_stat_cnfg->rdma_0_dcqcn = tmp[1]);
+
+            spin_unlock(&pd->stat_lock);
+        }
+        break;
+
     // read config
     case IOCTL_READ_CNFG:
         tmp[0] = ((uint64_t)pd->n_fpga_chan << 32) | ((uint64_t)pd->n_fpga_reg << 48) |
@@ -810,6 +886,7 @@ int fpga_mmap(struct file *file, struct vm_area_struct *vma)
 int32_t register_pid(struct fpga_dev *d, pid_t pid)
 {
     int32_t cpid;
+    struct pfa_cnfg cnfg;
 
     BUG_ON(!d);
 
@@ -829,6 +906,12 @@ int32_t register_pid(struct fpga_dev *d, pid_t pid)
     // unlock
     spin_unlock(&d->card_pid_lock);
 
+    // fresh fault history
+    cnfg.win_min = pfa_win_min;
+    cnfg.win_max = pfa_win_max;
+    cnfg.stride_depth = pfa_stride_depth;
+    pfa_init(&d->pfa[cpid], &cnfg);
+
     dbg_info("registration succeeded pid %d, cpid %d\n", pid, cpid);
 
     return cpid;
@@ -0,0 +1,137 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef __FPGA_HIST_H__
+#define __FPGA_HIST_H__
+
+/*
+ * Log2 latency histograms. Header only and without kernel dependencies,
+ * so the same code can be compiled and tested in user space (fpga_hist_test.c).
+ */
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+/* Bin i holds [2^i, 2^(i+1)), bin 0 also holds 0, the last bin everything above */
+#define HIST_N_BINS 40
+
+/* Histogram */
+struct lat_hist {
+    uint64_t cnt;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t bins[HIST_N_BINS];
+};
+
+/**
+ * @brief Bin of a value
+ * 
+ */
+static inline uint32_t hist_bin(uint64_t val)
+{
+    uint32_t bin;
+
+    if (val == 0)
+        return 0;
+
+    bin = 63 - __builtin_clzll(val);
+    return bin < HIST_N_BINS ? bin : HIST_N_BINS - 1;
+}
+
+/**
+ * @brief Upper bound of a bin (inclusive)
+ * 
+ */
+static inline uint64_t hist_bin_max(uint32_t bin)
+{
+    return bin < HIST_N_BINS - 1 ? (2ULL << bin) - 1 : ~0ULL;
+}
+
+/**
+ * @brief Clear a histogram
+ * 
+ */
+static inline void hist_reset(struct lat_hist *h)
+{
+    uint32_t i;
+
+    h->cnt = 0;
+    h->sum = 0;
+    h->min = ~0ULL;
+    h->max = 0;
+    for (i = 0; i < HIST_N_BINS; i++)
+        h->bins[i] = 0;
+}
+
+/**
+ * @brief Add a sample
+ * 
+ */
+static inline void hist_add(struct lat_hist *h, uint64_t val)
+{
+    h->cnt++;
+    h->sum += val;
+    if (val < h->min)
+        h->min = val;
+    if (val > h->max)
+        h->max = val;
+    h->bins[hist_bin(val)]++;
+}
+
+/**
+ * @brief Percentile estimate, upper bound of the bin holding it (capped at max)
+ * 
+ * @param h - histogram
+ * @param pct - percentile (0 - 100)
+ * @return 0 if empty
+ */
+static inline uint64_t hist_percentile(const struct lat_hist *h, uint32_t pct)
+{
+    uint32_t i;
+    uint64_t rank, acc = 0;
+
+    if (h->cnt == 0)
+        return 0;
+
+    // rank of the sample, 1 based
+    rank = (h->cnt * (pct > 100 ? 100 : pct) + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+
+    for (i = 0; i < HIST_N_BINS; i++) {
+        acc += h->bins[i];
+        if (acc >= rank)
+            return hist_bin_max(i) < h->max ? hist_bin_max(i) : h->max;
+    }
+
+    return h->max;
+}
+
+#endif // FPGA HIST
@@ -0,0 +1,90 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+/*
+ * User space test of the latency histograms (cc fpga_hist_test.c)
+ */
+#include <stdio.h>
+
+#include "fpga_hist.h"
+
+int main(void)
+{
+    struct lat_hist h;
+    uint64_t n = 0;
+    uint32_t i;
+
+    hist_reset(&h);
+    if (h.cnt || hist_percentile(&h, 50) != 0) {
+        printf("FAIL empty\n");
+        return 1;
+    }
+
+    // bins
+    if (hist_bin(0) != 0 || hist_bin(1) != 0 || hist_bin(2) != 1 || hist_bin(3) != 1 ||
+        hist_bin(1024) != 10 || hist_bin(~0ULL) != HIST_N_BINS - 1) {
+        printf("FAIL bins\n");
+        return 1;
+    }
+    if (hist_bin_max(0) != 1 || hist_bin_max(10) != 2047 || hist_bin_max(HIST_N_BINS - 1) != ~0ULL) {
+        printf("FAIL bin bounds\n");
+        return 1;
+    }
+
+    // 1 us .. 100 us
+    for (i = 1; i <= 100; i++)
+        hist_add(&h, i * 1000);
+
+    if (h.cnt != 100 || h.min != 1000 || h.max != 100000 || h.sum != 5050000) {
+        printf("FAIL summary\n");
+        return 1;
+    }
+
+    for (i = 0; i < HIST_N_BINS; i++)
+        n += h.bins[i];
+    if (n != h.cnt) {
+        printf("FAIL bin count %llu\n", (unsigned long long)n);
+        return 1;
+    }
+
+    // upper bound of the bin, capped at the max
+    if (hist_percentile(&h, 0) != 1023 || hist_percentile(&h, 50) != 65535 ||
+        hist_percentile(&h, 99) != 100000 || hist_percentile(&h, 100) != 100000 || hist_percentile(&h, 200) != 100000) {
+        printf("FAIL percentiles, p50 %llu, p99 %llu\n",
+            (unsigned long long)hist_percentile(&h, 50), (unsigned long long)hist_percentile(&h, 99));
+        return 1;
+    }
+
+    hist_reset(&h);
+    if (h.cnt || h.max || h.min != ~0ULL) {
+        printf("FAIL reset\n");
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
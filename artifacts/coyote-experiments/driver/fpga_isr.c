@@ -36,20 +36,19 @@
 */
 
 /**
- * @brief TLB page fault handling
+ * @brief TLB page fault handling, hard IRQ
+ * 
+ * Latches the fault and defers servicing to the IRQ thread, pinning
+ * user pages sleeps. The region stalls until the engine is restarted.
  * 
  */
 irqreturn_t fpga_tlb_miss_isr(int irq, void *dev_id)
 {
     unsigned long flags;
-    uint64_t vaddr;
-    uint32_t len;
-    int32_t cpid;
     struct fpga_dev *d;
     struct bus_drvdata *pd;
-    int ret_val = 0;
-    pid_t pid;
     uint64_t tmp;
+    uint64_t ts = ktime_get_ns();
 
     dbg_info("(irq=%d) page fault ISR\n", irq);
     BUG_ON(!dev_id);
@@ -65,37 +64,187 @@ irqreturn_t fpga_tlb_miss_isr(int irq, void *dev_id)
     spin_lock_irqsave(&(d->lock), flags);
 
     // read page fault
+    d->pf.ts_isr = ts;
     if (pd->en_avx) {
-        vaddr = d->fpga_cnfg_avx->vaddr_miss;
+        d->pf.vaddr = d->fpga_cnfg_avx->vaddr_miss;
         tmp = d->fpga_cnfg_avx->len_miss;
-        len = LOW_32(tmp);
-        cpid = (int32_t)HIGH_32(tmp);
     }
     else {
-        vaddr = d->fpga_cnfg->vaddr_miss;
+        d->pf.vaddr = d->fpga_cnfg->vaddr_miss;
         tmp = d->fpga_cnfg->len_miss;
-        len = LOW_32(tmp);
-        cpid = (int32_t)HIGH_32(tmp);
     }
+    d->pf.len = LOW_32(tmp);
+    d->pf.cpid = (int32_t)HIGH_32(tmp);
+
+    // unlock
+    spin_unlock_irqrestore(&(d->lock), flags);
+
+    return IRQ_WAKE_THREAD;
+}
+
+/**
+ * @brief TLB page fault handling, IRQ thread
+ * 
+ * Maps the fault-around window of the latched fault and restarts the engine.
+ * A fault that can't be served is not restarted, the owner gets a SIGBUS.
+ * 
+ */
+irqreturn_t fpga_tlb_miss_thread(int irq, void *dev_id)
+{
+    unsigned long flags;
+    uint64_t vaddr, start, count;
+    uint32_t len;
+    int32_t cpid;
+    struct fpga_dev *d;
+    struct bus_drvdata *pd;
+    struct pid *curr_pid;
+    struct task_struct *curr_task;
+    struct mm_struct *curr_mm;
+    struct fpga_pf_trace trace = { 0 };
+    int ret_val = 0;
+    pid_t pid;
+
+    d = (struct fpga_dev *)dev_id;
+    BUG_ON(!d);
+    pd = d->pd;
+    BUG_ON(!pd);
+
+    // oneshot, the fault can't be overwritten until we return
+    trace.ts[PF_TS_ISR] = d->pf.ts_isr;
+    trace.ts[PF_TS_THREAD] = ktime_get_ns();
+    vaddr = d->pf.vaddr;
+    len = d->pf.len;
+    cpid = d->pf.cpid;
     dbg_info("page fault, vaddr %llx, length %x, cpid %d\n", vaddr, len, cpid);
 
-    // get user pages
+    if (cpid < 0 || cpid >= N_CPID_MAX) {
+        pr_err("page fault, invalid cpid %d\n", cpid);
+        goto done;
+    }
+
+    mutex_lock(&d->mmu_lock);
+
+    // context, the task and its mm are held, the process may exit while the fault is served
     pid = d->pid_array[cpid];
-    ret_val = tlb_get_user_pages(d, vaddr, len, cpid, pid);
+    curr_pid = find_get_pid(pid);
+    curr_task = get_pid_task(curr_pid, PIDTYPE_PID);
+    put_pid(curr_pid);
+    if (!curr_task) {
+        dbg_info("page fault, no task for pid %d\n", pid);
+        goto out;
+    }
+
+    curr_mm = get_task_mm(curr_task);
+    if (!curr_mm) {
+        dbg_info("page fault, no mm for pid %d\n", pid);
+        goto out_task;
+    }
 
+    // get user pages
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+    mmap_read_lock(curr_mm);
+#else
+    down_read(&curr_mm->mmap_sem);
+#endif
+    tlb_fault_around(d, curr_mm, vaddr, len, cpid, &start, &count);
+    ret_val = tlb_pin_user_pages(d, curr_task, curr_mm, start, count, cpid, NULL, &trace);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+    mmap_read_unlock(curr_mm);
+#else
+    up_read(&curr_mm->mmap_sem);
+#endif
+
+    // unmappable, the request is failed like a cpu access to the range would be
+    if (ret_val <= 0) {
+        pr_err("page fault, vaddr %llx not mappable, pid %d\n", vaddr, pid);
+        send_sig(SIGBUS, curr_task, 0);
+    }
+
+    mmput(curr_mm);
+out_task:
+    put_task_struct(curr_task);
+out:
+    mutex_unlock(&d->mmu_lock);
+
+done:
     if (ret_val > 0) {
-        // restart the engine
+        // restart the engine, only once the miss is served, an unserved miss would fault again right away
+        spin_lock_irqsave(&(d->lock), flags);
         if (pd->en_avx)
             d->fpga_cnfg_avx->ctrl[0] = FPGA_CNFG_CTRL_IRQ_RESTART;
         else
             d->fpga_cnfg->ctrl = FPGA_CNFG_CTRL_IRQ_RESTART;
+        spin_unlock_irqrestore(&(d->lock), flags);
+
+        trace.ts[PF_TS_RESTART] = ktime_get_ns();
+        pf_stats_add(d, &trace, 1);
     }
     else {
         dbg_info("pages could not be obtained\n");
+        pf_stats_add(d, &trace, 0);
     }
 
-    // unlock
+    return IRQ_HANDLED;
+}
+
+/**
+ * @brief Set the interrupt coalescing of a vFPGA
+ * 
+ * Page faults and invalidations are not coalesced by the shell.
+ * 
+ * @param d - vFPGA
+ * @param cnt - events held before the interrupt is raised (0 - off)
+ * @param time - max cycles an event is held (0 - off)
+ */
+void fpga_irq_coal_set(struct fpga_dev *d, uint32_t cnt, uint32_t time)
+{
+    unsigned long flags;
+    uint64_t val;
+    struct bus_drvdata *pd;
+
+    BUG_ON(!d);
+    pd = d->pd;
+    BUG_ON(!pd);
+
+    d->irq_coal_cnt = min_t(uint32_t, cnt, IRQ_COAL_CNT_MASK);
+    d->irq_coal_time = time;
+    val = ((uint64_t)d->irq_coal_cnt << IRQ_COAL_CNT_SHFT) | (d->irq_coal_time & IRQ_COAL_TIME_MASK);
+
+    spin_lock_irqsave(&(d->lock), flags);
+    if (pd->en_avx)
+        ((uint64_t *)d->fpga_cnfg_avx)[FPGA_CNFG_AVX_IRQ_COAL_REG] = val;
+    else
+        ((uint64_t *)d->fpga_cnfg)[FPGA_CNFG_IRQ_COAL_REG] = val;
     spin_unlock_irqrestore(&(d->lock), flags);
 
-    return IRQ_HANDLED;
-}
\ No newline at end of file
+    dbg_info("vFPGA %d irq coalescing, cnt %d, time %d\n", d->id, d->irq_coal_cnt, d->irq_coal_time);
+}
+
+/**
+ * @brief Pin the vFPGA interrupt vector to a CPU
+ * 
+ * @param d - vFPGA
+ * @param cpu - target CPU (-1 - clear)
+ */
+int fpga_irq_affinity_set(struct fpga_dev *d, int cpu)
+{
+    int ret_val;
+
+    BUG_ON(!d);
+
+    if (d->irq <= 0)
+        return -ENODEV;
+    if (cpu >= 0 && (cpu >= nr_cpu_ids || !cpu_online(cpu)))
+        return -EINVAL;
+
+    ret_val = irq_set_affinity_hint(d->irq, cpu >= 0 ? cpumask_of(cpu) : NULL);
+    if (ret_val) {
+        pr_info("vFPGA %d IRQ#%d affinity could not be set, ret %d\n", d->id, d->irq, ret_val);
+        return ret_val;
+    }
+
+    d->irq_cpu = cpu;
+    dbg_info("vFPGA %d IRQ#%d affinity cpu %d\n", d->id, d->irq, cpu);
+
+    return 0;
+}
@@ -30,8 +30,14 @@
 
 #include "coyote_dev.h"
 #include "fpga_mmu.h"
+#include "fpga_dbg.h"
 
 /* Interrupt service routine */
 irqreturn_t fpga_tlb_miss_isr(int irq, void *dev_id);
+irqreturn_t fpga_tlb_miss_thread(int irq, void *dev_id);
+
+/* Interrupt control */
+void fpga_irq_coal_set(struct fpga_dev *d, uint32_t cnt, uint32_t time);
+int fpga_irq_affinity_set(struct fpga_dev *d, int cpu);
 
 #endif // FPGA ISR
\ No newline at end of file
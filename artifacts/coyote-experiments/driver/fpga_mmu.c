@@ -63,7 +63,7 @@ int alloc_user_buffers(struct fpga_dev *d, unsigned long n_pages, int32_t cpid)
 
     // check card
     if(pd->en_mem)
-        if (d->curr_user_buff.n_hpages > pd->num_free_lchunks)
+        if (d->curr_user_buff.n_hpages > pd->card_l.n_free)
             return -ENOMEM;
 
     d->curr_user_buff.huge = true;
@@ -302,6 +302,9 @@ int free_pr_buffers(struct fpga_dev *d, uint64_t vaddr)
 /**
  * @brief Allocate card memory
  * 
+ * Pages are taken as a single contiguous range if possible, otherwise as the
+ * largest free runs. Allocations are charged to the quota of the vFPGA.
+ * 
  * @param d - vFPGA
  * @param card_paddr - card physical address 
  * @param n_pages - number of pages to allocate
@@ -309,58 +312,77 @@ int free_pr_buffers(struct fpga_dev *d, uint64_t vaddr)
  */
 int card_alloc(struct fpga_dev *d, uint64_t *card_paddr, uint64_t n_pages, int type)
 {
-    int i;
+    int ret_val = 0;
+    uint32_t i, j, first, n_run;
+    uint32_t page_bits;
+    uint64_t offs;
+    spinlock_t *lock;
+    struct cmem_pool *pool;
     struct bus_drvdata *pd;
 
     BUG_ON(!d);
     pd = d->pd;
+    BUG_ON(!pd);
 
     switch (type) {
-    case 0: //
-        // lock
-        spin_lock(&pd->card_s_lock);
+    case SMALL_CHUNK_ALLOC: // small pages
+        lock = &pd->card_s_lock;
+        pool = &pd->card_s;
+        page_bits = STLB_PAGE_BITS;
+        offs = 0;
+        break;
+    case LARGE_CHUNK_ALLOC: // large pages
+        lock = &pd->card_l_lock;
+        pool = &pd->card_l;
+        page_bits = LTLB_PAGE_BITS;
+        offs = MEM_SEP;
+        break;
+    default: // TODO: Shared mem
+        return 0;
+    }
 
-        if(pd->num_free_schunks < n_pages) {
-            dbg_info("not enough free small card pages\n");
-            return -ENOMEM;
-        }
+    if (n_pages == 0)
+        return 0;
 
-        for(i = 0; i < n_pages; i++) {
-            pd->salloc->used = true;
-            card_paddr[i] = pd->salloc->id << STLB_PAGE_BITS;
-            dbg_info("user card buffer allocated @ %llx device %d\n", card_paddr[i], d->id);
-            pd->salloc = pd->salloc->next;
-        }
+    // lock
+    spin_lock(lock);
 
-        // release lock
-        spin_unlock(&pd->card_s_lock);
+    if (pd->card_used[type][d->id] + n_pages > pd->card_quota[type][d->id]) {
+        dbg_info("card memory quota exceeded, device %d\n", d->id);
+        ret_val = -EDQUOT;
+        goto out;
+    }
 
-        break;
-    case 1:
-        // lock
-        spin_lock(&pd->card_l_lock);
+    if (pool->n_free < n_pages) {
+        dbg_info("not enough free card pages, type %d\n", type);
+        ret_val = -ENOMEM;
+        goto out;
+    }
 
-        if(pd->num_free_lchunks < n_pages) {
-            dbg_info("not enough free large card pages\n");
-            return -ENOMEM;
-        }
+    if (cmem_alloc(pool, n_pages, &first) == 0) {
+        // contiguous
+        for (i = 0; i < n_pages; i++)
+            card_paddr[i] = ((uint64_t)(first + i) << page_bits) + offs;
+    } else {
+        // fragmented, largest runs first
+        for (i = 0; i < n_pages; i += n_run) {
+            n_run = cmem_alloc_run(pool, n_pages - i, &first);
+            BUG_ON(!n_run);
 
-        for(i = 0; i < n_pages; i++) {
-            pd->lalloc->used = true;
-            card_paddr[i] = (pd->lalloc->id << LTLB_PAGE_BITS) + MEM_SEP;
-            dbg_info("user card buffer allocated @ %llx device %d\n", card_paddr[i], d->id);
-            pd->lalloc = pd->lalloc->next;
+            for (j = 0; j < n_run; j++)
+                card_paddr[i + j] = ((uint64_t)(first + j) << page_bits) + offs;
         }
+        dbg_info("card memory fragmented, %llu pages not contiguous\n", n_pages);
+    }
 
-        // release lock
-        spin_unlock(&pd->card_l_lock);
+    pd->card_used[type][d->id] += n_pages;
+    dbg_info("user card buffer allocated @ %llx, %llu pages, device %d\n", card_paddr[0], n_pages, d->id);
 
-        break;
-    default: // TODO: Shared mem
-        break;
-    }
+out:
+    // release lock
+    spin_unlock(lock);
 
-    return 0;
+    return ret_val;
 }
 
 /**
@@ -373,8 +395,11 @@ int card_alloc(struct fpga_dev *d, uint64_t *card_paddr, uint64_t n_pages, int t
  */
 void card_free(struct fpga_dev *d, uint64_t *card_paddr, uint64_t n_pages, int type)
 {
-    int i;
-    uint64_t tmp_id;
+    uint32_t i, j;
+    uint32_t page_bits;
+    uint64_t offs;
+    spinlock_t *lock;
+    struct cmem_pool *pool;
     struct bus_drvdata *pd;
 
     BUG_ON(!d);
@@ -382,44 +407,40 @@ void card_free(struct fpga_dev *d, uint64_t *card_paddr, uint64_t n_pages, int t
     BUG_ON(!pd);
 
     switch (type) {
-    case 0: // small pages
-        // lock
-        spin_lock(&pd->card_s_lock);
-
-        for(i = n_pages - 1; i >= 0; i--) {
-            tmp_id = card_paddr[i] >> STLB_PAGE_BITS;
-            if(pd->schunks[tmp_id].used) {
-                pd->schunks[tmp_id].next = pd->salloc;
-                pd->salloc = &pd->schunks[tmp_id];
-            }
-        }
-
-        // release lock
-        spin_unlock(&pd->card_s_lock);
-
+    case SMALL_CHUNK_ALLOC: // small pages
+        lock = &pd->card_s_lock;
+        pool = &pd->card_s;
+        page_bits = STLB_PAGE_BITS;
+        offs = 0;
         break;
-    case 1: // large pages
-        // lock
-        spin_lock(&pd->card_l_lock);
+    case LARGE_CHUNK_ALLOC: // large pages
+        lock = &pd->card_l_lock;
+        pool = &pd->card_l;
+        page_bits = LTLB_PAGE_BITS;
+        offs = MEM_SEP;
+        break;
+    default:
+        return;
+    }
 
-        for(i = n_pages - 1; i >= 0; i--) {
-            tmp_id = (card_paddr[i] - MEM_SEP) >> LTLB_PAGE_BITS;
-            if(pd->lchunks[tmp_id].used) {
-                pd->lchunks[tmp_id].next = pd->lalloc;
-                pd->lalloc = &pd->lchunks[tmp_id];
-            }
-        }
+    // lock
+    spin_lock(lock);
 
-        // release lock
-        spin_unlock(&pd->card_l_lock);
+    // contiguous runs
+    for (i = 0; i < n_pages; i = j) {
+        for (j = i + 1; j < n_pages && card_paddr[j] == card_paddr[j - 1] + (1ULL << page_bits); j++);
 
-        break;
-    default:
-        break;
+        if (cmem_free(pool, (card_paddr[i] - offs) >> page_bits, j - i))
+            pr_warn("card memory @ %llx could not be freed, device %d\n", card_paddr[i], d->id);
     }
+
+    pd->card_used[type][d->id] -= min_t(uint64_t, n_pages, pd->card_used[type][d->id]);
+
+    // release lock
+    spin_unlock(lock);
 }
 
- /**
+/**
  * @brief Page map list
  * 
  * @param vaddr - starting vaddr
@@ -475,6 +496,32 @@ void tlb_create_unmap(struct tlb_order *tlb_ord, uint64_t vaddr, int32_t cpid, u
     dbg_info("unmapping TLB entry, vaddr %llx, cpid %d, hugepage %d\n", vaddr, cpid, tlb_ord->hugepage);
 }
 
+/**
+ * @brief Range invalidation command
+ * 
+ * @param vaddr - starting vaddr
+ * @param n_pages - number of TLB pages
+ * @param cpid - Coyote PID
+ * @param entry - list entry
+ */
+void tlb_create_unmap_range(struct tlb_order *tlb_ord, uint64_t vaddr, uint32_t n_pages, int32_t cpid, uint64_t *entry)
+{
+    tlb_create_unmap(tlb_ord, vaddr, cpid, entry);
+    entry[1] = ((uint64_t)TLB_CMD_INV_RANGE << TLB_CMD_SHFT) | (n_pages & TLB_CMD_LEN_MASK);
+}
+
+/**
+ * @brief Cpid invalidation command
+ * 
+ * @param cpid - Coyote PID
+ * @param entry - list entry
+ */
+void tlb_create_unmap_cpid(struct tlb_order *tlb_ord, int32_t cpid, uint64_t *entry)
+{
+    tlb_create_unmap(tlb_ord, 0, cpid, entry);
+    entry[1] = (uint64_t)TLB_CMD_INV_CPID << TLB_CMD_SHFT;
+}
+
 /**
  * @brief Map TLB
  * 
@@ -528,170 +575,259 @@ void tlb_service_dev(struct fpga_dev *d, struct tlb_order *tlb_ord, uint64_t* ma
 }
 
 /**
- * @brief Release all remaining user pages
+ * @brief Issue an invalidation command and wait for its sweep
+ * 
+ * The command is a posted write, completion is taken from the count of finished
+ * commands of the TLB. Pages may only be released once this returns 0.
  * 
  * @param d - vFPGA
- * @param dirtied - modified
+ * @param tlb_ord - TLB order
+ * @param map_cmd - range or cpid command
  */
-int tlb_put_user_pages_all(struct fpga_dev *d, int dirtied)
+int tlb_service_cmd(struct fpga_dev *d, struct tlb_order *tlb_ord, uint64_t *map_cmd)
 {
-    int i, bkt;
-    struct user_pages *tmp_buff;
-    uint64_t vaddr_tmp;
-    int32_t cpid_tmp;
-    uint64_t *map_array;
+    volatile uint64_t *tlb;
+    uint32_t inv_cnt;
+    uint64_t waited = 0;
     struct bus_drvdata *pd;
 
     BUG_ON(!d);
     pd = d->pd;
     BUG_ON(!pd);
 
-    hash_for_each(user_sbuff_map[d->id], bkt, tmp_buff, entry) {
-        
-        // release host pages
-        if(dirtied)
-            for(i = 0; i < tmp_buff->n_hpages; i++)
-                SetPageDirty(tmp_buff->hpages[i]);
+    tlb = tlb_ord->hugepage ? d->fpga_lTlb : d->fpga_sTlb;
 
-        for(i = 0; i < tmp_buff->n_hpages; i++)
-            put_page(tmp_buff->hpages[i]);
+    // lock
+    spin_lock(&pd->tlb_lock);
 
-        kfree(tmp_buff->hpages);
+    inv_cnt = (uint32_t)tlb[TLB_INV_CNT_REG];
+    tlb[0] = map_cmd[0];
+    tlb[1] = map_cmd[1];
 
-        // release card pages
-        if(pd->en_mem) {
-            if(tmp_buff->huge)
-                card_free(d, tmp_buff->cpages, tmp_buff->n_pages, LARGE_CHUNK_ALLOC);
-            else
-                card_free(d, tmp_buff->cpages, tmp_buff->n_pages, SMALL_CHUNK_ALLOC);
+    // poll
+    while ((uint32_t)tlb[TLB_INV_CNT_REG] == inv_cnt) {
+        if (waited >= TLB_INV_TIMEOUT_NS) {
+            spin_unlock(&pd->tlb_lock);
+            pr_err("TLB invalidation timed out, hugepage %d\n", tlb_ord->hugepage);
+            return -ETIMEDOUT;
         }
+        ndelay(TLB_INV_POLL_NS);
+        waited += TLB_INV_POLL_NS;
+    }
 
-        // unmap from TLB
-        vaddr_tmp = tmp_buff->vaddr;
-        cpid_tmp = tmp_buff->cpid;
+    // unlock
+    spin_unlock(&pd->tlb_lock);
 
-        // map array
-        map_array = (uint64_t *)kzalloc(tmp_buff->n_pages * 2 * sizeof(uint64_t), GFP_KERNEL);
-        if (map_array == NULL) {
-            dbg_info("map buffers could not be allocated\n");
-            return -ENOMEM;
-        }
+    return 0;
+}
 
-        // huge pages
-        if(tmp_buff->huge) {
-            // fill mappings
-            for (i = 0; i < tmp_buff->n_pages; i++) {
-                tlb_create_unmap(pd->ltlb_order, vaddr_tmp, cpid_tmp, &map_array[2*i]);
-                vaddr_tmp += pd->ltlb_order->page_size;
-            }
+/**
+ * @brief Invalidate the TLB entries of a buffer
+ * 
+ * One range command if batching is enabled, per page entries otherwise.
+ * 
+ * @param d - vFPGA
+ * @param buff - mapped buffer
+ */
+int tlb_unmap_buff(struct fpga_dev *d, struct user_pages *buff)
+{
+    int i;
+    uint64_t vaddr_tmp;
+    uint64_t *map_array;
+    uint64_t map_cmd[2] = { 0, 0 };
+    struct tlb_order *tlb_ord;
+    struct bus_drvdata *pd;
 
-            // fire
-            tlb_service_dev(d, pd->ltlb_order, map_array, tmp_buff->n_pages);
+    BUG_ON(!d);
+    pd = d->pd;
+    BUG_ON(!pd);
 
-        // small pages
-        } else {
-            // fill mappings
-            for (i = 0; i < tmp_buff->n_pages; i++) {
-                tlb_create_unmap(pd->stlb_order, vaddr_tmp, cpid_tmp, &map_array[2*i]);
-                vaddr_tmp += PAGE_SIZE;
-            }
+    tlb_ord = buff->huge ? pd->ltlb_order : pd->stlb_order;
 
-            // fire
-            tlb_service_dev(d, pd->stlb_order, map_array, tmp_buff->n_pages);
-        }
+    // single command
+    if (tlb_inv_batch) {
+        tlb_create_unmap_range(tlb_ord, buff->vaddr, buff->n_pages, buff->cpid, map_cmd);
+        return tlb_service_cmd(d, tlb_ord, map_cmd);
+    }
 
-        // free
-        kfree((void *)map_array);
+    // map array
+    map_array = (uint64_t *)kzalloc(buff->n_pages * 2 * sizeof(uint64_t), GFP_KERNEL);
+    if (map_array == NULL) {
+        dbg_info("map buffers could not be allocated\n");
+        return -ENOMEM;
+    }
 
-        // remove from map
-        hash_del(&tmp_buff->entry);
+    // fill mappings
+    vaddr_tmp = buff->vaddr;
+    for (i = 0; i < buff->n_pages; i++) {
+        tlb_create_unmap(tlb_ord, vaddr_tmp, buff->cpid, &map_array[2*i]);
+        vaddr_tmp += tlb_ord->page_size;
     }
 
+    // fire
+    tlb_service_dev(d, tlb_ord, map_array, buff->n_pages);
+
+    // free
+    kfree((void *)map_array);
+
     return 0;
 }
 
 /**
- * @brief Release user pages (cpid)
+ * @brief Invalidate all TLB entries of a cpid
  * 
  * @param d - vFPGA
  * @param cpid - Coyote PID
- * @param dirtied - modified
  */
-int tlb_put_user_pages_cpid(struct fpga_dev *d, int32_t cpid, int dirtied)
+int tlb_unmap_cpid(struct fpga_dev *d, int32_t cpid)
 {
-    int i, bkt;
-    struct user_pages *tmp_buff;
-    uint64_t vaddr_tmp;
-    uint64_t *map_array;
+    int ret_val;
+    uint64_t map_cmd[2];
     struct bus_drvdata *pd;
 
     BUG_ON(!d);
     pd = d->pd;
     BUG_ON(!pd);
 
-    hash_for_each(user_sbuff_map[d->id], bkt, tmp_buff, entry) {
-        if(tmp_buff->cpid == cpid) {
+    map_cmd[0] = map_cmd[1] = 0;
+    tlb_create_unmap_cpid(pd->stlb_order, cpid, map_cmd);
+    ret_val = tlb_service_cmd(d, pd->stlb_order, map_cmd);
 
-            // release host pages
-            if(dirtied)
-                for(i = 0; i < tmp_buff->n_hpages; i++)
-                    SetPageDirty(tmp_buff->hpages[i]);
+    map_cmd[0] = map_cmd[1] = 0;
+    tlb_create_unmap_cpid(pd->ltlb_order, cpid, map_cmd);
+    if (tlb_service_cmd(d, pd->ltlb_order, map_cmd))
+        ret_val = -ETIMEDOUT;
 
-            for(i = 0; i < tmp_buff->n_hpages; i++)
-                put_page(tmp_buff->hpages[i]);
+    return ret_val;
+}
 
-            kfree(tmp_buff->hpages);
+/**
+ * @brief Release host and card pages of a buffer
+ * 
+ * Only once the TLB entries are gone. If the invalidation could not be confirmed
+ * the pages stay pinned and allocated, the FPGA may still access them.
+ * 
+ * @param d - vFPGA
+ * @param buff - mapped buffer
+ * @param dirtied - modified
+ * @param unmapped - TLB invalidation completed
+ */
+static void tlb_release_buff(struct fpga_dev *d, struct user_pages *buff, int dirtied, int unmapped)
+{
+    int i;
+    struct bus_drvdata *pd = d->pd;
 
-            // release card pages
-            if(pd->en_mem) {
-                if(tmp_buff->huge)
-                    card_free(d, tmp_buff->cpages, tmp_buff->n_pages, LARGE_CHUNK_ALLOC);
-                else
-                    card_free(d, tmp_buff->cpages, tmp_buff->n_pages, SMALL_CHUNK_ALLOC);
-            }
+    if (!unmapped) {
+        pr_err("buffer vaddr %llx, cpid %d still mapped, pages not released\n", buff->vaddr, buff->cpid);
+        kfree(buff->hpages);
+        return;
+    }
 
-            // unmap from TLB
-            vaddr_tmp = tmp_buff->vaddr;
+    // release host pages
+    if(dirtied)
+        for(i = 0; i < buff->n_hpages; i++)
+            SetPageDirty(buff->hpages[i]);
 
-            // map array
-            map_array = (uint64_t *)kzalloc(tmp_buff->n_pages * 2 * sizeof(uint64_t), GFP_KERNEL);
-            if (map_array == NULL) {
-                dbg_info("map buffers could not be allocated\n");
-                return -ENOMEM;
-            }
+    for(i = 0; i < buff->n_hpages; i++)
+        put_page(buff->hpages[i]);
 
-            // huge pages
-            if(tmp_buff->huge) {
-                // fill mappings
-                for (i = 0; i < tmp_buff->n_pages; i++) {
-                    tlb_create_unmap(pd->ltlb_order, vaddr_tmp, cpid, &map_array[2*i]);
-                    vaddr_tmp += pd->ltlb_order->page_size;
-                }
+    kfree(buff->hpages);
 
-                // fire
-                tlb_service_dev(d, pd->ltlb_order, map_array, tmp_buff->n_pages);
+    // release card pages
+    if(pd->en_mem) {
+        if(buff->huge)
+            card_free(d, buff->cpages, buff->n_pages, LARGE_CHUNK_ALLOC);
+        else
+            card_free(d, buff->cpages, buff->n_pages, SMALL_CHUNK_ALLOC);
+    }
+}
 
-            // small pages
-            } else {
-                // fill mappings
-                for (i = 0; i < tmp_buff->n_pages; i++) {
-                    tlb_create_unmap(pd->stlb_order, vaddr_tmp, cpid, &map_array[2*i]);
-                    vaddr_tmp += PAGE_SIZE;
-                }
-
-                // fire
-                tlb_service_dev(d, pd->stlb_order, map_array, tmp_buff->n_pages);
-            }
+/**
+ * @brief Release all remaining user pages
+ * 
+ * With batching, the TLBs are invalidated with one command per cpid.
+ * 
+ * @param d - vFPGA
+ * @param dirtied - modified
+ */
+int tlb_put_user_pages_all(struct fpga_dev *d, int dirtied)
+{
+    int i, bkt;
+    int ret_val = 0;
+    uint64_t cpids = 0, failed = 0;
+    struct user_pages *tmp_buff;
+    struct hlist_node *tmp_node;
 
-            // free
-            kfree((void *)map_array);
+    BUG_ON(!d);
+
+    // unmap from TLB, completes before any page is released
+    hash_for_each(user_sbuff_map[d->id], bkt, tmp_buff, entry) {
+        if (tlb_inv_batch)
+            cpids |= 1ULL << tmp_buff->cpid;
+        else if (tlb_unmap_buff(d, tmp_buff))
+            ret_val = -ENOMEM;
+    }
+
+    for (i = 0; i < N_CPID_MAX; i++) {
+        if ((cpids & (1ULL << i)) && tlb_unmap_cpid(d, i)) {
+            failed |= 1ULL << i;
+            ret_val = -ETIMEDOUT;
+        }
+    }
+
+    hash_for_each_safe(user_sbuff_map[d->id], bkt, tmp_node, tmp_buff, entry) {
+        tlb_release_buff(d, tmp_buff, dirtied, !(failed & (1ULL << tmp_buff->cpid)));
+
+        // remove from map
+        hash_del(&tmp_buff->entry);
+        kfree(tmp_buff);
+    }
+
+    return ret_val;
+}
+
+/**
+ * @brief Release user pages (cpid)
+ * 
+ * @param d - vFPGA
+ * @param cpid - Coyote PID
+ * @param dirtied - modified
+ */
+int tlb_put_user_pages_cpid(struct fpga_dev *d, int32_t cpid, int dirtied)
+{
+    int bkt;
+    int ret_val = 0;
+    bool mapped = false, unmapped = true;
+    struct user_pages *tmp_buff;
+    struct hlist_node *tmp_node;
+
+    BUG_ON(!d);
+
+    // unmap from TLB, completes before any page is released
+    hash_for_each(user_sbuff_map[d->id], bkt, tmp_buff, entry) {
+        if(tmp_buff->cpid == cpid) {
+            if (!tlb_inv_batch && tlb_unmap_buff(d, tmp_buff))
+                ret_val = -ENOMEM;
+            mapped = true;
+        }
+    }
+
+    if (tlb_inv_batch && mapped && tlb_unmap_cpid(d, cpid)) {
+        unmapped = false;
+        ret_val = -ETIMEDOUT;
+    }
+
+    hash_for_each_safe(user_sbuff_map[d->id], bkt, tmp_node, tmp_buff, entry) {
+        if(tmp_buff->cpid == cpid) {
+            tlb_release_buff(d, tmp_buff, dirtied, unmapped);
 
             // remove from map
             hash_del(&tmp_buff->entry);
+            kfree(tmp_buff);
         }
     }
 
-    return 0;
+    return ret_val;
 }
 
 /**
@@ -704,79 +840,167 @@ int tlb_put_user_pages_cpid(struct fpga_dev *d, int32_t cpid, int dirtied)
  */
 int tlb_put_user_pages(struct fpga_dev *d, uint64_t vaddr, int32_t cpid, int dirtied)
 {
-    int i;
+    int ret_val = 0;
+    int ret_unmap;
     struct user_pages *tmp_buff;
-    uint64_t vaddr_tmp;
-    uint64_t *map_array;
+    struct hlist_node *tmp_node;
+
+    BUG_ON(!d);
+
+    hash_for_each_possible_safe(user_sbuff_map[d->id], tmp_buff, tmp_node, entry, vaddr) {
+        if(tmp_buff->vaddr == vaddr && tmp_buff->cpid == cpid) {
+            // unmap from TLB, the range command is waited on
+            ret_unmap = tlb_unmap_buff(d, tmp_buff);
+            if (ret_unmap)
+                ret_val = ret_unmap;
+
+            tlb_release_buff(d, tmp_buff, dirtied, ret_unmap != -ETIMEDOUT);
+
+            // remove from map
+            hash_del(&tmp_buff->entry);
+            kfree(tmp_buff);
+        }
+    }
+
+    return ret_val;
+}
+
+/**
+ * @brief Fault-around window of a TLB miss
+ * 
+ * Extends the faulting range according to the fault-around policy. The window stays within
+ * the faulting vma and does not overlap buffers already mapped for this cpid.
+ * Called with the mmap lock held.
+ * 
+ * @param d - vFPGA
+ * @param mm - faulting mm
+ * @param vaddr - faulting vaddr
+ * @param len - faulting length
+ * @param cpid - Coyote PID
+ * @param start - window start
+ * @param count - window length
+ */
+void tlb_fault_around(struct fpga_dev *d, struct mm_struct *mm, uint64_t vaddr, uint32_t len, int32_t cpid, uint64_t *start, uint64_t *count)
+{
+    int bkt;
+    struct vm_area_struct *vma;
+    struct user_pages *tmp_buff;
+    struct pfa_cnfg cnfg;
+    uint32_t page_shift, max_pages, n_pages;
+    uint64_t lo, hi, buff_end, first;
     struct bus_drvdata *pd;
 
     BUG_ON(!d);
     pd = d->pd;
     BUG_ON(!pd);
 
-    hash_for_each_possible(user_sbuff_map[d->id], tmp_buff, entry, vaddr) {
-        if(tmp_buff->vaddr == vaddr && tmp_buff->cpid == cpid) {
+    *start = vaddr;
+    *count = len;
 
-            // release host pages
-            if(dirtied)
-                for(i = 0; i < tmp_buff->n_hpages; i++)
-                    SetPageDirty(tmp_buff->hpages[i]);
+    if (!pfa_en || cpid < 0 || cpid >= N_CPID_MAX)
+        return;
 
-            for(i = 0; i < tmp_buff->n_hpages; i++)
-                put_page(tmp_buff->hpages[i]);
+    vma = find_vma(mm, vaddr);
+    if (!vma || vma->vm_start > vaddr)
+        return;
 
-            kfree(tmp_buff->hpages);
+    // window limits
+    if (is_vm_hugetlb_page(vma)) {
+        page_shift = pd->ltlb_order->page_shift;
+        max_pages = MAX_N_MAP_HUGE_PAGES >> (page_shift - PAGE_SHIFT);
+    } else {
+        page_shift = PAGE_SHIFT;
+        max_pages = MAX_N_MAP_PAGES;
+    }
 
-            // release card pages
-            if(pd->en_mem) {
-                if(tmp_buff->huge)
-                    card_free(d, tmp_buff->cpages, tmp_buff->n_pages, LARGE_CHUNK_ALLOC);
-                else
-                    card_free(d, tmp_buff->cpages, tmp_buff->n_pages, SMALL_CHUNK_ALLOC);
-            }
+    lo = vma->vm_start;
+    hi = vma->vm_end;
+    hash_for_each(user_sbuff_map[d->id], bkt, tmp_buff, entry) {
+        if (tmp_buff->cpid != cpid)
+            continue;
+
+        buff_end = tmp_buff->vaddr + (tmp_buff->n_hpages << PAGE_SHIFT);
+        if (tmp_buff->vaddr > vaddr && tmp_buff->vaddr < hi)
+            hi = tmp_buff->vaddr;
+        if (buff_end <= vaddr && buff_end > lo)
+            lo = buff_end;
+    }
 
-            // unmap from TLB
-            vaddr_tmp = vaddr;
+    cnfg.win_min = pfa_win_min > 0 ? pfa_win_min : 1;
+    cnfg.win_max = pfa_win_max > 0 ? min_t(uint32_t, pfa_win_max, max_pages) : 1;
+    cnfg.stride_depth = pfa_stride_depth > 0 ? pfa_stride_depth : 0;
 
-            // map array
-            map_array = (uint64_t *)kzalloc(tmp_buff->n_pages * 2 * sizeof(uint64_t), GFP_KERNEL);
-            if (map_array == NULL) {
-                dbg_info("map buffers could not be allocated\n");
-                return -ENOMEM;
-            }
+    n_pages = pfa_window(&d->pfa[cpid], &cnfg, vaddr, len, page_shift, lo, hi, &first);
 
-            // huge pages
-            if(tmp_buff->huge) {
-                // fill mappings
-                for (i = 0; i < tmp_buff->n_pages; i++) {
-                    tlb_create_unmap(pd->ltlb_order, vaddr_tmp, cpid, &map_array[2*i]);
-                    vaddr_tmp += pd->ltlb_order->page_size;
-                }
+    *start = first << page_shift;
+    *count = (uint64_t)n_pages << page_shift;
 
-                // fire
-                tlb_service_dev(d, pd->ltlb_order, map_array, tmp_buff->n_pages);
+    dbg_info("fault-around, vaddr %llx, length %x, window %llx - %llx, pattern %d\n",
+        vaddr, len, *start, *start + *count, d->pfa[cpid].pattern);
+}
 
-            // small pages
-            } else {
-                // fill mappings
-                for (i = 0; i < tmp_buff->n_pages; i++) {
-                    tlb_create_unmap(pd->stlb_order, vaddr_tmp, cpid, &map_array[2*i]);
-                    vaddr_tmp += PAGE_SIZE;
-                }
-
-                // fire
-                tlb_service_dev(d, pd->stlb_order, map_array, tmp_buff->n_pages);
-            }
+/**
+ * @brief Init a TLB batch
+ * 
+ * @param batch - batch
+ */
+int tlb_batch_init(struct tlb_batch *batch)
+{
+    batch->n_pages[SMALL_CHUNK_ALLOC] = 0;
+    batch->n_pages[LARGE_CHUNK_ALLOC] = 0;
+
+    // physically contiguous, pulled by the TLBF DMA
+    batch->map_array[SMALL_CHUNK_ALLOC] = (uint64_t *)kzalloc(TLB_BATCH_PAGES * 2 * sizeof(uint64_t), GFP_KERNEL);
+    batch->map_array[LARGE_CHUNK_ALLOC] = (uint64_t *)kzalloc(TLB_BATCH_PAGES * 2 * sizeof(uint64_t), GFP_KERNEL);
+    if (!batch->map_array[SMALL_CHUNK_ALLOC] || !batch->map_array[LARGE_CHUNK_ALLOC]) {
+        tlb_batch_free(batch);
+        return -ENOMEM;
+    }
 
-            // free
-            kfree((void *)map_array);
+    return 0;
+}
 
-            // remove from map
-            hash_del(&tmp_buff->entry);
-        }
+/**
+ * @brief Program all batched entries, one bulk transfer per TLB
+ * 
+ * @param d - vFPGA
+ * @param batch - batch
+ */
+void tlb_batch_flush(struct fpga_dev *d, struct tlb_batch *batch)
+{
+    struct bus_drvdata *pd = d->pd;
+
+    if (batch->n_pages[SMALL_CHUNK_ALLOC]) {
+        tlb_service_dev(d, pd->stlb_order, batch->map_array[SMALL_CHUNK_ALLOC], batch->n_pages[SMALL_CHUNK_ALLOC]);
+        batch->n_pages[SMALL_CHUNK_ALLOC] = 0;
     }
+    if (batch->n_pages[LARGE_CHUNK_ALLOC]) {
+        tlb_service_dev(d, pd->ltlb_order, batch->map_array[LARGE_CHUNK_ALLOC], batch->n_pages[LARGE_CHUNK_ALLOC]);
+        batch->n_pages[LARGE_CHUNK_ALLOC] = 0;
+    }
+}
 
-    return 0;
+/**
+ * @brief Release a TLB batch (not flushed)
+ * 
+ * @param batch - batch
+ */
+void tlb_batch_free(struct tlb_batch *batch)
+{
+    kfree(batch->map_array[SMALL_CHUNK_ALLOC]);
+    kfree(batch->map_array[LARGE_CHUNK_ALLOC]);
+    batch->map_array[SMALL_CHUNK_ALLOC] = NULL;
+    batch->map_array[LARGE_CHUNK_ALLOC] = NULL;
+}
+
+/* Append entries, flushes if the batch is full */
+static void tlb_batch_add(struct fpga_dev *d, struct tlb_batch *batch, int type, uint64_t *map_array, uint32_t n_pages)
+{
+    if (batch->n_pages[type] + n_pages > TLB_BATCH_PAGES)
+        tlb_batch_flush(d, batch);
+
+    memcpy(&batch->map_array[type][2 * batch->n_pages[type]], map_array, n_pages * 2 * sizeof(uint64_t));
+    batch->n_pages[type] += n_pages;
 }
 
 /** 
@@ -789,6 +1013,74 @@ int tlb_put_user_pages(struct fpga_dev *d, uint64_t vaddr, int32_t cpid, int dir
  * @param pid - user PID
  */
 int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t cpid, pid_t pid)
+{
+    return tlb_get_user_pages_batch(d, start, count, cpid, pid, NULL);
+}
+
+/**
+ * @brief Map a vector of ranges
+ * 
+ * TLB entries of all ranges are collected and programmed in bulk. A range maps at most
+ * MAX_N_MAP_PAGES, its status holds the mapped length. Every mapping is released by its
+ * own starting vaddr, so the remainder is mapped by the caller in a further range.
+ * 
+ * @param d - vFPGA
+ * @param ranges - ranges, status is set to the mapped length or an error
+ * @param n_ranges - number of ranges
+ * @param cpid - Coyote PID
+ * @param pid - user PID
+ * @return number of ranges mapped
+ */
+int tlb_get_user_pages_vec(struct fpga_dev *d, struct tlb_map_range *ranges, uint32_t n_ranges, int32_t cpid, pid_t pid)
+{
+    int ret_val;
+    uint32_t i, n_mapped = 0;
+    uint64_t mapped;
+    struct tlb_batch batch;
+
+    ret_val = tlb_batch_init(&batch);
+    if (ret_val)
+        return ret_val;
+
+    for (i = 0; i < n_ranges; i++) {
+        if (ranges[i].len == 0) {
+            ranges[i].status = -EINVAL;
+            continue;
+        }
+
+        ret_val = tlb_get_user_pages_batch(d, ranges[i].vaddr, ranges[i].len, cpid, pid, &batch);
+        if (ret_val > 0) {
+            // pages are capped per mapping, the caller maps the rest
+            mapped = ((uint64_t)ret_val << PAGE_SHIFT) - (ranges[i].vaddr & ~PAGE_MASK);
+            ranges[i].status = min_t(uint64_t, mapped, ranges[i].len);
+            n_mapped++;
+        } else {
+            ranges[i].status = ret_val ? ret_val : -EINVAL;
+        }
+    }
+
+    tlb_batch_flush(d, &batch);
+    tlb_batch_free(&batch);
+
+    dbg_info("vectored mapping, %d out of %d ranges mapped, cpid %d\n", n_mapped, n_ranges, cpid);
+
+    return n_mapped;
+}
+
+/** 
+ * @brief Pin user pages and fill TLB, the task, its mm and the mmap lock are held by the caller
+ * 
+ * @param d - vFPGA
+ * @param curr_task - user task
+ * @param curr_mm - user mm
+ * @param start - starting vaddr
+ * @param count - number of pages to map
+ * @param cpid - Coyote PID
+ * @param batch - TLB batch (NULL - program immediately)
+ * @param trace - page fault trace, stamped after pinning and mapping (NULL - not a fault)
+ */
+int tlb_pin_user_pages(struct fpga_dev *d, struct task_struct *curr_task, struct mm_struct *curr_mm,
+    uint64_t start, size_t count, int32_t cpid, struct tlb_batch *batch, struct fpga_pf_trace *trace)
 {
     int ret_val = 0, i, j;
     int n_pages, n_pages_huge;
@@ -799,8 +1091,6 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
     int hugepages;
     uint64_t *hpages_phys;
     uint64_t curr_vaddr, last_vaddr;
-    struct task_struct *curr_task;
-    struct mm_struct *curr_mm;
     uint64_t *map_array;
     uint64_t vaddr_tmp;
     struct bus_drvdata *pd;
@@ -809,13 +1099,12 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
     pd = d->pd;
     BUG_ON(!pd);
 
-    // context
-    curr_task = pid_task(find_vpid(pid), PIDTYPE_PID);
-    dbg_info("pid found = %d", pid);
-    curr_mm = curr_task->mm;
-
     // hugepages?
     vma_area_init = find_vma(curr_mm, start);
+    if (!vma_area_init || vma_area_init->vm_start > start) {
+        dbg_info("no vma for vaddr %llx\n", start);
+        return -EFAULT;
+    }
     hugepages = is_vm_hugetlb_page(vma_area_init);
 
     // number of pages
@@ -824,8 +1113,10 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
     n_pages = last - first + 1;
 
     if(hugepages) {
+        // capped mappings end on a huge page, the remainder never shares one with this mapping
         if(n_pages > MAX_N_MAP_HUGE_PAGES)
-            n_pages = MAX_N_MAP_HUGE_PAGES;
+            n_pages = ((((start & PAGE_MASK) + ((uint64_t)MAX_N_MAP_HUGE_PAGES << PAGE_SHIFT)) & pd->ltlb_order->page_mask) -
+                (start & PAGE_MASK)) >> PAGE_SHIFT;
     } else {
         if(n_pages > MAX_N_MAP_PAGES)
             n_pages = MAX_N_MAP_PAGES;
@@ -872,6 +1163,11 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
     for(i = 0; i < n_pages; i++)
         flush_dcache_page(user_pg->hpages[i]);
 
+    if (trace) {
+        trace->ts[PF_TS_PINNED] = ktime_get_ns();
+        trace->huge = hugepages;
+    }
+
     // add mapped entry
     user_pg->vaddr = start;
     user_pg->n_hpages = n_pages;
@@ -881,8 +1177,9 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
 
     // huge pages
     if (hugepages) {
+        // pinned range only, count may be capped
         first = (start & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift;
-        last = ((start + count - 1) & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift;
+        last = (((start & PAGE_MASK) + ((uint64_t)n_pages << PAGE_SHIFT) - 1) & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift;
         n_pages_huge = last - first + 1;
         user_pg->n_pages = n_pages_huge;
 
@@ -936,7 +1233,10 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
         }
 
         // fire
-        tlb_service_dev(d, pd->ltlb_order, map_array, n_pages_huge);
+        if (batch)
+            tlb_batch_add(d, batch, LARGE_CHUNK_ALLOC, map_array, n_pages_huge);
+        else
+            tlb_service_dev(d, pd->ltlb_order, map_array, n_pages_huge);
 
         // free
         kfree((void *)map_array);
@@ -975,12 +1275,17 @@ int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t
         }
 
         // fire
-        tlb_service_dev(d, pd->stlb_order, map_array, n_pages);
+        if (batch)
+            tlb_batch_add(d, batch, SMALL_CHUNK_ALLOC, map_array, n_pages);
+        else
+            tlb_service_dev(d, pd->stlb_order, map_array, n_pages);
 
         // free
         kfree((void *)map_array);
     }
 
+    if (trace)
+        trace->ts[PF_TS_MAPPED] = ktime_get_ns();
     hash_add(user_sbuff_map[d->id], &user_pg->entry, start);
 
     return n_pages;
@@ -1005,4 +1310,55 @@ fail_card_unmap:
     kfree(user_pg->cpages);
 
     return -ENOMEM;
+}
+
+/** 
+ * @brief Get user pages and fill TLB, entries are appended to the batch if passed
+ * 
+ * @param d - vFPGA
+ * @param start - starting vaddr
+ * @param count - number of pages to map
+ * @param cpid - Coyote PID
+ * @param pid - user PID
+ * @param batch - TLB batch (NULL - program immediately)
+ */
+int tlb_get_user_pages_batch(struct fpga_dev *d, uint64_t start, size_t count, int32_t cpid, pid_t pid, struct tlb_batch *batch)
+{
+    int ret_val;
+    struct pid *curr_pid;
+    struct task_struct *curr_task;
+    struct mm_struct *curr_mm;
+
+    // context, held while the pages are pinned, the process may exit meanwhile
+    curr_pid = find_get_pid(pid);
+    curr_task = get_pid_task(curr_pid, PIDTYPE_PID);
+    put_pid(curr_pid);
+    if (!curr_task) {
+        dbg_info("no task for pid %d\n", pid);
+        return -ESRCH;
+    }
+
+    curr_mm = get_task_mm(curr_task);
+    if (!curr_mm) {
+        dbg_info("no mm for pid %d\n", pid);
+        put_task_struct(curr_task);
+        return -ESRCH;
+    }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+    mmap_read_lock(curr_mm);
+#else
+    down_read(&curr_mm->mmap_sem);
+#endif
+    ret_val = tlb_pin_user_pages(d, curr_task, curr_mm, start, count, cpid, batch, NULL);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+    mmap_read_unlock(curr_mm);
+#else
+    up_read(&curr_mm->mmap_sem);
+#endif
+
+    mmput(curr_mm);
+    put_task_struct(curr_task);
+
+    return ret_val;
 }
\ No newline at end of file
@@ -45,12 +45,27 @@ void card_free(struct fpga_dev *d, uint64_t *card_paddr, uint64_t n_pages, int t
 /* TLB mappings */
 void tlb_create_map(struct tlb_order *tlb_ord, uint64_t vaddr, uint64_t paddr_host, uint64_t paddr_card, int32_t cpid, uint64_t *entry);
 void tlb_create_unmap(struct tlb_order *tlb_ord, uint64_t vaddr, int32_t cpid, uint64_t *entry);
+void tlb_create_unmap_range(struct tlb_order *tlb_ord, uint64_t vaddr, uint32_t n_pages, int32_t cpid, uint64_t *entry);
+void tlb_create_unmap_cpid(struct tlb_order *tlb_ord, int32_t cpid, uint64_t *entry);
 
 /* TLB control */
 void tlb_service_dev(struct fpga_dev *d, struct tlb_order *tlb_ord, uint64_t *entry, uint32_t n_pages);
+int tlb_unmap_buff(struct fpga_dev *d, struct user_pages *buff);
+int tlb_service_cmd(struct fpga_dev *d, struct tlb_order *tlb_ord, uint64_t *map_cmd);
+int tlb_unmap_cpid(struct fpga_dev *d, int32_t cpid);
+
+/* TLB batches */
+int tlb_batch_init(struct tlb_batch *batch);
+void tlb_batch_flush(struct fpga_dev *d, struct tlb_batch *batch);
+void tlb_batch_free(struct tlb_batch *batch);
 
 /* Page table walks */
 int tlb_get_user_pages(struct fpga_dev *d, uint64_t start, size_t count, int32_t cpid, pid_t pid);
+int tlb_get_user_pages_batch(struct fpga_dev *d, uint64_t start, size_t count, int32_t cpid, pid_t pid, struct tlb_batch *batch);
+int tlb_get_user_pages_vec(struct fpga_dev *d, struct tlb_map_range *ranges, uint32_t n_ranges, int32_t cpid, pid_t pid);
+int tlb_pin_user_pages(struct fpga_dev *d, struct task_struct *curr_task, struct mm_struct *curr_mm,
+    uint64_t start, size_t count, int32_t cpid, struct tlb_batch *batch, struct fpga_pf_trace *trace);
+void tlb_fault_around(struct fpga_dev *d, struct mm_struct *mm, uint64_t vaddr, uint32_t len, int32_t cpid, uint64_t *start, uint64_t *count);
 int tlb_put_user_pages(struct fpga_dev *d, uint64_t vaddr, int32_t cpid, int dirtied);
 int tlb_put_user_pages_cpid(struct fpga_dev *d, int32_t cpid, int dirtied);
 int tlb_put_user_pages_all(struct fpga_dev *d, int dirtied);
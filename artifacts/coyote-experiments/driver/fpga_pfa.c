@@ -0,0 +1,128 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#include "fpga_pfa.h"
+
+/*
+ ____  _____ _
+|  _ \|  ___/ \
+| |_) | |_ / _ \
+|  __/|  _/ ___ \
+|_|   |_|/_/   \_\
+*/
+
+#define PFA_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define PFA_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/**
+ * @brief Reset the fault history
+ * 
+ * @param st - fault history
+ * @param cnfg - window configuration
+ */
+void pfa_init(struct pfa_state *st, const struct pfa_cnfg *cnfg)
+{
+    st->valid = 0;
+    st->pattern = PFA_RANDOM;
+    st->last_page = 0;
+    st->next_page = 0;
+    st->stride = 0;
+    st->win = PFA_MAX(cnfg->win_min, 1);
+}
+
+/**
+ * @brief Window to map on a fault
+ * 
+ */
+uint32_t pfa_window(struct pfa_state *st, const struct pfa_cnfg *cnfg, uint64_t vaddr, uint32_t len,
+    uint32_t page_shift, uint64_t lo, uint64_t hi, uint64_t *first)
+{
+    uint64_t fp, lp, lo_page, hi_page;
+    uint64_t start, end, ahead, last;
+    uint32_t win_min, win_max, need;
+    int64_t stride;
+
+    win_min = PFA_MAX(cnfg->win_min, 1);
+    win_max = PFA_MAX(cnfg->win_max, win_min);
+
+    // faulting pages
+    fp = vaddr >> page_shift;
+    lp = (vaddr + (len ? len : 1) - 1) >> page_shift;
+    need = (uint32_t)PFA_MIN(lp - fp + 1, (uint64_t)win_max);
+
+    // pattern
+    stride = (int64_t)(fp - st->last_page);
+    if (st->valid && fp == st->next_page) {
+        st->pattern = PFA_SEQUENTIAL;
+        st->win = PFA_MIN(st->win * 2, win_max);
+    } else if (st->valid && stride != 0 && stride == st->stride) {
+        st->pattern = PFA_STRIDED;
+        st->win = win_min;
+    } else {
+        st->pattern = PFA_RANDOM;
+        st->win = win_min;
+    }
+
+    // window
+    last = fp;
+    start = fp;
+    end = fp + PFA_MAX(need, st->win);
+
+    if (st->pattern == PFA_STRIDED) {
+        // contiguous cover of the next strides, only if it fits the window
+        ahead = (uint64_t)(stride > 0 ? stride : -stride) * cnfg->stride_depth;
+        if (ahead + (end - start) <= win_max) {
+            if (stride > 0)
+                end += ahead;
+            else
+                start = (fp > ahead) ? fp - ahead : 0;
+
+            // next fault expected one stride past the mapped ones
+            last = fp + stride * (int64_t)cnfg->stride_depth;
+        }
+    }
+
+    // clip, the faulting page always stays in
+    lo_page = (lo + (1ULL << page_shift) - 1) >> page_shift;
+    hi_page = hi >> page_shift;
+    if (lo_page > fp)
+        lo_page = fp;
+    if (hi_page <= fp)
+        hi_page = fp + 1;
+
+    start = PFA_MAX(start, lo_page);
+    end = PFA_MIN(end, hi_page);
+
+    // history
+    st->valid = 1;
+    st->last_page = last;
+    st->next_page = end;
+    st->stride = stride;
+
+    *first = start;
+    return (uint32_t)(end - start);
+}
@@ -0,0 +1,91 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+#ifndef __FPGA_PFA_H__
+#define __FPGA_PFA_H__
+
+/*
+ * Page fault-around policy. No kernel dependencies, so the policy can be
+ * compiled and tested in user space.
+ */
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+/* Defaults (pages) */
+#define PFA_DEF_WIN_MIN 1
+#define PFA_DEF_WIN_MAX 128
+#define PFA_DEF_STRIDE_DEPTH 4
+
+/* Detected access pattern */
+#define PFA_RANDOM 0
+#define PFA_SEQUENTIAL 1
+#define PFA_STRIDED 2
+
+/* Window configuration */
+struct pfa_cnfg {
+    uint32_t win_min; // pages mapped on random faults
+    uint32_t win_max; // pages mapped at most
+    uint32_t stride_depth; // strides mapped ahead
+};
+
+/* Per cpid fault history */
+struct pfa_state {
+    int valid;
+    int pattern;
+    uint64_t last_page; // last faulting page
+    uint64_t next_page; // first page after the last mapped window
+    int64_t stride; // last fault distance (pages)
+    uint32_t win; // current sequential window (pages)
+};
+
+/* Reset the history */
+void pfa_init(struct pfa_state *st, const struct pfa_cnfg *cnfg);
+
+/**
+ * @brief Window to map on a fault
+ *
+ * Sequential faults (right after the previously mapped window) double the window,
+ * repeating strides map ahead stride_depth strides, anything else maps win_min pages.
+ * The faulting range is always covered (up to win_max) and the window is clipped to [lo, hi).
+ *
+ * @param st - fault history
+ * @param cnfg - window configuration
+ * @param vaddr - faulting vaddr
+ * @param len - faulting length
+ * @param page_shift - page size of the faulting area
+ * @param lo - lowest mappable vaddr
+ * @param hi - mappable vaddr bound (exclusive)
+ * @param first - first page of the window
+ * @return number of pages in the window
+ */
+uint32_t pfa_window(struct pfa_state *st, const struct pfa_cnfg *cnfg, uint64_t vaddr, uint32_t len,
+    uint32_t page_shift, uint64_t lo, uint64_t hi, uint64_t *first);
+
+#endif /* FPGA PFA */
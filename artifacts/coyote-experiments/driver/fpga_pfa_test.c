@@ -0,0 +1,112 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+/*
+ * User space test of the fault-around policy (cc fpga_pfa_test.c fpga_pfa.c)
+ */
+#include <stdio.h>
+
+#include "fpga_pfa.h"
+
+#define T_SHIFT 12
+#define T_HI (1ULL << 40)
+
+static int expect(struct pfa_state *st, const struct pfa_cnfg *cnfg, uint64_t page, uint32_t len_pages,
+    uint64_t lo, uint64_t hi, uint64_t first, uint32_t n, int pattern, const char *name)
+{
+    uint64_t got_first;
+    uint32_t got_n;
+
+    got_n = pfa_window(st, cnfg, page << T_SHIFT, len_pages << T_SHIFT, T_SHIFT, lo, hi, &got_first);
+    if (got_first != first || got_n != n || st->pattern != pattern) {
+        printf("FAIL %s, page %llu, window %llu + %u, pattern %d\n",
+            name, (unsigned long long)page, (unsigned long long)got_first, got_n, st->pattern);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    struct pfa_cnfg cnfg = { PFA_DEF_WIN_MIN, PFA_DEF_WIN_MAX, PFA_DEF_STRIDE_DEPTH };
+    struct pfa_state st;
+    uint64_t page;
+    uint32_t win;
+
+    // sequential, the window doubles up to win_max
+    pfa_init(&st, &cnfg);
+    if (expect(&st, &cnfg, 100, 1, 0, T_HI, 100, 1, PFA_RANDOM, "sequential first"))
+        return 1;
+    for (page = 101, win = 2; page < 2000; page += win, win = win * 2 > PFA_DEF_WIN_MAX ? PFA_DEF_WIN_MAX : win * 2)
+        if (expect(&st, &cnfg, page, 1, 0, T_HI, page, win, PFA_SEQUENTIAL, "sequential"))
+            return 1;
+
+    // a jump resets the window
+    if (expect(&st, &cnfg, 10000, 1, 0, T_HI, 10000, 1, PFA_RANDOM, "sequential reset"))
+        return 1;
+
+    // the faulting range is covered, up to win_max
+    if (expect(&st, &cnfg, 20000, 3, 0, T_HI, 20000, 3, PFA_RANDOM, "fault range") ||
+        expect(&st, &cnfg, 35000, 200, 0, T_HI, 35000, PFA_DEF_WIN_MAX, PFA_RANDOM, "fault range max"))
+        return 1;
+
+    // strided, maps stride_depth strides ahead once a stride repeats
+    pfa_init(&st, &cnfg);
+    if (expect(&st, &cnfg, 1000, 1, 0, T_HI, 1000, 1, PFA_RANDOM, "strided first") ||
+        expect(&st, &cnfg, 1010, 1, 0, T_HI, 1010, 1, PFA_RANDOM, "strided second") ||
+        expect(&st, &cnfg, 1020, 1, 0, T_HI, 1020, 41, PFA_STRIDED, "strided") ||
+        expect(&st, &cnfg, 1070, 1, 0, T_HI, 1070, 41, PFA_STRIDED, "strided next"))
+        return 1;
+
+    // strides that don't fit the window map the faulting page only
+    pfa_init(&st, &cnfg);
+    if (expect(&st, &cnfg, 0, 1, 0, T_HI, 0, 1, PFA_RANDOM, "wide first") ||
+        expect(&st, &cnfg, 100, 1, 0, T_HI, 100, 1, PFA_RANDOM, "wide second") ||
+        expect(&st, &cnfg, 200, 1, 0, T_HI, 200, 1, PFA_STRIDED, "wide"))
+        return 1;
+
+    // negative strides map below, clipped to the vma start
+    pfa_init(&st, &cnfg);
+    if (expect(&st, &cnfg, 600, 1, 0, T_HI, 600, 1, PFA_RANDOM, "down first") ||
+        expect(&st, &cnfg, 590, 1, 0, T_HI, 590, 1, PFA_RANDOM, "down second") ||
+        expect(&st, &cnfg, 580, 1, 560ULL << T_SHIFT, T_HI, 560, 21, PFA_STRIDED, "down clipped"))
+        return 1;
+
+    // vma end clips the window, an unaligned start rounds up
+    cnfg.win_min = 16;
+    pfa_init(&st, &cnfg);
+    if (expect(&st, &cnfg, 505, 1, 0, 510ULL << T_SHIFT, 505, 5, PFA_RANDOM, "clip end") ||
+        expect(&st, &cnfg, 900, 1, (890ULL << T_SHIFT) + 1, 910ULL << T_SHIFT, 900, 10, PFA_RANDOM, "clip unaligned"))
+        return 1;
+
+    // the faulting page always stays in the window
+    if (expect(&st, &cnfg, 650, 1, 700ULL << T_SHIFT, 800ULL << T_SHIFT, 650, 16, PFA_RANDOM, "below vma") ||
+        expect(&st, &cnfg, 850, 1, 700ULL << T_SHIFT, 800ULL << T_SHIFT, 850, 1, PFA_RANDOM, "above vma"))
+        return 1;
+
+    printf("OK\n");
+    return 0;
+}
@@ -188,7 +188,11 @@ ssize_t cyt_attr_nstats_q0_show(struct kobject *kobj, struct kobj_attribute *att
     "PSN drop cnt: %lld\n"
     "Retrans cnt: %lld\n"
     "TCP session cnt: %lld\n"
-    "STRM down: %lld\n\n", 
+    "STRM down: %lld\n"
+    "DPI reject cnt: %lld\n"
+    "DPI monitor cnt: %lld\n"
+    "DPI quarantine cnt: %lld\n"
+    "DPI quarantine qpn: %lld\n\n", 
     
     LOW_32 (pd->fpga_stat_cnfg->net_0_debug[0]),
     HIGH_32(pd->fpga_stat_cnfg->net_0_debug[0]),
@@ -205,7 +209,11 @@ ssize_t cyt_attr_nstats_q0_show(struct kobject *kobj, struct kobj_attribute *att
     LOW_32 (pd->fpga_stat_cnfg->net_0_debug[6]),
     HIGH_32(pd->fpga_stat_cnfg->net_0_debug[6]),
     LOW_32 (pd->fpga_stat_cnfg->net_0_debug[7]),
-    LOW_32 (pd->fpga_stat_cnfg->net_0_debug[8]) 
+    LOW_32 (pd->fpga_stat_cnfg->net_0_debug[8]),
+    LOW_32 (pd->fpga_stat_cnfg->net_0_debug[9]),
+    HIGH_32(pd->fpga_stat_cnfg->net_0_debug[9]),
+    LOW_32 (pd->fpga_stat_cnfg->net_0_debug[10]),
+    HIGH_32(pd->fpga_stat_cnfg->net_0_debug[10]) 
   );
 }
 
@@ -234,7 +242,11 @@ ssize_t cyt_attr_nstats_q1_show(struct kobject *kobj, struct kobj_attribute *att
     "PSN drop cnt: %lld\n"
     "Retrans cnt: %lld\n"
     "TCP session cnt: %lld\n"
-    "STRM down: %lld\n\n", 
+    "STRM down: %lld\n"
+    "DPI reject cnt: %lld\n"
+    "DPI monitor cnt: %lld\n"
+    "DPI quarantine cnt: %lld\n"
+    "DPI quarantine qpn: %lld\n\n", 
     
     LOW_32 (pd->fpga_stat_cnfg->net_1_debug[0]),
     HIGH_32(pd->fpga_stat_cnfg->net_1_debug[0]),
@@ -251,7 +263,11 @@ ssize_t cyt_attr_nstats_q1_show(struct kobject *kobj, struct kobj_attribute *att
     LOW_32 (pd->fpga_stat_cnfg->net_1_debug[6]),
     HIGH_32(pd->fpga_stat_cnfg->net_1_debug[6]),
     LOW_32 (pd->fpga_stat_cnfg->net_1_debug[7]),
-    LOW_32 (pd->fpga_stat_cnfg->net_1_debug[8]) 
+    LOW_32 (pd->fpga_stat_cnfg->net_1_debug[8]),
+    LOW_32 (pd->fpga_stat_cnfg->net_1_debug[9]),
+    HIGH_32(pd->fpga_stat_cnfg->net_1_debug[9]),
+    LOW_32 (pd->fpga_stat_cnfg->net_1_debug[10]),
+    HIGH_32(pd->fpga_stat_cnfg->net_1_debug[10]) 
   );
 }
 
@@ -375,3 +391,122 @@ ssize_t cyt_attr_cnfg_show(struct kobject *kobj, struct kobj_attribute *attr, ch
   );
 }
 
+/**
+ * @brief Sysfs read card memory
+ * 
+ */
+ssize_t cyt_attr_cmem_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+  int i, j;
+  ssize_t len = 0;
+  struct cmem_stats st[2];
+  struct bus_drvdata *pd = container_of(kobj, struct bus_drvdata, cyt_kobj);
+  BUG_ON(!pd);
+
+  spin_lock(&pd->card_s_lock);
+  cmem_get_stats(&pd->card_s, &st[SMALL_CHUNK_ALLOC]);
+  spin_unlock(&pd->card_s_lock);
+  spin_lock(&pd->card_l_lock);
+  cmem_get_stats(&pd->card_l, &st[LARGE_CHUNK_ALLOC]);
+  spin_unlock(&pd->card_l_lock);
+
+  pr_info("coyote-sysfs:  card memory\n");
+  len += sprintf(buf + len, "\n -- \033[31m\e[1mCARD MEMORY\033[0m\e[0m\n\n");
+
+  for (i = 0; i < 2; i++) {
+    len += sprintf(buf + len, "%s PAGES:\n"
+      "total pages: %u\n"
+      "free pages: %u\n"
+      "largest free block: %u\n"
+      "fragmentation (%%): %u\n",
+      i == SMALL_CHUNK_ALLOC ? "SMALL" : "LARGE",
+      st[i].n_pages, st[i].n_free, st[i].largest, st[i].frag);
+
+    for (j = 0; j <= CMEM_MAX_ORDER; j++)
+      if (st[i].n_free_blocks[j])
+        len += sprintf(buf + len, "free blocks order %d: %u\n", j, st[i].n_free_blocks[j]);
+  }
+
+  len += sprintf(buf + len, "QUOTAS:\n");
+  for (i = 0; i < pd->n_fpga_reg; i++)
+    len += sprintf(buf + len, "vFPGA %d used/quota small: %llu/%llu, large: %llu/%llu\n", i,
+      pd->card_used[SMALL_CHUNK_ALLOC][i], pd->card_quota[SMALL_CHUNK_ALLOC][i],
+      pd->card_used[LARGE_CHUNK_ALLOC][i], pd->card_quota[LARGE_CHUNK_ALLOC][i]);
+  len += sprintf(buf + len, "\n");
+
+  return len;
+}
+
+/**
+ * @brief Sysfs write card memory quota (vFPGA id, small pages, large pages)
+ * 
+ */
+ssize_t cyt_attr_cmem_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count) {
+  int vfid;
+  unsigned long long q_s, q_l;
+  struct bus_drvdata *pd = container_of(kobj, struct bus_drvdata, cyt_kobj);
+  BUG_ON(!pd);
+
+  if (sscanf(buf, "%d %llu %llu", &vfid, &q_s, &q_l) != 3 || vfid < 0 || vfid >= pd->n_fpga_reg)
+    return -EINVAL;
+
+  spin_lock(&pd->card_s_lock);
+  pd->card_quota[SMALL_CHUNK_ALLOC][vfid] = min_t(uint64_t, q_s, N_SMALL_CHUNKS);
+  spin_unlock(&pd->card_s_lock);
+  spin_lock(&pd->card_l_lock);
+  pd->card_quota[LARGE_CHUNK_ALLOC][vfid] = min_t(uint64_t, q_l, N_LARGE_CHUNKS);
+  spin_unlock(&pd->card_l_lock);
+
+  pr_info("coyote-sysfs:  card memory quota vFPGA %d, small %llu, large %llu\n", vfid, q_s, q_l);
+
+  return count;
+}
+
+/**
+ * @brief Sysfs read interrupts
+ * 
+ */
+ssize_t cyt_attr_irq_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+  int i;
+  ssize_t len = 0;
+  struct bus_drvdata *pd = container_of(kobj, struct bus_drvdata, cyt_kobj);
+  BUG_ON(!pd);
+
+  pr_info("coyote-sysfs:  interrupts\n");
+  len += sprintf(buf + len, "\n -- \033[31m\e[1mINTERRUPTS\033[0m\e[0m\n\n");
+
+  for (i = 0; i < pd->n_fpga_reg; i++) {
+    len += sprintf(buf + len, "VFPGA %d:\n"
+      "vector: %d\n"
+      "cpu: %d\n"
+      "coalescing events: %u\n"
+      "coalescing cycles: %u\n",
+      i, pd->fpga_dev[i].irq, pd->fpga_dev[i].irq_cpu,
+      pd->fpga_dev[i].irq_coal_cnt, pd->fpga_dev[i].irq_coal_time);
+  }
+  len += sprintf(buf + len, "\n");
+
+  return len;
+}
+
+/**
+ * @brief Sysfs write interrupts (vFPGA id, cpu, coalescing events, coalescing cycles)
+ * 
+ */
+ssize_t cyt_attr_irq_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count) {
+  int vfid, cpu, ret_val;
+  unsigned int cnt, time;
+  struct bus_drvdata *pd = container_of(kobj, struct bus_drvdata, cyt_kobj);
+  BUG_ON(!pd);
+
+  if (sscanf(buf, "%d %d %u %u", &vfid, &cpu, &cnt, &time) != 4 || vfid < 0 || vfid >= pd->n_fpga_reg)
+    return -EINVAL;
+
+  ret_val = fpga_irq_affinity_set(&pd->fpga_dev[vfid], cpu);
+  if (ret_val)
+    return ret_val;
+  fpga_irq_coal_set(&pd->fpga_dev[vfid], cnt, time);
+
+  pr_info("coyote-sysfs:  interrupts vFPGA %d, cpu %d, coalescing %u events, %u cycles\n", vfid, cpu, cnt, time);
+
+  return count;
+}
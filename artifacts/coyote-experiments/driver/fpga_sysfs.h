@@ -29,6 +29,7 @@
 #define __FPGA_SYSFS_H__
 
 #include "coyote_dev.h"
+#include "fpga_isr.h"
 
 /* Sysfs */
 
@@ -58,4 +59,12 @@ ssize_t cyt_attr_xstats_show(struct kobject *kobj, struct kobj_attribute *attr,
 // Config
 ssize_t cyt_attr_cnfg_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
 
+// Card memory
+ssize_t cyt_attr_cmem_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+ssize_t cyt_attr_cmem_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+// Interrupts
+ssize_t cyt_attr_irq_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+ssize_t cyt_attr_irq_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
 #endif // FPGA FOPS
\ No newline at end of file
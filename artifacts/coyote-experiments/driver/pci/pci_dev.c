@@ -153,7 +153,9 @@ void irq_teardown(struct bus_drvdata *d)
     if (d->msix_enabled) {
         for (i = 0; i < d->n_fpga_reg; i++) {
             pr_info("releasing IRQ%d\n", d->irq_entry[i].vector);
+            irq_set_affinity_hint(d->irq_entry[i].vector, NULL);
             free_irq(d->irq_entry[i].vector, &d->fpga_dev[i]);
+            d->fpga_dev[i].irq = 0;
         }
     }
     else if (d->irq_line != -1) {
@@ -165,32 +167,43 @@ void irq_teardown(struct bus_drvdata *d)
 /**
  * @brief Setup user MSI-X
  * 
+ * Each vFPGA gets its own vector, spread over the CPUs local to the device.
+ * 
  */
 int msix_irq_setup(struct bus_drvdata *d)
 {
     int i;
     int ret_val;
+    int node;
 
     BUG_ON(!d);
 
     write_msix_vectors(d);
+    node = dev_to_node(&d->pci_dev->dev);
 
     for (i = 0; i < d->n_fpga_reg; i++) {
-        ret_val = request_irq(d->irq_entry[i].vector, fpga_tlb_miss_isr, 0,
-                              DRV_NAME, &d->fpga_dev[i]);
+        snprintf(d->fpga_dev[i].irq_name, sizeof(d->fpga_dev[i].irq_name), DEV_NAME "%d", i);
+        ret_val = request_threaded_irq(d->irq_entry[i].vector, fpga_tlb_miss_isr, fpga_tlb_miss_thread,
+                                       IRQF_ONESHOT, d->fpga_dev[i].irq_name, &d->fpga_dev[i]);
 
         if (ret_val) {
             pr_info("couldn't use IRQ#%d, ret=%d\n", d->irq_entry[i].vector, ret_val);
             break;
         }
 
-        pr_info("using IRQ#%d with %d\n", d->irq_entry[i].vector, d->fpga_dev[i].id);
+        d->fpga_dev[i].irq = d->irq_entry[i].vector;
+        fpga_irq_affinity_set(&d->fpga_dev[i], cpumask_local_spread(i, node));
+
+        pr_info("using IRQ#%d with %d, cpu %d\n", d->irq_entry[i].vector, d->fpga_dev[i].id, d->fpga_dev[i].irq_cpu);
     }
 
     // unwind
     if (ret_val) {
-        while (--i >= 0)
+        while (--i >= 0) {
+            irq_set_affinity_hint(d->irq_entry[i].vector, NULL);
             free_irq(d->irq_entry[i].vector, &d->fpga_dev[i]);
+            d->fpga_dev[i].irq = 0;
+        }
     }
 
     return ret_val;
@@ -946,8 +959,8 @@ err_init_fpga_dev:
     kfree(d->fpga_dev);
     class_destroy(fpga_class);
 err_create_fpga_dev:
-    vfree(d->schunks);
-    vfree(d->lchunks);
+    vfree(d->card_s_meta);
+    vfree(d->card_l_meta);
 err_card_alloc:
     remove_sysfs_entry(d);
 err_sysfs:
@@ -34,6 +34,7 @@
 
 /* Interrupts */
 irqreturn_t fpga_tlb_miss_isr(int irq, void *dev_id);
+irqreturn_t fpga_tlb_miss_thread(int irq, void *dev_id);
 void user_interrupts_enable(struct bus_drvdata *d, uint32_t mask);
 void user_interrupts_disable(struct bus_drvdata *d, uint32_t mask);
 uint32_t read_interrupts(struct bus_drvdata *d);
@@ -49,7 +49,7 @@ if(NOT EXAMPLE EQUAL 0)
         set(EN_STRM 1)
         set(EN_MEM 0)
         set(EN_RDMA_0 1)
-        set(PMTU_BYTES 1024)
+        set(PMTU_BYTES 4096)
     elseif(EXAMPLE STREQUAL "perf_rdma_card")
         message("** RDMA card perf. Force config.")
         set(EN_HLS 0)
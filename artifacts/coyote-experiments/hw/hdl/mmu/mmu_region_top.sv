@@ -169,6 +169,10 @@ assign sTlb.wr    = mutex[1] ? wr_sTlb.wr : rd_sTlb.wr;
 assign lTlb.valid = mutex[1] ? wr_lTlb.valid : rd_lTlb.valid;
 assign sTlb.valid = mutex[1] ? wr_sTlb.valid : rd_sTlb.valid;
 
+// Completed invalidation commands
+logic [31:0] inv_cnt_lTlb;
+logic [31:0] inv_cnt_sTlb;
+
 // TLBs
 tlb_controller #(
     .TLB_ORDER(TLB_L_ORDER),
@@ -180,7 +184,8 @@ tlb_controller #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axis(axis_lTlb),
-    .TLB(lTlb)
+    .TLB(lTlb),
+    .inv_cnt(inv_cnt_lTlb)
 );
 
 tlb_controller #(
@@ -193,7 +198,8 @@ tlb_controller #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axis(axis_sTlb),
-    .TLB(sTlb)
+    .TLB(sTlb),
+    .inv_cnt(inv_cnt_sTlb)
 );
 
 // TLB slaves
@@ -205,7 +211,8 @@ tlb_slave_axil #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axi_ctrl(s_axi_ctrl_lTlb),
-    .m_axis(axis_lTlb)
+    .m_axis(axis_lTlb),
+    .inv_cnt(inv_cnt_lTlb)
 );
 
 tlb_slave_axil #(
@@ -216,7 +223,8 @@ tlb_slave_axil #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axi_ctrl(s_axi_ctrl_sTlb),
-    .m_axis(axis_sTlb)
+    .m_axis(axis_sTlb),
+    .inv_cnt(inv_cnt_sTlb)
 );
 
 // ----------------------------------------------------------------------------------------
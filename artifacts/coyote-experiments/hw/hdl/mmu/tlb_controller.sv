@@ -34,6 +34,14 @@ import lynxTypes::*;
  *
  * Pulls the VA -> PA mappings from the host memory.
  *
+ * Unmap entries (valid bit cleared) can carry an invalidation command in the
+ * upper bits of the second word:
+ *  - CMD_INV_RANGE: invalidate [vaddr, vaddr + n pages) of the cpid, n in the lower 32 bits
+ *  - CMD_INV_CPID: invalidate all entries of the cpid
+ * Commands sweep the affected sets, done is raised once the sweep completes.
+ * inv_cnt counts the completed commands, the host polls it through the AXI-Lite slave
+ * before the unmapped pages are released.
+ *
  *  @param TLB_ORDER    Size of the TLBs
  *  @param PG_BITS      Number of page size bits
  *  @param N_ASSOC      Set associativity
@@ -50,7 +58,8 @@ module tlb_controller #(
 
   AXI4S.s                   s_axis,
   tlbIntf.s                 TLB,
-  output logic              done_map
+  output logic              done_map,
+  output logic [31:0]       inv_cnt
 );
 
 // -- Decl ----------------------------------------------------------
@@ -66,10 +75,18 @@ localparam integer TLB_VAL_BIT = TAG_BITS + PID_BITS;
 
 localparam integer TLB_SIZE = 2**TLB_ORDER;
 localparam integer TLB_IDX_BITS = $clog2(N_ASSOC);
+localparam integer VPN_BITS = HASH_BITS + TAG_BITS;
+
+// -- Commands
+localparam integer CMD_OFFS = 126;
+localparam integer CMD_LEN_BITS = 32;
+localparam logic [1:0] CMD_INV_SINGLE = 2'b00;
+localparam logic [1:0] CMD_INV_RANGE = 2'b01;
+localparam logic [1:0] CMD_INV_CPID = 2'b10;
 
 // -- FSM
-typedef enum logic[1:0]  {ST_IDLE, ST_WAIT, ST_COMP} state_t;
-logic [1:0] state_C, state_N;
+typedef enum logic[2:0]  {ST_IDLE, ST_WAIT, ST_COMP, ST_SWEEP_ADDR, ST_SWEEP_WAIT, ST_SWEEP_COMP} state_t;
+logic [2:0] state_C, state_N;
 
 // -- Internal
 AXI4S axis_fifo_out ();
@@ -86,6 +103,17 @@ logic done_C, done_N;
 logic [N_ASSOC-1:0] tag_cmp;
 logic [TLB_IDX_BITS-1:0] hit_idx;
 
+// -- Invalidation sweep
+logic [TLB_ORDER-1:0] tlb_addr;
+logic [1:0] cmd;
+logic [CMD_LEN_BITS-1:0] cmd_len;
+logic sweep_start;
+logic [TLB_ORDER-1:0] sweep_addr_C, sweep_addr_N;
+logic [TLB_ORDER:0] sweep_cnt_C, sweep_cnt_N;
+logic [N_ASSOC-1:0] sweep_match;
+logic [N_ASSOC-1:0][VPN_BITS-1:0] sweep_offs;
+logic [31:0] inv_cnt_C, inv_cnt_N;
+
 logic [N_ASSOC_BITS-1:0] nxt_insert_C, nxt_insert_N;
 logic [N_ASSOC_BITS-1:0] entry_insert_fe, entry_insert_se;
 logic [1:0] entry_insert_min;
@@ -134,7 +162,7 @@ for (genvar i = 0; i < N_ASSOC; i++) begin
       .clk       (aclk),
       .a_en      (1'b1),
       .a_we      (tlb_wr_en[i]),
-      .a_addr    (axis_s0.tdata[0+:TLB_ORDER]),
+      .a_addr    (tlb_addr),
       .b_en      (1'b1),
       .b_addr    (TLB.addr[PG_BITS+:TLB_ORDER]),
       .a_data_in (tlb_data_upd_in[i]),
@@ -176,6 +204,9 @@ always_ff @( posedge aclk ) begin : PROC_LUP
         last_C = 0;
         done_C <= 1'b0;
         nxt_insert_C <= 0;
+        sweep_addr_C <= 0;
+        sweep_cnt_C <= 0;
+        inv_cnt_C <= 0;
 
 `ifdef EN_NRU
         ref_r_C <= 0;
@@ -196,6 +227,9 @@ always_ff @( posedge aclk ) begin : PROC_LUP
         last_C  = last_N;
         done_C <= done_N;
         nxt_insert_C <= nxt_insert_N;
+        sweep_addr_C <= sweep_addr_N;
+        sweep_cnt_C <= sweep_cnt_N;
+        inv_cnt_C <= inv_cnt_N;
 
 `ifdef EN_NRU
         ref_r_C <= ref_r_N;
@@ -223,17 +257,54 @@ always_comb begin: NSL
             state_N = ST_COMP;
 
         ST_COMP:
-            state_N = ST_IDLE;
+            state_N = sweep_start ? ST_SWEEP_ADDR : ST_IDLE;
+
+        ST_SWEEP_ADDR:
+            state_N = ST_SWEEP_WAIT;
+
+        ST_SWEEP_WAIT:
+            state_N = ST_SWEEP_COMP;
+
+        ST_SWEEP_COMP:
+            state_N = (sweep_cnt_C == 1) ? ST_IDLE : ST_SWEEP_ADDR;
 
 	endcase // state_C
 end
 
+// Command
+assign cmd = data_C[CMD_OFFS+:2];
+assign cmd_len = data_C[64+:CMD_LEN_BITS];
+assign sweep_start = !data_C[HASH_BITS+TLB_VAL_BIT] && ((cmd == CMD_INV_CPID) || (cmd == CMD_INV_RANGE && cmd_len != 0));
+
+// Port A address, the entry key is held for the write back
+always_comb begin
+    case (state_C)
+        ST_IDLE: tlb_addr = axis_s0.tdata[0+:TLB_ORDER];
+        ST_SWEEP_ADDR, ST_SWEEP_WAIT, ST_SWEEP_COMP: tlb_addr = sweep_addr_C;
+        default: tlb_addr = data_C[0+:TLB_ORDER];
+    endcase
+end
+
+// Sweep match, entry vpn is {tag, set}
+always_comb begin
+    for(int i = 0; i < N_ASSOC; i++) begin
+        sweep_offs[i] = {tlb_data_upd_out[i][0+:TAG_BITS], sweep_addr_C} - data_C[0+:VPN_BITS];
+
+        sweep_match[i] = tlb_data_upd_out[i][TLB_VAL_BIT] &&
+            (tlb_data_upd_out[i][TAG_BITS+:PID_BITS] == data_C[HASH_BITS+TAG_BITS+:PID_BITS]) && // pid
+            ((cmd == CMD_INV_CPID) || (sweep_offs[i] < cmd_len)); // range
+    end
+end
+
 // DP 
 always_comb begin
     data_N  = data_C;
     last_N  = last_C;
     done_N = 1'b0;
     nxt_insert_N = nxt_insert_C;
+    sweep_addr_N = sweep_addr_C;
+    sweep_cnt_N = sweep_cnt_C;
+    inv_cnt_N = inv_cnt_C;
 
     // Input
     axis_s0.tready = 1'b0;
@@ -285,11 +356,26 @@ always_comb begin
         end
 
         ST_COMP: begin
-            if(last_C) begin
+            if(last_C && !sweep_start) begin
                 done_N = 1'b1;
             end
 
-            if(data_C[HASH_BITS+TLB_VAL_BIT]) begin
+            if(sweep_start) begin
+                // Invalidation command, range sweeps at most all sets once
+                if(cmd == CMD_INV_CPID) begin
+                    sweep_addr_N = 0;
+                    sweep_cnt_N = TLB_SIZE;
+                end
+                else begin
+                    sweep_addr_N = data_C[0+:HASH_BITS];
+                    sweep_cnt_N = (cmd_len >= TLB_SIZE) ? TLB_SIZE : cmd_len[TLB_ORDER:0];
+                end
+            end
+            else if(!data_C[HASH_BITS+TLB_VAL_BIT] && cmd != CMD_INV_SINGLE) begin
+                // Empty range, nothing to sweep
+                inv_cnt_N = inv_cnt_C + 1;
+            end
+            else if(data_C[HASH_BITS+TLB_VAL_BIT]) begin
                 // Insertion
 `ifdef EN_NRU
                 if(!filled) begin
@@ -303,7 +389,7 @@ always_comb begin
 `endif
                 nxt_insert_N = nxt_insert_C + 1;
             end
-            else begin
+            else if(cmd == CMD_INV_SINGLE) begin
                 // Removal
                 for(int i = 0; i < N_ASSOC; i++) begin
                     if((tlb_data_upd_out[i][0+:TAG_BITS] == data_C[HASH_BITS+:TAG_BITS]) && // tag
@@ -318,11 +404,33 @@ always_comb begin
             end
         end
 
+        ST_SWEEP_COMP: begin
+            for(int i = 0; i < N_ASSOC; i++) begin
+                if(sweep_match[i]) begin
+                    tlb_wr_en[i] = ~0;
+`ifdef EN_NRU
+                    ref_r_N[i][sweep_addr_C] = 0;
+                    ref_m_N[i][sweep_addr_C] = 0;
+`endif
+                end
+            end
+
+            sweep_addr_N = sweep_addr_C + 1;
+            sweep_cnt_N = sweep_cnt_C - 1;
+
+            if(sweep_cnt_C == 1) begin
+                inv_cnt_N = inv_cnt_C + 1;
+                if(last_C)
+                    done_N = 1'b1;
+            end
+        end
+
     endcase
 end
 
 // Done signal
 assign done_map = done_C;
+assign inv_cnt = inv_cnt_C;
 
 // Find first order
 always_comb begin   
@@ -249,6 +249,10 @@ assign sTlb.wr    = mutex[1] ? wr_sTlb.wr : rd_sTlb.wr;
 assign lTlb.valid = mutex[1] ? wr_lTlb.valid : rd_lTlb.valid;
 assign sTlb.valid = mutex[1] ? wr_sTlb.valid : rd_sTlb.valid;
 
+// Completed invalidation commands
+logic [31:0] inv_cnt_lTlb;
+logic [31:0] inv_cnt_sTlb;
+
 // TLBs
 tlb_controller #(
     .TLB_ORDER(TLB_L_ORDER),
@@ -260,7 +264,8 @@ tlb_controller #(
     .aresetn(aresetn),
     .s_axis(axis_lTlb),
     .TLB(lTlb),
-    .done_map(done_map_lTlb)
+    .done_map(done_map_lTlb),
+    .inv_cnt(inv_cnt_lTlb)
 );
 
 tlb_controller #(
@@ -273,7 +278,8 @@ tlb_controller #(
     .aresetn(aresetn),
     .s_axis(axis_sTlb),
     .TLB(sTlb),
-    .done_map(done_map_sTlb)
+    .done_map(done_map_sTlb),
+    .inv_cnt(inv_cnt_sTlb)
 );
 
 // TLB slaves
@@ -285,7 +291,8 @@ tlb_slave_axil #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axi_ctrl(s_axi_ctrl_lTlb),
-    .m_axis(axis_lTlb_0)
+    .m_axis(axis_lTlb_0),
+    .inv_cnt(inv_cnt_lTlb)
 );
 
 tlb_slave_axil #(
@@ -296,7 +303,8 @@ tlb_slave_axil #(
     .aclk(aclk),
     .aresetn(aresetn),
     .s_axi_ctrl(s_axi_ctrl_sTlb),
-    .m_axis(axis_sTlb_0)
+    .m_axis(axis_sTlb_0),
+    .inv_cnt(inv_cnt_sTlb)
 );
 
 `ifdef EN_TLBF
@@ -38,14 +38,15 @@ module tlb_slave_axil #(
   input  logic              aresetn,
   
   AXI4L.s                   s_axi_ctrl,
-  AXI4S.m                   m_axis
+  AXI4S.m                   m_axis,
+  input  logic [31:0]       inv_cnt
 );
 
 // -- Decl ----------------------------------------------------------
 // ------------------------------------------------------------------
 
 // Constants
-localparam integer N_REGS = 2;
+localparam integer N_REGS = 4;
 localparam integer ADDR_LSB = $clog2(AXIL_DATA_BITS/8);
 localparam integer ADDR_MSB = $clog2(N_REGS);
 localparam integer AXIL_ADDR_BITS = ADDR_MSB + ADDR_LSB;
@@ -80,6 +81,8 @@ localparam integer CTRL_REG_0         = 0;
 // v, tag, key
 localparam integer CTRL_REG_1         = 1;
 // pcard, phost
+localparam integer STAT_REG           = 2;
+// completed invalidation commands (RO)
 
 // Write process
 assign slv_reg_wren = axi_wready && s_axi_ctrl.wvalid && axi_awready && s_axi_ctrl.awvalid;
@@ -132,6 +135,8 @@ always_ff @(posedge aclk) begin
           axi_rdata <= slv_reg[CTRL_REG_0];
         CTRL_REG_1: // ctrl 1
           axi_rdata <= slv_reg[CTRL_REG_1];
+        STAT_REG: // status
+          axi_rdata[31:0] <= inv_cnt;
         default: ;
       endcase
     end
@@ -2,6 +2,7 @@
 //
 // Payload extractor - looks at incoming network traffic and extracts payload 
 // (on 512 Bit AXI-Stream) and Meta-Information (Opcode, QPN) on dedicated interfaces
+// Inspected are all opcodes carrying payload: RDMA WRITE, SEND and RDMA READ RESPONSE
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -20,7 +21,16 @@ module payload_extractor(
     AXI4S.m m_axis_payload_tx, 
 
     // Outgoing Meta-Information consisting of QPN and opcode 
-    output logic [31:0] meta_tx_o
+    output logic [31:0] meta_tx_o, 
+
+    // Per-QP DPI policy updates, taken from the QP context (0 - enforce, 1 - monitor, 2 - bypass)
+    input logic policy_valid_i, 
+    input logic [9:0] policy_qpn_i, 
+    input logic [1:0] policy_mode_i, 
+
+    // Quarantined QPs, skipped until their context is written again 
+    input logic quarantine_valid_i, 
+    input logic [9:0] quarantine_qpn_i
 ); 
 
     ////////////////////////////////////////////////////////////////////////
@@ -33,6 +43,25 @@ module payload_extractor(
     localparam lp_opcode_write_middle = 8'h07; 
     localparam lp_opcode_write_last = 8'h08; 
     localparam lp_opcode_write_only = 8'h0a; 
+    localparam lp_opcode_send_first = 8'h00; 
+    localparam lp_opcode_send_middle = 8'h01; 
+    localparam lp_opcode_send_last = 8'h02; 
+    localparam lp_opcode_send_only = 8'h04; 
+    localparam lp_opcode_read_resp_first = 8'h0d; 
+    localparam lp_opcode_read_resp_middle = 8'h0e; 
+    localparam lp_opcode_read_resp_last = 8'h0f; 
+    localparam lp_opcode_read_resp_only = 8'h10; 
+
+    // Bytes per beat and headers in front of the payload (IPv4, UDP, BTH + extended header), ICRC behind it 
+    localparam lp_data_bytes = 64; 
+    localparam lp_hdr_bytes_bth = 40; 
+    localparam lp_hdr_bytes_aeth = 44; 
+    localparam lp_hdr_bytes_reth = 56; 
+    localparam lp_icrc_bytes = 4; 
+
+    localparam lp_dpi_bypass = 2'h2; 
+    localparam lp_dpi_quarantine = 2'h3; 
+    localparam lp_n_policy_qps = 1024; 
 
     ////////////////////////////////////////////////////////////////////////
     //
@@ -69,6 +98,13 @@ module payload_extractor(
         WAIT_SEND_LAST = 3
     } FSMState; 
 
+    // Extended header in front of the payload 
+    typedef enum logic[1:0] {
+        HDR_BTH = 0,    // SEND, WRITE MIDDLE / LAST, READ RESPONSE MIDDLE 
+        HDR_AETH = 1,   // READ RESPONSE FIRST / LAST / ONLY 
+        HDR_RETH = 2    // WRITE FIRST / ONLY 
+    } HeaderType; 
+
 
     /////////////////////////////////////////////////////////////////////////////////
     //
@@ -88,8 +124,6 @@ module payload_extractor(
     // Register to hold valid-value 
     logic payload_valid[2]; 
 
-    // Pointers to indicate fill-level of payload-words
-    DataFillIndicator payload_fill_indicator[2]; 
 
     // Selector for the payload_word 
     logic payload_word_selector; 
@@ -105,9 +139,20 @@ module payload_extractor(
     MetaQPN qpn_extractor; 
     MetaOpcode opcode_extractor; 
 
-    // Logic signal to show whether the incoming operation is of WRITE-type and thus carries payload
-    logic is_of_write_type; 
-    logic without_exh; 
+    // Logic signal to show whether the incoming operation carries payload and which header precedes it 
+    logic is_inspected; 
+    HeaderType hdr_extractor; 
+    HeaderType hdr_type; 
+
+    // Payload bytes in the open register, payload bytes of a last beat 
+    logic [6:0] open_bytes; 
+    logic [6:0] last_bytes; 
+    logic [6:0] first_last_bytes; 
+
+    // Payload of the first beat, beat shifted behind the open bytes and its spill-over 
+    DataWord first_payload; 
+    DataWord shifted_lo; 
+    DataWord shifted_hi; 
 
     // Logic signals to determine whether incoming packets are actually RDMA-traffic 
     logic RDMA_marker_present; 
@@ -115,6 +160,10 @@ module payload_extractor(
     logic marker_2; 
     logic marker_3; 
 
+    // DPI policy per QP, payload of bypassed QPs is not extracted 
+    logic [1:0] dpi_policy [lp_n_policy_qps]; 
+    logic is_bypassed; 
+
     // Reversed reset for sanity 
     logic rst_inverted;  
 
@@ -122,6 +171,32 @@ module payload_extractor(
     DataFillIndicator usable_bits_last_chunk; 
 
 
+    //////////////////////////////////////////////////////////////////////
+    // 
+    // Helpers 
+    //
+    //////////////////////////////////////////////////////////////////////
+
+    function automatic logic [6:0] hdr_bytes(input HeaderType hdr); 
+        case(hdr) 
+            HDR_AETH: return lp_hdr_bytes_aeth; 
+            HDR_RETH: return lp_hdr_bytes_reth; 
+            default: return lp_hdr_bytes_bth; 
+        endcase 
+    endfunction 
+
+    // Keep of the lowest n bytes 
+    function automatic DataKeep keep_mask(input logic [6:0] n_bytes); 
+        return (n_bytes >= lp_data_bytes) ? 64'hffffffffffffffff : ((64'h1 << n_bytes) - 1); 
+    endfunction 
+
+    function automatic DataWord byte_mask(input DataKeep keep); 
+        for(integer i = 0; i < lp_data_bytes; i++) begin 
+            byte_mask[8*i+:8] = {8{keep[i]}}; 
+        end 
+    endfunction 
+
+
     //////////////////////////////////////////////////////////////////////
     // 
     // Combinatorial Logic for extraction of meta-information 
@@ -135,8 +210,25 @@ module payload_extractor(
     assign opcode_extractor = m_axis_rx_data_i[231:224]; 
     assign qpn_extractor = m_axis_rx_data_i[287:264]; 
 
-    // Determine if the incoming packet is of WRITE-type and carries extractable payload
-    assign is_of_write_type = (opcode_extractor == lp_opcode_write_first) || (opcode_extractor == lp_opcode_write_last) || (opcode_extractor == lp_opcode_write_middle) || (opcode_extractor == lp_opcode_write_only); 
+    // Determine if the incoming packet carries extractable payload
+    assign is_inspected = (opcode_extractor == lp_opcode_write_first) || (opcode_extractor == lp_opcode_write_last) || (opcode_extractor == lp_opcode_write_middle) || (opcode_extractor == lp_opcode_write_only) || 
+        (opcode_extractor == lp_opcode_send_first) || (opcode_extractor == lp_opcode_send_last) || (opcode_extractor == lp_opcode_send_middle) || (opcode_extractor == lp_opcode_send_only) || 
+        (opcode_extractor == lp_opcode_read_resp_first) || (opcode_extractor == lp_opcode_read_resp_last) || (opcode_extractor == lp_opcode_read_resp_middle) || (opcode_extractor == lp_opcode_read_resp_only); 
+
+    // Header layout, selects the offset of the payload 
+    always_comb begin 
+        if((opcode_extractor == lp_opcode_write_first) || (opcode_extractor == lp_opcode_write_only)) begin 
+            hdr_extractor = HDR_RETH; 
+        end else if((opcode_extractor == lp_opcode_read_resp_first) || (opcode_extractor == lp_opcode_read_resp_last) || (opcode_extractor == lp_opcode_read_resp_only)) begin 
+            hdr_extractor = HDR_AETH; 
+        end else begin 
+            hdr_extractor = HDR_BTH; 
+        end 
+    end 
+
+    // Bypassed QPs are not classified, the transport does not wait for a decision either 
+    // Packets of quarantined QPs are dropped by the transport before inspection 
+    assign is_bypassed = (dpi_policy[qpn_extractor[9:0]] == lp_dpi_bypass) || (dpi_policy[qpn_extractor[9:0]] == lp_dpi_quarantine); 
 
     // Assure that the packet is actually RDMA
     assign marker_1 = (m_axis_rx_data_i[15:0] == 16'h0245); 
@@ -144,6 +236,37 @@ module payload_extractor(
     assign marker_3 = (m_axis_rx_data_i[291:288] == 4'h0); 
     assign RDMA_marker_present = marker_1 && marker_2 && marker_3; 
 
+    // Payload bytes of the last beat (in front of the ICRC) 
+    assign last_bytes = ($countones(m_axis_rx_keep_i) > lp_icrc_bytes) ? ($countones(m_axis_rx_keep_i) - lp_icrc_bytes) : 7'd0; 
+    assign first_last_bytes = ($countones(m_axis_rx_keep_i) > hdr_bytes(hdr_extractor) + lp_icrc_bytes) ? 
+        ($countones(m_axis_rx_keep_i) - hdr_bytes(hdr_extractor) - lp_icrc_bytes) : 7'd0; 
+
+    // The open register always holds the payload bytes of the first beat, constant offsets for each header 
+    assign open_bytes = lp_data_bytes - hdr_bytes(hdr_type); 
+
+    always_comb begin 
+        case(hdr_extractor) 
+            HDR_AETH: first_payload = m_axis_rx_data_i >> (8*lp_hdr_bytes_aeth); 
+            HDR_RETH: first_payload = m_axis_rx_data_i >> (8*lp_hdr_bytes_reth); 
+            default: first_payload = m_axis_rx_data_i >> (8*lp_hdr_bytes_bth); 
+        endcase 
+
+        case(hdr_type) 
+            HDR_AETH: begin 
+                shifted_lo = m_axis_rx_data_i << (8*(lp_data_bytes-lp_hdr_bytes_aeth)); 
+                shifted_hi = m_axis_rx_data_i >> (8*lp_hdr_bytes_aeth); 
+            end 
+            HDR_RETH: begin 
+                shifted_lo = m_axis_rx_data_i << (8*(lp_data_bytes-lp_hdr_bytes_reth)); 
+                shifted_hi = m_axis_rx_data_i >> (8*lp_hdr_bytes_reth); 
+            end 
+            default: begin 
+                shifted_lo = m_axis_rx_data_i << (8*(lp_data_bytes-lp_hdr_bytes_bth)); 
+                shifted_hi = m_axis_rx_data_i >> (8*lp_hdr_bytes_bth); 
+            end 
+        endcase 
+    end 
+
     // Assign the meta-output to the current meta-register 
     assign meta_tx_o = current_transmission_meta; 
 
@@ -297,6 +420,21 @@ module payload_extractor(
     //
     //////////////////////////////////////////////////////////////////////
 
+    // Policy table, all QPs enforce by default 
+    initial begin 
+        for(integer i = 0; i < lp_n_policy_qps; i++) begin 
+            dpi_policy[i] = 2'b0; 
+        end 
+    end 
+
+    always_ff @(posedge nclk) begin 
+        if(policy_valid_i) begin 
+            dpi_policy[policy_qpn_i] <= policy_mode_i; 
+        end else if(quarantine_valid_i) begin 
+            dpi_policy[quarantine_qpn_i] <= lp_dpi_quarantine; 
+        end 
+    end 
+
     always_ff @(posedge nclk) begin 
         if(rst_inverted) begin 
             // Reset the required registers 
@@ -305,7 +443,6 @@ module payload_extractor(
                 payload_keep[output_counter] <= 64'b0; 
                 payload_valid[output_counter] <= 1'b0; 
                 payload_last[output_counter] <= 1'b0; 
-                payload_fill_indicator[output_counter] <= 9'b0; 
             end 
             
             // Reset the word selector 
@@ -318,50 +455,33 @@ module payload_extractor(
             // Reset the FSM to its starting state 
             fsm_state <= IDLE; 
 
-            without_exh <= 0; 
-
-            // Reset the output interfaces 
-            /*m_axis_payload_tx.tvalid <= 1'b0;
-            m_axis_payload_tx.tdata <= 512'b0;
-            m_axis_payload_tx.tkeep <= 64'b0;
-            m_axis_payload_tx.tlast <= 1'b0;
-            meta_tx_o <= 32'b0;*/
+            hdr_type <= HDR_RETH; 
 
         end else begin 
             // FSM to deal with the incoming data 
             case(fsm_state) 
                 IDLE: begin 
-                    // Only begin to process if there's a new transmission coming in & it's of type WRITE (carries payload that can be taken out)
-                    if(m_axis_rx_valid_i && is_of_write_type && RDMA_marker_present) begin 
+                    // Only begin to process if there's a new transmission coming in that carries payload (WRITE, SEND, READ RESPONSE)
+                    if(m_axis_rx_valid_i && is_inspected && RDMA_marker_present && !is_bypassed) begin 
                         // Store current meta-information as dependent on the just started transmission 
                         current_transmission_meta.QPN <= qpn_extractor; 
                         current_transmission_meta.Opcode <= opcode_extractor; 
+                        hdr_type <= hdr_extractor; 
 
-                        // Store first part of the payload in the current payload register
-                        if((opcode_extractor == lp_opcode_write_middle) || (opcode_extractor == lp_opcode_write_last)) begin 
-                            payload_word[payload_word_selector][191:0] <= m_axis_rx_data_i[511:320]; 
-                            payload_keep[payload_word_selector][23:0] <= 24'hffffff; 
-                            payload_keep[payload_word_selector][63:24] <= 40'b0; 
-                            without_exh <= 1'b1;
-                        end else begin 
-                            payload_word[payload_word_selector][63:0] <= m_axis_rx_data_i[511:448]; 
-                            payload_keep[payload_word_selector][7:0] <= 8'hff; 
-                            payload_keep[payload_word_selector][63:8] <= 56'b0; 
-                            without_exh <= 1'b0;
-                        end  
-                        
-                        // Check whether this first message is also the last - interesting, but ok
+                        // Store first part of the payload in the current payload register 
                         if(m_axis_rx_last_i) begin 
+                            // Single beat packet, only the bytes in front of the ICRC 
+                            payload_word[payload_word_selector] <= first_payload & byte_mask(keep_mask(first_last_bytes)); 
+                            payload_keep[payload_word_selector] <= keep_mask(first_last_bytes); 
                             payload_valid[payload_word_selector] <= 1'b1; 
                             payload_last[payload_word_selector] <= 1'b1; 
                             fsm_state <= WAIT_SEND_LAST; 
                         end else begin    
+                            payload_word[payload_word_selector] <= first_payload; 
+                            payload_keep[payload_word_selector] <= keep_mask(lp_data_bytes - hdr_bytes(hdr_extractor)); 
                             payload_valid[payload_word_selector] <= 1'b0; 
                             payload_last[payload_word_selector] <= 1'b0; 
                             fsm_state <= SUBSEQUENT; 
-
-                            // Set fill-counter 
-                            payload_fill_indicator[payload_word_selector] <= 10'd64; 
                         end
                     end 
                 end 
@@ -375,383 +495,41 @@ module payload_extractor(
 
                     // Check if there's new input available
                     if(m_axis_rx_valid_i) begin 
-                        // Check if this input has last-flag set 
-                        if(m_axis_rx_last_i) begin 
-                            // If that's the last chunk, we need to consult the keep-signal and take the ICRC-offset into account to get the remaining payload-bits 
-                            case(m_axis_rx_keep_i)
-                                64'h000000000000000f: begin 
-                                    // It's just the CRC, so no data for us! 
-                                    payload_valid[payload_word_selector] <= 1'b1; 
-                                    payload_last[payload_word_selector] <= 1'b1; 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h00000000000000ff: begin 
-                                    // 32 Bit of Payload for us, fits in the open register
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1;
-                                        payload_word[payload_word_selector][223:192] <= m_axis_rx_data_i[31:0];  
-                                        payload_keep[payload_word_selector][27:0] <= 28'hfffffff; 
-                                        payload_keep[payload_word_selector][63:28] <= 36'b0; 
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1;
-                                        payload_word[payload_word_selector][95:64] <= m_axis_rx_data_i[31:0];  
-                                        payload_keep[payload_word_selector][11:0] <= 12'hfff; 
-                                        payload_keep[payload_word_selector][63:12] <= 52'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h0000000000000fff: begin 
-                                    // 64 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][255:192] <= m_axis_rx_data_i[63:0]; 
-                                        payload_keep[payload_word_selector][31:0] <= 32'hffffffff; 
-                                        payload_keep[payload_word_selector][63:24] <= 32'b0; 
-                                    end else begin
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][127:64] <= m_axis_rx_data_i[63:0]; 
-                                        payload_keep[payload_word_selector][15:0] <= 16'hffff; 
-                                        payload_keep[payload_word_selector][63:16] <= 48'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h000000000000ffff: begin 
-                                    // 96 Bit of Payload for us, fits in the open register
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][287:192] <= m_axis_rx_data_i[95:0]; 
-                                        payload_keep[payload_word_selector][35:0] <= 36'hfffffff; 
-                                        payload_keep[payload_word_selector][63:36] <= 28'b0; 
-                                    end else begin
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][159:64] <= m_axis_rx_data_i[95:0]; 
-                                        payload_keep[payload_word_selector][19:0] <= 20'hfffff; 
-                                        payload_keep[payload_word_selector][63:20] <= 44'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h00000000000fffff: begin 
-                                    // 128 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][319:192] <= m_axis_rx_data_i[127:0]; 
-                                        payload_keep[payload_word_selector][39:0] <= 40'hffffffffff; 
-                                        payload_keep[payload_word_selector][63:40] <= 24'b0; 
-                                    end else begin
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][191:64] <= m_axis_rx_data_i[127:0]; 
-                                        payload_keep[payload_word_selector][23:0] <= 24'hffffff; 
-                                        payload_keep[payload_word_selector][63:24] <= 40'b0; 
-                                    end
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h0000000000ffffff: begin 
-                                    // 160 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][351:192] <= m_axis_rx_data_i[159:0]; 
-                                        payload_keep[payload_word_selector][43:0] <= 44'hfffffffffff; 
-                                        payload_keep[payload_word_selector][63:44] <= 20'b0; 
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][223:64] <= m_axis_rx_data_i[159:0];
-                                        payload_keep[payload_word_selector][27:0] <= 28'hfffffff; 
-                                        payload_keep[payload_word_selector][63:28] <= 36'b0;  
-                                    end
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h000000000fffffff: begin 
-                                    // 192 Bit of Payload for us, fits in the open register
-                                    if(without_exh) begin
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][383:192] <= m_axis_rx_data_i[191:0]; 
-                                        payload_keep[payload_word_selector][47:0] <= 48'hffffffffffff; 
-                                        payload_keep[payload_word_selector][63:48] <= 16'b0; 
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][255:64] <= m_axis_rx_data_i[191:0]; 
-                                        payload_keep[payload_word_selector][31:0] <= 32'hffffffff; 
-                                        payload_keep[payload_word_selector][63:32] <= 32'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h00000000ffffffff: begin 
-                                    // 224 Bit of Payload for us, fits in the open register
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][415:192] <= m_axis_rx_data_i[223:0]; 
-                                        payload_keep[payload_word_selector][51:0] <= 52'hfffffffffffff; 
-                                        payload_keep[payload_word_selector][63:52] <= 12'b0;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][287:64] <= m_axis_rx_data_i[223:0]; 
-                                        payload_keep[payload_word_selector][35:0] <= 36'hfffffffff; 
-                                        payload_keep[payload_word_selector][63:36] <= 28'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h0000000fffffffff: begin 
-                                    // 256 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][447:192] <= m_axis_rx_data_i[255:0]; 
-                                        payload_keep[payload_word_selector][55:0] <= 56'hffffffffffffff; 
-                                        payload_keep[payload_word_selector][63:56] <= 8'b0;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][319:64] <= m_axis_rx_data_i[255:0];
-                                        payload_keep[payload_word_selector][39:0] <= 40'hffffffffff; 
-                                        payload_keep[payload_word_selector][63:40] <= 24'b0;
-                                    end   
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h000000ffffffffff: begin 
-                                    // 288 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][479:192] <= m_axis_rx_data_i[287:0]; 
-                                        payload_keep[payload_word_selector][59:0] <= 60'hfffffffffffffff; 
-                                        payload_keep[payload_word_selector][63:60] <= 4'b0;
-                                    end else begin
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][351:64] <= m_axis_rx_data_i[287:0]; 
-                                        payload_keep[payload_word_selector][43:0] <= 44'hfffffffffff; 
-                                        payload_keep[payload_word_selector][63:44] <= 20'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h00000fffffffffff: begin 
-                                    // 320 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-                                        // payload_keep[payload_word_selector][63:56] <= 8'b0; 
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][383:64] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][47:0] <= 48'hffffffffffff; 
-                                        payload_keep[payload_word_selector][63:48] <= 16'b0; 
-                                    end 
-
-                                    // Go to last state 
-                                    fsm_state <= WAIT_SEND_LAST; 
-                                end 
-
-                                64'h0000ffffffffffff: begin 
-                                    // 352 Bit of Payload for us, fits in the open register
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][31:0] <= m_axis_rx_data_i[351:320];
-                                        payload_last[payload_next_word_selector] <= 1'b1;
-                                        payload_keep[payload_next_word_selector][3:0] <= 4'hf;
-                                        payload_keep[payload_next_word_selector][63:4] <= 60'h0;
-
-                                        fsm_state <= FINAL;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][415:64] <= m_axis_rx_data_i[351:0]; 
-                                        payload_keep[payload_word_selector][51:0] <= 52'hfffffffffffff; 
-                                        payload_keep[payload_word_selector][63:52] <= 12'b0;
-
-                                        // Go to last state 
-                                        fsm_state <= WAIT_SEND_LAST; 
-                                    end  
-                                end 
-
-                                64'h000fffffffffffff: begin 
-                                    // 384 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][63:0] <= m_axis_rx_data_i[383:320];
-                                        payload_last[payload_next_word_selector] <= 1'b1;
-                                        payload_keep[payload_next_word_selector][7:0] <= 8'hff;
-                                        payload_keep[payload_next_word_selector][63:8] <= 56'h0;
-
-                                        fsm_state <= FINAL;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][447:64] <= m_axis_rx_data_i[383:0]; 
-                                        payload_keep[payload_word_selector][55:0] <= 56'hffffffffffffff; 
-                                        payload_keep[payload_word_selector][63:56] <= 8'b0; 
-
-                                        // Go to last state 
-                                        fsm_state <= WAIT_SEND_LAST; 
-                                    end 
-                                end 
-
-                                64'h00ffffffffffffff: begin 
-                                    // 416 Bit of Payload for us, fits in the open register 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][95:0] <= m_axis_rx_data_i[415:320];
-                                        payload_last[payload_next_word_selector] <= 1'b1;
-                                        payload_keep[payload_next_word_selector][11:0] <= 12'hfff;
-                                        payload_keep[payload_next_word_selector][63:12] <= 52'h0;
-
-                                        fsm_state <= FINAL;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][479:64] <= m_axis_rx_data_i[415:0]; 
-                                        payload_keep[payload_word_selector][59:0] <= 60'hfffffffffffffff; 
-                                        payload_keep[payload_word_selector][63:60] <= 4'b0; 
-
-                                        // Go to last state 
-                                        fsm_state <= WAIT_SEND_LAST;
-                                    end  
-                                end 
-
-                                64'h0fffffffffffffff: begin 
-                                    // 448 Bit of Payload for us, fits in the open register (for the last time) 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][127:0] <= m_axis_rx_data_i[447:320];
-                                        payload_last[payload_next_word_selector] <= 1'b1;
-                                        payload_keep[payload_next_word_selector][15:0] <= 16'hffff;
-                                        payload_keep[payload_next_word_selector][63:16] <= 48'h0;
-
-                                        fsm_state <= FINAL;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b1; 
-                                        payload_word[payload_word_selector][511:64] <= m_axis_rx_data_i[447:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-                                        // Go to last state 
-                                        fsm_state <= WAIT_SEND_LAST; 
-                                    end 
-                                end 
-
-                                64'hffffffffffffffff: begin 
-                                    // 480 Bit of Payload for us, has to be split up into both registers 
-                                    if(without_exh) begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][159:0] <= m_axis_rx_data_i[479:320];
-                                        payload_last[payload_next_word_selector] <= 1'b1;
-                                        payload_keep[payload_next_word_selector][19:0] <= 20'hfffff;
-                                        payload_keep[payload_next_word_selector][63:20] <= 44'h0;
-                                    end else begin 
-                                        payload_valid[payload_word_selector] <= 1'b1; 
-                                        payload_last[payload_word_selector] <= 1'b0; 
-                                        payload_word[payload_word_selector][511:64] <= m_axis_rx_data_i[447:0]; 
-                                        payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                        payload_word[payload_next_word_selector][31:0] <= m_axis_rx_data_i[511:448]; 
-                                        payload_last[payload_next_word_selector] <= 1'b1; 
-                                        payload_keep[payload_next_word_selector][3:0] <= 4'hf; 
-                                        payload_keep[payload_next_word_selector][63:4] <= 60'b0; 
-                                    end 
-
-                                    // Go to second to last state 
-                                    fsm_state <= FINAL; 
-                                end 
-                            endcase
-                            
+                        if(m_axis_rx_last_i && (open_bytes + last_bytes <= lp_data_bytes)) begin 
+                            // Remaining payload fits in the open register 
+                            payload_word[payload_word_selector] <= payload_word[payload_word_selector] | (shifted_lo & byte_mask(keep_mask(open_bytes + last_bytes))); 
+                            payload_keep[payload_word_selector] <= keep_mask(open_bytes + last_bytes); 
+                            payload_valid[payload_word_selector] <= 1'b1; 
+                            payload_last[payload_word_selector] <= 1'b1; 
+
+                            // Go to last state 
+                            fsm_state <= WAIT_SEND_LAST; 
                         end else begin 
-                            // If not, we can assume full 512 bits of data that has to be distributed among the two registers 
-                            if(without_exh) begin 
-                                payload_valid[payload_word_selector] <= 1'b1; 
-                                payload_last[payload_word_selector] <= 1'b0; 
-                                payload_word[payload_word_selector][511:192] <= m_axis_rx_data_i[319:0]; 
-                                payload_keep[payload_word_selector][63:0] <= 64'hffffffffffffffff; 
-
-                                payload_word[payload_next_word_selector][191:0] <= m_axis_rx_data_i[511:320];
-                                payload_last[payload_next_word_selector] <= 1'b0;
-                                payload_valid[payload_next_word_selector] <= 1'b0;
-                                payload_keep[payload_next_word_selector][23:0] <= 24'hffffff;
-                                payload_keep[payload_next_word_selector][63:24] <= 40'h0;
-                            end else begin
-                                // Fill up the first register 
-                                payload_word[payload_word_selector][511:64] <= m_axis_rx_data_i[447:0]; 
-                                payload_keep[payload_word_selector][63:8] <= 56'hffffffffffffff; 
-                                payload_valid[payload_word_selector] <= 1'b1; 
-                                payload_last[payload_word_selector] <= 1'b0; 
-                                //payload_fill_indicator <= 10'd512; 
-                                
-                                // Fill the rest in the second register 
-                                payload_word[payload_next_word_selector][447:0] <= m_axis_rx_data_i[511:448]; 
-                                payload_keep[payload_next_word_selector][7:0] <= 8'hff; 
-                                payload_valid[payload_next_word_selector] <= 1'b0; 
+                            // Fill up the open register, the rest goes to the other one 
+                            payload_word[payload_word_selector] <= payload_word[payload_word_selector] | shifted_lo; 
+                            payload_keep[payload_word_selector] <= 64'hffffffffffffffff; 
+                            payload_valid[payload_word_selector] <= 1'b1; 
+                            payload_last[payload_word_selector] <= 1'b0; 
+
+                            if(m_axis_rx_last_i) begin 
+                                // Spills over into the other register, sent out in the next cycle 
+                                payload_word[payload_next_word_selector] <= shifted_hi & byte_mask(keep_mask(open_bytes + last_bytes - lp_data_bytes)); 
+                                payload_keep[payload_next_word_selector] <= keep_mask(open_bytes + last_bytes - lp_data_bytes); 
+                                payload_last[payload_next_word_selector] <= 1'b1; 
+
+                                // Go to second to last state 
+                                fsm_state <= FINAL; 
+                            end else begin 
+                                payload_word[payload_next_word_selector] <= shifted_hi; 
+                                payload_keep[payload_next_word_selector] <= keep_mask(open_bytes); 
                                 payload_last[payload_next_word_selector] <= 1'b0; 
-                            end
 
-                            // Increment the payload_word_selector to point to the other register 
-                            payload_word_selector <= payload_word_selector + 1; 
+                                // Increment the payload_word_selector to point to the other register 
+                                payload_word_selector <= payload_word_selector + 1; 
 
-                            // Return to this state to wait for the next incoming message-chunk 
-                            fsm_state <= SUBSEQUENT; 
+                                // Return to this state to wait for the next incoming message-chunk 
+                                fsm_state <= SUBSEQUENT; 
+                            end 
                         end 
                     end 
                 end 
@@ -776,7 +554,6 @@ module payload_extractor(
                         payload_keep[output_counter] <= 64'b0; 
                         payload_valid[output_counter] <= 1'b0; 
                         payload_last[output_counter] <= 1'b0; 
-                        payload_fill_indicator[output_counter] <= 9'b0; 
                     end 
 
                     // Reset the payload_word_selector to start at register 0 with a clean cut 
@@ -785,8 +562,7 @@ module payload_extractor(
                     // Return to initial IDLE-state to wait for new incoming traffic 
                     fsm_state <= IDLE; 
                 end 
-            endcase
+            endcase 
         end 
     end 
-
 endmodule
\ No newline at end of file
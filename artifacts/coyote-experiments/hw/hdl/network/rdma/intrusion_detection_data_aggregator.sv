@@ -30,6 +30,14 @@ module intrusion_detection_data_aggregator(
     localparam lp_opcode_write_middle = 8'h07; 
     localparam lp_opcode_write_last = 8'h08; 
     localparam lp_opcode_write_only = 8'h0a; 
+    localparam lp_opcode_send_first = 8'h00; 
+    localparam lp_opcode_send_middle = 8'h01; 
+    localparam lp_opcode_send_last = 8'h02; 
+    localparam lp_opcode_send_only = 8'h04; 
+    localparam lp_opcode_read_resp_first = 8'h0d; 
+    localparam lp_opcode_read_resp_middle = 8'h0e; 
+    localparam lp_opcode_read_resp_last = 8'h0f; 
+    localparam lp_opcode_read_resp_only = 8'h10; 
 
 
     ///////////////////////////////////////////////////////////////////////////////////////
@@ -139,8 +147,10 @@ module intrusion_detection_data_aggregator(
             if(m_axis_rx.tvalid) begin 
                 // Check if there is already an ongoing / registered transmission to which this chunk of data belongs to 
                 if(!ongoing_transmission) begin 
-                    // Step 1: Check if the incoming burst is a WRITE - only such are treated
-                    if(opcode_extractor == lp_opcode_write_first || opcode_extractor == lp_opcode_write_last || opcode_extractor == lp_opcode_write_middle || opcode_extractor == lp_opcode_write_only) begin 
+                    // Step 1: Check if the incoming burst carries payload (WRITE, SEND, READ RESPONSE) - only such are treated
+                    if(opcode_extractor == lp_opcode_write_first || opcode_extractor == lp_opcode_write_last || opcode_extractor == lp_opcode_write_middle || opcode_extractor == lp_opcode_write_only || 
+                        opcode_extractor == lp_opcode_send_first || opcode_extractor == lp_opcode_send_last || opcode_extractor == lp_opcode_send_middle || opcode_extractor == lp_opcode_send_only || 
+                        opcode_extractor == lp_opcode_read_resp_first || opcode_extractor == lp_opcode_read_resp_last || opcode_extractor == lp_opcode_read_resp_middle || opcode_extractor == lp_opcode_read_resp_only) begin 
                         ongoing_transmission <= 1'b1; 
                         current_qpn <= qpn_extractor; 
                     end 
@@ -2,6 +2,10 @@
 //
 // Intrusion Detection Decider - receives payload and leads it to the ML-model for decision
 //
+// Decisions are sticky per message: once a packet is rejected, the remaining packets 
+// of the same message on that QP are not fed to the ML-model and rejected right away. 
+// The decisions still come out in packet order, one per packet. 
+//
 //////////////////////////////////////////////////////////////////////////////////
 
 module intrusion_detection_decider(
@@ -19,6 +23,25 @@ module intrusion_detection_decider(
     metaIntf.m m_rdma_intrusion_decision 
 );
 
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    // Definition of localparams
+    //
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Opcodes starting a new message (FIRST / ONLY of SEND, WRITE, READ RESPONSE) 
+    localparam lp_opcode_send_first = 8'h00; 
+    localparam lp_opcode_send_only = 8'h04; 
+    localparam lp_opcode_write_first = 8'h06; 
+    localparam lp_opcode_write_only = 8'h0a; 
+    localparam lp_opcode_read_resp_first = 8'h0d; 
+    localparam lp_opcode_read_resp_only = 8'h10; 
+
+    // Number of QPs with message state, message IDs per QP 
+    localparam lp_n_msg_qps = 1024; 
+    localparam lp_msg_id_bits = 4; 
+
+
     ////////////////////////////////////////////////////////////////////////////////
     //
     // Definition of data types
@@ -40,10 +63,21 @@ module intrusion_detection_decider(
     // 8 Bit Signal to hold the RDMA-Opcode 
     typedef logic [7:0] MetaOpcode; 
 
+    // Message ID, counts the messages of a QP 
+    typedef logic [lp_msg_id_bits-1:0] MsgID; 
+
+    // Failed message of a QP 
+    typedef struct packed{
+        logic valid; 
+        MsgID id; 
+    } FailedMsg; 
+
     // Combine QPN and Opcode to a single Meta-Datatype 
     typedef struct packed{
         MetaQPN QPN;
         MetaOpcode Opcode;
+        MsgID msg_id; 
+        logic skip; 
         logic incomplete; 
         logic valid; 
         logic last; 
@@ -86,6 +120,19 @@ module intrusion_detection_decider(
     // Input delay 
     DataWord input_data_delayed;
     logic input_valid_delayed;
+
+    // Current message per QP and the last failed one 
+    MsgID msg_id [lp_n_msg_qps]; 
+    FailedMsg msg_failed [lp_n_msg_qps]; 
+
+    // Packet on the input, message ID and skip are taken at the first word 
+    logic in_packet; 
+    MsgID packet_msg_id; 
+    logic packet_skip; 
+    logic [9:0] input_qpn; 
+    logic msg_start; 
+    MsgID word_msg_id; 
+    logic word_skip; 
  
 
     ///////////////////////////////////////////////////////////////////////////////
@@ -97,8 +144,22 @@ module intrusion_detection_decider(
     // Reversal of the reset for my own sanity
     assign rst_inverted = ~nresetn;
 
-    // Calculation of the final ACK / NAK decision 
-    assign decision_calculator = ((meta_pipeline[10].incomplete) ? (ml_decision_aggregator.acceptable) : (ml_decision_aggregator.acceptable & (~mlm_decision_data)));
+    // Opcode starting a new message 
+    function automatic logic is_msg_start(input MetaOpcode opcode); 
+        return (opcode == lp_opcode_send_first) || (opcode == lp_opcode_send_only) || 
+            (opcode == lp_opcode_write_first) || (opcode == lp_opcode_write_only) || 
+            (opcode == lp_opcode_read_resp_first) || (opcode == lp_opcode_read_resp_only); 
+    endfunction
+
+    // Calculation of the final ACK / NAK decision, skipped packets are rejected 
+    assign decision_calculator = (meta_pipeline[10].skip) ? 1'b0 : 
+        ((meta_pipeline[10].incomplete) ? (ml_decision_aggregator.acceptable) : (ml_decision_aggregator.acceptable & (~mlm_decision_data)));
+
+    // Message of the incoming word, a new one starts with FIRST / ONLY 
+    assign input_qpn = meta_rx_i[17:8]; 
+    assign msg_start = is_msg_start(meta_rx_i[7:0]); 
+    assign word_msg_id = in_packet ? packet_msg_id : (msg_start ? msg_id[input_qpn] + 1 : msg_id[input_qpn]); 
+    assign word_skip = in_packet ? packet_skip : (!msg_start && (msg_failed[input_qpn] == {1'b1, msg_id[input_qpn]})); 
 
     // Bit-Reversal of the input 
     always_comb begin
@@ -116,11 +177,11 @@ module intrusion_detection_decider(
     myproject intrusion_detector_1(
         .ap_clk(nclk), 
         .ap_rst(rst_inverted), 
-        .ap_start(s_axis_payload_rx.tvalid), 
+        .ap_start(s_axis_payload_rx.tvalid & ~word_skip), 
         .ap_done(mlm_done), 
         .ap_idle(mlm_idle), 
         .ap_ready(mlm_ready), 
-        .q_dense_input_ap_vld(s_axis_payload_rx.tvalid), 
+        .q_dense_input_ap_vld(s_axis_payload_rx.tvalid & ~word_skip), 
         .q_dense_input(mlm_input_word), 
         .layer12_out(mlm_decision_data), 
         .layer12_out_ap_vld(mlm_decision_valid)
@@ -137,6 +198,53 @@ module intrusion_detection_decider(
         .probe5(mlm_decision_valid)     // 1
     );*/
     
+    ///////////////////////////////////////////////////////////////////////////////
+    //
+    // Sequential logic of the per-QP message state
+    //
+    ///////////////////////////////////////////////////////////////////////////////
+
+    initial begin 
+        for(integer i = 0; i < lp_n_msg_qps; i++) begin 
+            msg_id[i] = '0; 
+            msg_failed[i] = '0; 
+        end 
+    end 
+
+    // Message ID of the first word of a packet 
+    always_ff @(posedge nclk) begin 
+        if(s_axis_payload_rx.tvalid && !in_packet) begin 
+            msg_id[input_qpn] <= word_msg_id; 
+        end 
+    end 
+
+    // Rejected packet, the rest of its message is skipped. An accepted first packet clears 
+    // the failure of an earlier message (message IDs wrap). 
+    always_ff @(posedge nclk) begin 
+        if(meta_pipeline[10].valid && meta_pipeline[10].last) begin 
+            if(!decision_calculator) begin 
+                msg_failed[meta_pipeline[10].QPN[9:0]] <= {1'b1, meta_pipeline[10].msg_id}; 
+            end else if(is_msg_start(meta_pipeline[10].Opcode)) begin 
+                msg_failed[meta_pipeline[10].QPN[9:0]] <= '0; 
+            end 
+        end 
+    end 
+
+    always_ff @(posedge nclk) begin 
+        if(rst_inverted) begin 
+            in_packet <= 1'b0; 
+            packet_msg_id <= '0; 
+            packet_skip <= 1'b0; 
+        end else begin 
+            if(s_axis_payload_rx.tvalid) begin 
+                in_packet <= ~s_axis_payload_rx.tlast; 
+                packet_msg_id <= word_msg_id; 
+                packet_skip <= word_skip; 
+            end 
+        end 
+    end 
+
+
     ///////////////////////////////////////////////////////////////////////////////
     //
     // Sequential logic of the meta-side channel
@@ -149,6 +257,8 @@ module intrusion_detection_decider(
             for(integer pipeline_stage = 0; pipeline_stage < 11; pipeline_stage++) begin 
                 meta_pipeline[pipeline_stage].QPN <= 24'b0;
                 meta_pipeline[pipeline_stage].Opcode <= 8'b0;
+                meta_pipeline[pipeline_stage].msg_id <= '0;
+                meta_pipeline[pipeline_stage].skip <= 1'b0;
                 meta_pipeline[pipeline_stage].incomplete <= 1'b0;
                 meta_pipeline[pipeline_stage].valid <= 1'b0;
                 meta_pipeline[pipeline_stage].last <= 1'b0;
@@ -158,12 +268,16 @@ module intrusion_detection_decider(
             if(s_axis_payload_rx.tvalid) begin 
                 meta_pipeline[0].QPN <= meta_rx_i[31:8];
                 meta_pipeline[0].Opcode <= meta_rx_i[7:0];
+                meta_pipeline[0].msg_id <= word_msg_id;
+                meta_pipeline[0].skip <= word_skip;
                 meta_pipeline[0].incomplete <= ~(s_axis_payload_rx.tkeep == 64'hffffffffffffffff);
                 meta_pipeline[0].valid <= s_axis_payload_rx.tvalid;
                 meta_pipeline[0].last <= s_axis_payload_rx.tlast;
             end else begin 
                 meta_pipeline[0].QPN <= 24'b0;
                 meta_pipeline[0].Opcode <= 8'b0;
+                meta_pipeline[0].msg_id <= '0;
+                meta_pipeline[0].skip <= 1'b0;
                 meta_pipeline[0].incomplete <= 1'b0;
                 meta_pipeline[0].valid <= 1'b0;
                 meta_pipeline[0].last <= 1'b0;
@@ -197,7 +311,7 @@ module intrusion_detection_decider(
                 if(meta_pipeline[10].last) begin 
                     // Send out ML-decision for the whole payload-chunk 
                     m_rdma_intrusion_decision.valid <= 1'b1;
-                    m_rdma_intrusion_decision.data[24:1] <= ml_decision_aggregator.QPN;
+                    m_rdma_intrusion_decision.data[24:1] <= meta_pipeline[10].QPN;
                     m_rdma_intrusion_decision.data[0] <= decision_calculator; 
 
                     // Reset the ml_decision_aggregator 
@@ -13,23 +13,57 @@ module rdma_flow (
     // Acks as responses to the user commands 
     metaIntf.m                  m_ack,
 
+    // Per-QP READ window, taken from the QP context (0 - RDMA_N_RD_OUTSTANDING)
+    input  logic                wnd_valid,
+    input  logic [RDMA_QPN_BITS-1:0] wnd_qpn,
+    input  logic [RDMA_RD_WND_BITS-1:0] wnd_rd,
+
     // Incoming clock and reset
     input  logic                aclk,
     input  logic                aresetn
 );
 
 // localparams for bitwidths
-localparam integer RDMA_N_OST = 16;
+// WRITEs are bound by the retransmission buffer slots (offs), READs by RDMA_N_RD_OUTSTANDING,
+// each has its own ring of ssns per QP
+localparam integer RDMA_WR_OST_BITS = RDMA_OFFS_BITS;
+localparam integer RDMA_RD_OST_BITS = $clog2(RDMA_N_RD_OUTSTANDING);
+localparam integer RDMA_N_OST = (RDMA_N_RD_OUTSTANDING > RDMA_N_WR_OUTSTANDING) ? RDMA_N_RD_OUTSTANDING : RDMA_N_WR_OUTSTANDING;
 localparam integer RDMA_OST_BITS = $clog2(RDMA_N_OST);
+localparam integer QP_BITS = N_REGIONS_BITS + PID_BITS;
+localparam integer N_QPS = 2**QP_BITS;
+
+// Per-QP head and tail of both rings, with a wrap bit, the number of outstanding requests is head - tail.
+// Kept in distributed RAM (one entry per QP), cleared by a sweep after reset.
+(* ram_style = "distributed" *) logic [2*(RDMA_WR_OST_BITS+1)-1:0] wr_ptr [N_QPS];
+(* ram_style = "distributed" *) logic [2*(RDMA_RD_OST_BITS+1)-1:0] rd_ptr [N_QPS];
+
+// READ window per QP (0 - RDMA_N_RD_OUTSTANDING)
+(* ram_style = "distributed" *) logic [RDMA_RD_WND_BITS-1:0] rd_wnd [N_QPS];
+
+// Reset sweep
+logic init_C = 1'b1;
+logic [QP_BITS-1:0] init_addr_C = 0;
 
-// READ and WRITE opcode 
-localparam integer RD_OP = 0;
-localparam integer WR_OP = 1;
+// Ring pointers of the serviced QP
+logic [QP_BITS-1:0] qp_addr;
+logic [RDMA_WR_OST_BITS:0] wr_head, wr_tail;
+logic [RDMA_RD_OST_BITS:0] rd_head, rd_tail;
+logic wr_ptr_we, rd_ptr_we;
+logic [2*(RDMA_WR_OST_BITS+1)-1:0] wr_ptr_in;
+logic [2*(RDMA_RD_OST_BITS+1)-1:0] rd_ptr_in;
+logic [RDMA_WR_OST_BITS:0] wr_issued;
+logic [RDMA_RD_OST_BITS:0] rd_issued;
+logic [RDMA_OST_BITS:0] issued;
 
-// Definition of status variables for C and N (head, tail and issue)
-logic [1:0][N_REGIONS_BITS-1:0][PID_BITS-1:0][RDMA_OST_BITS-1:0] head_C = 0, head_N;
-logic [1:0][N_REGIONS_BITS-1:0][PID_BITS-1:0][RDMA_OST_BITS-1:0] tail_C = 0, tail_N;
-logic [1:0][N_REGIONS_BITS-1:0][PID_BITS-1:0] issued_C = 0, issued_N;
+// Memory write ports, the sweep or the serviced QP
+logic [QP_BITS-1:0] ptr_waddr;
+logic wr_ptr_wen, rd_ptr_wen;
+logic [2*(RDMA_WR_OST_BITS+1)-1:0] wr_ptr_wdata;
+logic [2*(RDMA_RD_OST_BITS+1)-1:0] rd_ptr_wdata;
+logic [QP_BITS-1:0] wnd_waddr;
+logic wnd_wen;
+logic [RDMA_RD_WND_BITS-1:0] wnd_wdata;
 
 // Further variables C and N for ACKs etc. 
 logic ssn_rd_C = 0, ssn_rd_N;
@@ -37,15 +71,16 @@ logic [N_REGIONS_BITS-1:0] ack_vfid_C, ack_vfid_N;
 logic [PID_BITS-1:0] ack_pid_C, ack_pid_N;
 logic ack_rd_C, ack_rd_N;
 
-// Control and Data signals for the memory buffer 
+// Control and Data signals for the ssn memories (WRITE and READ ring)
 // Way selector
-logic [3:0] ssn_wr;
+logic [3:0] ssn_wr_we, ssn_rd_we;
 // Memory Address 
-logic [1+N_REGIONS_BITS+PID_BITS+RDMA_OST_BITS-1:0] ssn_addr;
+logic [QP_BITS+RDMA_WR_OST_BITS-1:0] ssn_wr_addr;
+logic [QP_BITS+RDMA_RD_OST_BITS-1:0] ssn_rd_addr;
 // Data In 
 logic [31:0] ssn_in;
 // Data Out
-logic [31:0] ssn_out;
+logic [31:0] ssn_wr_out, ssn_rd_out, ssn_out;
 
 // Definition of ACKs for reads 
 logic ack_rd;
@@ -56,28 +91,41 @@ logic [PID_BITS-1:0] ack_pid;
 logic req_rd;
 logic [N_REGIONS_BITS-1:0] req_vfid;
 logic [PID_BITS-1:0] req_pid;
+logic [RDMA_RD_WND_BITS-1:0] req_wnd_qp;
+logic [RDMA_RD_WND_BITS:0] req_wnd;
 
 metaIntf #(.STYPE(rdma_ack_t)) ack_que_in ();
 
-// Definition of a memory as buffer 
+// Definition of the memories as buffers 
 ram_sp_nc #(
-    .ADDR_BITS(1+N_REGIONS_BITS+PID_BITS+RDMA_OST_BITS),
+    .ADDR_BITS(QP_BITS+RDMA_WR_OST_BITS),
     .DATA_BITS(32)
-) inst_ssn (
+) inst_ssn_wr (
     .clk(aclk),
     .a_en(1'b1),
-    .a_we(ssn_wr),
-    .a_addr(ssn_addr),
+    .a_we(ssn_wr_we),
+    .a_addr(ssn_wr_addr),
     .a_data_in(ssn_in),
-    .a_data_out(ssn_out)
+    .a_data_out(ssn_wr_out)
+);
+
+ram_sp_nc #(
+    .ADDR_BITS(QP_BITS+RDMA_RD_OST_BITS),
+    .DATA_BITS(32)
+) inst_ssn_rd (
+    .clk(aclk),
+    .a_en(1'b1),
+    .a_we(ssn_rd_we),
+    .a_addr(ssn_rd_addr),
+    .a_data_in(ssn_in),
+    .a_data_out(ssn_rd_out)
 );
 
 // REG - at every clock counter, switch from N to C
 always_ff @(posedge aclk) begin
     if(~aresetn) begin
-        head_C <= 0;
-        tail_C <= 0;
-        issued_C <= 0;
+        init_C <= 1'b1;
+        init_addr_C <= 0;
 
         ssn_rd_C <= 1'b0;
         ack_vfid_C <= 'X;
@@ -85,9 +133,13 @@ always_ff @(posedge aclk) begin
         ack_rd_C <= 'X;
     end
     else begin
-        head_C <= head_N;
-        tail_C <= tail_N;
-        issued_C <= issued_N;
+        // A window write holds the sweep for a cycle
+        if(init_C && !wnd_valid) begin
+            init_addr_C <= init_addr_C + 1;
+            if(init_addr_C == N_QPS-1) begin
+                init_C <= 1'b0;
+            end
+        end
         
         ssn_rd_C <= ssn_rd_N;
         ack_vfid_C <= ack_vfid_N;
@@ -96,35 +148,76 @@ always_ff @(posedge aclk) begin
     end
 end
 
+// Pointer and window memories
+assign ptr_waddr = init_C ? init_addr_C : qp_addr;
+assign wr_ptr_wen = init_C | wr_ptr_we;
+assign rd_ptr_wen = init_C | rd_ptr_we;
+assign wr_ptr_wdata = init_C ? 0 : wr_ptr_in;
+assign rd_ptr_wdata = init_C ? 0 : rd_ptr_in;
+
+assign wnd_waddr = wnd_valid ? wnd_qpn[0+:QP_BITS] : init_addr_C;
+assign wnd_wen = wnd_valid | init_C;
+assign wnd_wdata = wnd_valid ? wnd_rd : 0;
+
+always_ff @(posedge aclk) begin
+    if(wr_ptr_wen) begin
+        wr_ptr[ptr_waddr] <= wr_ptr_wdata;
+    end
+    if(rd_ptr_wen) begin
+        rd_ptr[ptr_waddr] <= rd_ptr_wdata;
+    end
+    if(wnd_wen) begin
+        rd_wnd[wnd_waddr] <= wnd_wdata;
+    end
+end
+
+// One QP is serviced per cycle, the ACK first
+assign qp_addr = s_ack.valid ? {ack_vfid, ack_pid} : {req_vfid, req_pid};
+assign {wr_tail, wr_head} = wr_ptr[qp_addr];
+assign {rd_tail, rd_head} = rd_ptr[qp_addr];
+assign req_wnd_qp = rd_wnd[{req_vfid, req_pid}];
+
 // Service
 always_comb begin
     // Default case: Loop-back from C to N (opposed to always_ff)
-    head_N = head_C;
-    tail_N = tail_C;
-    issued_N = issued_C;
     ssn_rd_N = 1'b0;
     ack_vfid_N = ack_vfid_C;
     ack_pid_N = ack_pid_C;
     ack_rd_N = ack_rd_C;
+
+    wr_ptr_we = 1'b0;
+    rd_ptr_we = 1'b0;
+    wr_ptr_in = {wr_tail, wr_head};
+    rd_ptr_in = {rd_tail, rd_head};
     
-    ssn_wr = 0;
-    ssn_addr = 0;
+    ssn_wr_we = 0;
+    ssn_rd_we = 0;
+    ssn_wr_addr = 0;
+    ssn_rd_addr = 0;
     ssn_in = {6'd0, s_req.data.cmplt, s_req.data.last, s_req.data.ssn};
 
     s_ack.ready = 1'b0;
     s_req.ready = 1'b0;
 
-    if(s_ack.valid) begin
+    if(init_C) begin
+        // Clearing the pointers
+    end
+    else if(s_ack.valid) begin
         // Service ack
         s_ack.ready = 1'b1;
 
-        tail_N[ack_rd][ack_vfid][ack_pid] = tail_C[ack_rd][ack_vfid][ack_pid] + 1;
-        if(head_C[ack_rd][ack_vfid][ack_pid] == tail_N[ack_rd][ack_vfid][ack_pid]) begin
-            issued_N[ack_rd][ack_vfid][ack_pid] = 1'b0;
+        if(ack_rd) begin
+            rd_ptr_we = 1'b1;
+            rd_ptr_in = {rd_tail + 1'b1, rd_head};
+        end
+        else begin
+            wr_ptr_we = 1'b1;
+            wr_ptr_in = {wr_tail + 1'b1, wr_head};
         end
 
         ssn_rd_N = 1'b1;
-        ssn_addr = {ack_rd, ack_vfid[N_REGIONS_BITS-1:0], ack_pid, tail_C[ack_rd][ack_vfid][ack_pid]};
+        ssn_wr_addr = {ack_vfid, ack_pid, wr_tail[0+:RDMA_WR_OST_BITS]};
+        ssn_rd_addr = {ack_vfid, ack_pid, rd_tail[0+:RDMA_RD_OST_BITS]};
         
         ack_vfid_N = ack_vfid;
         ack_pid_N = ack_pid;
@@ -132,14 +225,22 @@ always_comb begin
     end
     else if(s_req.valid) begin
         // Service req
-        if((!issued_C[req_rd][req_vfid][req_pid] || (head_C[req_rd][req_vfid][req_pid] != tail_C[req_rd][req_vfid][req_pid])) && m_req.ready) begin
+        if((issued < req_wnd) && m_req.ready) begin
             s_req.ready = 1'b1;
 
-            head_N[req_rd][req_vfid][req_pid] = head_C[req_rd][req_vfid][req_pid] + 1;
-            issued_N[req_rd][req_vfid][req_pid] = 1'b1;
+            if(req_rd) begin
+                rd_ptr_we = 1'b1;
+                rd_ptr_in = {rd_tail, rd_head + 1'b1};
+                ssn_rd_we = ~0;
+            end
+            else begin
+                wr_ptr_we = 1'b1;
+                wr_ptr_in = {wr_tail, wr_head + 1'b1};
+                ssn_wr_we = ~0;
+            end
 
-            ssn_wr = ~0;
-            ssn_addr = {req_rd, req_vfid[N_REGIONS_BITS-1:0], req_pid, head_C[req_rd][req_vfid][req_pid]};
+            ssn_wr_addr = {req_vfid, req_pid, wr_head[0+:RDMA_WR_OST_BITS]};
+            ssn_rd_addr = {req_vfid, req_pid, rd_head[0+:RDMA_RD_OST_BITS]};
         end
     end
 end
@@ -148,10 +249,14 @@ always_comb begin
     m_req.valid = s_req.valid & s_req.ready;
 
     m_req.data = s_req.data;
-    m_req.data.offs = head_C[req_rd][req_vfid][req_pid];
+    // At most RDMA_N_WR_OUTSTANDING WRITEs in flight, the head of the WRITE ring is a free buffer slot
+    // (one per path MTU packet, the slot id is carried in the 4 bit dest of the memory command)
+    m_req.data.offs = req_rd ? 0 : wr_head[0+:RDMA_OFFS_BITS];
 end
 
 // DP
+assign ssn_out = ack_rd_C ? ssn_rd_out : ssn_wr_out;
+
 assign ack_que_in.valid = ssn_rd_C && ssn_out[RDMA_MSN_BITS];
 assign ack_que_in.data.rd = ack_rd_C;
 assign ack_que_in.data.cmplt = ssn_out[RDMA_MSN_BITS+1];
@@ -178,6 +283,19 @@ assign req_rd = s_req.data.opcode == RC_RDMA_READ_REQUEST;
 assign req_pid = s_req.data.qpn[0+:PID_BITS];
 assign req_vfid = s_req.data.qpn[PID_BITS+:N_REGIONS_BITS];
 
+assign wr_issued = wr_head - wr_tail;
+assign rd_issued = rd_head - rd_tail;
+assign issued = req_rd ? rd_issued : wr_issued;
+
+always_comb begin
+    if(!req_rd)
+        req_wnd = RDMA_N_WR_OUTSTANDING;
+    else if(req_wnd_qp == 0 || req_wnd_qp > RDMA_N_RD_OUTSTANDING)
+        req_wnd = RDMA_N_RD_OUTSTANDING;
+    else
+        req_wnd = req_wnd_qp;
+end
+
 /*
 ila_req inst_ila_req (
     .clk(aclk),
@@ -186,9 +304,9 @@ ila_req inst_ila_req (
     .probe2(s_req.data), // 512
     .probe3(m_req.valid),
     .probe4(m_req.ready), 
-    .probe5(head_C[0][0][0]), // 4 
-    .probe6(tail_C[0][0][0]), // 4
-    .probe7(issued_C[0][0][0]),
+    .probe5(wr_head), // 5
+    .probe6(wr_tail), // 5
+    .probe7(issued),
     .probe8(ssn_rd_C),
     .probe9(ack_vfid_C[0]),
     .probe10(ack_pid_C[0]), // 6
@@ -196,8 +314,8 @@ ila_req inst_ila_req (
     .probe12(s_ack.valid),
     .probe13(s_ack.ready),
     .probe14(s_ack.data), // 40
-    .probe15(ssn_wr), // 4
-    .probe16(ssn_addr), // 12
+    .probe15(ssn_wr_we), // 4
+    .probe16(ssn_wr_addr), // 11
     .probe17(ssn_in), // 32
     .probe18(ssn_out) // 32
 );
@@ -0,0 +1,220 @@
+/**
+  * Copyright (c) 2021, Systems Group, ETH Zurich
+  * All rights reserved.
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  * this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  * this list of conditions and the following disclaimer in the documentation
+  * and/or other materials provided with the distribution.
+  * 3. Neither the name of the copyright holder nor the names of its contributors
+  * may be used to endorse or promote products derived from this software
+  * without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+  * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  */
+
+`timescale 1ns / 1ps
+
+import lynxTypes::*;
+
+/**
+ * @brief   RDMA path MTU segmentation
+ *
+ * Splits the WRITE and SEND packets of the request parser (up to PMTU_BYTES) further
+ * into packets of the path MTU negotiated by the QP. Each packet is a request of its own,
+ * so it takes its own retransmission buffer slot in rdma_flow. The slot id rides the
+ * memory command dest field, so the WRITE bytes in flight per QP are bound by
+ * RDMA_N_WR_OUTSTANDING times the path MTU.
+ *
+ * The last packet of a request and the next request are taken in the same cycle.
+ */
+module rdma_pmtu_seg #(
+    parameter integer       DBG = 0
+) (
+    input  logic                        aclk,
+    input  logic                        aresetn,
+
+    metaIntf.s                          s_req,
+    metaIntf.m                          m_req,
+
+    // Path MTU of the QP, from the QP context
+    input  logic                        pmtu_valid,
+    input  logic [RDMA_QPN_BITS-1:0]    pmtu_qpn,
+    input  logic [RDMA_PMTU_BITS-1:0]   pmtu_enc
+);
+
+// FSM
+typedef enum logic[0:0]  {ST_IDLE, ST_SEND} state_t;
+logic [0:0] state_C, state_N;
+
+// Path MTU per QP (1 - 256 .. 5 - 4096, 0 - PMTU_BYTES), distributed RAM without a reset,
+// every QP context write sets it, a QP sends only after its context is written
+(* ram_style = "distributed" *) logic [RDMA_PMTU_BITS-1:0] pmtu_C [2**RDMA_QPN_BITS];
+logic [RDMA_PMTU_BITS-1:0] pmtu_req;
+logic [RDMA_LEN_BITS-1:0] mtu_req;
+
+// Request
+rdma_req_t req_C, req_N;
+logic [RDMA_VADDR_BITS-1:0] lvaddr_C, lvaddr_N;
+logic [RDMA_VADDR_BITS-1:0] rvaddr_C, rvaddr_N;
+logic [RDMA_LEN_BITS-1:0] len_C, len_N;
+logic [RDMA_LEN_BITS-1:0] mtu_C, mtu_N;
+logic [0:0] first_C, first_N;
+
+// Opcode classes
+logic is_wr, is_send, is_head, is_tail;
+logic split;
+logic [RDMA_OPCODE_BITS-1:0] op_first, op_middle, op_last;
+
+// REG
+always_ff @(posedge aclk) begin: PROC_REG
+    if (aresetn == 1'b0) begin
+        state_C <= ST_IDLE;
+    end
+    else begin
+        state_C <= state_N;
+
+        req_C <= req_N;
+        lvaddr_C <= lvaddr_N;
+        rvaddr_C <= rvaddr_N;
+        len_C <= len_N;
+        mtu_C <= mtu_N;
+        first_C <= first_N;
+    end
+end
+
+// Path MTU table
+always_ff @(posedge aclk) begin: PROC_PMTU
+    if(pmtu_valid) begin
+        pmtu_C[pmtu_qpn] <= pmtu_enc;
+    end
+end
+
+// Path MTU of the incoming request
+always_comb begin
+    pmtu_req = pmtu_C[s_req.data.qpn];
+
+    if(pmtu_req == 0 || pmtu_req > 5 || (128 << pmtu_req) > PMTU_BYTES)
+        mtu_req = PMTU_BYTES;
+    else
+        mtu_req = 128 << pmtu_req;
+end
+
+// Opcodes of the packets
+always_comb begin
+    is_wr = (req_C.opcode == RC_RDMA_WRITE_FIRST) || (req_C.opcode == RC_RDMA_WRITE_MIDDLE) ||
+            (req_C.opcode == RC_RDMA_WRITE_LAST) || (req_C.opcode == RC_RDMA_WRITE_ONLY);
+    is_send = (req_C.opcode == RC_SEND_FIRST) || (req_C.opcode == RC_SEND_MIDDLE) ||
+              (req_C.opcode == RC_SEND_LAST) || (req_C.opcode == RC_SEND_ONLY);
+    is_head = (req_C.opcode == RC_RDMA_WRITE_FIRST) || (req_C.opcode == RC_RDMA_WRITE_ONLY) ||
+              (req_C.opcode == RC_SEND_FIRST) || (req_C.opcode == RC_SEND_ONLY);
+    is_tail = (req_C.opcode == RC_RDMA_WRITE_LAST) || (req_C.opcode == RC_RDMA_WRITE_ONLY) ||
+              (req_C.opcode == RC_SEND_LAST) || (req_C.opcode == RC_SEND_ONLY);
+
+    op_first = is_wr ? RC_RDMA_WRITE_FIRST : RC_SEND_FIRST;
+    op_middle = is_wr ? RC_RDMA_WRITE_MIDDLE : RC_SEND_MIDDLE;
+    op_last = is_wr ? RC_RDMA_WRITE_LAST : RC_SEND_LAST;
+
+    split = (is_wr || is_send) && (len_C > mtu_C);
+end
+
+// NSL
+always_comb begin: NSL
+	state_N = state_C;
+
+	case(state_C)
+		ST_IDLE: 
+			if(s_req.valid) begin
+                state_N = ST_SEND;
+            end
+
+        ST_SEND:
+            if(m_req.ready && !split && !s_req.valid) begin
+                state_N = ST_IDLE;
+            end
+
+	endcase // state_C
+end
+
+// DP
+always_comb begin: DP
+    req_N = req_C;
+    lvaddr_N = lvaddr_C;
+    rvaddr_N = rvaddr_C;
+    len_N = len_C;
+    mtu_N = mtu_C;
+    first_N = first_C;
+
+    // Flow
+    s_req.ready = 1'b0;
+    m_req.valid = 1'b0;
+
+    // Data
+    m_req.data = req_C;
+    m_req.data.msg[RDMA_LVADDR_OFFS+:RDMA_VADDR_BITS] = lvaddr_C;
+    m_req.data.msg[RDMA_RVADDR_OFFS+:RDMA_VADDR_BITS] = rvaddr_C;
+
+    if(split) begin
+        m_req.data.opcode = (first_C && is_head) ? op_first : op_middle;
+        m_req.data.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS] = mtu_C;
+        m_req.data.last = 1'b0;
+    end
+    else begin
+        m_req.data.opcode = first_C ? req_C.opcode : (is_tail ? op_last : op_middle);
+        m_req.data.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS] = len_C;
+    end
+
+    case(state_C)
+        ST_IDLE: begin
+            s_req.ready = 1'b1;
+        end
+
+        ST_SEND: begin
+            m_req.valid = 1'b1;
+
+            if(m_req.ready) begin
+                if(split) begin
+                    lvaddr_N = lvaddr_C + mtu_C;
+                    rvaddr_N = is_wr ? rvaddr_C + mtu_C : rvaddr_C;
+                    len_N = len_C - mtu_C;
+                    first_N = 1'b0;
+                end
+                else begin
+                    s_req.ready = 1'b1;
+                end
+            end
+        end
+
+    endcase
+
+    // Next request
+    if(s_req.ready) begin
+        req_N = s_req.data;
+        lvaddr_N = s_req.data.msg[RDMA_LVADDR_OFFS+:RDMA_VADDR_BITS];
+        rvaddr_N = s_req.data.msg[RDMA_RVADDR_OFFS+:RDMA_VADDR_BITS];
+        len_N = s_req.data.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS];
+        mtu_N = mtu_req;
+        first_N = 1'b1;
+    end
+end
+
+/////////////////////////////////////////////////////////////////////////////
+// DEBUG
+/////////////////////////////////////////////////////////////////////////////
+`ifdef DBG_RDMA_PMTU_SEG
+
+`endif
+
+endmodule
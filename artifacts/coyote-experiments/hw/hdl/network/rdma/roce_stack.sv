@@ -58,6 +58,7 @@ module roce_stack (
     metaIntf.s                  s_rdma_qp_interface,
     metaIntf.s                  s_rdma_conn_interface,
     input  logic [31:0]         local_ip_address,
+    input  logic [63:0]         dcqcn_cnfg,
 
     output logic                ibv_rx_pkg_count_valid,
     output logic [31:0]         ibv_rx_pkg_count_data,    
@@ -68,7 +69,15 @@ module roce_stack (
     output logic                psn_drop_pkg_count_valid,
     output logic [31:0]         psn_drop_pkg_count_data,
     output logic                retrans_count_valid,
-    output logic [31:0]         retrans_count_data
+    output logic [31:0]         retrans_count_data,
+    output logic                dpi_reject_count_valid,
+    output logic [31:0]         dpi_reject_count_data,
+    output logic                dpi_monitor_count_valid,
+    output logic [31:0]         dpi_monitor_count_data,
+    output logic                dpi_quarantine_count_valid,
+    output logic [31:0]         dpi_quarantine_count_data,
+    output logic                dpi_quarantine_qpn_valid,
+    output logic [31:0]         dpi_quarantine_qpn_data
 );
 
 //
@@ -146,14 +155,30 @@ assign rdma_ack.data.pid = ack_meta_data[1+:PID_BITS];
 assign rdma_ack.data.vfid = ack_meta_data[1+PID_BITS+:N_REGIONS_BITS]; 
 assign rdma_ack.data.ssn = ack_meta_data[1+RDMA_ACK_QPN_BITS+:RDMA_ACK_PSN_BITS]; // msn
 
+// Path MTU - splits the user commands in packets of the QP path MTU
+metaIntf #(.STYPE(rdma_req_t)) rdma_sq_seg ();
+
+rdma_pmtu_seg inst_rdma_pmtu_seg (
+    .aclk(nclk),
+    .aresetn(nresetn),
+    .s_req(s_rdma_sq),
+    .m_req(rdma_sq_seg),
+    .pmtu_valid(s_rdma_qp_interface.valid & s_rdma_qp_interface.ready),
+    .pmtu_qpn(s_rdma_qp_interface.data[32+:RDMA_QPN_BITS]),
+    .pmtu_enc(s_rdma_qp_interface.data[27+:RDMA_PMTU_BITS])
+);
+
 // Flow control - controls flow of user commands 
 rdma_flow inst_rdma_flow (
     .aclk(nclk),
     .aresetn(nresetn),
-    .s_req(s_rdma_sq),
+    .s_req(rdma_sq_seg),
     .m_req(rdma_sq),
     .s_ack(rdma_ack),
-    .m_ack(m_rdma_ack)
+    .m_ack(m_rdma_ack),
+    .wnd_valid(s_rdma_qp_interface.valid & s_rdma_qp_interface.ready),
+    .wnd_qpn(s_rdma_qp_interface.data[32+:RDMA_QPN_BITS]),
+    .wnd_rd(s_rdma_qp_interface.data[18+:RDMA_RD_WND_BITS])
 );
 /*
 ila_ack inst_ila_ack (
@@ -194,7 +219,12 @@ payload_extractor inst_payload_extractor (
     .m_axis_rx_valid_i(s_axis_rx.tvalid), 
     .m_axis_rx_last_i(s_axis_rx.tlast), 
     .m_axis_payload_tx(payload_output), 
-    .meta_tx_o(meta_tx_o)
+    .meta_tx_o(meta_tx_o), 
+    .policy_valid_i(s_rdma_qp_interface.valid & s_rdma_qp_interface.ready), 
+    .policy_qpn_i(s_rdma_qp_interface.data[32+:10]), 
+    .policy_mode_i(s_rdma_qp_interface.data[8+:2]), 
+    .quarantine_valid_i(dpi_quarantine_qpn_valid), 
+    .quarantine_qpn_i(dpi_quarantine_qpn_data[9:0])
 );
 
 // Instantiate the intrusion_detection_decider 
@@ -477,6 +507,9 @@ rocev2_ip rocev2_inst(
     // IP
     .local_ip_address({local_ip_address,local_ip_address,local_ip_address,local_ip_address}), //Use IPv4 addr
 
+    // DCQCN
+    .dcqcnCnfg(dcqcn_cnfg),
+
     .regIbvCountRx(ibv_rx_pkg_count_data),
     .regIbvCountRx_ap_vld(ibv_rx_pkg_count_valid),
     .regIbvCountTx(ibv_tx_pkg_count_data),
@@ -486,7 +519,15 @@ rocev2_ip rocev2_inst(
     .regInvalidPsnDropCount(psn_drop_pkg_count_data),
     .regInvalidPsnDropCount_ap_vld(psn_drop_pkg_count_valid),
     .regRetransCount(retrans_count_data),
-    .regRetransCount_ap_vld(retrans_count_valid)
+    .regRetransCount_ap_vld(retrans_count_valid),
+    .regDpiRejectCount(dpi_reject_count_data),
+    .regDpiRejectCount_ap_vld(dpi_reject_count_valid),
+    .regDpiMonitorCount(dpi_monitor_count_data),
+    .regDpiMonitorCount_ap_vld(dpi_monitor_count_valid),
+    .regDpiQuarantineCount(dpi_quarantine_count_data),
+    .regDpiQuarantineCount_ap_vld(dpi_quarantine_count_valid),
+    .regDpiQuarantineQpn(dpi_quarantine_qpn_data),
+    .regDpiQuarantineQpn_ap_vld(dpi_quarantine_qpn_valid)
     
 `else
 
@@ -588,6 +629,9 @@ rocev2_ip rocev2_inst(
     // IP
     .local_ip_address_V({local_ip_address,local_ip_address,local_ip_address,local_ip_address}), //Use IPv4 addr
 
+    // DCQCN
+    .dcqcnCnfg_V(dcqcn_cnfg),
+
     .regIbvCountRx_V(ibv_rx_pkg_count_data),
     .regIbvCountRx_V_ap_vld(ibv_rx_pkg_count_valid),
     .regIbvCountTx_V(ibv_tx_pkg_count_data),
@@ -597,7 +641,15 @@ rocev2_ip rocev2_inst(
     .regInvalidPsnDropCount_V(psn_drop_pkg_count_data),
     .regInvalidPsnDropCount_V_ap_vld(psn_drop_pkg_count_valid),
     .regRetransCount_V(retrans_count_data),
-    .regRetransCount_V_ap_vld(retrans_count_valid)
+    .regRetransCount_V_ap_vld(retrans_count_valid),
+    .regDpiRejectCount_V(dpi_reject_count_data),
+    .regDpiRejectCount_V_ap_vld(dpi_reject_count_valid),
+    .regDpiMonitorCount_V(dpi_monitor_count_data),
+    .regDpiMonitorCount_V_ap_vld(dpi_monitor_count_valid),
+    .regDpiQuarantineCount_V(dpi_quarantine_count_data),
+    .regDpiQuarantineCount_V_ap_vld(dpi_quarantine_count_valid),
+    .regDpiQuarantineQpn_V(dpi_quarantine_qpn_data),
+    .regDpiQuarantineQpn_V_ap_vld(dpi_quarantine_qpn_valid)
 
 `endif
 );
@@ -59,6 +59,7 @@ module network_stack #(
     /* QP interface */
     metaIntf.s                  s_rdma_qp_interface,
     metaIntf.s                  s_rdma_conn_interface,
+    input  logic [63:0]         s_rdma_dcqcn_cnfg,
 
     /* Commands */
     metaIntf.s                  s_rdma_sq,
@@ -213,6 +214,14 @@ logic[31:0] regInvalidPsnDropCount;
 logic       regInvalidPsnDropCount_valid;
 logic[31:0] regRetransCount;
 logic       regRetransCount_valid;
+logic[31:0] regDpiRejectCount;
+logic       regDpiRejectCount_valid;
+logic[31:0] regDpiMonitorCount;
+logic       regDpiMonitorCount_valid;
+logic[31:0] regDpiQuarantineCount;
+logic       regDpiQuarantineCount_valid;
+logic[31:0] regDpiQuarantineQpn;
+logic       regDpiQuarantineQpn_valid;
 
 logic       session_count_valid;
 logic[15:0] session_count_data;
@@ -786,6 +795,7 @@ roce_stack inst_roce_stack (
     
     //.local_ip_address_V(link_local_ipv6_address), // Use IPv6 addr
     .local_ip_address(iph_ip_address), //Use IPv4 addr
+    .dcqcn_cnfg(s_rdma_dcqcn_cnfg),
 
     // Debug
     .ibv_rx_pkg_count_valid(regIbvRxPkgCount_valid),
@@ -797,7 +807,15 @@ roce_stack inst_roce_stack (
     .psn_drop_pkg_count_valid(regInvalidPsnDropCount_valid),
     .psn_drop_pkg_count_data(regInvalidPsnDropCount),
     .retrans_count_valid(regRetransCount_valid),
-    .retrans_count_data(regRetransCount)
+    .retrans_count_data(regRetransCount),
+    .dpi_reject_count_valid(regDpiRejectCount_valid),
+    .dpi_reject_count_data(regDpiRejectCount),
+    .dpi_monitor_count_valid(regDpiMonitorCount_valid),
+    .dpi_monitor_count_data(regDpiMonitorCount),
+    .dpi_quarantine_count_valid(regDpiQuarantineCount_valid),
+    .dpi_quarantine_count_data(regDpiQuarantineCount),
+    .dpi_quarantine_qpn_valid(regDpiQuarantineQpn_valid),
+    .dpi_quarantine_qpn_data(regDpiQuarantineQpn)
 );
 /*
 ila_roce inst_ila_roce (
@@ -974,6 +992,10 @@ end
     assign net_stats_tmp[0].ibv_tx_pkg_counter = regIbvTxPkgCount;
     assign net_stats_tmp[0].roce_psn_drop_counter = regInvalidPsnDropCount;
     assign net_stats_tmp[0].roce_retrans_counter = regRetransCount;
+    assign net_stats_tmp[0].roce_dpi_reject_counter = regDpiRejectCount;
+    assign net_stats_tmp[0].roce_dpi_monitor_counter = regDpiMonitorCount;
+    assign net_stats_tmp[0].roce_dpi_quarantine_counter = regDpiQuarantineCount;
+    assign net_stats_tmp[0].roce_dpi_quarantine_qpn = regDpiQuarantineQpn;
     assign net_stats_tmp[0].tcp_session_counter = session_count_data;
     assign net_stats_tmp[0].axis_stream_down = axis_stream_down;
 
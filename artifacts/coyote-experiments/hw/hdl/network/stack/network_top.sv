@@ -66,6 +66,7 @@ module network_top #(
 
     metaIntf.s                  s_rdma_qp_interface,
     metaIntf.s                  s_rdma_conn_interface,
+    input  logic [63:0]         s_rdma_dcqcn_cnfg,
 
     // Commands
     metaIntf.s                  s_rdma_sq,
@@ -309,6 +310,7 @@ AXI4S #(.AXI4S_DATA_BITS(AXI_NET_BITS)) axis_tcp_tx_aclk ();
 
 // Regs
 logic [N_REG_NET_S0:0][63:0] ddr_offset_addr;
+logic [1:0][63:0] rdma_dcqcn_cnfg_n_clk;
 AXI4 axi_tcp_ddr_slice ();
 
 /**
@@ -343,6 +345,14 @@ inst_network_dropper (
 //     .probe4(axis_n_clk_tx_data.tdata)   // 512
 // ); 
 
+/**
+ * DCQCN parameters, quasi-static (written before the QPs are set up), registered into the network clock
+ */
+always_ff @(posedge n_clk) begin
+    rdma_dcqcn_cnfg_n_clk[0] <= s_rdma_dcqcn_cnfg;
+    rdma_dcqcn_cnfg_n_clk[1] <= rdma_dcqcn_cnfg_n_clk[0];
+end
+
 /**
  * Network stack
  */
@@ -363,6 +373,7 @@ network_stack #(
 
     .s_rdma_qp_interface(rdma_qp_interface_n_clk),
     .s_rdma_conn_interface(rdma_conn_interface_n_clk),
+    .s_rdma_dcqcn_cnfg(rdma_dcqcn_cnfg_n_clk[1]),
 
     .s_rdma_sq(rdma_sq_n_clk),
     .m_rdma_ack(rdma_ack_n_clk),
@@ -309,6 +309,11 @@ localparam integer STAT_INVLDT_REG                          = 12;
 localparam integer STAT_PFAULT_REG                          = 13;
 localparam integer STAT_NOTIFY_REG                          = 14;
 
+// 15 (RW) : IRQ coalescing
+localparam integer IRQ_COAL_REG                             = 15;
+    localparam integer IRQ_COAL_TIME_OFFS   = 0; // cycles
+    localparam integer IRQ_COAL_CNT_OFFS    = 32; // events
+
 // 17 - 20 (RW) : Writeback
 localparam integer WBACK_LCL_RD_OFFS_REG                    = 16;
 localparam integer WBACK_LCL_WR_OFFS_REG                    = 17;
@@ -373,6 +378,7 @@ always_ff @(posedge aclk) begin
         
         slv_reg[CTRL_REG][31:0] <= 0;
         slv_reg[ISR_REG][7:0] <= 0;
+        slv_reg[IRQ_COAL_REG] <= 0;
         slv_reg[OFFL_CTRL_REG][31:0] <= 0;
         slv_reg[SYNC_CTRL_REG][31:0] <= 0;
 
@@ -598,6 +604,13 @@ always_ff @(posedge aclk) begin
                 invldt_post <= s_axi_ctrl.wdata[ISR_INVLDT];
             end
           end
+
+        IRQ_COAL_REG: // IRQ coalescing
+          for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
+            if(s_axi_ctrl.wstrb[i]) begin
+              slv_reg[IRQ_COAL_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
         ISR_HPID_PID_MISS_REG: // Pid miss
           for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
             if(s_axi_ctrl.wstrb[i]) begin
@@ -828,6 +841,8 @@ always_ff @(posedge aclk) begin
           axi_rdata <= slv_reg[STAT_PFAULT_REG];
         STAT_NOTIFY_REG:
           axi_rdata <= slv_reg[STAT_NOTIFY_REG];
+        IRQ_COAL_REG:
+          axi_rdata <= slv_reg[IRQ_COAL_REG];
 
 `ifdef EN_WB
         WBACK_LCL_RD_OFFS_REG: // Writeback read
@@ -1163,7 +1178,49 @@ assign pfault_rd_ctrl.data = slv_reg[ISR_REG][ISR_SUCCESS];
 assign pfault_wr_ctrl.valid = slv_reg[ISR_REG][ISR_RESTART_RD];
 assign pfault_wr_ctrl.data = slv_reg[ISR_REG][ISR_SUCCESS];
 
-assign usr_irq = irq_pending;
+// ---------------------------------------------------------------------------------------- 
+// IRQ coalescing
+// ----------------------------------------------------------------------------------------
+// Page faults and invalidations stall the region and are raised right away. Other events 
+// (notify, offload, sync) are held until CNT events are waiting or the oldest one waited 
+// TIME cycles. A zero threshold is disabled, with both at zero coalescing is off.
+// Once raised, the interrupt stays up until the host clears the latched event.
+logic irq_bypass;
+logic irq_fired;
+logic [31:0] irq_coal_timer;
+logic [4:0] irq_notify_cnt; // queued notifications
+logic [5:0] irq_waiting; // latched + queued events
+logic irq_cnt_hit;
+logic irq_time_hit;
+logic irq_fire;
+
+assign irq_bypass = (slv_reg[ISR_REG][TYPE_MISS_OFFS+:16] == IRQ_PFAULT) || (slv_reg[ISR_REG][TYPE_MISS_OFFS+:16] == IRQ_INVLDT);
+`ifdef EN_MEM
+assign irq_waiting = irq_pending + irq_notify_cnt + offload_rsp + sync_rsp;
+`else
+assign irq_waiting = irq_pending + irq_notify_cnt;
+`endif
+assign irq_cnt_hit = (slv_reg[IRQ_COAL_REG][IRQ_COAL_CNT_OFFS+:16] != 0) && 
+                     (slv_reg[IRQ_COAL_REG][IRQ_COAL_CNT_OFFS+:16] <= irq_waiting);
+assign irq_time_hit = (slv_reg[IRQ_COAL_REG][IRQ_COAL_TIME_OFFS+:32] != 0) && 
+                      (slv_reg[IRQ_COAL_REG][IRQ_COAL_TIME_OFFS+:32] <= irq_coal_timer);
+assign irq_fire = irq_bypass || irq_cnt_hit || irq_time_hit ||
+                  ((slv_reg[IRQ_COAL_REG][IRQ_COAL_CNT_OFFS+:16] == 0) && (slv_reg[IRQ_COAL_REG][IRQ_COAL_TIME_OFFS+:32] == 0));
+
+always_ff @(posedge aclk) begin
+    if(aresetn == 1'b0) begin
+        irq_fired <= 1'b0;
+        irq_coal_timer <= 0;
+        irq_notify_cnt <= 0;
+    end
+    else begin
+        irq_fired <= irq_pending & (irq_fired | irq_fire);
+        irq_coal_timer <= ((irq_waiting != 0) & ~irq_fired) ? irq_coal_timer + 1 : 0;
+        irq_notify_cnt <= irq_notify_cnt + (s_notify.valid & s_notify.ready) - (notify_irq.valid & notify_irq.ready);
+    end
+end
+
+assign usr_irq = irq_pending & (irq_fired | irq_fire);
 
 // Host request
 metaIntf #(.STYPE(dreq_t)) host_req ();
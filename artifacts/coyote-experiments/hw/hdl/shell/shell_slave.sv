@@ -150,6 +150,8 @@ localparam integer NET_STAT_IBV_REG       = 101;
 localparam integer NET_STAT_DROP_REG      = 102;
 localparam integer NET_STAT_SESS_REG      = 103;
 localparam integer NET_STAT_DOWN_REG      = 104;
+localparam integer NET_STAT_DPI_REG       = 105;
+localparam integer NET_STAT_QRNT_REG      = 106;
 
 // ---------------------------------------------------------------------------------------- 
 // Write process 
@@ -333,6 +335,10 @@ always_ff @(posedge aclk) begin
             axi_rdata[31:0] <= s_net_stats.tcp_session_counter; 
           NET_STAT_DOWN_REG: // rdma
             axi_rdata[0] <= s_net_stats.axis_stream_down;
+          NET_STAT_DPI_REG: // rdma dpi
+            axi_rdata <= {s_net_stats.roce_dpi_monitor_counter, s_net_stats.roce_dpi_reject_counter};
+          NET_STAT_QRNT_REG: // rdma dpi quarantine
+            axi_rdata <= {s_net_stats.roce_dpi_quarantine_qpn, s_net_stats.roce_dpi_quarantine_counter};
   `endif
 
 `endif
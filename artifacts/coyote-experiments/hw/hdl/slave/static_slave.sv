@@ -80,11 +80,13 @@ module static_slave (
 `ifdef EN_RDMA_0
   metaIntf.m                m_rdma_0_qp_interface,
   metaIntf.m                m_rdma_0_conn_interface,
+  output logic [63:0]       m_rdma_0_dcqcn_cnfg,
 `endif
 
 `ifdef EN_RDMA_1
   metaIntf.m                m_rdma_1_qp_interface,
   metaIntf.m                m_rdma_1_conn_interface,
+  output logic [63:0]       m_rdma_1_dcqcn_cnfg,
 `endif
 
 `ifdef EN_TCP_0
@@ -306,6 +308,10 @@ localparam integer NET_DROP_CLEAR_0       = 46;
 localparam integer NET_DROP_RX_1          = 47;
 localparam integer NET_DROP_TX_1          = 48;
 localparam integer NET_DROP_CLEAR_1       = 49;
+// DCQCN
+// 50 - 51 (RW) : DCQCN parameters
+localparam integer RDMA_0_DCQCN_REG       = 50;
+localparam integer RDMA_1_DCQCN_REG       = 51;
 
 // XDMA STATS
 localparam integer XDMA_STAT_0_BPSS       = 66;
@@ -331,6 +337,8 @@ localparam integer NET_STAT_0_IBV_REG     = 103;
 localparam integer NET_STAT_0_DROP_REG    = 104;
 localparam integer NET_STAT_0_SESS_REG    = 105;
 localparam integer NET_STAT_0_DOWN_REG    = 106;
+localparam integer NET_STAT_0_DPI_REG     = 107;
+localparam integer NET_STAT_0_QRNT_REG    = 108;
 
 localparam integer NET_STAT_1_PKG_REG     = 130;
 localparam integer NET_STAT_1_ARP_REG     = 131;
@@ -341,6 +349,8 @@ localparam integer NET_STAT_1_IBV_REG     = 135;
 localparam integer NET_STAT_1_DROP_REG    = 136;
 localparam integer NET_STAT_1_SESS_REG    = 137;
 localparam integer NET_STAT_1_DOWN_REG    = 138;
+localparam integer NET_STAT_1_DPI_REG     = 139;
+localparam integer NET_STAT_1_QRNT_REG    = 140;
 
 // ---------------------------------------------------------------------------------------- 
 // Write process 
@@ -381,11 +391,13 @@ always_ff @(posedge aclk) begin
 `ifdef EN_RDMA_0
     m_rdma_0_qp_interface.valid <= 1'b0;
     m_rdma_0_conn_interface.valid <= 1'b0;
+    slv_reg[RDMA_0_DCQCN_REG] <= 0;
 `endif 
 
 `ifdef EN_RDMA_1
     m_rdma_1_qp_interface.valid <= 1'b0;
     m_rdma_1_conn_interface.valid <= 1'b0;
+    slv_reg[RDMA_1_DCQCN_REG] <= 0;
 `endif 
 
 `ifdef EN_TCP_0
@@ -615,6 +627,12 @@ always_ff @(posedge aclk) begin
               m_rdma_0_conn_interface.valid <= 1'b1;
             end
           end
+        RDMA_0_DCQCN_REG: // DCQCN
+          for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
+            if(s_axi_ctrl.wstrb[i]) begin
+              slv_reg[RDMA_0_DCQCN_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
 `endif
 
 `ifdef EN_RDMA_1
@@ -664,6 +682,12 @@ always_ff @(posedge aclk) begin
               m_rdma_1_conn_interface.valid <= 1'b1;
             end
           end
+        RDMA_1_DCQCN_REG: // DCQCN
+          for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
+            if(s_axi_ctrl.wstrb[i]) begin
+              slv_reg[RDMA_1_DCQCN_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
 `endif
 
 `ifdef EN_TCP_0
@@ -833,6 +857,8 @@ always_ff @(posedge aclk) begin
           axi_rdata <= slv_reg[RDMA_0_CONN_REG_1];
         RDMA_0_CONN_REG_2: // Connection final
           axi_rdata <= slv_reg[RDMA_0_CONN_REG_2];
+        RDMA_0_DCQCN_REG: // DCQCN
+          axi_rdata <= slv_reg[RDMA_0_DCQCN_REG];
 `endif
 
 `ifdef EN_RDMA_1
@@ -850,6 +876,8 @@ always_ff @(posedge aclk) begin
           axi_rdata <= slv_reg[RDMA_1_CONN_REG_1];
         RDMA_1_CONN_REG_2: // Connection final
           axi_rdata <= slv_reg[RDMA_1_CONN_REG_2];
+        RDMA_1_DCQCN_REG: // DCQCN
+          axi_rdata <= slv_reg[RDMA_1_DCQCN_REG];
 `endif
 
 `ifdef EN_TCP_0
@@ -923,6 +951,10 @@ always_ff @(posedge aclk) begin
             axi_rdata[31:0] <= s_net_stats_0.tcp_session_counter; 
           NET_STAT_0_DOWN_REG: // rdma
             axi_rdata[0] <= s_net_stats_0.axis_stream_down;
+          NET_STAT_0_DPI_REG: // rdma dpi
+            axi_rdata <= {s_net_stats_0.roce_dpi_monitor_counter, s_net_stats_0.roce_dpi_reject_counter};
+          NET_STAT_0_QRNT_REG: // rdma dpi quarantine
+            axi_rdata <= {s_net_stats_0.roce_dpi_quarantine_qpn, s_net_stats_0.roce_dpi_quarantine_counter};
   `endif
 
   `ifdef EN_NET_1
@@ -944,6 +976,10 @@ always_ff @(posedge aclk) begin
             axi_rdata[31:0] <= s_net_stats_1.tcp_session_counter; 
           NET_STAT_1_DOWN_REG: // rdma
             axi_rdata[0] <= s_net_stats_1.axis_stream_down;
+          NET_STAT_1_DPI_REG: // rdma dpi
+            axi_rdata <= {s_net_stats_1.roce_dpi_monitor_counter, s_net_stats_1.roce_dpi_reject_counter};
+          NET_STAT_1_QRNT_REG: // rdma dpi quarantine
+            axi_rdata <= {s_net_stats_1.roce_dpi_quarantine_qpn, s_net_stats_1.roce_dpi_quarantine_counter};
   `endif
 
 `endif
@@ -1124,6 +1160,9 @@ assign m_rdma_0_conn_interface.data[103:40] = slv_reg[RDMA_0_CONN_REG_1][63:0];
 assign m_rdma_0_conn_interface.data[167:104] = slv_reg[RDMA_0_CONN_REG_2][63:0]; // gid
 assign m_rdma_0_conn_interface.data[183:168] = slv_reg[RDMA_0_CONN_REG_0][55:40]; // port
 
+// DCQCN parameters
+assign m_rdma_0_dcqcn_cnfg = slv_reg[RDMA_0_DCQCN_REG];
+
 `endif
 
 `ifdef EN_RDMA_1
@@ -1140,6 +1179,9 @@ assign m_rdma_1_conn_interface.data[103:40] = slv_reg[RDMA_1_CONN_REG_1][63:0];
 assign m_rdma_1_conn_interface.data[167:104] = slv_reg[RDMA_1_CONN_REG_2][63:0]; // gid
 assign m_rdma_1_conn_interface.data[183:168] = slv_reg[RDMA_1_CONN_REG_0][55:40]; // port
 
+// DCQCN parameters
+assign m_rdma_1_dcqcn_cnfg = slv_reg[RDMA_1_DCQCN_REG];
+
 `endif
 
 `ifdef EN_TCP_0
@@ -0,0 +1,531 @@
+/************************************************
+Copyright (c) 2019, Systems Group, ETH Zurich.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************/
+#pragma once
+
+#include <iostream>
+#include "../axi_utils.hpp"
+#include "ib_transport_protocol.hpp"
+#include <rocev2_config.hpp> //defines MAX_QPS
+
+using namespace hls;
+
+/*
+ * DCQCN congestion control
+ *
+ * Notification point (NP): CE marked packets trigger a CNP back to the sender, at most one per QP every DCQCN_TIME_CNP
+ * Reaction point (RP): a CNP cuts the current rate of the QP by alpha/2, alpha recovers on a timer, the rate on
+ * the rate timer and on a byte counter (DCQCN_BYTE_COUNTER bytes sent), fast recovery until either stage passed F,
+ * additive increase until both did, then hyper increase towards the line rate
+ * Rates are fractions of the data path rate (one WIDTH beat per cycle), DCQCN_RATE_LINE is the full rate
+ */
+const uint32_t DCQCN_RATE_BITS = 15;
+const uint32_t DCQCN_ALPHA_BITS = 10;
+static const ap_uint<DCQCN_RATE_BITS> DCQCN_RATE_LINE = 1 << (DCQCN_RATE_BITS-1);
+static const ap_uint<DCQCN_ALPHA_BITS+1> DCQCN_ALPHA_ONE = 1 << DCQCN_ALPHA_BITS;
+
+// Defaults of the dcqcnCnfg fields left at 0
+const uint32_t DCQCN_DEF_G = 4; // alpha gain 1/16
+const uint32_t DCQCN_DEF_F = 5; // fast recovery periods
+const uint32_t DCQCN_DEF_AI = 40; // additive increase, ~0.25% of the line rate
+const uint32_t DCQCN_DEF_HAI = 400; // hyper increase
+const uint32_t DCQCN_DEF_MIN_RATE = 1; // in 1/256 of the line rate
+const uint32_t DCQCN_DEF_PERIOD = 1; // timer multiplier
+
+// Max. credit of an idle paced QP, in bytes
+const uint32_t DCQCN_BURST = PMTU;
+// Fraction bits of the pacer credit, a QP at the min. rate earns less than a byte per cycle
+const uint32_t DCQCN_CREDIT_FRAC_BITS = DCQCN_RATE_BITS-1;
+
+// Pacer queues, QPs map to bucket qpn % DCQCN_PACER_BUCKETS, a paced QP only blocks its own bucket
+// (and the shared input once DCQCN_PACER_DEPTH of its requests are waiting)
+const uint32_t DCQCN_PACER_BUCKET_BITS = 2;
+const uint32_t DCQCN_PACER_BUCKETS = 1 << DCQCN_PACER_BUCKET_BITS;
+const uint32_t DCQCN_PACER_DEPTH_BITS = 4;
+const uint32_t DCQCN_PACER_DEPTH = 1 << DCQCN_PACER_DEPTH_BITS;
+
+// RP timers are scan rounds over all QPs (as the transport timer), the NP interval is in cycles
+#ifndef __SYNTHESIS__
+static const ap_uint<16> DCQCN_TIME_ALPHA	= 2;
+static const ap_uint<16> DCQCN_TIME_RATE	= 2;
+static const ap_uint<32> DCQCN_TIME_CNP		= 256;
+static const ap_uint<32> DCQCN_BYTE_COUNTER	= 8 * PMTU;
+#else
+static const ap_uint<16> DCQCN_TIME_ALPHA	= (55.0/0.0064/MAX_QPS) + 1;
+static const ap_uint<16> DCQCN_TIME_RATE	= (55.0/0.0064/MAX_QPS) + 1;
+static const ap_uint<32> DCQCN_TIME_CNP		= (50.0/0.0064) + 1;
+static const ap_uint<32> DCQCN_BYTE_COUNTER	= 10 * 1024 * 1024;
+#endif
+
+/**
+ * DCQCN parameters, dcqcnCnfg register
+ * [0] disable, [7:4] g, [11:8] F, [31:16] AI, [47:32] HAI (DCQCN_RATE_LINE units), [55:48] min. rate (1/256 of the line rate), [63:56] timer multiplier
+ */
+struct dcqcnParams
+{
+	bool		disable;
+	ap_uint<4>	g;
+	ap_uint<4>	f;
+	ap_uint<16>	ai;
+	ap_uint<16>	hai;
+	ap_uint<DCQCN_RATE_BITS> minRate;
+	ap_uint<8>	period;
+	dcqcnParams(ap_uint<64> cnfg)
+	{
+		disable = cnfg[0];
+		g = (cnfg(7, 4) != 0) ? ap_uint<4>(cnfg(7, 4)) : ap_uint<4>(DCQCN_DEF_G);
+		f = (cnfg(11, 8) != 0) ? ap_uint<4>(cnfg(11, 8)) : ap_uint<4>(DCQCN_DEF_F);
+		ai = (cnfg(31, 16) != 0) ? ap_uint<16>(cnfg(31, 16)) : ap_uint<16>(DCQCN_DEF_AI);
+		hai = (cnfg(47, 32) != 0) ? ap_uint<16>(cnfg(47, 32)) : ap_uint<16>(DCQCN_DEF_HAI);
+		minRate = ((cnfg(55, 48) != 0) ? ap_uint<8>(cnfg(55, 48)) : ap_uint<8>(DCQCN_DEF_MIN_RATE)) << (DCQCN_RATE_BITS-1-8);
+		period = (cnfg(63, 56) != 0) ? ap_uint<8>(cnfg(63, 56)) : ap_uint<8>(DCQCN_DEF_PERIOD);
+	}
+};
+
+struct dcqcnRateUpd
+{
+	ap_uint<16> qpn;
+	ap_uint<DCQCN_RATE_BITS> rate;
+	dcqcnRateUpd() {}
+	dcqcnRateUpd(ap_uint<16> qpn, ap_uint<DCQCN_RATE_BITS> rate)
+		:qpn(qpn), rate(rate) {}
+};
+
+struct dcqcnNpEntry
+{
+	ap_uint<32> time;
+	bool		valid;
+};
+
+struct dcqcnRpEntry
+{
+	ap_uint<DCQCN_RATE_BITS> rc; // current rate
+	ap_uint<DCQCN_RATE_BITS> rt; // target rate
+	ap_uint<DCQCN_ALPHA_BITS+1> alpha;
+	ap_uint<24>	alphaTimer;
+	ap_uint<24>	rateTimer;
+	ap_uint<8>	timerStage; // rate timer periods since the last CNP
+	ap_uint<8>	byteStage; // byte counter periods since the last CNP
+	bool		active; // below line rate
+};
+
+struct dcqcnPacerEntry
+{
+	ap_uint<DCQCN_RATE_BITS> rate;
+	ap_int<48>	credit; // bytes in 1/2^DCQCN_CREDIT_FRAC_BITS, negative - deficit of the last request
+	ap_uint<32>	time;
+	ap_uint<32>	bytes; // sent since the last byte counter event
+};
+
+/**
+ * RX ECN - splits the CE mark off the IP/UDP meta, one flag per packet for the rx ibh fsm
+ */
+template <int INSTID = 0>
+void rx_ecn_split(
+	stream<ipUdpMeta>& input,
+	stream<ipUdpMeta>& output,
+	stream<bool>& ceFifo
+) {
+#pragma HLS PIPELINE II=1
+#pragma HLS INLINE off
+
+	ipUdpMeta meta;
+
+	if (!input.empty())
+	{
+		input.read(meta);
+		output.write(meta);
+		ceFifo.write(meta.ecn == 0x3);
+	}
+}
+
+/**
+ * DCQCN notification point - CNP requests for CE marked packets, rate limited per QP
+ */
+template <int INSTID = 0>
+void dcqcn_np(
+	// QPs of CE marked packets, from the rx ibh fsm
+	stream<ap_uint<16> >& rx_ceQpFifo,
+	// CNP requests, to the meta merger
+	stream<ap_uint<16> >& tx_cnpFifo,
+	ap_uint<64> dcqcnCnfg
+) {
+#pragma HLS PIPELINE II=1
+#pragma HLS INLINE off
+
+	static dcqcnNpEntry npTable[MAX_QPS];
+#if defined( __VITIS_HLS__)
+	#pragma HLS bind_storage variable=npTable type=RAM_T2P impl=BRAM
+	#pragma HLS aggregate  variable=npTable compact=bit
+#else
+	#pragma HLS RESOURCE variable=npTable core=RAM_T2P_BRAM
+	#pragma HLS DATA_PACK variable=npTable
+#endif
+	#pragma HLS DEPENDENCE variable=npTable inter false
+
+	static ap_uint<32> now = 0;
+	dcqcnParams params(dcqcnCnfg);
+	ap_uint<16> qpn;
+	dcqcnNpEntry entry;
+
+	now++;
+
+	if (!rx_ceQpFifo.empty())
+	{
+		rx_ceQpFifo.read(qpn);
+		entry = npTable[qpn];
+		if (!params.disable && (!entry.valid || (now - entry.time) >= DCQCN_TIME_CNP * params.period))
+		{
+			std::cout << "[DCQCN NP " << INSTID << "]: CNP for qpn " << std::hex << qpn << std::dec << std::endl;
+			tx_cnpFifo.write(qpn);
+			entry.time = now;
+			entry.valid = true;
+			npTable[qpn] = entry;
+		}
+	}
+}
+
+/**
+ * DCQCN rate increase step, on the rate timer or the byte counter
+ */
+inline void dcqcn_rate_increase(dcqcnRpEntry& entry, dcqcnParams& params)
+{
+#pragma HLS INLINE
+	ap_uint<DCQCN_RATE_BITS+2> rsum;
+
+	rsum = entry.rt;
+	if (entry.timerStage > params.f && entry.byteStage > params.f)
+	{
+		rsum += params.hai;
+	}
+	else if (entry.timerStage > params.f || entry.byteStage > params.f)
+	{
+		rsum += params.ai;
+	}
+	entry.rt = (rsum > DCQCN_RATE_LINE) ? DCQCN_RATE_LINE : ap_uint<DCQCN_RATE_BITS>(rsum);
+
+	// Rc = (Rt + Rc) / 2, rounded up to reach the line rate
+	rsum = entry.rt + entry.rc + 1;
+	entry.rc = rsum >> 1;
+	if (entry.rc == DCQCN_RATE_LINE)
+	{
+		entry.active = false;
+	}
+}
+
+/**
+ * DCQCN reaction point - per QP rate, cut on CNPs, recovered by the byte counter events of the pacer
+ * and a round robin timer scan
+ */
+template <int INSTID = 0>
+void dcqcn_rp(
+	// Local QPs of received CNPs, from the rx ibh fsm
+	stream<ap_uint<16> >& rx_cnpFifo,
+	// QPs that sent DCQCN_BYTE_COUNTER bytes, from the pacer
+	stream<ap_uint<16> >& pacer2rp_byteCnt,
+	// Rate changes, to the pacer
+	stream<dcqcnRateUpd>& rp2pacer_upd,
+	ap_uint<64> dcqcnCnfg
+) {
+#pragma HLS PIPELINE II=1
+#pragma HLS INLINE off
+
+	static dcqcnRpEntry rpTable[MAX_QPS];
+#if defined( __VITIS_HLS__)
+	#pragma HLS bind_storage variable=rpTable type=RAM_T2P impl=BRAM
+	#pragma HLS aggregate  variable=rpTable compact=bit
+#else
+	#pragma HLS RESOURCE variable=rpTable core=RAM_T2P_BRAM
+	#pragma HLS DATA_PACK variable=rpTable
+#endif
+	#pragma HLS DEPENDENCE variable=rpTable inter false
+
+	static ap_uint<16> rp_currPosition = 0;
+	dcqcnParams params(dcqcnCnfg);
+	ap_uint<16> qpn;
+	dcqcnRpEntry entry;
+	ap_uint<DCQCN_RATE_BITS+DCQCN_ALPHA_BITS+1> cut;
+
+	if (!rx_cnpFifo.empty() && !rp2pacer_upd.full())
+	{
+		rx_cnpFifo.read(qpn);
+		entry = rpTable[qpn];
+		if (!entry.active)
+		{
+			entry.rc = DCQCN_RATE_LINE;
+			entry.alpha = DCQCN_ALPHA_ONE;
+		}
+
+		// Rc = Rc * (1 - alpha/2), alpha = (1 - g) * alpha + g
+		entry.rt = entry.rc;
+		cut = entry.rc * entry.alpha;
+		entry.rc -= cut >> (DCQCN_ALPHA_BITS+1);
+		if (entry.rc < params.minRate)
+		{
+			entry.rc = params.minRate;
+		}
+		entry.alpha += (DCQCN_ALPHA_ONE - entry.alpha) >> params.g;
+		entry.alphaTimer = DCQCN_TIME_ALPHA * params.period;
+		entry.rateTimer = DCQCN_TIME_RATE * params.period;
+		entry.timerStage = 0;
+		entry.byteStage = 0;
+		entry.active = true;
+		rpTable[qpn] = entry;
+
+		std::cout << "[DCQCN RP " << INSTID << "]: CNP on qpn " << std::hex << qpn << std::dec << ", rate " << entry.rc << ", alpha " << entry.alpha << std::endl;
+		rp2pacer_upd.write(dcqcnRateUpd(qpn, entry.rc));
+	}
+	else if (!pacer2rp_byteCnt.empty() && !rp2pacer_upd.full())
+	{
+		pacer2rp_byteCnt.read(qpn);
+		entry = rpTable[qpn];
+		if (entry.active)
+		{
+			if (entry.byteStage != 0xff)
+			{
+				entry.byteStage++;
+			}
+			dcqcn_rate_increase(entry, params);
+			rpTable[qpn] = entry;
+			rp2pacer_upd.write(dcqcnRateUpd(qpn, entry.rc));
+		}
+	}
+	else if (!rp2pacer_upd.full())
+	{
+		// perform round robin to advance the timers
+		qpn = rp_currPosition;
+		rp_currPosition++;
+		if (rp_currPosition >= MAX_QPS)
+		{
+			rp_currPosition = 0;
+		}
+
+		entry = rpTable[qpn];
+
+		if (entry.active)
+		{
+			// No CNP for a period, alpha = (1 - g) * alpha
+			if (entry.alphaTimer > 0)
+			{
+				entry.alphaTimer--;
+			}
+			else
+			{
+				entry.alpha -= entry.alpha >> params.g;
+				entry.alphaTimer = DCQCN_TIME_ALPHA * params.period;
+			}
+
+			// Rate increase: fast recovery, additive, hyper
+			if (entry.rateTimer > 0)
+			{
+				entry.rateTimer--;
+			}
+			else
+			{
+				entry.rateTimer = DCQCN_TIME_RATE * params.period;
+				if (entry.timerStage != 0xff)
+				{
+					entry.timerStage++;
+				}
+				dcqcn_rate_increase(entry, params);
+				rp2pacer_upd.write(dcqcnRateUpd(qpn, entry.rc));
+			}
+		}
+
+		rpTable[qpn] = entry;
+	}
+}
+
+/**
+ * DCQCN pacer - holds local requests of QPs below line rate until they have the credit (rate * elapsed time)
+ *
+ * Requests wait in per bucket queues, each cycle the next non-empty bucket is tried. A paced QP only blocks
+ * the QPs of its bucket, the order within a QP is kept. Paced QPs report every DCQCN_BYTE_COUNTER bytes to the RP.
+ */
+template <int WIDTH, int INSTID = 0>
+void dcqcn_pacer(
+	stream<txMeta>& s_axis_sq_meta,
+	stream<dcqcnRateUpd>& rp2pacer_upd,
+	stream<txMeta>& tx_pacedSqMetaFifo,
+	stream<ap_uint<16> >& pacer2rp_byteCnt,
+	ap_uint<64> dcqcnCnfg
+) {
+#pragma HLS PIPELINE II=1
+#pragma HLS INLINE off
+
+	static dcqcnPacerEntry pacerTable[MAX_QPS];
+#if defined( __VITIS_HLS__)
+	#pragma HLS bind_storage variable=pacerTable type=RAM_T2P impl=BRAM
+	#pragma HLS aggregate  variable=pacerTable compact=bit
+#else
+	#pragma HLS RESOURCE variable=pacerTable core=RAM_T2P_BRAM
+	#pragma HLS DATA_PACK variable=pacerTable
+#endif
+	#pragma HLS DEPENDENCE variable=pacerTable inter false
+
+	static txMeta pacerQueue[DCQCN_PACER_BUCKETS][DCQCN_PACER_DEPTH];
+	#pragma HLS ARRAY_PARTITION variable=pacerQueue complete dim=1
+	#pragma HLS DEPENDENCE variable=pacerQueue inter false
+	static ap_uint<DCQCN_PACER_DEPTH_BITS> queueHead[DCQCN_PACER_BUCKETS];
+	static ap_uint<DCQCN_PACER_DEPTH_BITS> queueTail[DCQCN_PACER_BUCKETS];
+	static ap_uint<DCQCN_PACER_DEPTH_BITS+1> queueUsed[DCQCN_PACER_BUCKETS];
+	#pragma HLS ARRAY_PARTITION variable=queueHead complete
+	#pragma HLS ARRAY_PARTITION variable=queueTail complete
+	#pragma HLS ARRAY_PARTITION variable=queueUsed complete
+
+	static ap_uint<32> now = 0;
+	static txMeta inMeta;
+	static bool inValid = false;
+	static ap_uint<DCQCN_PACER_BUCKET_BITS> bucketPtr = 0;
+	dcqcnParams params(dcqcnCnfg);
+	dcqcnRateUpd upd;
+	dcqcnPacerEntry entry;
+	txMeta meta;
+	ap_uint<DCQCN_PACER_BUCKET_BITS> inBucket;
+	ap_uint<DCQCN_PACER_BUCKET_BITS> outBucket;
+	ap_uint<DCQCN_PACER_BUCKET_BITS> bucket;
+	bool push = false;
+	bool pop = false;
+	bool found = false;
+	ap_uint<32> elapsed;
+	ap_uint<32> len;
+	ap_int<48> credit;
+
+	now++;
+
+	// Enqueue, stalls only when the bucket of the request is full
+	if (!inValid && !s_axis_sq_meta.empty())
+	{
+		s_axis_sq_meta.read(inMeta);
+		inValid = true;
+	}
+
+	if (inValid)
+	{
+		inBucket = inMeta.qpn(DCQCN_PACER_BUCKET_BITS-1, 0);
+		if (queueUsed[inBucket] < DCQCN_PACER_DEPTH)
+		{
+			pacerQueue[inBucket][queueTail[inBucket]] = inMeta;
+			queueTail[inBucket]++;
+			push = true;
+			inValid = false;
+		}
+	}
+
+	if (!rp2pacer_upd.empty())
+	{
+		rp2pacer_upd.read(upd);
+		entry = pacerTable[upd.qpn];
+		if (entry.rate == 0 || entry.rate == DCQCN_RATE_LINE)
+		{
+			// Start pacing
+			entry.credit = 0;
+			entry.time = now;
+			entry.bytes = 0;
+		}
+		entry.rate = upd.rate;
+		pacerTable[upd.qpn] = entry;
+	}
+	else if (!tx_pacedSqMetaFifo.full())
+	{
+		// Next non-empty bucket after the last one tried
+		for (int i = 0; i < DCQCN_PACER_BUCKETS; i++)
+		{
+		#pragma HLS UNROLL
+			bucket = bucketPtr + i;
+			if (!found && queueUsed[bucket] != 0)
+			{
+				found = true;
+				outBucket = bucket;
+			}
+		}
+
+		if (found)
+		{
+			bucketPtr = outBucket + 1;
+			meta = pacerQueue[outBucket][queueHead[outBucket]];
+			entry = pacerTable[meta.qpn];
+			if (params.disable || entry.rate == 0 || entry.rate == DCQCN_RATE_LINE)
+			{
+				tx_pacedSqMetaFifo.write(meta);
+				pop = true;
+			}
+			else
+			{
+				// Credit is folded in on every attempt, elapsed only caps the gap since the last one
+				elapsed = now - entry.time;
+				if (elapsed > (1 << 20))
+				{
+					elapsed = 1 << 20;
+				}
+				credit = entry.credit + ap_int<48>((ap_uint<48>)elapsed * entry.rate * (WIDTH/8));
+				if (credit >= 0)
+				{
+					if (credit > ((ap_int<48>)DCQCN_BURST << DCQCN_CREDIT_FRAC_BITS))
+					{
+						credit = (ap_int<48>)DCQCN_BURST << DCQCN_CREDIT_FRAC_BITS;
+					}
+					// Only requests with payload are charged
+					len = meta.params(159,128);
+					if (len > (1 << 30))
+					{
+						len = 1 << 30;
+					}
+					if (meta.op_code != RC_RDMA_READ_REQUEST)
+					{
+						credit -= (ap_int<48>)len << DCQCN_CREDIT_FRAC_BITS;
+						entry.bytes += len;
+					}
+					// Byte counter, retried on the next request if the RP is busy
+					if (entry.bytes >= DCQCN_BYTE_COUNTER && !pacer2rp_byteCnt.full())
+					{
+						pacer2rp_byteCnt.write(meta.qpn);
+						entry.bytes = 0;
+					}
+
+					tx_pacedSqMetaFifo.write(meta);
+					pop = true;
+				}
+				entry.credit = credit;
+				entry.time = now;
+				pacerTable[meta.qpn] = entry;
+			}
+
+			if (pop)
+			{
+				queueHead[outBucket]++;
+			}
+		}
+	}
+
+	for (int i = 0; i < DCQCN_PACER_BUCKETS; i++)
+	{
+	#pragma HLS UNROLL
+		queueUsed[i] = queueUsed[i] + ((push && inBucket == i) ? 1 : 0) - ((pop && outBucket == i) ? 1 : 0);
+	}
+}
@@ -33,6 +33,7 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "state_table.hpp"
 #include "msn_table.hpp"
 #include "transport_timer.hpp"
+#include "dcqcn.hpp"
 #include "retransmitter/retransmitter.hpp"
 #include "read_req_table.hpp"
 #include "multi_queue/multi_queue.hpp"
@@ -229,8 +230,8 @@ void rx_process_exh(
 					// Decide between READ_REQUEST and WRITEs to write out to the Meta-FIFO
 					if (opCode == RC_RDMA_READ_REQUEST)
 					{
-						// Is not NAK, number of packets derived by length of read access
-						exhMetaFifo.write(exhMeta(false, (rdmaHeader.getLength()+(PMTU-1))/PMTU));
+						// Is not NAK, number of packets derived by length of read access and the QP path MTU in rx_ibh_fsm
+						exhMetaFifo.write(exhMeta(false, rdmaHeader.getLength()));
 					}
 					else
 					{
@@ -324,6 +325,12 @@ void rx_ibh_fsm(
 	stream<fwdPolicy>& ibhDropMetaFifo,
 	// Output to rx_exh_fsm: One bit rd (no idea for what), qpn, psn
 	stream<ackMeta>& m_axis_rx_ack_meta,
+	// Congestion experienced bit of the packet, received from rx_ecn_split
+	stream<bool>& ceFifo,
+	// Output to the DCQCN notification point: qpn of a CE marked packet
+	stream<ap_uint<16> >& rx_ceQpFifo,
+	// Output to the DCQCN reaction point: qpn of a received CNP
+	stream<ap_uint<16> >& rx_cnpFifo,
 #ifdef RETRANS_EN
 	stream<rxTimerUpdate>&	rxClearTimer_req,
 	stream<retransUpdate>&	rx2retrans_upd,
@@ -355,6 +362,9 @@ void rx_ibh_fsm(
 	// State of the QueuePair: Dealing with PSNs, retry counter etc. 
 	rxStateRsp qpState;
 
+	// Congestion experienced
+	bool ce;
+
 	static ibhFsmMeta dbg_meta_input;
 
 
@@ -362,10 +372,11 @@ void rx_ibh_fsm(
 	{
 	// LOAD: Idle-state to read the BTH, ExH, check if it's a response and write destination qp and response-bit to the state table
 	case LOAD:
-		if (!metaIn.empty() && !exhMetaFifo.empty())
+		if (!metaIn.empty() && !exhMetaFifo.empty() && !ceFifo.empty())
 		{
 			metaIn.read(meta);
 			exhMetaFifo.read(emeta);
+			ceFifo.read(ce);
 			isResponse = checkIfResponse(meta.op_code);
 			dbg_meta_input.counter = 1;
 			dbg_meta_input.op_code = meta.op_code;
@@ -375,6 +386,23 @@ void rx_ibh_fsm(
 			dbg_meta_input.isNak = emeta.isNak;
 			dbg_meta_input.num_pkg = emeta.numPkg;
 			tx_ibhfsm_metain_debug.write(dbg_meta_input);
+
+			// CNP, consumed by the reaction point, does not touch the PSN state
+			if (meta.op_code == RC_CNP)
+			{
+				std::cout << std::hex << "[RX IBH FSM " << INSTID << "]: CNP for qpn " << meta.dest_qp << std::endl;
+				ibhDropFifo.write(true);
+				ibhDropMetaFifo.write(fwdPolicy(true, false));
+				rx_cnpFifo.write(meta.dest_qp);
+				break;
+			}
+
+			// CE marked, notify the sender
+			if (ce && meta.op_code != RC_ACK)
+			{
+				rx_ceQpFifo.write(meta.dest_qp);
+			}
+
 			stateTable_upd_req.write(rxStateReq(meta.dest_qp, isResponse));
 			fsmState = PROCESS;
 		}
@@ -387,6 +415,11 @@ void rx_ibh_fsm(
 		if (!stateTable_rsp.empty())
 		{
 			stateTable_rsp.read(qpState);
+			// The response to a READ takes one PSN per path MTU of the QP
+			if (meta.op_code == RC_RDMA_READ_REQUEST)
+			{
+				emeta.numPkg = pmtuPackets(emeta.rdLength, qpState.pmtu);
+			}
 			//ap_uint<24> oldest_outstanding_psn = qpState.epsn- 8388608;
 			//TODO compute or store oldest outstanding??
 			//TODO also increment oldest outstanding
@@ -397,8 +430,19 @@ void rx_ibh_fsm(
 			// For requests we require total order, for responses, there is potential ACK coalescing, see page 299
 			// For requests, max_forward == epsn
 
+			// Quarantined QP, failed inspection too often: drop silently, ACKs of own requests still pass
+			if (qpState.quarantined && meta.op_code != RC_ACK)
+			{
+				std::cout << std::hex << "[RX IBH FSM " << INSTID << "]: dropping quarantined qpn " << meta.dest_qp << ", psn " << meta.psn << std::endl;
+				// A READ request has no data beat to drop
+				if (meta.op_code != RC_RDMA_READ_REQUEST)
+				{
+					ibhDropFifo.write(true);
+				}
+				ibhDropMetaFifo.write(fwdPolicy(true, false));
+			}
 			// Easy case: current psn is the expected psn, or packet is an ACK
-			if (qpState.epsn == meta.psn || meta.op_code == RC_ACK)
+			else if (qpState.epsn == meta.psn || meta.op_code == RC_ACK)
 			{
 
 			#ifdef DBG_IBV_IBH_FSM
@@ -421,7 +465,7 @@ void rx_ibh_fsm(
 				ibhDropMetaFifo.write(fwdPolicy(false, false));
 
 				// Write out the BTH 
-				metaOut.write(ibhMeta(meta.op_code, meta.partition_key, meta.dest_qp, meta.psn, meta.validPSN));
+				metaOut.write(ibhMeta(meta.op_code, meta.partition_key, meta.dest_qp, meta.psn, meta.validPSN, qpState.pmtu));
 
 				// Update psn with the Pkg-number as received from the Extended Header Meta Content. Write it to the State Table. 
 				//TODO for last param we need vaddr here!
@@ -442,7 +486,7 @@ void rx_ibh_fsm(
 					std::cout << std::hex <<"[RX IBH FSM " << INSTID << "]: retrans update, psn " << meta.psn << std::endl;
 
                     // Retrans table update
-					rx2retrans_upd.write(retransUpdate(meta.dest_qp, meta.psn, meta.op_code));
+					rx2retrans_upd.write(retransUpdate(meta.dest_qp, meta.psn, meta.op_code, qpState.pmtu));
 					dbg_meta_input.counter = 4;
 
                     if (meta.op_code != RC_RDMA_READ_RESP_FIRST && meta.op_code != RC_RDMA_READ_RESP_MIDDLE) {
@@ -489,7 +533,7 @@ void rx_ibh_fsm(
 					//ibhDropFifo.write(false);
 					// Don't drop, pass on the BTH to the next module in line 
 					ibhDropMetaFifo.write(fwdPolicy(false, false));
-					metaOut.write(ibhMeta(meta.op_code, meta.partition_key, meta.dest_qp, meta.psn, meta.validPSN));
+					metaOut.write(ibhMeta(meta.op_code, meta.partition_key, meta.dest_qp, meta.psn, meta.validPSN, qpState.pmtu));
 					dbg_meta_input.counter = 7;
 					//No release required
 					//stateTable_upd_req.write(rxStateReq(meta.dest_qp, meta.psn, meta.partition_key, 0)); //TODO always +1??
@@ -600,6 +644,12 @@ void rx_ibh_fsm(
  * RDMA READ RESPONSE MIDDLE: PayLd
  * RDMA READ RESPONSE LAST: AETH, PayLd
  * ACK: AETH
+ *
+ * Packets carrying payload (RDMA WRITE, SEND, READ RESPONSE) are not waiting for the intrusion decision here.
+ * They are handed to the DPI holding buffer (rx_dpi_release) and committed or NAKed (dropped for READ RESPONSEs)
+ * once their verdict arrives, everything else keeps flowing. READ REQUESTs of a QP with outstanding verdicts
+ * are ordered behind them.
+ * QPs with the DPI_BYPASS policy are not inspected (the extractor skips them as well).
  */
 template <int WIDTH, int INSTID = 0>
 void rx_exh_fsm(
@@ -634,14 +684,18 @@ void rx_exh_fsm(
 	stream<pkgShift>& rx_pkgShiftTypeFifo, 
 	// Debugging output with the QPN to determine when packets have reached this point (for time measurements)
 	stream<ap_uint<16>>& tx_exhfsm_qpn_debug, 
-	// Intrusion Detection Input 
-	stream<intrusionDecision>& intrusionDecisionIn
+	// Output to rx_dpi_release, packets waiting for the intrusion decision or ordered behind one
+	stream<dpiHold>& rx_exh2dpiHoldFifo,
+	// Input from rx_dpi_release, QPN of every released holding buffer entry
+	stream<ap_uint<24> >& rx_dpi2exhReleaseFifo,
+	// DPI policy updates from qp_interface
+	stream<dpiPolicyReq>& qpi2exh_dpiPolicy
 ) {
 #pragma HLS inline off
 #pragma HLS pipeline II=1
 
-	// State-Machine with three states for META, DMA_META and DATA
-	enum pe_fsmStateType {META, DMA_META, INTRUSION_DECISION, DATA};
+	// State-Machine with the states META, DMA_META and DATA, DPI_DRAIN waits for the held packets of a QP
+	enum pe_fsmStateType {META, DMA_META, DATA, DPI_DRAIN};
 	static pe_fsmStateType pe_fsmState = META;
 	// Variable for storing the BTH
 	static ibhMeta meta;
@@ -657,15 +711,39 @@ void rx_exh_fsm(
 	static bool consumeReadInit;
 	//static rxReadReqRsp readReqMeta;
 	static retransRdInit readReqInit;
-	// Variable for storing the Intrusion Decision 
-	static intrusionDecision intrusionDecisionVar; 
+	// Number of holding buffer entries per QP and in total, bound by DPI_HOLD_ENTRIES
+	static ap_uint<8> dpiPending[MAX_QPS];
+	static ap_uint<8> dpiInFlight = 0;
+	// DPI policy per QP (dpiMode)
+	static ap_uint<2> dpiPolicy[MAX_QPS];
+	// Packet goes through the holding buffer
+	bool hold;
+	ap_uint<24> releaseQpn;
+	dpiPolicyReq policyReq;
+	ap_uint<2> policy;
+	memCmd readRespCmd;
+	bool msgFirst;
+	bool msgLast;
 
 
 	switch (pe_fsmState)
 	{
 	// Initial state is META: read the incoming meta-information (headers)
 	case META:
-		if (!metaIn.empty() && !headerInput.empty())
+		// Released entries first, the counts have to be current for the next packet
+		if (!rx_dpi2exhReleaseFifo.empty())
+		{
+			rx_dpi2exhReleaseFifo.read(releaseQpn);
+			dpiPending[releaseQpn]--;
+			dpiInFlight--;
+		}
+		else if (!qpi2exh_dpiPolicy.empty())
+		{
+			// Has to match the extractor, only change the policy of an idle QP
+			qpi2exh_dpiPolicy.read(policyReq);
+			dpiPolicy[policyReq.qpn] = policyReq.mode;
+		}
+		else if (!metaIn.empty() && !headerInput.empty())
 		{
 			// Read both BTH and Extended Header
 			metaIn.read(meta);
@@ -714,29 +792,35 @@ void rx_exh_fsm(
 				retrans2rx_init.read(readReqInit);
 			}
 			tx_exhfsm_qpn_debug.write(1);
-			pe_fsmState = INTRUSION_DECISION;
+			pe_fsmState = DATA;
 		}
 		break;
 
-	// State for fetching the Intrusion Decision 
-	case INTRUSION_DECISION: 
-		// Poll for incoming intrusion decisions: 
-		if((meta.op_code == RC_RDMA_WRITE_FIRST) || (meta.op_code == RC_RDMA_WRITE_ONLY) || (meta.op_code == RC_RDMA_WRITE_MIDDLE) || (meta.op_code == RC_RDMA_WRITE_LAST)) {
-			if(!intrusionDecisionIn.empty()) {
-				intrusionDecisionIn.read(intrusionDecisionVar); 
-				tx_exhfsm_qpn_debug.write(2);
-				tx_exhfsm_qpn_debug.write(intrusionDecisionVar.is_acceptable);
-				tx_exhfsm_qpn_debug.write(intrusionDecisionVar.qpn);
-				pe_fsmState = DATA; 
-			}
-		} else {
-			tx_exhfsm_qpn_debug.write(3);
-			pe_fsmState = DATA; 
+	// Wait until the held packets of the QP are released, or for a free holding buffer entry
+	case DPI_DRAIN:
+		if (!rx_dpi2exhReleaseFifo.empty())
+		{
+			rx_dpi2exhReleaseFifo.read(releaseQpn);
+			dpiPending[releaseQpn]--;
+			dpiInFlight--;
+			pe_fsmState = DATA;
 		}
-
-		break; 
+		break;
 
 	case DATA: // TODO merge with DMA_META
+		hold = (dpiPending[meta.dest_qp] != 0);
+		policy = dpiPolicy[meta.dest_qp];
+		msgFirst = checkIfFirstPkt(meta.op_code);
+		msgLast = checkIfLastPkt(meta.op_code);
+
+		// A packet that goes through the holding buffer needs a free entry, the held entries fit into
+		// the release FIFO so rx_dpi_release never blocks on it. Packets that are not held pass.
+		if (dpiInFlight >= DPI_HOLD_ENTRIES && (policy != DPI_BYPASS || hold) && checkIfDataPkt(meta.op_code))
+		{
+			pe_fsmState = DPI_DRAIN;
+			break;
+		}
+
 		// Data treatment depends on the opcode of the received packet 
 		switch(meta.op_code)
 		{
@@ -750,14 +834,26 @@ void rx_exh_fsm(
 			// Compute payload length
 			// Payloadlength is calculated from length of the UDP-frame minus bitfields for UDP header, BTH header and ICRC field
 			payLoadLength = udpLength - (8 + 12 + 4); // UDP, BTH, CRC
-			// Issue a memory write command based on the SEND-opcode
-			memoryWriteCmd.write(memCmd(0, payLoadLength, PKG_F, PKG_INT, meta.dest_qp));
+			if (policy == DPI_BYPASS && !hold)
+			{
+				// Issue a memory write command based on the SEND-opcode
+				memoryWriteCmd.write(memCmd(0, payLoadLength, PKG_F, PKG_INT, meta.dest_qp));
+				// Trigger ACK - requires actions of the stream merger, packet merger and payload manager
+				rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
+			}
+			else
+			{
+				// Inspected like the WRITEs, the commit and the ACK wait for the intrusion decision
+				rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, memCmd(0, payLoadLength, PKG_F, PKG_INT, meta.dest_qp), policy != DPI_BYPASS, policy == DPI_MONITOR, true, msgFirst, msgLast));
+				dpiPending[meta.dest_qp]++;
+				dpiInFlight++;
+				hold = true;
+			}
 			// Update state - count up the message sequence number for current destination QPN
 			rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1));
-			// Trigger ACK - requires actions of the stream merger, packet merger and payload manager
-			rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
 			rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
-			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp));
+			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp, hold));
+			tx_exhfsm_qpn_debug.write(hold ? 2 : 3);
 
 			pe_fsmState = META;
 			break;
@@ -771,13 +867,24 @@ void rx_exh_fsm(
             // [BTH][PayLd]
 			// Compute payload length
 			payLoadLength = udpLength - (8 + 12 + 4); // UDP, BTH, RETH, CRC
-			memoryWriteCmd.write(memCmd(0, payLoadLength, PKG_NF, PKG_INT, meta.dest_qp));
+			if (policy == DPI_BYPASS && !hold)
+			{
+				memoryWriteCmd.write(memCmd(0, payLoadLength, PKG_NF, PKG_INT, meta.dest_qp));
+				// Trigger ACK
+				rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
+			}
+			else
+			{
+				rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, memCmd(0, payLoadLength, PKG_NF, PKG_INT, meta.dest_qp), policy != DPI_BYPASS, policy == DPI_MONITOR, true, msgFirst, msgLast));
+				dpiPending[meta.dest_qp]++;
+				dpiInFlight++;
+				hold = true;
+			}
 			// Update state
 			rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1));
-			// Trigger ACK
-			rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
 			rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
-			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp));
+			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp, hold));
+			tx_exhfsm_qpn_debug.write(hold ? 2 : 3);
 
 			pe_fsmState = META;
 			break;
@@ -790,39 +897,36 @@ void rx_exh_fsm(
 
 			if (rdmaHeader.getLength() != 0)
 			{
-				if(intrusionDecisionVar.is_acceptable && (intrusionDecisionVar.qpn == meta.dest_qp)) {
-					//Compute payload length
-					payLoadLength = udpLength - (8 + 12 + 16 + 4); //UDP, BTH, RETH, CRC
-					//compute remaining length
-
-					// For WRITE-messages, the length of the RDMA Extended Header needs to be subtracted from the overall length as well
-					ap_uint<32> headerLen = rdmaHeader.getLength();
-					ap_uint<32> remainingLength =  headerLen - payLoadLength;
+				//Compute payload length
+				payLoadLength = udpLength - (8 + 12 + 16 + 4); //UDP, BTH, RETH, CRC
+				//compute remaining length
 
-					// Send external request for writing to memory 
-					if(meta.op_code == RC_RDMA_WRITE_ONLY)
-					{
-						memoryWriteCmd.write(memCmd(rdmaHeader.getVirtualAddress(), payLoadLength, PKG_F, PKG_HOST, meta.dest_qp));
-					}
-					if(meta.op_code == RC_RDMA_WRITE_FIRST) 
-					{
-						memoryWriteCmd.write(memCmd(rdmaHeader.getVirtualAddress(), payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp));
-					}
+				// For WRITE-messages, the length of the RDMA Extended Header needs to be subtracted from the overall length as well
+				ap_uint<32> headerLen = rdmaHeader.getLength();
+				ap_uint<32> remainingLength =  headerLen - payLoadLength;
 
-					// Update state in the msn table 
-					//TODO msn, only for ONLY??
-					rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1, rdmaHeader.getVirtualAddress()+payLoadLength, remainingLength, 1));
-					// Trigger ACK
+				if (policy == DPI_BYPASS && !hold)
+				{
+					// Not inspected, straight to memory
+					memoryWriteCmd.write(memCmd(rdmaHeader.getVirtualAddress(), payLoadLength, (meta.op_code == RC_RDMA_WRITE_ONLY) ? PKG_F : PKG_NF, PKG_HOST, meta.dest_qp));
 					rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
-					rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
-					rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_RETH, meta.dest_qp));
-					tx_exhfsm_qpn_debug.write(4);
-				} else {
-					// If Incoming Payload is not acceptable, send out a NAK 
-					rx_pkgSplitTypeFifo.write(RC_ACK); 
-					rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, true));
-					tx_exhfsm_qpn_debug.write(5); 
 				}
+				else
+				{
+					// The write command is held until the intrusion decision, a rejected packet is NAKed and its payload dropped
+					rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, memCmd(rdmaHeader.getVirtualAddress(), payLoadLength,
+						(meta.op_code == RC_RDMA_WRITE_ONLY) ? PKG_F : PKG_NF, PKG_HOST, meta.dest_qp), policy != DPI_BYPASS, policy == DPI_MONITOR, true, msgFirst, msgLast));
+					dpiPending[meta.dest_qp]++;
+					dpiInFlight++;
+					hold = true;
+				}
+
+				// Update state in the msn table, also for rejected packets so the rest of the message lands at the right offsets
+				//TODO msn, only for ONLY??
+				rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1, rdmaHeader.getVirtualAddress()+payLoadLength, remainingLength, 1));
+				rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
+				rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_RETH, meta.dest_qp, hold));
+				tx_exhfsm_qpn_debug.write(hold ? 2 : 3);
 				pe_fsmState = META;
 			}
 			break;
@@ -830,36 +934,33 @@ void rx_exh_fsm(
 		case RC_RDMA_WRITE_MIDDLE:
 		case RC_RDMA_WRITE_LAST:
 		{
-			if(intrusionDecisionVar.is_acceptable && (intrusionDecisionVar.qpn == meta.dest_qp)) {
-				// [BTH][PayLd]
-				//Fwd data words
-				payLoadLength = udpLength - (8 + 12 + 4); //UDP, BTH, CRC
-				//compute remaining length
-				ap_uint<32> remainingLength = dmaMeta.dma_length - payLoadLength;
-
-				// Issue the write command 
-				if(meta.op_code == RC_RDMA_WRITE_LAST) 
-				{
-					memoryWriteCmd.write(memCmd(dmaMeta.vaddr, payLoadLength, PKG_F, PKG_HOST, meta.dest_qp));
-				}
-				if(meta.op_code == RC_RDMA_WRITE_MIDDLE) 
-				{
-					memoryWriteCmd.write(memCmd(dmaMeta.vaddr, payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp));
-				}
+			// [BTH][PayLd]
+			//Fwd data words
+			payLoadLength = udpLength - (8 + 12 + 4); //UDP, BTH, CRC
+			//compute remaining length
+			ap_uint<32> remainingLength = dmaMeta.dma_length - payLoadLength;
 
-				//TODO msn only on LAST??
-				// Update the msn table 
-				rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1, dmaMeta.vaddr+payLoadLength, remainingLength, 1));
-				// Trigger ACK
+			if (policy == DPI_BYPASS && !hold)
+			{
+				memoryWriteCmd.write(memCmd(dmaMeta.vaddr, payLoadLength, (meta.op_code == RC_RDMA_WRITE_LAST) ? PKG_F : PKG_NF, PKG_HOST, meta.dest_qp));
 				rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, false));
-				rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
-				rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp));
-				tx_exhfsm_qpn_debug.write(6);
-			} else {
-				rx_pkgSplitTypeFifo.write(RC_ACK);
-				rx_exhEventMetaFifo.write(ackEvent(meta.dest_qp, meta.psn, true)); 
-				tx_exhfsm_qpn_debug.write(7);
 			}
+			else
+			{
+				// Hold the write command until the intrusion decision
+				rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, memCmd(dmaMeta.vaddr, payLoadLength,
+					(meta.op_code == RC_RDMA_WRITE_LAST) ? PKG_F : PKG_NF, PKG_HOST, meta.dest_qp), policy != DPI_BYPASS, policy == DPI_MONITOR, true, msgFirst, msgLast));
+				dpiPending[meta.dest_qp]++;
+				dpiInFlight++;
+				hold = true;
+			}
+
+			//TODO msn only on LAST??
+			// Update the msn table 
+			rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1, dmaMeta.vaddr+payLoadLength, remainingLength, 1));
+			rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
+			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp, hold));
+			tx_exhfsm_qpn_debug.write(hold ? 2 : 3);
 			pe_fsmState = META;
 			break;
 		}
@@ -867,9 +968,15 @@ void rx_exh_fsm(
 		{
 			// [BTH][RETH]
 			RdmaExHeader<WIDTH> rdmaHeader = exHeader.getRdmaHeader();
+			if (hold)
+			{
+				// The response implicitly ACKs the earlier packets, wait for their verdicts
+				pe_fsmState = DPI_DRAIN;
+				break;
+			}
 			if (rdmaHeader.getLength() != 0)
 			{
-				readRequestFifo.write(readRequest(meta.dest_qp, rdmaHeader.getVirtualAddress(), rdmaHeader.getLength(), meta.psn));
+				readRequestFifo.write(readRequest(meta.dest_qp, rdmaHeader.getVirtualAddress(), rdmaHeader.getLength(), meta.psn, meta.pmtu));
 				rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn+1));
 			}
 			pe_fsmState = META;
@@ -901,28 +1008,41 @@ void rx_exh_fsm(
 			}*/
 			//Write out meta
 			payLoadLength = udpLength - (8 + 12 + 4 + 4); //UDP, BTH, AETH, CRC
-			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_AETH, meta.dest_qp));
 			
 			// Based on the received opcode, issue memory commands 
 			if (meta.op_code == RC_RDMA_READ_RESP_FIRST) 
 			{
-				memoryWriteCmd.write(memCmd(readReqInit.laddr, payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp));
+				readRespCmd = memCmd(readReqInit.laddr, payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp);
 				//TODO maybe not the best way to store the vaddr in the msnTable
 				rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn, readReqInit.laddr+payLoadLength, payLoadLength, readReqInit.lst));
                 std::cout << "[RX EXH FSM " << INSTID << "]: read resp first: " << std::hex << dmaMeta.vaddr << ", ctl: " << readReqInit.lst << std::endl;
 			}
 			if (meta.op_code == RC_RDMA_READ_RESP_ONLY) 
 			{
-				memoryWriteCmd.write(memCmd(readReqInit.laddr, payLoadLength, readReqInit.lst, PKG_HOST, meta.dest_qp));
+				readRespCmd = memCmd(readReqInit.laddr, payLoadLength, readReqInit.lst, PKG_HOST, meta.dest_qp);
 				//TODO maybe not the best way to store the vaddr in the msnTable
 				rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn, readReqInit.laddr+payLoadLength, payLoadLength, readReqInit.lst));
                 std::cout << "[RX EXH FSM " << INSTID << "]: read resp only: " << std::hex << dmaMeta.vaddr << ", ctl: " << dmaMeta.lst << std::endl;
 			}
 			if (meta.op_code == RC_RDMA_READ_RESP_LAST) 
 			{
-				memoryWriteCmd.write(memCmd(dmaMeta.vaddr, payLoadLength, dmaMeta.lst, PKG_HOST, meta.dest_qp));
+				readRespCmd = memCmd(dmaMeta.vaddr, payLoadLength, dmaMeta.lst, PKG_HOST, meta.dest_qp);
                 std::cout << "[RX EXH FSM " << INSTID << "]: read resp last: " << std::hex << dmaMeta.vaddr << ", ctl: " << dmaMeta.lst << std::endl;
 			}
+
+			if (policy == DPI_BYPASS && !hold)
+			{
+				memoryWriteCmd.write(readRespCmd);
+			}
+			else
+			{
+				// Inspected as well, a response is not ACKed, a rejected one is only dropped
+				rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, readRespCmd, policy != DPI_BYPASS, policy == DPI_MONITOR, false, msgFirst, msgLast));
+				dpiPending[meta.dest_qp]++;
+				dpiInFlight++;
+				hold = true;
+			}
+			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_AETH, meta.dest_qp, hold));
 			
 			rx_pkgSplitTypeFifo.write(pkgSplit(meta.op_code));
 			pe_fsmState = META;
@@ -931,8 +1051,19 @@ void rx_exh_fsm(
 		case RC_RDMA_READ_RESP_MIDDLE:
 			// [BTH][PayLd]
 			payLoadLength = udpLength - (8 + 12 + 4); //UDP, BTH, CRC
-			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp));
-			memoryWriteCmd.write(memCmd(dmaMeta.vaddr, payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp));
+			readRespCmd = memCmd(dmaMeta.vaddr, payLoadLength, PKG_NF, PKG_HOST, meta.dest_qp);
+			if (policy == DPI_BYPASS && !hold)
+			{
+				memoryWriteCmd.write(readRespCmd);
+			}
+			else
+			{
+				rx_exh2dpiHoldFifo.write(dpiHold(meta.dest_qp, meta.psn, readRespCmd, policy != DPI_BYPASS, policy == DPI_MONITOR, false, msgFirst, msgLast));
+				dpiPending[meta.dest_qp]++;
+				dpiInFlight++;
+				hold = true;
+			}
+			rx_pkgShiftTypeFifo.write(pkgShift(SHIFT_NONE, meta.dest_qp, hold));
             std::cout << "[RX EXH FSM " << INSTID << "]: read resp middle: " << std::hex << dmaMeta.vaddr << std::endl;
 
 			rxExh2msnTable_upd_req.write(rxMsnReq(meta.dest_qp, dmaMeta.msn, dmaMeta.vaddr+payLoadLength, payLoadLength, dmaMeta.lst));
@@ -1138,6 +1269,8 @@ void handle_read_requests(
 
 	// Current word for loading the read request
 	static readRequest request; //Need QP, dma_length, vaddr
+	// Path MTU of the QP, in bytes
+	static ap_uint<32> mtu;
 
 	// Variables to dissect the read request in single fields 
 	ibOpCode readOpcode;
@@ -1158,14 +1291,15 @@ void handle_read_requests(
 			readLength = request.dma_length;
 			dmaLength = request.dma_length;
 			readOpcode = RC_RDMA_READ_RESP_ONLY;
+			mtu = pmtuBytes(request.pmtu);
 
 			// If the requested DMA length is longer than the MTU, split workload up and switch to GENERATE
-			if (request.dma_length > PMTU)
+			if (request.dma_length > mtu)
 			{
 				// Set read length to MTU, change vaddr and dma_length
-				readLength = PMTU;
-				request.vaddr += PMTU;
-				request.dma_length -= PMTU;
+				readLength = mtu;
+				request.vaddr += mtu;
+				request.dma_length -= mtu;
 				readOpcode = RC_RDMA_READ_RESP_FIRST;
 				hrr_fsmState = GENERATE;
 			}
@@ -1184,11 +1318,11 @@ void handle_read_requests(
 		readLength = request.dma_length;
 
 		// If still too long: Adapt addresses and length, generate the middle read 
-		if (request.dma_length > PMTU)
+		if (request.dma_length > mtu)
 		{
-			readLength = PMTU;
-			request.vaddr += PMTU;
-			request.dma_length -= PMTU;
+			readLength = mtu;
+			request.vaddr += mtu;
+			request.dma_length -= mtu;
 			readOpcode = RC_RDMA_READ_RESP_MIDDLE;
             std::cout << "[READ_HANDLER " << INSTID << "]: read handler middle packet, psn " << request.psn << std::endl;
 		}
@@ -1219,7 +1353,9 @@ void merge_rx_pkgs(
 	stream<net_axis<WIDTH> >& rx_rethSift2mergerFifo,
 	stream<net_axis<WIDTH> >& rx_NoSift2mergerFifo,
 	// package sent out for further processing 
-	stream<net_axis<WIDTH> >& m_axis_mem_write_data
+	stream<net_axis<WIDTH> >& m_axis_mem_write_data,
+	// package sent to the DPI holding buffer
+	stream<net_axis<WIDTH> >& rx_dpiHoldDataFifo
 ) {
 #pragma HLS inline off
 #pragma HLS pipeline II=1
@@ -1228,7 +1364,7 @@ void merge_rx_pkgs(
 	enum mrpStateType{IDLE, FWD_AETH, FWD_RETH, FWD_NONE};
 	static mrpStateType state = IDLE;
 
-	pkgShift shift;
+	static pkgShift shift;
 
 	switch (state)
 	{
@@ -1260,7 +1396,10 @@ void merge_rx_pkgs(
 
 			// Read incoming word and forward it to the memory - why though? It's an ACK.
 			rx_aethSift2mergerFifo.read(currWord);
-			m_axis_mem_write_data.write(currWord);
+			if (shift.hold)
+				rx_dpiHoldDataFifo.write(currWord);
+			else
+				m_axis_mem_write_data.write(currWord);
 
 			if (currWord.last)
 			{
@@ -1275,7 +1414,10 @@ void merge_rx_pkgs(
 			net_axis<WIDTH> currWord;
 			// Same treatment
 			rx_rethSift2mergerFifo.read(currWord);
-			m_axis_mem_write_data.write(currWord);
+			if (shift.hold)
+				rx_dpiHoldDataFifo.write(currWord);
+			else
+				m_axis_mem_write_data.write(currWord);
 			
 			if (currWord.last)
 			{
@@ -1289,7 +1431,10 @@ void merge_rx_pkgs(
 			// Same treatment
 			net_axis<WIDTH> currWord;
 			rx_NoSift2mergerFifo.read(currWord);
-			m_axis_mem_write_data.write(currWord);
+			if (shift.hold)
+				rx_dpiHoldDataFifo.write(currWord);
+			else
+				m_axis_mem_write_data.write(currWord);
 			
 			if (currWord.last)
 			{
@@ -1300,6 +1445,240 @@ void merge_rx_pkgs(
 	}//switch
 }
 
+/**
+ * DPI holding buffer - commits the held packets once their intrusion decision arrives
+ *
+ * Entries and their payload are held in arrival order, the decisions arrive in the same order as the
+ * payload was classified. An accepted packet issues its memory write and ACK, a rejected one is NAKed
+ * and its payload dropped. READ RESPONSEs are not ACKed, a rejected one is only dropped. Entries without check are only ordered behind earlier entries of their QP.
+ * Entries of DPI_MONITOR QPs are always committed, their would-be rejections are only counted.
+ *
+ * Verdicts are sticky per message: once a packet of a multi-packet message is rejected, the rest of the message
+ * is dropped and NAKed (the decider skips its inference and rejects it as well) and counted once as a rejection.
+ * The next FIRST or ONLY packet of the QP starts a new message.
+ *
+ * Rejections are reported to the state table, which quarantines a QP at its reject threshold. Decisions of packets
+ * classified before the quarantine took effect (and dropped in rx_ibh_fsm) are discarded. Writing the QP context
+ * resets the quarantine and the failed message of the QP, as in the state table.
+ */
+template <int WIDTH, int INSTID = 0>
+void rx_dpi_release(
+	// Input from rx_exh_fsm, QPN, PSN and the write command of the held packets
+	stream<dpiHold>& rx_exh2dpiHoldFifo,
+	// Intrusion Detection Input
+	stream<intrusionDecision>& intrusionDecisionIn,
+	// Held payload from merge_rx_pkgs
+	stream<net_axis<WIDTH> >& rx_dpiHoldDataFifo,
+	// Committed write commands and payload to merge_rx_mem
+	stream<memCmd>& rx_dpiMemCmdFifo,
+	stream<net_axis<WIDTH> >& rx_dpiMemDataFifo,
+	// ACK / NAK to the stream merger
+	stream<ackEvent>& rx_dpiEventFifo,
+	// QPN of the released entry back to rx_exh_fsm
+	stream<ap_uint<24> >& rx_dpi2exhReleaseFifo,
+	// QPN of every written QP context from qp_interface
+	stream<ap_uint<24> >& qpi2dpi_ctxUpd,
+	// Rejections to the state table, response whether the QP is quarantined
+	stream<ap_uint<16> >& rx_dpi2stateTable_reject,
+	stream<bool>& stateTable2dpi_rsp,
+	// Rejected packets of enforcing QPs (once per failed message), would-be rejected packets of monitored QPs
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount
+) {
+#pragma HLS inline off
+#pragma HLS pipeline II=1
+
+	enum rdrStateType {META, DECISION, FWD, DROP, QUARANTINE};
+	static rdrStateType rdr_state = META;
+	static ap_uint<32> rejectCount = 0;
+	static ap_uint<32> monitorCount = 0;
+
+	static dpiHold entry;
+	// Message of the QP failed, rest is dropped
+	static bool msgFailed[MAX_QPS];
+	// QP quarantined by the state table, its later packets are dropped in rx_ibh_fsm
+	static bool quarantined[MAX_QPS];
+	static bool rejected = false;
+	intrusionDecision decision;
+	net_axis<WIDTH> currWord;
+	ap_uint<24> ctxQpn;
+
+	switch (rdr_state)
+	{
+	case META:
+		if (!qpi2dpi_ctxUpd.empty())
+		{
+			qpi2dpi_ctxUpd.read(ctxQpn);
+			quarantined[ctxQpn] = false;
+			msgFailed[ctxQpn] = false;
+		}
+		else if (!rx_exh2dpiHoldFifo.empty())
+		{
+			rx_exh2dpiHoldFifo.read(entry);
+			if (entry.check)
+			{
+				rdr_state = DECISION;
+			}
+			else
+			{
+				rx_dpiMemCmdFifo.write(entry.cmd);
+				if (entry.ack)
+					rx_dpiEventFifo.write(ackEvent(entry.qpn, entry.psn, false));
+				rx_dpi2exhReleaseFifo.write(entry.qpn);
+				rdr_state = FWD;
+			}
+		}
+		break;
+	case DECISION:
+		if (!intrusionDecisionIn.empty())
+		{
+			intrusionDecisionIn.read(decision);
+			if (decision.qpn != entry.qpn && quarantined[decision.qpn])
+			{
+				// Classified before its QP was quarantined, the packet itself was dropped in rx_ibh_fsm
+				std::cout << "[RX DPI RELEASE " << INSTID << "]: discarding decision of quarantined qpn " << std::hex << decision.qpn << std::endl;
+			}
+			else
+			{
+				if (msgFailed[entry.qpn] && !entry.first)
+				{
+					// Rest of a rejected message, its PSN is NAKed as well
+					std::cout << "[RX DPI RELEASE " << INSTID << "]: failed message qpn " << std::hex << entry.qpn << ", psn " << entry.psn << std::endl;
+					if (entry.ack)
+						rx_dpiEventFifo.write(ackEvent(entry.qpn, entry.psn, true));
+					msgFailed[entry.qpn] = !entry.last;
+					rdr_state = DROP;
+				}
+				else if (decision.is_acceptable && (decision.qpn == entry.qpn))
+				{
+					msgFailed[entry.qpn] = false;
+					rx_dpiMemCmdFifo.write(entry.cmd);
+					if (entry.ack)
+						rx_dpiEventFifo.write(ackEvent(entry.qpn, entry.psn, false));
+					rdr_state = FWD;
+				}
+				else if (entry.monitor)
+				{
+					// Monitor only, committed anyway
+					std::cout << "[RX DPI RELEASE " << INSTID << "]: monitored qpn " << std::hex << entry.qpn << ", psn " << entry.psn << std::endl;
+					rx_dpiMemCmdFifo.write(entry.cmd);
+					if (entry.ack)
+						rx_dpiEventFifo.write(ackEvent(entry.qpn, entry.psn, false));
+					monitorCount++;
+					regDpiMonitorCount = monitorCount;
+					msgFailed[entry.qpn] = false;
+					rdr_state = FWD;
+				}
+				else
+				{
+					// If Incoming Payload is not acceptable, send out a NAK
+					std::cout << "[RX DPI RELEASE " << INSTID << "]: rejected qpn " << std::hex << entry.qpn << ", psn " << entry.psn << std::endl;
+					if (entry.ack)
+						rx_dpiEventFifo.write(ackEvent(entry.qpn, entry.psn, true));
+					rejectCount++;
+					regDpiRejectCount = rejectCount;
+					msgFailed[entry.qpn] = !entry.last;
+					rx_dpi2stateTable_reject.write(entry.qpn);
+					rejected = true;
+					rdr_state = DROP;
+				}
+				rx_dpi2exhReleaseFifo.write(entry.qpn);
+			}
+		}
+		break;
+	case FWD:
+		if (!rx_dpiHoldDataFifo.empty())
+		{
+			rx_dpiHoldDataFifo.read(currWord);
+			rx_dpiMemDataFifo.write(currWord);
+			if (currWord.last)
+			{
+				rdr_state = META;
+			}
+		}
+		break;
+	case DROP:
+		if (!rx_dpiHoldDataFifo.empty())
+		{
+			rx_dpiHoldDataFifo.read(currWord);
+			if (currWord.last)
+			{
+				rdr_state = rejected ? QUARANTINE : META;
+			}
+		}
+		break;
+	case QUARANTINE:
+		// Quarantine has to be known before the next decision is matched
+		if (!stateTable2dpi_rsp.empty())
+		{
+			stateTable2dpi_rsp.read(quarantined[entry.qpn]);
+			rejected = false;
+			rdr_state = META;
+		}
+		break;
+	}//switch
+}
+
+/**
+ * Memory write merger - forwards whole packets (command and payload) of the direct and the DPI path
+ */
+template <int WIDTH, int INSTID = 0>
+void merge_rx_mem(
+	stream<memCmd>& rx_exhMemCmdFifo,
+	stream<net_axis<WIDTH> >& rx_exhMemDataFifo,
+	stream<memCmd>& rx_dpiMemCmdFifo,
+	stream<net_axis<WIDTH> >& rx_dpiMemDataFifo,
+	stream<memCmd>& m_axis_mem_write_cmd,
+	stream<net_axis<WIDTH> >& m_axis_mem_write_data
+) {
+#pragma HLS inline off
+#pragma HLS pipeline II=1
+
+	enum mrmStateType {IDLE, FWD_EXH, FWD_DPI};
+	static mrmStateType state = IDLE;
+
+	net_axis<WIDTH> currWord;
+
+	switch (state)
+	{
+	case IDLE:
+		// Held packets are older, they go first
+		if (!rx_dpiMemCmdFifo.empty())
+		{
+			m_axis_mem_write_cmd.write(rx_dpiMemCmdFifo.read());
+			state = FWD_DPI;
+		}
+		else if (!rx_exhMemCmdFifo.empty())
+		{
+			m_axis_mem_write_cmd.write(rx_exhMemCmdFifo.read());
+			state = FWD_EXH;
+		}
+		break;
+	case FWD_EXH:
+		if (!rx_exhMemDataFifo.empty())
+		{
+			rx_exhMemDataFifo.read(currWord);
+			m_axis_mem_write_data.write(currWord);
+			if (currWord.last)
+			{
+				state = IDLE;
+			}
+		}
+		break;
+	case FWD_DPI:
+		if (!rx_dpiMemDataFifo.empty())
+		{
+			rx_dpiMemDataFifo.read(currWord);
+			m_axis_mem_write_data.write(currWord);
+			if (currWord.last)
+			{
+				state = IDLE;
+			}
+		}
+		break;
+	}//switch
+}
+
 // ------------------------------------------------------------------------------------------------
 // TX path
 // ------------------------------------------------------------------------------------------------
@@ -1627,15 +2006,18 @@ void tx_pkg_arbiter(
 }
 
 /**
- * TX meta merger - three sources of inputs for generating some kind of output: Response 
- * to a remote read request, ACKing another remote message, writing out a local RDMA-packet
+ * TX meta merger - four sources of inputs for generating some kind of output: Congestion
+ * notification, response to a remote read request, ACKing another remote message, writing out a local RDMA-packet
  * 
+ * tx_cnpFifo RC_CNP from the DCQCN notification point
  * rx_ackEventFifo RC_ACK from ibh and exh
  * rx_readEvenFifo READ events from RX side
  * tx_appMetaFifo, retransmission events, WRITEs and READ_REQ only
  */
 template <int INSTID = 0>
 void meta_merger(	
+	// Input from the DCQCN notification point, QPN to send a CNP to
+	stream<ap_uint<16> >&	tx_cnpFifo,
 	// Input from the stream merger, carries QPN, PSN, validPSN and NAK-bit to generate an ACK
 	stream<ackEvent>&	rx_ackEventFifo,
 	// Input from handle read request, carries opcode, QPN, ADDR, length, PSN, validPSN, NAK-bit to respond to a read request
@@ -1658,12 +2040,23 @@ void meta_merger(
 
 	ackEvent aev;
 	event ev;
+	ap_uint<16> qpn;
 	ap_uint<16> key = 0; //TODO hack
 
-	// Check the three sources of incoming meta information for generating an outgoing message
+	// Check the four sources of incoming meta information for generating an outgoing message
+
+	// Congestion notification, no PSN (not sequenced, not acked)
+	if (!tx_cnpFifo.empty())
+	{
+		tx_cnpFifo.read(qpn);
+		tx_connTable_req.write(qpn);
+		tx_ibhMetaFifo.write(ibhMeta(RC_CNP, key, qpn, 0, true));
+		tx_exhMetaFifo.write(event(RC_CNP, qpn));
+		std::cout << "[META MERGER " << INSTID << "]: CNP for qpn " << qpn << std::endl;
+	}
 
 	// Acking a remote message 
-	if (!rx_ackEventFifo.empty())
+	else if (!rx_ackEventFifo.empty())
 	{
 		rx_ackEventFifo.read(aev);
 
@@ -1694,20 +2087,14 @@ void meta_merger(
 	{
 		tx_appMetaFifo.read(ev);
 
-		ap_uint<22> numPkg = 1;
-		if (ev.op_code == RC_RDMA_READ_REQUEST)
-		{
-			numPkg = (ev.length+(PMTU-1)) / PMTU;
-		}
-
 		tx_connTable_req.write(ev.qpn(15, 0));
 		if (ev.validPsn) //retransmit
 		{
 			tx_ibhMetaFifo.write(ibhMeta(ev.op_code, key, ev.qpn, ev.psn, ev.validPsn));
 		}
-		else //local
+		else //local, the PSNs of a READ follow from its length and the QP path MTU
 		{
-			tx_ibhMetaFifo.write(ibhMeta(ev.op_code, key, ev.qpn, numPkg));
+			tx_ibhMetaFifo.write(ibhMeta(ev.op_code, key, ev.qpn, (ev.op_code == RC_RDMA_READ_REQUEST) ? ev.length : ap_uint<32>(0)));
 		}
 		tx_exhMetaFifo.write(ev);
 		std::cout << "[META MERGER " << INSTID << "]: reading from app event with qpn " << ev.qpn << ", psn " << ev.psn << std::endl;
@@ -1853,7 +2240,11 @@ void generate_ibh(
 				psn_debug.psn = qpState.req_next_psn;
 				tx_gibh_psn_debug.write(psn_debug);
 
-				//Update PSN
+				//Update PSN, a READ takes one per packet of its response
+				if (meta.op_code == RC_RDMA_READ_REQUEST)
+				{
+					meta.numPkg = pmtuPackets(meta.rdLength, qpState.pmtu);
+				}
 				ap_uint<24> nextPsn = qpState.req_next_psn + meta.numPkg;
 				txIbh2stateTable_upd_req.write(txStateReq(meta.dest_qp, nextPsn));
 
@@ -2025,11 +2416,8 @@ void generate_exh(
 					packetInfoFifo.write(info);
 
 					//BTH: 12, RETH: 16, PayLd: x, ICRC: 4
+					// Requests arrive segmented by the QP path MTU, a WRITE_FIRST carries its own length as well
 					ap_uint<32> payloadLen = meta.length;
-					if (meta.op_code == RC_RDMA_WRITE_FIRST)
-					{
-						payloadLen = PMTU;
-					}
 					// Seems as if the 2 trailing padding bytes don't occur here, but somewhere later in the chain
 					udpLen = 12+16+payloadLen+4; //TODO dma_len can be much larger, for multiple packets we need to split this into multiple packets
 					lengthFifo.write(udpLen);
@@ -2090,6 +2478,24 @@ void generate_exh(
 				}
 				break;
 			}
+			case RC_CNP:
+			{
+				// [BTH][16 reserved]
+				sendWord.data = 0;
+				sendWord.keep = ~0;
+				sendWord.last = 1;
+				std::cout << "[GENERATE EXH " << INSTID << "]: RC_CNP with qpn " << meta.qpn << std::endl;
+				output.write(sendWord);
+
+				info.isAETH = false;
+				info.hasHeader = true;
+				info.hasPayload = false;
+				packetInfoFifo.write(info);
+
+				//BTH: 12, reserved: 16, ICRC: 4
+				lengthFifo.write(12+16+4);
+				break;
+			}
 			case RC_RDMA_READ_RESP_ONLY:
 			case RC_RDMA_READ_RESP_FIRST:
 			case RC_RDMA_READ_RESP_LAST:
@@ -2596,7 +3002,11 @@ void qp_interface(
 	// Initial access to the State Table: QPN, new state, RPSN, LPSN, Write-Bit
 	stream<ifStateReq>&			qpi2stateTable_upd_req,
 	// Initial access to the MSN Table: QPN and rkey
-	stream<ifMsnReq>&			if2msnTable_init
+	stream<ifMsnReq>&			if2msnTable_init,
+	// DPI policy of the QP to rx_exh_fsm
+	stream<dpiPolicyReq>&		qpi2exh_dpiPolicy,
+	// Written QP to rx_dpi_release
+	stream<ap_uint<24> >&		qpi2dpi_ctxUpd
 ) {
 #pragma HLS inline off
 #pragma HLS pipeline II=1
@@ -2615,6 +3025,8 @@ void qp_interface(
 			contextIn.read(context);
 			// Update the state table with the QPN
 			qpi2stateTable_upd_req.write(context.qp_num);
+			qpi2exh_dpiPolicy.write(dpiPolicyReq(context.qp_num, context.dpi_mode));
+			qpi2dpi_ctxUpd.write(context.qp_num);
 			qp_fsmState = UPD_STATE;
 		}
 		break;
@@ -2624,8 +3036,8 @@ void qp_interface(
 		{
 			stateTable2qpi_rsp.read(state);
 			//TODO check if valid transition
-			// Update the state table with QPN, new state, remote PSN, local PSN
-			qpi2stateTable_upd_req.write(ifStateReq(context.qp_num, context.newState, context.remote_psn, context.local_psn));
+			// Update the state table with QPN, new state, remote PSN, local PSN, DPI reject threshold, path MTU
+			qpi2stateTable_upd_req.write(ifStateReq(context.qp_num, (qpState) context.newState.to_uint(), context.remote_psn, context.local_psn, context.dpi_threshold, context.pmtu));
 			// Update the msn table with the QPN and the rkey
 			if2msnTable_init.write(ifMsnReq(context.qp_num, context.r_key)); //TODO store virtual address somewhere??
 			qp_fsmState = GET_STATE;
@@ -2707,6 +3119,13 @@ void ib_transport_protocol(
 	stream<net_axis<WIDTH> >& m_axis_mem_write_data,
 	stream<net_axis<WIDTH> >& s_axis_mem_read_data,
 
+	// QP context backing store
+	stream<memCmd>& m_axis_ctx_read_cmd,
+	stream<net_axis<WIDTH> >& s_axis_ctx_read_data,
+	stream<memCmd>& m_axis_ctx_write_cmd,
+	stream<net_axis<WIDTH> >& m_axis_ctx_write_data,
+	stream<ap_uint<8> >& s_axis_ctx_write_sts,
+
 	// QP
 	stream<qpContext>& s_axis_qp_interface,
 	stream<ifConnReq>& s_axis_qp_conn_interface,
@@ -2751,6 +3170,9 @@ void ib_transport_protocol(
 	// Intrusion Detection Input 
 	stream<intrusionDecision>& intrusionDecisionIn, 
 
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
+
 	// Debug
 #ifdef DBG_IBV
 	stream<psnPkg>& m_axis_dbg,
@@ -2758,7 +3180,13 @@ void ib_transport_protocol(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn,
+	ap_uint<32>& regQpCacheHitCount,
+	ap_uint<32>& regQpCacheMissCount
 ) {
 #pragma HLS INLINE
 
@@ -2815,6 +3243,50 @@ void ib_transport_protocol(
 	#pragma HLS DATA_PACK variable=rx_remoteMemCmd
 #endif
 
+	// DPI holding buffer
+	static stream<dpiHold>	rx_exh2dpiHoldFifo("rx_exh2dpiHoldFifo");
+	static stream<ap_uint<24> >	rx_dpi2exhReleaseFifo("rx_dpi2exhReleaseFifo");
+	static stream<net_axis<WIDTH> >	rx_dpiHoldDataFifo("rx_dpiHoldDataFifo");
+	static stream<memCmd>	rx_dpiMemCmdFifo("rx_dpiMemCmdFifo");
+	static stream<net_axis<WIDTH> >	rx_dpiMemDataFifo("rx_dpiMemDataFifo");
+	static stream<ackEvent>	rx_dpiEventFifo("rx_dpiEventFifo");
+	static stream<ackEvent>	rx_exhDpiEventFifo("rx_exhDpiEventFifo");
+	static stream<memCmd>	rx_exhMemCmdFifo("rx_exhMemCmdFifo");
+	static stream<net_axis<WIDTH> >	rx_exhMemDataFifo("rx_exhMemDataFifo");
+	static stream<dpiPolicyReq>	qpi2exh_dpiPolicy("qpi2exh_dpiPolicy");
+	static stream<ap_uint<24> >	qpi2dpi_ctxUpd("qpi2dpi_ctxUpd");
+	static stream<ap_uint<16> >	rx_dpi2stateTable_reject("rx_dpi2stateTable_reject");
+	static stream<bool>	stateTable2dpi_rsp("stateTable2dpi_rsp");
+	// Both DPI_HOLD_ENTRIES deep, rx_exh_fsm bounds the held packets in flight to it
+	#pragma HLS STREAM depth=16 variable=rx_exh2dpiHoldFifo
+	#pragma HLS STREAM depth=16 variable=rx_dpi2exhReleaseFifo
+	#pragma HLS STREAM depth=512 variable=rx_dpiHoldDataFifo
+	#pragma HLS STREAM depth=4 variable=rx_dpiMemCmdFifo
+	#pragma HLS STREAM depth=4 variable=rx_dpiMemDataFifo
+	#pragma HLS STREAM depth=2 variable=rx_dpiEventFifo
+	#pragma HLS STREAM depth=2 variable=rx_exhDpiEventFifo
+	#pragma HLS STREAM depth=4 variable=rx_exhMemCmdFifo
+	#pragma HLS STREAM depth=4 variable=rx_exhMemDataFifo
+	#pragma HLS STREAM depth=2 variable=qpi2exh_dpiPolicy
+	#pragma HLS STREAM depth=2 variable=qpi2dpi_ctxUpd
+	#pragma HLS STREAM depth=2 variable=rx_dpi2stateTable_reject
+	#pragma HLS STREAM depth=2 variable=stateTable2dpi_rsp
+#if defined( __VITIS_HLS__)
+	#pragma HLS aggregate  variable=rx_exh2dpiHoldFifo compact=bit
+	#pragma HLS aggregate  variable=rx_dpiMemCmdFifo compact=bit
+	#pragma HLS aggregate  variable=rx_dpiEventFifo compact=bit
+	#pragma HLS aggregate  variable=rx_exhDpiEventFifo compact=bit
+	#pragma HLS aggregate  variable=rx_exhMemCmdFifo compact=bit
+	#pragma HLS aggregate  variable=qpi2exh_dpiPolicy compact=bit
+#else
+	#pragma HLS DATA_PACK variable=rx_exh2dpiHoldFifo
+	#pragma HLS DATA_PACK variable=rx_dpiMemCmdFifo
+	#pragma HLS DATA_PACK variable=rx_dpiEventFifo
+	#pragma HLS DATA_PACK variable=rx_exhDpiEventFifo
+	#pragma HLS DATA_PACK variable=rx_exhMemCmdFifo
+	#pragma HLS DATA_PACK variable=qpi2exh_dpiPolicy
+#endif
+
 	static stream<ibhMeta>	tx_ibhMetaFifo("tx_ibhMetaFifo");
 	static stream<event>	tx_appMetaFifo("tx_appMetaFifo");
 	//static stream<event>	tx_localMetaFifo("tx_localMetaFifo");
@@ -3006,6 +3478,8 @@ void ib_transport_protocol(
 	static stream<retransAddrLen> tx2retrans_insertAddrLen("tx2retrans_insertAddrLen");
 	static stream<retransEntry>	tx2retrans_insertRequest("tx2retrans_insertRequest");
 	static stream<retransEvent> retransmitter2exh_eventFifo("retransmitter2exh_eventFifo");
+	static stream<ap_uint<16> > retrans2admit_release("retrans2admit_release");
+	static stream<txMeta> tx_admittedSqMetaFifo("tx_admittedSqMetaFifo");
 	#pragma HLS STREAM depth=2 variable=rxClearTimer_req
 	#pragma HLS STREAM depth=2 variable=txSetTimer_req
 	#pragma HLS STREAM depth=2 variable=rx2retrans_upd
@@ -3016,6 +3490,13 @@ void ib_transport_protocol(
 	#pragma HLS STREAM depth=8 variable=tx2retrans_insertAddrLen
 	#pragma HLS STREAM depth=2 variable=tx2retrans_insertRequest
 	#pragma HLS STREAM depth=8 variable=retransmitter2exh_eventFifo
+	#pragma HLS STREAM depth=4 variable=retrans2admit_release
+	#pragma HLS STREAM depth=2 variable=tx_admittedSqMetaFifo
+#if defined( __VITIS_HLS__)
+	#pragma HLS aggregate  variable=tx_admittedSqMetaFifo compact=bit
+#else
+	#pragma HLS DATA_PACK variable=tx_admittedSqMetaFifo
+#endif
 #endif
 
 	//TODO this is a hack
@@ -3023,7 +3504,7 @@ void ib_transport_protocol(
 	#pragma HLS STREAM depth=2 variable=tx_dstQpFifo
 
 	// Interface
-	qp_interface<INSTID>(s_axis_qp_interface, stateTable2qpi_rsp, qpi2stateTable_upd_req, if2msnTable_init);
+	qp_interface<INSTID>(s_axis_qp_interface, stateTable2qpi_rsp, qpi2stateTable_upd_req, if2msnTable_init, qpi2exh_dpiPolicy, qpi2dpi_ctxUpd);
 
 
 	// ------------------------------------------------------------------------------------------------
@@ -3050,6 +3531,33 @@ void ib_transport_protocol(
 	#pragma HLS DATA_PACK variable=rx_exhMetaFifo
 #endif
 
+	// DCQCN
+	static stream<ipUdpMeta> rx_ecnSplit2metaFifo("rx_ecnSplit2metaFifo");
+	static stream<bool> rx_ceFifo("rx_ceFifo");
+	static stream<ap_uint<16> > rx_ceQpFifo("rx_ceQpFifo");
+	static stream<ap_uint<16> > rx_cnpFifo("rx_cnpFifo");
+	static stream<ap_uint<16> > tx_cnpFifo("tx_cnpFifo");
+	static stream<dcqcnRateUpd> rp2pacer_upd("rp2pacer_upd");
+	static stream<ap_uint<16> > pacer2rp_byteCnt("pacer2rp_byteCnt");
+	static stream<txMeta> tx_pacedSqMetaFifo("tx_pacedSqMetaFifo");
+	#pragma HLS STREAM depth=4 variable=rx_ecnSplit2metaFifo
+	#pragma HLS STREAM depth=8 variable=rx_ceFifo
+	#pragma HLS STREAM depth=4 variable=rx_ceQpFifo
+	#pragma HLS STREAM depth=4 variable=rx_cnpFifo
+	#pragma HLS STREAM depth=4 variable=tx_cnpFifo
+	#pragma HLS STREAM depth=4 variable=rp2pacer_upd
+	#pragma HLS STREAM depth=4 variable=pacer2rp_byteCnt
+	#pragma HLS STREAM depth=2 variable=tx_pacedSqMetaFifo
+#if defined( __VITIS_HLS__)
+	#pragma HLS aggregate  variable=rx_ecnSplit2metaFifo compact=bit
+	#pragma HLS aggregate  variable=rp2pacer_upd compact=bit
+	#pragma HLS aggregate  variable=tx_pacedSqMetaFifo compact=bit
+#else
+	#pragma HLS DATA_PACK variable=rx_ecnSplit2metaFifo
+	#pragma HLS DATA_PACK variable=rp2pacer_upd
+	#pragma HLS DATA_PACK variable=tx_pacedSqMetaFifo
+#endif
+
 	rx_process_ibh<WIDTH, INSTID>(
 #ifdef DBG_IBV_IBH_PROCESS
 		m_axis_dbg,
@@ -3081,6 +3589,9 @@ void ib_transport_protocol(
 		rx_ibhDropFifo,
 		rx_ibhDropMetaFifo,
 		m_axis_rx_ack_meta,
+		rx_ceFifo,
+		rx_ceQpFifo,
+		rx_cnpFifo,
 #ifdef RETRANS_EN
 		rxClearTimer_req,
 		rx2retrans_upd,
@@ -3095,8 +3606,13 @@ void ib_transport_protocol(
 	drop_ooo_ibh<WIDTH, INSTID>(
         rx_exh2dropFifo, rx_ibhDropFifo, rx_ibhDrop2exhFifo);
 
+	// ECN of the IP header, CE marks are turned into CNPs by the notification point
+	rx_ecn_split<INSTID>(s_axis_rx_meta, rx_ecnSplit2metaFifo, rx_ceFifo);
+
+	dcqcn_np<INSTID>(rx_ceQpFifo, tx_cnpFifo, dcqcnCnfg);
+
 	//some hack TODO, make this nicer.. not sure what this is still for
-	ipUdpMetaHandler<WIDTH, INSTID>(s_axis_rx_meta, rx_exh2drop_MetaFifo, rx_ibhDropMetaFifo, exh_lengthFifo, rx_drop2exhFsm_MetaFifo);
+	ipUdpMetaHandler<WIDTH, INSTID>(rx_ecnSplit2metaFifo, rx_exh2drop_MetaFifo, rx_ibhDropMetaFifo, exh_lengthFifo, rx_drop2exhFsm_MetaFifo);
 
 	rx_exh_fsm<WIDTH, INSTID>(	
 		rx_fsm2exh_MetaFifo,
@@ -3111,7 +3627,7 @@ void ib_transport_protocol(
 		//rx_readReqAddr_pop_rsp,
 		rx_drop2exhFsm_MetaFifo,
 		//rx_ibhDrop2exhFifo,
-		m_axis_mem_write_cmd,
+		rx_exhMemCmdFifo,
 		rx_readRequestFifo,
 		//m_axis_rx_ack_meta,
 		rxExh2msnTable_upd_req,
@@ -3123,7 +3639,9 @@ void ib_transport_protocol(
 		rx_pkgSplitTypeFifo,
 		rx_pkgShiftTypeFifo, 
 		tx_exhfsm_qpn_debug, 
-		intrusionDecisionIn
+		rx_exh2dpiHoldFifo,
+		rx_dpi2exhReleaseFifo,
+		qpi2exh_dpiPolicy
 	);
 
 	rx_exh_payload<WIDTH, INSTID>(	
@@ -3145,7 +3663,8 @@ void ib_transport_protocol(
 	);
 
 	//TODO is order important??
-	stream_merger<ackEvent>(rx_exhEventMetaFifo, rx_ibhEventFifo, rx_ackEventFifo);
+	stream_merger<ackEvent>(rx_exhEventMetaFifo, rx_dpiEventFifo, rx_exhDpiEventFifo);
+	stream_merger<ackEvent>(rx_exhDpiEventFifo, rx_ibhEventFifo, rx_ackEventFifo);
 
 	// RETH: 16 bytes
 	//TODO not required for AXI_WIDTH == 64, also this seems to have a bug, this goes together with the hack in process_exh where we don't write the first word out
@@ -3155,7 +3674,25 @@ void ib_transport_protocol(
 	// AETH: 4 bytes
 	rshiftWordByOctet<net_axis<WIDTH>, WIDTH,13, INSTID>(((AETH_SIZE%WIDTH)/8), rx_exh2aethShiftFifo, rx_aethSift2mergerFifo);
 
-	merge_rx_pkgs<WIDTH, INSTID>(rx_pkgShiftTypeFifo, rx_aethSift2mergerFifo, rx_rethSift2mergerFifo, rx_exhNoShiftFifo, m_axis_mem_write_data);
+	merge_rx_pkgs<WIDTH, INSTID>(rx_pkgShiftTypeFifo, rx_aethSift2mergerFifo, rx_rethSift2mergerFifo, rx_exhNoShiftFifo, rx_exhMemDataFifo, rx_dpiHoldDataFifo);
+
+	// DPI, held packets are committed or NAKed as their intrusion decisions arrive
+	rx_dpi_release<WIDTH, INSTID>(
+		rx_exh2dpiHoldFifo,
+		intrusionDecisionIn,
+		rx_dpiHoldDataFifo,
+		rx_dpiMemCmdFifo,
+		rx_dpiMemDataFifo,
+		rx_dpiEventFifo,
+		rx_dpi2exhReleaseFifo,
+		qpi2dpi_ctxUpd,
+		rx_dpi2stateTable_reject,
+		stateTable2dpi_rsp,
+		regDpiRejectCount,
+		regDpiMonitorCount
+	);
+
+	merge_rx_mem<WIDTH, INSTID>(rx_exhMemCmdFifo, rx_exhMemDataFifo, rx_dpiMemCmdFifo, rx_dpiMemDataFifo, m_axis_mem_write_cmd, m_axis_mem_write_data);
 
 	// ------------------------------------------------------------------------------------------------
 	// TX path
@@ -3173,8 +3710,20 @@ void ib_transport_protocol(
 	#pragma HLS STREAM depth=4 variable=tx_split2rethMerge
 	#pragma HLS STREAM depth=4 variable=tx_rethMerge2rethShift
 
+	// DCQCN reaction point, paces the send queue per QP
+	dcqcn_rp<INSTID>(rx_cnpFifo, pacer2rp_byteCnt, rp2pacer_upd, dcqcnCnfg);
+
+#ifdef RETRANS_EN
+	// Retransmitter meta table entries are reserved per QP before a request is sent
+	retrans_admission<INSTID>(s_axis_sq_meta, retrans2admit_release, tx_admittedSqMetaFifo);
+
+	dcqcn_pacer<WIDTH, INSTID>(tx_admittedSqMetaFifo, rp2pacer_upd, tx_pacedSqMetaFifo, pacer2rp_byteCnt, dcqcnCnfg);
+#else
+	dcqcn_pacer<WIDTH, INSTID>(s_axis_sq_meta, rp2pacer_upd, tx_pacedSqMetaFifo, pacer2rp_byteCnt, dcqcnCnfg);
+#endif
+
 	local_req_handler<INSTID>(
-		s_axis_sq_meta,
+		tx_pacedSqMetaFifo,
 #ifdef RETRANS_EN
 		retransmitter2exh_eventFifo,
 		tx2retrans_insertAddrLen,
@@ -3198,7 +3747,7 @@ void ib_transport_protocol(
 	stream_merger(tx_split2rethMerge, tx_appDataFifo, tx_rethMerge2rethShift);
 #endif
 	//merges and orders event going to TX path
-	meta_merger<INSTID>(rx_ackEventFifo, rx_readEvenFifo, tx_appMetaFifo, tx_ibhconnTable_req, tx_ibhMetaFifo, tx_exhMetaFifo, tx_ackEvent_debug);
+	meta_merger<INSTID>(tx_cnpFifo, rx_ackEventFifo, rx_readEvenFifo, tx_appMetaFifo, tx_ibhconnTable_req, tx_ibhMetaFifo, tx_exhMetaFifo, tx_ackEvent_debug);
 
 	//Shift playload by 4 bytes for AETH (data from memory)
 	lshiftWordByOctet<WIDTH,12,INSTID>(((AETH_SIZE%WIDTH)/8), tx_split2aethShift, tx_aethShift2payFifo);
@@ -3261,13 +3810,24 @@ void ib_transport_protocol(
 		tx_connTable2ibh_rsp
 	);
 
-	state_table<INSTID>(
+	state_table<WIDTH, INSTID>(
 		rxIbh2stateTable_upd_req,
 		txIbh2stateTable_upd_req,
 		qpi2stateTable_upd_req,
 		stateTable2rxIbh_rsp,
 		stateTable2txIbh_rsp,
-		stateTable2qpi_rsp
+		stateTable2qpi_rsp,
+		rx_dpi2stateTable_reject,
+		stateTable2dpi_rsp,
+		m_axis_ctx_read_cmd,
+		s_axis_ctx_read_data,
+		m_axis_ctx_write_cmd,
+		m_axis_ctx_write_data,
+		s_axis_ctx_write_sts,
+		regDpiQuarantineCount,
+		regDpiQuarantineQpn,
+		regQpCacheHitCount,
+		regQpCacheMissCount
 	);
 
 	msn_table<INSTID>(
@@ -3313,6 +3873,7 @@ void ib_transport_protocol(
 		rx2retrans_req,
 		timer2retrans_req,
 		tx2retrans_insertRequest,
+		retrans2admit_release,
 		retransmitter2exh_eventFifo
 	);
 #endif
@@ -3332,6 +3893,11 @@ template void ib_transport_protocol<DATA_WIDTH, ninst>(		   	\
 	stream<memCmd>& m_axis_mem_read_cmd,		                \
 	stream<net_axis<DATA_WIDTH> >& m_axis_mem_write_data,		\
 	stream<net_axis<DATA_WIDTH> >& s_axis_mem_read_data,		\
+	stream<memCmd>& m_axis_ctx_read_cmd,		                \
+	stream<net_axis<DATA_WIDTH> >& s_axis_ctx_read_data,		\
+	stream<memCmd>& m_axis_ctx_write_cmd,		                \
+	stream<net_axis<DATA_WIDTH> >& m_axis_ctx_write_data,		\
+	stream<ap_uint<8> >& s_axis_ctx_write_sts,		            \
 	stream<qpContext>& s_axis_qp_interface,		               	\
 	stream<ifConnReq>& s_axis_qp_conn_interface,		        \
 	stream<ackEvent>& tx_ackEvent_debug, 						\
@@ -3349,11 +3915,18 @@ template void ib_transport_protocol<DATA_WIDTH, ninst>(		   	\
 	stream<ap_uint<24> >& tx_iumm_dstQpFifo_debug,				\
 	stream<ap_uint<16> >& tx_exhfsm_qpn_debug, 					\
 	stream<intrusionDecision>& intrusionDecisionIn, 			\
+	ap_uint<64> dcqcnCnfg,		                        		\
 	stream<psnPkg>& m_axis_dbg,		                        	\
 	ap_uint<32>& regInvalidPsnDropCount,		                \
     ap_uint<32>& regRetransCount,		                        \
 	ap_uint<32>& regIbvCountRx,		                       	    \
-    ap_uint<32>& regIbvCountTx		                       	    \
+    ap_uint<32>& regIbvCountTx,		                       	    \
+	ap_uint<32>& regDpiRejectCount,		                        \
+	ap_uint<32>& regDpiMonitorCount,		                       \
+	ap_uint<32>& regDpiQuarantineCount,		                    \
+	ap_uint<32>& regDpiQuarantineQpn,		                    \
+	ap_uint<32>& regQpCacheHitCount,		                        \
+	ap_uint<32>& regQpCacheMissCount		                        \
 );
 #else
 #define ib_transport_protocol_spec_decla(ninst)                 \
@@ -3368,6 +3941,11 @@ template void ib_transport_protocol<DATA_WIDTH, ninst>(		   	\
 	stream<memCmd>& m_axis_mem_read_cmd,		                \
 	stream<net_axis<DATA_WIDTH> >& m_axis_mem_write_data,		\
 	stream<net_axis<DATA_WIDTH> >& s_axis_mem_read_data,		\
+	stream<memCmd>& m_axis_ctx_read_cmd,		                \
+	stream<net_axis<DATA_WIDTH> >& s_axis_ctx_read_data,		\
+	stream<memCmd>& m_axis_ctx_write_cmd,		                \
+	stream<net_axis<DATA_WIDTH> >& m_axis_ctx_write_data,		\
+	stream<ap_uint<8> >& s_axis_ctx_write_sts,		            \
 	stream<qpContext>& s_axis_qp_interface,		               	\
 	stream<ifConnReq>& s_axis_qp_conn_interface,		        \
 	stream<ackEvent>& tx_ackEvent_debug, 						\
@@ -3385,10 +3963,17 @@ template void ib_transport_protocol<DATA_WIDTH, ninst>(		   	\
 	stream<ap_uint<24> >& tx_iumm_dstQpFifo_debug,				\
 	stream<ap_uint<16>>& tx_exhfsm_qpn_debug,					\
 	stream<intrusionDecision>& intrusionDecisionIn, 			\
+	ap_uint<64> dcqcnCnfg,		                        		\
 	ap_uint<32>& regInvalidPsnDropCount,		                \
     ap_uint<32>& regRetransCount,		                        \
 	ap_uint<32>& regIbvCountRx,		                       	    \
-    ap_uint<32>& regIbvCountTx		                       	    \
+    ap_uint<32>& regIbvCountTx,		                       	    \
+	ap_uint<32>& regDpiRejectCount,		                        \
+	ap_uint<32>& regDpiMonitorCount,		                       \
+	ap_uint<32>& regDpiQuarantineCount,		                    \
+	ap_uint<32>& regDpiQuarantineQpn,		                    \
+	ap_uint<32>& regQpCacheHitCount,		                        \
+	ap_uint<32>& regQpCacheMissCount		                        \
 );
 #endif
 
@@ -63,6 +63,9 @@ typedef enum {AETH, RETH, RAW, IMMED} pkgType;
 typedef enum {SHIFT_AETH, SHIFT_RETH, SHIFT_NONE} pkgShiftType;
 typedef enum {PKG_SEND, PKG_WRITE} pkgOper;
 
+// DPI policy of a QP, enforce (NAK rejected packets), monitor (classify and count, always accept), bypass (no inspection)
+typedef enum {DPI_ENFORCE, DPI_MONITOR, DPI_BYPASS} dpiMode;
+
 typedef enum {
 	PKG_NF = 0,
 	PKG_F = 1
@@ -108,19 +111,34 @@ typedef enum {
 	RC_RDMA_READ_RESP_LAST = 0x0F,
 	RC_RDMA_READ_RESP_ONLY = 0x10,
 	RC_ACK = 0x11,
+	RC_CNP = 0x81, // RoCEv2 congestion notification, [BTH][16 reserved]
 } ibOpCode;
 
 bool checkIfResponse(ibOpCode code);
 bool checkIfWrite(ibOpCode code);
 bool checkIfAethHeader(ibOpCode code);
 bool checkIfRethHeader(ibOpCode code);
+bool checkIfFirstPkt(ibOpCode code);
+bool checkIfLastPkt(ibOpCode code);
+bool checkIfDataPkt(ibOpCode code);
+
+// Path MTU of a QP, IB encoding 1 - 256 .. 5 - 4096, 0 or above the stack PMTU - PMTU
+ap_uint<4> pmtuLog(ap_uint<3> pmtu);
+ap_uint<32> pmtuBytes(ap_uint<3> pmtu);
+ap_uint<22> pmtuPackets(ap_uint<32> length, ap_uint<3> pmtu);
 
 /* QP context */
 // Was 3 + 3*24 + 16 + 64 = 155 Bit, is now 171 bit (with full 32-bit rkey)
 struct qpContext
 {
 	// I'm not sure which role the order of these fields play in here when receiving values from s_axis_qp_interface
-	qpState		newState;
+	// State word (32 bit): QP state, DPI policy, DPI reject threshold, READ window, path MTU
+	ap_uint<8>	newState; // qpState
+	ap_uint<2>	dpi_mode; // dpiMode
+	ap_uint<8>	dpi_threshold; // rejected messages until quarantine, 0 - never
+	ap_uint<9>	rd_window; // outstanding READs, enforced by rdma_flow, 0 - RDMA_N_RD_OUTSTANDING
+	ap_uint<3>	pmtu; // path MTU, same on both ends, 1 - 256 .. 5 - 4096, 0 - PMTU
+	ap_uint<2>	rsvd;
 	ap_uint<24> qp_num;
 	ap_uint<24> remote_psn;
 	ap_uint<24> local_psn;
@@ -130,7 +148,11 @@ struct qpContext
 	ap_uint<32> r_key;
 	qpContext() {}
 	qpContext(qpState newState, ap_uint<24> qp_num, ap_uint<24> remote_psn, ap_uint<24> local_psn, ap_uint<16> r_key, ap_uint<64> virtual_address)
-				:newState(newState), qp_num(qp_num), remote_psn(remote_psn), local_psn(local_psn), r_key(r_key), virtual_address(virtual_address) {}
+				:newState(newState), dpi_mode(DPI_ENFORCE), dpi_threshold(0), rd_window(0), pmtu(0), rsvd(0), qp_num(qp_num), remote_psn(remote_psn), local_psn(local_psn), r_key(r_key), virtual_address(virtual_address) {}
+	qpContext(qpState newState, ap_uint<24> qp_num, ap_uint<24> remote_psn, ap_uint<24> local_psn, ap_uint<16> r_key, ap_uint<64> virtual_address, dpiMode dpi_mode)
+				:newState(newState), dpi_mode(dpi_mode), dpi_threshold(0), rd_window(0), pmtu(0), rsvd(0), qp_num(qp_num), remote_psn(remote_psn), local_psn(local_psn), r_key(r_key), virtual_address(virtual_address) {}
+	qpContext(qpState newState, ap_uint<24> qp_num, ap_uint<24> remote_psn, ap_uint<24> local_psn, ap_uint<16> r_key, ap_uint<64> virtual_address, dpiMode dpi_mode, ap_uint<8> dpi_threshold)
+				:newState(newState), dpi_mode(dpi_mode), dpi_threshold(dpi_threshold), rd_window(0), pmtu(0), rsvd(0), qp_num(qp_num), remote_psn(remote_psn), local_psn(local_psn), r_key(r_key), virtual_address(virtual_address) {}
 };
 
 /* QP connection */
@@ -152,11 +174,14 @@ struct readRequest
 	ap_uint<32> dma_length;
 	ap_uint<24> psn;
 	ap_uint<1>  host;
+	ap_uint<3>  pmtu; // the response is split in packets of the QP path MTU
 	
 	readRequest() {}
 	readRequest(ap_uint<24> qpn, ap_uint<64> vaddr, ap_uint<32> len, ap_uint<24> psn)
 //		:qpn(qpn), vaddr(vaddr), dma_length(len), psn(psn) {}
-		:qpn(qpn), vaddr(vaddr), dma_length(len), psn(psn), host(1) {}
+		:qpn(qpn), vaddr(vaddr), dma_length(len), psn(psn), host(1), pmtu(0) {}
+	readRequest(ap_uint<24> qpn, ap_uint<64> vaddr, ap_uint<32> len, ap_uint<24> psn, ap_uint<3> pmtu)
+		:qpn(qpn), vaddr(vaddr), dma_length(len), psn(psn), host(1), pmtu(pmtu) {}
 };
 
 struct fwdPolicy
@@ -348,9 +373,43 @@ struct pkgShift
 {
 	pkgShiftType type;
 	ap_uint<24> qpn;
+	bool hold; // payload goes to the DPI holding buffer
 	pkgShift() {}
 	pkgShift(pkgShiftType type, ap_uint<24> qpn) 
-		:type(type), qpn(qpn) {}
+		:type(type), qpn(qpn), hold(false) {}
+	pkgShift(pkgShiftType type, ap_uint<24> qpn, bool hold) 
+		:type(type), qpn(qpn), hold(hold) {}
+};
+
+// Held packets in flight, depth of the hold and the release FIFO
+const uint32_t DPI_HOLD_ENTRIES = 16;
+
+/* DPI holding buffer entry, committed by rx_dpi_release */
+struct dpiHold
+{
+	ap_uint<24> qpn;
+	ap_uint<24> psn;
+	memCmd		cmd;
+	bool		check; // waits for an intrusion decision, otherwise only ordered behind earlier entries of the QP
+	bool		monitor; // decision is only counted
+	bool		ack; // ACK / NAK on release, not for READ RESPONSEs
+	bool		first; // first packet of the message
+	bool		last; // last packet of the message
+	dpiHold() {}
+	dpiHold(ap_uint<24> qpn, ap_uint<24> psn, memCmd cmd, bool check)
+		:qpn(qpn), psn(psn), cmd(cmd), check(check), monitor(false), ack(true), first(true), last(true) {}
+	dpiHold(ap_uint<24> qpn, ap_uint<24> psn, memCmd cmd, bool check, bool monitor, bool ack, bool first, bool last)
+		:qpn(qpn), psn(psn), cmd(cmd), check(check), monitor(monitor), ack(ack), first(first), last(last) {}
+};
+
+/* DPI policy update */
+struct dpiPolicyReq
+{
+	ap_uint<24> qpn;
+	ap_uint<2>	mode;
+	dpiPolicyReq() {}
+	dpiPolicyReq(ap_uint<24> qpn, ap_uint<2> mode)
+		:qpn(qpn), mode(mode) {}
 };
 
 struct pkgInfo
@@ -480,25 +539,30 @@ struct ibhMeta
 	ap_uint<24> psn;
 	bool		validPSN;
 	ap_uint<22> numPkg; //TODO does not really fit here //TODO how many bits does this need?
+	ap_uint<32> rdLength; // READ_REQUEST, numPkg follows from the QP path MTU in generate_ibh
+	ap_uint<3>	pmtu; // QP path MTU, rx_ibh_fsm to rx_exh_fsm
 	ibhMeta()
 		:op_code(RC_ACK) {} //TODO
 	ibhMeta(ibOpCode op, ap_uint<16> key, ap_uint<24> qp)
-			:op_code(op), partition_key(key), dest_qp(qp), psn(0), validPSN(false), numPkg(1) {}
-	ibhMeta(ibOpCode op, ap_uint<16> key, ap_uint<24> qp, ap_uint<22> numPkg)
-			:op_code(op), partition_key(key), dest_qp(qp), psn(0), validPSN(false), numPkg(numPkg) {}
+			:op_code(op), partition_key(key), dest_qp(qp), psn(0), validPSN(false), numPkg(1), rdLength(0), pmtu(0) {}
+	ibhMeta(ibOpCode op, ap_uint<16> key, ap_uint<24> qp, ap_uint<32> rdLength)
+			:op_code(op), partition_key(key), dest_qp(qp), psn(0), validPSN(false), numPkg(1), rdLength(rdLength), pmtu(0) {}
 	ibhMeta(ibOpCode op, ap_uint<16> key, ap_uint<24> qp, ap_uint<24> psn, bool vp)
-			:op_code(op), partition_key(key), dest_qp(qp), psn(psn), validPSN(vp), numPkg(1) {}
+			:op_code(op), partition_key(key), dest_qp(qp), psn(psn), validPSN(vp), numPkg(1), rdLength(0), pmtu(0) {}
+	ibhMeta(ibOpCode op, ap_uint<16> key, ap_uint<24> qp, ap_uint<24> psn, bool vp, ap_uint<3> pmtu)
+			:op_code(op), partition_key(key), dest_qp(qp), psn(psn), validPSN(vp), numPkg(1), rdLength(0), pmtu(pmtu) {}
 };
 
 struct exhMeta
 {
 	bool		isNak;
 	ap_uint<22> numPkg; //TODO how many bits does this need?
+	ap_uint<32> rdLength; // READ_REQUEST, numPkg follows from the QP path MTU in rx_ibh_fsm
 	exhMeta() {}
 	exhMeta(bool isNak)
-		:isNak(isNak), numPkg(1) {}
-	exhMeta(bool isNak, ap_uint<22> numPkg)
-		:isNak(isNak), numPkg(numPkg) {}
+		:isNak(isNak), numPkg(1), rdLength(0) {}
+	exhMeta(bool isNak, ap_uint<32> rdLength)
+		:isNak(isNak), numPkg(1), rdLength(rdLength) {}
 };
 
 // Debugging packet for incoming meta-data in rx_ibh_fsm
@@ -682,6 +746,13 @@ void ib_transport_protocol(
 	hls::stream<net_axis<WIDTH> >& m_axis_mem_write_data,
 	hls::stream<net_axis<WIDTH> >& s_axis_mem_read_data,
 
+	// QP context backing store
+	hls::stream<memCmd>& m_axis_ctx_read_cmd,
+	hls::stream<net_axis<WIDTH> >& s_axis_ctx_read_data,
+	hls::stream<memCmd>& m_axis_ctx_write_cmd,
+	hls::stream<net_axis<WIDTH> >& m_axis_ctx_write_data,
+	hls::stream<ap_uint<8> >& s_axis_ctx_write_sts,
+
 	// QP
 	hls::stream<qpContext>&	s_axis_qp_interface,
 	hls::stream<ifConnReq>&	s_axis_qp_conn_interface,
@@ -724,6 +795,9 @@ void ib_transport_protocol(
 	// Intrusion Detection Input 
 	hls::stream<intrusionDecision>& intrusionDecisionIn, 
 
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
+
 	// Debug
 #ifdef DBG_IBV
 	hls::stream<psnPkg>& m_axis_dbg, 
@@ -731,5 +805,11 @@ void ib_transport_protocol(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn,
+	ap_uint<32>& regQpCacheHitCount,
+	ap_uint<32>& regQpCacheMissCount
 );
@@ -53,3 +53,39 @@ bool checkIfRethHeader(ibOpCode code)
 	return (code == RC_RDMA_WRITE_ONLY  || code == RC_RDMA_WRITE_FIRST ||
 			code == RC_RDMA_READ_REQUEST);
 }
+
+bool checkIfLastPkt(ibOpCode code)
+{
+	return (code == RC_SEND_LAST || code == RC_SEND_ONLY ||
+			code == RC_RDMA_WRITE_LAST || code == RC_RDMA_WRITE_ONLY ||
+			code == RC_RDMA_READ_RESP_LAST || code == RC_RDMA_READ_RESP_ONLY);
+}
+
+bool checkIfFirstPkt(ibOpCode code)
+{
+	return (code == RC_SEND_FIRST || code == RC_SEND_ONLY ||
+			code == RC_RDMA_WRITE_FIRST || code == RC_RDMA_WRITE_ONLY ||
+			code == RC_RDMA_READ_RESP_FIRST || code == RC_RDMA_READ_RESP_ONLY);
+}
+
+bool checkIfDataPkt(ibOpCode code)
+{
+	return (code == RC_SEND_FIRST || code == RC_SEND_MIDDLE ||
+			code == RC_SEND_LAST  || code == RC_SEND_ONLY ||
+			checkIfWrite(code) || (checkIfResponse(code) && code != RC_ACK));
+}
+
+ap_uint<4> pmtuLog(ap_uint<3> pmtu)
+{
+	return (pmtu == 0 || pmtu > 5 || pmtu + 7 > PMTU_LOG) ? ap_uint<4>(PMTU_LOG) : ap_uint<4>(pmtu + 7);
+}
+
+ap_uint<32> pmtuBytes(ap_uint<3> pmtu)
+{
+	return ap_uint<32>(1) << pmtuLog(pmtu);
+}
+
+ap_uint<22> pmtuPackets(ap_uint<32> length, ap_uint<3> pmtu)
+{
+	return (length + pmtuBytes(pmtu) - 1) >> pmtuLog(pmtu);
+}
@@ -32,7 +32,11 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../ib_transport_protocol.hpp"
 using namespace hls;
 
-const uint32_t META_TABLE_SIZE = 2000;
+// One entry per outstanding request, shared by all QPs
+const uint32_t META_TABLE_SIZE = RETRANS_META_ENTRIES;
+// Fair share, a QP is admitted below RETRANS_QP_MIN_ENTRIES entries or below (free entries << RETRANS_DT_SHIFT)
+const uint32_t RETRANS_QP_MIN_ENTRIES = 4;
+const uint32_t RETRANS_DT_SHIFT = 2;
 
 struct retransEvent;
 
@@ -41,9 +45,12 @@ struct retransUpdate
 	ap_uint<16> qpn;
 	ap_uint<24> latest_acked_req; //TODO rename?
     ibOpCode op_code;
+	ap_uint<3> pmtu; // READ responses advance the entry by the QP path MTU
 	retransUpdate() {}
 	retransUpdate(ap_uint<16> qpn, ap_uint<24> psn, ibOpCode op_code)
-		:qpn(qpn), latest_acked_req(psn), op_code(op_code) {}
+		:qpn(qpn), latest_acked_req(psn), op_code(op_code), pmtu(0) {}
+	retransUpdate(ap_uint<16> qpn, ap_uint<24> psn, ibOpCode op_code, ap_uint<3> pmtu)
+		:qpn(qpn), latest_acked_req(psn), op_code(op_code), pmtu(pmtu) {}
 };
 
 struct retransRdInit
@@ -180,8 +187,92 @@ struct pointerReq
 		:qpn(qpn), lock(l) {}
 };
 
+// PSN a follows b in the 24 bit sequence space
+inline bool psnAfter(ap_uint<24> a, ap_uint<24> b)
+{
+	ap_uint<24> diff = a - b;
+	return (diff != 0) && (diff < 0x800000);
+}
+
 /*********************IMPLEMENTATION*********************/
 
+/**
+ * Retransmitter admission - fair share of the meta table between QPs (dynamic threshold)
+ *
+ * Every request holds one meta table entry until it is acknowledged. The entry is reserved here,
+ * before the request is sent, so the insertion behind generate_ibh never waits for a free entry
+ * and ACKs, read responses and retransmissions keep flowing when the table runs full.
+ * A request waits while its QP holds its share, releases are served first.
+ */
+template <int INSTID = 0>
+void retrans_admission(
+	stream<txMeta>&					s_axis_sq_meta,
+	stream<ap_uint<16> >&			releaseFifo,
+	stream<txMeta>&					m_axis_sq_meta)
+{
+#pragma HLS PIPELINE II=1
+#pragma HLS INLINE off
+
+	static ap_uint<16> qp_used[MAX_QPS];
+#if defined( __VITIS_HLS__)
+	#pragma HLS bind_storage variable=qp_used type=RAM_T2P impl=BRAM
+#else
+	#pragma HLS RESOURCE variable=qp_used core=RAM_T2P_BRAM
+#endif
+	#pragma HLS DEPENDENCE variable=qp_used inter false
+
+	static ap_uint<16> ra_used = 0;
+	static bool ra_pending = false;
+	static txMeta ra_meta;
+	// Last update, forwarded to back-to-back accesses of the same QP
+	static ap_uint<16> ra_lastQpn = 0;
+	static ap_uint<16> ra_lastUsed = 0;
+	static bool ra_lastValid = false;
+
+	ap_uint<16> qpn;
+	ap_uint<16> qpUsed;
+
+	if (!releaseFifo.empty())
+	{
+		releaseFifo.read(qpn);
+		qpUsed = (ra_lastValid && ra_lastQpn == qpn) ? ra_lastUsed : qp_used[qpn];
+		qpUsed--;
+		qp_used[qpn] = qpUsed;
+		ra_used--;
+
+		ra_lastQpn = qpn;
+		ra_lastUsed = qpUsed;
+		ra_lastValid = true;
+	}
+	else if (ra_pending || !s_axis_sq_meta.empty())
+	{
+		if (!ra_pending)
+		{
+			s_axis_sq_meta.read(ra_meta);
+			ra_pending = true;
+		}
+
+		qpn = ra_meta.qpn;
+		qpUsed = (ra_lastValid && ra_lastQpn == qpn) ? ra_lastUsed : qp_used[qpn];
+		ap_uint<32> threshold = ap_uint<32>(META_TABLE_SIZE - ra_used) << RETRANS_DT_SHIFT;
+
+		if (ra_used < META_TABLE_SIZE && (qpUsed < RETRANS_QP_MIN_ENTRIES || qpUsed < threshold))
+		{
+			qpUsed++;
+			qp_used[qpn] = qpUsed;
+			ra_used++;
+
+			ra_lastQpn = qpn;
+			ra_lastUsed = qpUsed;
+			ra_lastValid = true;
+
+			m_axis_sq_meta.write(ra_meta);
+			ra_pending = false;
+		}
+	}
+}
+
+
 template <int INSTID = 0>
 void retrans_pointer_table(	
     stream<pointerReq>&			    pointerReqFifo,
@@ -294,6 +385,7 @@ void process_retransmissions(
 	stream<retransMetaEntry>&		metaRspFifo,
 	stream<ap_uint<16> >&			freeListFifo,
 	stream<ap_uint<16> >&			releaseFifo,
+	stream<ap_uint<16> >&			retrans2admit_release,
 	stream<retransEvent>&			retrans2event
 ) {
 #pragma HLS PIPELINE II=1
@@ -308,6 +400,8 @@ void process_retransmissions(
 	static retransmission retrans;
 	static retransMetaEntry meta; //TODO register needed??
 	static retransPointerEntry ptrMeta;
+	// NAK retransmission, the PSNs before the NAKed (expected) one arrived and are not resent
+	static bool selective;
 
 	switch (rt_state)
 	{
@@ -323,7 +417,9 @@ void process_retransmissions(
 		{
 			rx2retrans_req.read(retrans);
 			std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: RX Retransmit triggered!!" << std::endl;
-			pointerReqFifo.write(pointerReq(retrans.qpn)); 		// enquire whether we have previous req for this qpn
+			// The NAK carries the expected PSN and acknowledges everything before, locked to release those entries
+			pointerReqFifo.write(pointerReq(retrans.qpn, true));
+			selective = true;
 			rt_state = RETRANS_0;
 		}
 		else if (!timer2retrans_req.empty())
@@ -332,6 +428,7 @@ void process_retransmissions(
 			timer2retrans_req.read(retrans);
 			// Uses always head psn
 			pointerReqFifo.write(pointerReq(retrans.qpn)); 		// enquire whether we have previous req for this qpn
+			selective = false;
 			rt_state = TIMER_RETRANS_0;
 		}
 		else if (!tx2retrans_insertRequest.empty() && !freeListFifo.empty())
@@ -420,14 +517,17 @@ void process_retransmissions(
                 // Packet update
                 if(update.op_code == RC_RDMA_READ_RESP_FIRST || update.op_code == RC_RDMA_READ_RESP_MIDDLE) {
                     // Packet update
-                    meta.localAddr += PMTU;
-                    meta.remoteAddr += PMTU;
-                    meta.length -= PMTU;
+                    meta.localAddr += pmtuBytes(update.pmtu);
+                    meta.remoteAddr += pmtuBytes(update.pmtu);
+                    meta.length -= pmtuBytes(update.pmtu);
                     meta.psn += 1;
                     // Update meta table
                     metaReqFifo.write(retransMetaReq(ptrMeta.head, retransMetaEntry(meta)));
 
                     std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: state UPDATE_1 packet update, psn " << meta.psn << ", laddr " << meta.localAddr << ", raddr " << meta.remoteAddr << ", len " << meta.length << std::endl;
+                } else if (update.op_code == RC_ACK && psnAfter(meta.psn, update.latest_acked_req)) {
+                    // Duplicate ACK of a resent PSN, the head is not acknowledged yet
+                    std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: state UPDATE_1 duplicate ack, psn " << update.latest_acked_req << std::endl;
                 } else {
                     // Move index
                     ptrMeta.head = meta.next;
@@ -435,6 +535,7 @@ void process_retransmissions(
 
                     // Clear free list
                     releaseFifo.write(curr);
+                    retrans2admit_release.write(update.qpn);
                     curr = meta.next;
 
                     std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: state UPDATE_1 ack update, psn " << meta.psn << std::endl;
@@ -452,7 +553,6 @@ void process_retransmissions(
 		{
 			std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: NAK, retransmitting qpn " << retrans.qpn << std::endl;
 			pointerRspFifo.read(ptrMeta);
-			rt_state = MAIN;
 			if (ptrMeta.valid)
 			{
 				// Enquire the first uncleared index (head) in `Retrans Meta Table`
@@ -460,49 +560,57 @@ void process_retransmissions(
 				curr = ptrMeta.head;
 				rt_state = RETRANS_1;
 			}
+			else
+			{
+				// Release lock
+				pointerUpdFifo.write(pointerUpdate(retrans.qpn, ptrMeta));
+				rt_state = MAIN;
+			}
 		}
 		break;
 	case RETRANS_1:
-		// loop until we get the psn "head" for retransmission
+		// Release the entries acknowledged by the NAK (their ACKs got lost), READ requests wait for their responses
 		if (!metaRspFifo.empty())
 		{
 			metaRspFifo.read(meta);
-			rt_state = MAIN;
-			if (meta.valid)
+			if (meta.valid && psnAfter(retrans.psn, meta.psn) && meta.opCode != RC_RDMA_READ_REQUEST)
 			{
+				std::cout << std::hex << "[PROCESS RETRANSMISSION " << INSTID << "]: NAK acknowledges psn " << meta.psn << std::endl;
+				ptrMeta.head = meta.next;
+				ptrMeta.valid = !meta.isTail;
+
+				// Clear free list
+				releaseFifo.write(curr);
+				retrans2admit_release.write(retrans.qpn);
+				curr = meta.next;
+
 				if (meta.isTail)
 				{
-					// this should ideally not happen
-					// requested retransmission psn not stored
-					std::cout << "[PROCESS RETRANSMISSION " << INSTID << "]: state RETRANS_1 trying to retransmit psn that is ACKed" << std::endl;
+					// Nothing left to resend, release lock
+					pointerUpdFifo.write(pointerUpdate(retrans.qpn, ptrMeta));
 					rt_state = MAIN;
 				}
 				else
 				{
-					// traversing the list
 					metaReqFifo.write(retransMetaReq(meta.next));
 				}
-
-				// check if we should start retransmitting
-				if (meta.psn == retrans.psn)
-				{
-					std::cout << std::hex << "[PROCESS RETRANSMISSION " << INSTID << "]: retransmitting psn " << meta.psn << std::endl;
-					retrans2event.write(retransEvent(meta.opCode, retrans.qpn, meta.localAddr, meta.remoteAddr, meta.length, meta.psn, meta.lst, meta.offs));
-					if (!meta.isTail)
-					{
-						rt_state = RETRANS_2;
-					}
-				}
-				else
+			}
+			else
+			{
+				// New head, release lock
+				pointerUpdFifo.write(pointerUpdate(retrans.qpn, ptrMeta));
+				rt_state = MAIN;
+				if (meta.valid)
 				{
-					// keep traversing
-					rt_state = RETRANS_1;
+					// Resend the missing range from here
+					metaReqFifo.write(retransMetaReq(curr));
+					rt_state = RETRANS_2;
 				}
 			}
 		}
 		break;
 	case RETRANS_2:
-		// Retransmit everything until reach tail
+		// Retransmit everything until reach tail, on a NAK from the NAKed psn on
 		if (!metaRspFifo.empty())
 		{
 			metaRspFifo.read(meta);
@@ -515,8 +623,11 @@ void process_retransmissions(
 					metaReqFifo.write(retransMetaReq(meta.next));
 					rt_state = RETRANS_2;
 				}
-				std::cout << std::hex << "[PROCESS RETRANSMISSION " << INSTID << "]: retransmitting psn " << meta.psn << std::endl;
-				retrans2event.write(retransEvent(meta.opCode, retrans.qpn, meta.localAddr, meta.remoteAddr, meta.length, meta.psn, meta.lst, meta.offs));
+				if (!selective || !psnAfter(retrans.psn, meta.psn))
+				{
+					std::cout << std::hex << "[PROCESS RETRANSMISSION " << INSTID << "]: retransmitting psn " << meta.psn << std::endl;
+					retrans2event.write(retransEvent(meta.opCode, retrans.qpn, meta.localAddr, meta.remoteAddr, meta.length, meta.psn, meta.lst, meta.offs));
+				}
 			}
 		}
 		break;
@@ -569,6 +680,7 @@ void retransmitter(
 	stream<retransmission>& rx2retrans_req,
 	stream<retransmission>& timer2retrans_req,
 	stream<retransEntry>&	tx2retrans_insertRequest,
+	stream<ap_uint<16> >&	retrans2admit_release,
 	stream<retransEvent>&	retrans2event
 ) {
 //#pragma HLS DATAFLOW
@@ -612,6 +724,7 @@ void retransmitter(
 		rt_metaRspFifo,
 		rt_freeListFifo,
 		rt_releaseFifo,
+		retrans2admit_release,
 		retrans2event
 	);
 }
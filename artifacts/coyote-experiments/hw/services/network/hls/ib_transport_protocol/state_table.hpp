@@ -32,6 +32,9 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../ib_transport_protocol/ib_transport_protocol.hpp"
 #include <rocev2_config.hpp> //defines MAX_QPS
 
+// Bits of a state table entry in the QP context backing store
+const uint32_t STATE_ENTRY_BITS = 143;
+
 //PSN, page 293, 307, 345
 struct stateTableEntry
 {
@@ -43,6 +46,22 @@ struct stateTableEntry
 	ap_uint<24> req_old_unack;
 	ap_uint<24> req_old_valid; //required? can be computed?
 	ap_uint<3>	retryCounter;
+	//inspection
+	ap_uint<8>	rejectCount;
+	ap_uint<8>	rejectThreshold; // 0 - never quarantined
+	bool		quarantined;
+	//path MTU, segmentation of the READ responses
+	ap_uint<3>	pmtu;
+	stateTableEntry() {}
+	stateTableEntry(ap_uint<STATE_ENTRY_BITS> line)
+		:resp_epsn(line(23, 0)), resp_old_outstanding(line(47, 24)), req_next_psn(line(71, 48)), req_old_unack(line(95, 72)),
+		req_old_valid(line(119, 96)), retryCounter(line(122, 120)), rejectCount(line(130, 123)), rejectThreshold(line(138, 131)),
+		quarantined(line[139]), pmtu(line(142, 140)) {}
+	ap_uint<STATE_ENTRY_BITS> toLine()
+	{
+		return (pmtu, ap_uint<1>(quarantined), rejectThreshold, rejectCount, retryCounter, req_old_valid, req_old_unack, req_next_psn,
+				resp_old_outstanding, resp_epsn);
+	}
 };
 
 struct ifStateReq
@@ -51,12 +70,18 @@ struct ifStateReq
 	qpState		newState;
 	ap_uint<24> remote_psn;
 	ap_uint<24> local_psn;
+	ap_uint<8>	rejectThreshold;
+	ap_uint<3>	pmtu;
 	bool		write;
 	ifStateReq() {}
 	ifStateReq(ap_uint<24> qpn)
 		:qpn(qpn), write(false) {}
 	ifStateReq(ap_uint<16> qpn, qpState s, ap_uint<24> rpsn, ap_uint<24> lpsn)
-		:qpn(qpn), newState(s), remote_psn(rpsn), local_psn(lpsn), write(true) {}
+		:qpn(qpn), newState(s), remote_psn(rpsn), local_psn(lpsn), rejectThreshold(0), pmtu(0), write(true) {}
+	ifStateReq(ap_uint<16> qpn, qpState s, ap_uint<24> rpsn, ap_uint<24> lpsn, ap_uint<8> thr)
+		:qpn(qpn), newState(s), remote_psn(rpsn), local_psn(lpsn), rejectThreshold(thr), pmtu(0), write(true) {}
+	ifStateReq(ap_uint<16> qpn, qpState s, ap_uint<24> rpsn, ap_uint<24> lpsn, ap_uint<8> thr, ap_uint<3> pmtu)
+		:qpn(qpn), newState(s), remote_psn(rpsn), local_psn(lpsn), rejectThreshold(thr), pmtu(pmtu), write(true) {}
 };
 
 struct rxStateReq
@@ -84,14 +109,20 @@ struct rxStateRsp
 	ap_uint<24> max_forward; //used for reponses, page 346
 
 	ap_uint<3>	retryCounter;
+	bool		quarantined;
+	ap_uint<3>	pmtu;
 
-	rxStateRsp() {}
+	rxStateRsp() :quarantined(false), pmtu(0) {}
 	rxStateRsp(ap_uint<24> epsn, ap_uint<24> old)
-		:epsn(epsn), oldest_outstanding_psn(old), max_forward(0), retryCounter(0) {}
+		:epsn(epsn), oldest_outstanding_psn(old), max_forward(0), retryCounter(0), quarantined(false), pmtu(0) {}
 	rxStateRsp(ap_uint<24> epsn, ap_uint<24> old, ap_uint<24> maxf)
-		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(0) {}
+		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(0), quarantined(false), pmtu(0) {}
 	rxStateRsp(ap_uint<24> epsn, ap_uint<24> old, ap_uint<24> maxf, ap_uint<3> rc)
-		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(rc) {}
+		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(rc), quarantined(false), pmtu(0) {}
+	rxStateRsp(ap_uint<24> epsn, ap_uint<24> old, ap_uint<24> maxf, ap_uint<3> rc, bool qrnt)
+		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(rc), quarantined(qrnt), pmtu(0) {}
+	rxStateRsp(ap_uint<24> epsn, ap_uint<24> old, ap_uint<24> maxf, ap_uint<3> rc, bool qrnt, ap_uint<3> pmtu)
+		:epsn(epsn), oldest_outstanding_psn(old), max_forward(maxf), retryCounter(rc), quarantined(qrnt), pmtu(pmtu) {}
 };
 
 struct txStateReq
@@ -106,101 +137,353 @@ struct txStateReq
 		:qpn(qpn), psn(psn), write(true) {}
 };
 
-template <int INSTID>
+// Lines of the state table, the whole table when it is not cached
+const uint32_t STATE_LINES = (QP_CACHE_LINES == 0) ? MAX_QPS : QP_CACHE_LINES;
+// Evicted lines kept on chip until their write-back is acknowledged
+const uint32_t STATE_VICTIMS = 4;
+
+#ifdef __SYNTHESIS__
+// The rocev2 top has no QP context backing store ports, a miss would never be served
+static_assert(QP_CACHE_LINES == 0, "QP context cache (ROCE_STACK_QP_CACHE_LINES) is csim only");
+#endif
+
+typedef enum {ST_SRC_RX, ST_SRC_TX, ST_SRC_QPI, ST_SRC_DPI} stateSrcType;
+
+template <int WIDTH, int INSTID>
 void state_table(	hls::stream<rxStateReq>& rxIbh2stateTable_upd_req,
 						hls::stream<txStateReq>& txIbh2stateTable_upd_req,
 						hls::stream<ifStateReq>& qpi2stateTable_upd_req,
 						hls::stream<rxStateRsp>& stateTable2rxIbh_rsp,
 						hls::stream<stateTableEntry>& stateTable2txIbh_rsp,
-						hls::stream<stateTableEntry>& stateTable2qpi_rsp);
-
+						hls::stream<stateTableEntry>& stateTable2qpi_rsp,
+						hls::stream<ap_uint<16> >& dpi2stateTable_reject,
+						hls::stream<bool>& stateTable2dpi_rsp,
+						hls::stream<memCmd>& m_axis_ctx_read_cmd,
+						hls::stream<net_axis<WIDTH> >& s_axis_ctx_read_data,
+						hls::stream<memCmd>& m_axis_ctx_write_cmd,
+						hls::stream<net_axis<WIDTH> >& m_axis_ctx_write_data,
+						hls::stream<ap_uint<8> >& s_axis_ctx_write_sts,
+						ap_uint<32>& regDpiQuarantineCount,
+						ap_uint<32>& regDpiQuarantineQpn,
+						ap_uint<32>& regQpCacheHitCount,
+						ap_uint<32>& regQpCacheMissCount);
 
-template <int INSTID = 0>
+/**
+ * State table
+ *
+ * With QP_CACHE_LINES set, the table is a direct mapped cache of the per-QP state, backed by card memory
+ * (one WIDTH word per QP at QP_CACHE_BASE). A request missing its QP is parked and the QP fetched, only the
+ * source of the request is stalled, the other sources are served in the meantime. One fetch is outstanding
+ * at a time, the fetched line is installed and the parked request served in the same cycle. Dirty lines are
+ * written back on eviction and kept in a small victim buffer, a refetch is served from there. A victim slot
+ * is reused only once its write-back is acknowledged, and a QP is not fetched while its write-back is pending,
+ * the read and write ports are not ordered. A QP setup writes the whole entry and does not fetch.
+ */
+template <int WIDTH, int INSTID = 0>
 void state_table(		
 	hls::stream<rxStateReq>& rxIbh2stateTable_upd_req,
 	hls::stream<txStateReq>& txIbh2stateTable_upd_req,
 	hls::stream<ifStateReq>& qpi2stateTable_upd_req,
 	hls::stream<rxStateRsp>& stateTable2rxIbh_rsp,
 	hls::stream<stateTableEntry>& stateTable2txIbh_rsp,
-	hls::stream<stateTableEntry>& stateTable2qpi_rsp
+	hls::stream<stateTableEntry>& stateTable2qpi_rsp,
+	// Inspection rejections, response whether the QP is quarantined
+	hls::stream<ap_uint<16> >& dpi2stateTable_reject,
+	hls::stream<bool>& stateTable2dpi_rsp,
+	// QP context backing store, only used with QP_CACHE_LINES (csim, not ports of the rocev2 top)
+	hls::stream<memCmd>& m_axis_ctx_read_cmd,
+	hls::stream<net_axis<WIDTH> >& s_axis_ctx_read_data,
+	hls::stream<memCmd>& m_axis_ctx_write_cmd,
+	hls::stream<net_axis<WIDTH> >& m_axis_ctx_write_data,
+	// Write-back acknowledgements, in order (datamover status)
+	hls::stream<ap_uint<8> >& s_axis_ctx_write_sts,
+	// Number of quarantined QPs, last quarantined QPN
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn,
+	// Lookups served on chip, QPs fetched from the backing store
+	ap_uint<32>& regQpCacheHitCount,
+	ap_uint<32>& regQpCacheMissCount
 ) {
 #pragma HLS PIPELINE II=1
 #pragma HLS INLINE off
 
-	static stateTableEntry state_table[MAX_QPS];
+	static stateTableEntry state_table[STATE_LINES];
+	static ap_uint<16> line_qpn[STATE_LINES];
+	static bool line_valid[STATE_LINES];
+	static bool line_dirty[STATE_LINES];
 #if defined( __VITIS_HLS__)
 	#pragma HLS bind_storage variable=state_table type=RAM_2P impl=BRAM
 #else
 	#pragma HLS RESOURCE variable=state_table core=RAM_2P_BRAM
 #endif
 
-	rxStateReq rxRequest;
-	txStateReq txRequest;
-	ifStateReq ifRequest;
+	// Requests waiting for their QP, a parked source is not read
+	static bool parked[4];
+	#pragma HLS ARRAY_PARTITION variable=parked complete
+	static rxStateReq rxRequest;
+	static txStateReq txRequest;
+	static ifStateReq ifRequest;
+	static ap_uint<16> rejectQpn;
+
+	// Outstanding fetch
+	static bool fetching = false;
+	static stateSrcType fetchSrc;
+
+	static stateTableEntry victim[STATE_VICTIMS];
+	static ap_uint<16> victim_qpn[STATE_VICTIMS];
+	static bool victim_valid[STATE_VICTIMS];
+	static bool victim_wb[STATE_VICTIMS]; // write-back not acknowledged
+	#pragma HLS ARRAY_PARTITION variable=victim complete
+	#pragma HLS ARRAY_PARTITION variable=victim_qpn complete
+	#pragma HLS ARRAY_PARTITION variable=victim_valid complete
+	#pragma HLS ARRAY_PARTITION variable=victim_wb complete
+	static ap_uint<2> victimPtr = 0;
+	static ap_uint<2> victimAckPtr = 0;
+
+	static ap_uint<32> qrntCount = 0;
+	static ap_uint<32> hitCount = 0;
+	static ap_uint<32> missCount = 0;
+
+	stateSrcType src;
+	bool sel = false;
+	bool filled = false;
+	net_axis<WIDTH> fillWord;
+
+	// Write-backs complete in order
+	if (QP_CACHE_LINES != 0 && !s_axis_ctx_write_sts.empty())
+	{
+		s_axis_ctx_write_sts.read();
+		victim_wb[victimAckPtr] = false;
+		victimAckPtr++;
+	}
+
+	// Installing may evict, the fetched line is only taken with a victim slot free
+	bool victimFree = !victim_wb[victimPtr];
 
-	if (!rxIbh2stateTable_upd_req.empty())
+	if (QP_CACHE_LINES != 0 && fetching && victimFree && !s_axis_ctx_read_data.empty())
+	{
+		s_axis_ctx_read_data.read(fillWord);
+		fetching = false;
+		src = fetchSrc;
+		sel = true;
+		filled = true;
+	}
+	else if (!fetching && (parked[ST_SRC_RX] || parked[ST_SRC_TX] || parked[ST_SRC_QPI] || parked[ST_SRC_DPI]))
+	{
+		// Parked request waiting for the fetch slot
+		src = parked[ST_SRC_RX] ? ST_SRC_RX : parked[ST_SRC_TX] ? ST_SRC_TX : parked[ST_SRC_QPI] ? ST_SRC_QPI : ST_SRC_DPI;
+		sel = true;
+	}
+	else if (!parked[ST_SRC_RX] && !rxIbh2stateTable_upd_req.empty())
 	{
 		rxIbh2stateTable_upd_req.read(rxRequest);
-		if (rxRequest.write)
+		src = ST_SRC_RX;
+		sel = true;
+	}
+	else if (!parked[ST_SRC_TX] && !txIbh2stateTable_upd_req.empty())
+	{
+		txIbh2stateTable_upd_req.read(txRequest);
+		src = ST_SRC_TX;
+		sel = true;
+	}
+	else if (!parked[ST_SRC_QPI] && !qpi2stateTable_upd_req.empty())
+	{
+		qpi2stateTable_upd_req.read(ifRequest);
+		src = ST_SRC_QPI;
+		sel = true;
+	}
+	else if (!parked[ST_SRC_DPI] && !dpi2stateTable_reject.empty())
+	{
+		dpi2stateTable_reject.read(rejectQpn);
+		src = ST_SRC_DPI;
+		sel = true;
+	}
+
+	if (sel)
+	{
+		ap_uint<16> qpn = (src == ST_SRC_RX) ? rxRequest.qpn : (src == ST_SRC_TX) ? txRequest.qpn :
+						  (src == ST_SRC_QPI) ? ifRequest.qpn : rejectQpn;
+		ap_uint<16> idx = (QP_CACHE_LINES == 0) ? qpn : (ap_uint<16>) (qpn & (STATE_LINES-1));
+		stateTableEntry line = state_table[idx];
+		stateTableEntry entry = line;
+		bool hit = (QP_CACHE_LINES == 0) || (line_valid[idx] && line_qpn[idx] == qpn);
+		bool install = false;
+
+		bool inVictim = false;
+		bool wbPending = false;
+		ap_uint<2> v = 0;
+		for (int i = 0; i < STATE_VICTIMS; i++)
 		{
-			if (rxRequest.isResponse)
+		#pragma HLS UNROLL
+			if (victim_valid[i] && victim_qpn[i] == qpn)
 			{
-				state_table[rxRequest.qpn].req_old_unack = rxRequest.epsn;
+				inVictim = true;
+				v = i;
 			}
-			else
+			if (victim_wb[i] && victim_qpn[i] == qpn)
 			{
-				state_table[rxRequest.qpn].resp_epsn = rxRequest.epsn;
-				state_table[rxRequest.qpn].retryCounter = rxRequest.retryCounter;
-				//state_table[rxRequest.qpn].sendNAK = rxRequest.epsn;
+				wbPending = true;
 			}
 		}
-		else
+		bool evict = (QP_CACHE_LINES != 0) && line_valid[idx] && line_dirty[idx];
+
+		if (hit)
 		{
-			stateTableEntry entry = state_table[rxRequest.qpn(15,0)];
-			if (rxRequest.isResponse)
+			// A setup in the meantime wins over the fetched state
+			if (!filled)
 			{
-				stateTable2rxIbh_rsp.write(rxStateRsp(entry.req_old_unack, entry.req_old_valid, entry.req_next_psn-1));
-			}
-			else
-			{
-				stateTable2rxIbh_rsp.write(rxStateRsp(entry.resp_epsn, entry.resp_old_outstanding, entry.resp_epsn, entry.retryCounter));
+				hitCount++;
+				regQpCacheHitCount = hitCount;
 			}
 		}
-	}
-	else if (!txIbh2stateTable_upd_req.empty())
-	{
-		txIbh2stateTable_upd_req.read(txRequest);
-		if (txRequest.write)
+		else if (filled)
 		{
-			state_table[txRequest.qpn].req_next_psn = txRequest.psn;
+			entry = stateTableEntry(fillWord.data(STATE_ENTRY_BITS-1, 0));
+			install = true;
 		}
-		else
+		else if (evict && !victimFree)
 		{
-			stateTable2txIbh_rsp.write(state_table[txRequest.qpn]);
+			// Retried once a write-back is acknowledged
+			parked[src] = true;
 		}
-	}
-	else if (!qpi2stateTable_upd_req.empty())
-	{
-		qpi2stateTable_upd_req.read(ifRequest);
-		if (ifRequest.write)
+		else if (src == ST_SRC_QPI && ifRequest.write)
+		{
+			// Whole entry written below
+			if (inVictim)
+				victim_valid[v] = false;
+			install = true;
+		}
+		else if (inVictim)
 		{
-			std::cout << std::hex << "[STATE TABLE " << INSTID << "]: setup new connection, psn " << ifRequest.remote_psn << std::endl;
-			//state_table[ifRequest.qpn].state = ifRequest.newState;
-			//state_table[ifRequest.qpn].prevOpCode = RC_RDMA_WRITE_LAST;
-			state_table[ifRequest.qpn].resp_epsn = ifRequest.local_psn;
-			state_table[ifRequest.qpn].resp_old_outstanding = ifRequest.local_psn;
-			state_table[ifRequest.qpn].req_next_psn = ifRequest.remote_psn;
-			state_table[ifRequest.qpn].req_old_unack = ifRequest.remote_psn;
-			state_table[ifRequest.qpn].req_old_valid = ifRequest.remote_psn;
-			state_table[ifRequest.qpn].retryCounter = 0xF;
-			//state_table[ifRequest.qpn].sendNAK = false;
-
-			//state_table[ifRequest.qpn].r_key = ifRequest.r_key;
-			//state_table[ifRequest.qpn].virtual_address = ifRequest.virtual_address;
+			entry = victim[v];
+			victim_valid[v] = false;
+			install = true;
 		}
 		else
 		{
-			stateTable2qpi_rsp.write(state_table[ifRequest.qpn(15,0)]);
+			// Memory holds the QP only once its write-back is acknowledged
+			if (!fetching && !wbPending)
+			{
+				std::cout << std::hex << "[STATE TABLE " << INSTID << "]: fetching qpn " << qpn << std::endl;
+				m_axis_ctx_read_cmd.write(memCmd(QP_CACHE_BASE + ((ap_uint<64>) qpn) * (WIDTH/8), WIDTH/8, PKG_F, 0, 0, 0));
+				fetching = true;
+				fetchSrc = src;
+				missCount++;
+				regQpCacheMissCount = missCount;
+			}
+			parked[src] = true;
+		}
+
+		if (install)
+		{
+			// Evict, dirty state goes back to memory
+			if (evict)
+			{
+				m_axis_ctx_write_cmd.write(memCmd(QP_CACHE_BASE + ((ap_uint<64>) line_qpn[idx]) * (WIDTH/8), WIDTH/8, PKG_F, 0, 0, 0));
+				m_axis_ctx_write_data.write(net_axis<WIDTH>(line.toLine(), ~ap_uint<WIDTH/8>(0), 1));
+				victim[victimPtr] = line;
+				victim_qpn[victimPtr] = line_qpn[idx];
+				victim_valid[victimPtr] = true;
+				victim_wb[victimPtr] = true;
+				victimPtr++;
+			}
+			line_qpn[idx] = qpn;
+			line_valid[idx] = true;
+			line_dirty[idx] = false;
+			hit = true;
+		}
+
+		if (hit)
+		{
+			bool dirty = false;
+			parked[src] = false;
+
+			switch (src)
+			{
+			case ST_SRC_RX:
+				if (rxRequest.write)
+				{
+					if (rxRequest.isResponse)
+					{
+						entry.req_old_unack = rxRequest.epsn;
+					}
+					else
+					{
+						entry.resp_epsn = rxRequest.epsn;
+						entry.retryCounter = rxRequest.retryCounter;
+						//entry.sendNAK = rxRequest.epsn;
+					}
+					dirty = true;
+				}
+				else
+				{
+					if (rxRequest.isResponse)
+					{
+						stateTable2rxIbh_rsp.write(rxStateRsp(entry.req_old_unack, entry.req_old_valid, entry.req_next_psn-1, 0, entry.quarantined, entry.pmtu));
+					}
+					else
+					{
+						stateTable2rxIbh_rsp.write(rxStateRsp(entry.resp_epsn, entry.resp_old_outstanding, entry.resp_epsn, entry.retryCounter, entry.quarantined, entry.pmtu));
+					}
+				}
+				break;
+			case ST_SRC_TX:
+				if (txRequest.write)
+				{
+					entry.req_next_psn = txRequest.psn;
+					dirty = true;
+				}
+				else
+				{
+					stateTable2txIbh_rsp.write(entry);
+				}
+				break;
+			case ST_SRC_QPI:
+				if (ifRequest.write)
+				{
+					std::cout << std::hex << "[STATE TABLE " << INSTID << "]: setup new connection, psn " << ifRequest.remote_psn << std::endl;
+					//entry.state = ifRequest.newState;
+					//entry.prevOpCode = RC_RDMA_WRITE_LAST;
+					entry.resp_epsn = ifRequest.local_psn;
+					entry.resp_old_outstanding = ifRequest.local_psn;
+					entry.req_next_psn = ifRequest.remote_psn;
+					entry.req_old_unack = ifRequest.remote_psn;
+					entry.req_old_valid = ifRequest.remote_psn;
+					entry.retryCounter = 0xF;
+					entry.rejectCount = 0;
+					entry.rejectThreshold = ifRequest.rejectThreshold;
+					entry.quarantined = false;
+					entry.pmtu = ifRequest.pmtu;
+					//entry.sendNAK = false;
+					dirty = true;
+				}
+				else
+				{
+					stateTable2qpi_rsp.write(entry);
+				}
+				break;
+			case ST_SRC_DPI:
+				if (!entry.quarantined && entry.rejectThreshold != 0)
+				{
+					entry.rejectCount++;
+					if (entry.rejectCount >= entry.rejectThreshold)
+					{
+						std::cout << std::hex << "[STATE TABLE " << INSTID << "]: quarantined qpn " << rejectQpn << std::endl;
+						entry.quarantined = true;
+						qrntCount++;
+						regDpiQuarantineCount = qrntCount;
+						regDpiQuarantineQpn = rejectQpn;
+					}
+					dirty = true;
+				}
+				stateTable2dpi_rsp.write(entry.quarantined);
+				break;
+			}
+
+			if (dirty || install)
+				state_table[idx] = entry;
+			if (dirty)
+				line_dirty[idx] = true;
 		}
 	}
 
@@ -50,7 +50,7 @@ void process_ipv6(	stream<net_axis<WIDTH> >&	input,
 			output.write(currWord);
 			if (!metaWritten)
 			{
-				metaOut.write(ipv6Meta(pi_header.getSrcAddress(), pi_header.getPayloadLen(), pi_header.getNextHeader()));
+				metaOut.write(ipv6Meta(pi_header.getSrcAddress(), pi_header.getPayloadLen(), pi_header.getNextHeader(), pi_header.getECN()));
 				metaWritten = true;
 			}
 		}
@@ -37,9 +37,12 @@ struct ipv6Meta
 	ap_uint<128> their_address;
 	ap_uint<16> length;
 	ap_uint<8>  next_header;
+	ap_uint<2>  ecn;
 	ipv6Meta() {}
 	ipv6Meta(ap_uint<128> addr, ap_uint<16> len, ap_uint<8> next)
-		:their_address(addr), length(len), next_header(next) {}
+		:their_address(addr), length(len), next_header(next), ecn(0) {}
+	ipv6Meta(ap_uint<128> addr, ap_uint<16> len, ap_uint<8> next, ap_uint<2> ecn)
+		:their_address(addr), length(len), next_header(next), ecn(ecn) {}
 };
 
 
@@ -96,6 +99,11 @@ public:
 	{
 		return header(55,48);
 	}
+	// Low two bits of the traffic class
+	ap_uint<2> getECN()
+	{
+		return header(13,12);
+	}
 };
 
 
@@ -87,6 +87,9 @@ void rocev2(
 
 	hls::stream<intrusionDecision>& intrusionDecisionIn, 
 
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
+
 	//Debug output
 #ifdef DBG_IBV
 	hls::stream<psnPkg>& m_axis_dbg,
@@ -95,7 +98,11 @@ void rocev2(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn
 ) {
 #pragma HLS INLINE
 
@@ -125,6 +132,15 @@ void rocev2(
 	#pragma HLS STREAM depth=2 variable=tx_udp2ipMetaFifo
 	#pragma HLS STREAM depth=2 variable=tx_udp2ipFifo
 
+	// QP context backing store, not connected, the state table is only cached in csim (QP_CACHE_LINES)
+	static stream<memCmd>	ctx_readCmdFifo("ctx_readCmdFifo");
+	static stream<net_axis<WIDTH> >	ctx_readDataFifo("ctx_readDataFifo");
+	static stream<memCmd>	ctx_writeCmdFifo("ctx_writeCmdFifo");
+	static stream<net_axis<WIDTH> >	ctx_writeDataFifo("ctx_writeDataFifo");
+	static stream<ap_uint<8> >	ctx_writeStsFifo("ctx_writeStsFifo");
+	ap_uint<32> regQpCacheHitCount;
+	ap_uint<32> regQpCacheMissCount;
+
     /*
      * CRC
      */
@@ -193,6 +209,11 @@ void rocev2(
 		m_axis_mem_read_cmd,
 		m_axis_mem_write_data,
 		s_axis_mem_read_data,
+		ctx_readCmdFifo,
+		ctx_readDataFifo,
+		ctx_writeCmdFifo,
+		ctx_writeDataFifo,
+		ctx_writeStsFifo,
 		s_axis_qp_interface,
 		s_axis_qp_conn_interface,
 		tx_ackEvent_debug, 
@@ -210,6 +231,7 @@ void rocev2(
 		tx_iumm_dstQpFifo_debug,
 		tx_exhfsm_qpn_debug,
 		intrusionDecisionIn, 
+		dcqcnCnfg,
 
 #ifdef DBG_IBV
 		m_axis_dbg,
@@ -217,7 +239,13 @@ void rocev2(
 		regInvalidPsnDropCount,
         regRetransCount,
 		regIbvCountRx,
-        regIbvCountTx
+        regIbvCountTx,
+		regDpiRejectCount,
+		regDpiMonitorCount,
+		regDpiQuarantineCount,
+		regDpiQuarantineQpn,
+		regQpCacheHitCount,
+		regQpCacheMissCount
 	);
     
 }
@@ -264,6 +292,9 @@ void rocev2_top(
 	// Intrusion Detection Input 
 	stream<intrusionDecision>& intrusionDecisionIn, 
 
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
+
 	//Debug output
 #ifdef DBG_IBV
 	stream<psnPkg>& m_axis_dbg,
@@ -272,7 +303,11 @@ void rocev2_top(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn
 ) {
 	#pragma HLS DATAFLOW disable_start_propagation
 	#pragma HLS INTERFACE ap_ctrl_none port=return
@@ -304,6 +339,7 @@ void rocev2_top(
 	#pragma HLS aggregate  variable=s_axis_qp_conn_interface compact=bit
 
 	#pragma HLS INTERFACE ap_none register port=local_ip_address
+	#pragma HLS INTERFACE ap_none register port=dcqcnCnfg
 
 	#pragma HLS INTERFACE axis register port=tx_ackEvent_debug
 	#pragma HLS INTERFACE axis register port=tx_ibhHeaderFifo_debug
@@ -378,6 +414,7 @@ void rocev2_top(
 		tx_iumm_dstQpFifo_debug, 
 		tx_exhfsm_qpn_debug, 
 		intrusionDecisionIn, 
+		dcqcnCnfg,
 
 #ifdef DBG_IBV
 		m_axis_dbg,
@@ -386,7 +423,11 @@ void rocev2_top(
 		regInvalidPsnDropCount,
         regRetransCount,
 		regIbvCountRx,
-        regIbvCountTx
+        regIbvCountTx,
+		regDpiRejectCount,
+		regDpiMonitorCount,
+		regDpiQuarantineCount,
+		regDpiQuarantineQpn
 	);
 	
 #else
@@ -435,6 +476,9 @@ void rocev2_top(
 	stream<ap_uint<16> >& tx_exhfsm_qpn_debug, 
 	stream<intrusionDecision>& intrusionDecisionIn, 
 
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
+
 	//Debug output
 #ifdef DBG_IBV
 	stream<psnPkg>& m_axis_dbg,
@@ -443,7 +487,11 @@ void rocev2_top(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn
 ) {
 	#pragma HLS DATAFLOW disable_start_propagation
 	#pragma HLS INTERFACE ap_ctrl_none port=return
@@ -475,6 +523,7 @@ void rocev2_top(
 	#pragma HLS DATA_PACK variable=s_axis_qp_conn_interface
 
 	#pragma HLS INTERFACE ap_none register port=local_ip_address
+	#pragma HLS INTERFACE ap_none register port=dcqcnCnfg
 
 	#pragma HLS INTERFACE axis register port=tx_ackEvent_debug
 	#pragma HLS INTERFACE axis register port=tx_ibhHeaderFifo_debug
@@ -530,6 +579,8 @@ void rocev2_top(
 		tx_gibh_state_debug,
 		tx_iumm_dstQpFifo_debug, 
 		tx_exhfsm_qpn_debug,
+		intrusionDecisionIn,
+		dcqcnCnfg,
 
 #ifdef DBG_IBV
 		m_axis_dbg,
@@ -538,7 +589,11 @@ void rocev2_top(
 		regInvalidPsnDropCount,
         regRetransCount,
 		regIbvCountRx,
-        regIbvCountTx
+        regIbvCountTx,
+		regDpiRejectCount,
+		regDpiMonitorCount,
+		regDpiQuarantineCount,
+		regDpiQuarantineQpn
 );
 #endif
 
@@ -81,6 +81,9 @@ void rocev2(
 	hls::stream<ap_uint<24> >& tx_iumm_dstQpFifo_debug, 
 	hls::stream<ap_uint<16>>& tx_exhfsm_qpn_debug,
 	hls::stream<intrusionDecision>& intrusionDecisionIn, 
+
+	// DCQCN parameters
+	ap_uint<64> dcqcnCnfg,
 	
 	// Debug
 #ifdef DBG_IBV
@@ -90,6 +93,10 @@ void rocev2(
 	ap_uint<32>& regInvalidPsnDropCount,
     ap_uint<32>& regRetransCount,
 	ap_uint<32>& regIbvCountRx,
-    ap_uint<32>& regIbvCountTx
+    ap_uint<32>& regIbvCountTx,
+	ap_uint<32>& regDpiRejectCount,
+	ap_uint<32>& regDpiMonitorCount,
+	ap_uint<32>& regDpiQuarantineCount,
+	ap_uint<32>& regDpiQuarantineQpn
 );
 
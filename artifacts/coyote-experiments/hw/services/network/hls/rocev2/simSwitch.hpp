@@ -61,11 +61,18 @@ using namespace hls;
         cntPacketN##srcNode++;                                                  \
         if(dropEveryNPacket)                                                    \
             dropPacketN##srcNode = (cntPacketN##srcNode % dropEveryNPacket)==0; \
-        if(dropPacketN##srcNode);                                               \
+        if(dropPacketN##srcNode)                                                \
+            congestedPortN1.droppedPkts++;                                      \
         else if(udpMetaN##srcNode.their_address==ip_address_n0)                 \
-            m_axis_rx_meta_n0.write(udpMetaN##srcNode);                         \
-        else if(udpMetaN##srcNode.their_address==ip_address_n1)                 \
-            m_axis_rx_meta_n1.write(udpMetaN##srcNode);                         \
+            linkN0.push(udpMetaN##srcNode, simCycle);                           \
+        else if(udpMetaN##srcNode.their_address==ip_address_n1){                \
+            congestedPortN1.pkts++;                                             \
+            if(markEcn(congestedPortN1)){                                       \
+                udpMetaN##srcNode.ecn = 0x3;                                    \
+                congestedPortN1.markedPkts++;                                   \
+            }                                                                   \
+            egressMetaN1.write(udpMetaN##srcNode);                              \
+        }                                                                       \
         else                                                                    \
             std::cout << "[ERROR] Non-existing IP:" << std::hex                 \
                 << udpMetaN##srcNode.their_address << std::endl;                \
@@ -94,11 +101,16 @@ using namespace hls;
 #define FWDDATA(srcNode)                                                \
     if (!s_axis_tx_data_n##srcNode.empty() && udpMetaVldN##srcNode){    \
         s_axis_tx_data_n##srcNode.read(currWordN##srcNode);             \
+        if(firstWordN##srcNode && currWordN##srcNode.data(7,0)==RC_CNP) \
+            congestedPortN1.cnpPkts++;                                  \
+        firstWordN##srcNode = currWordN##srcNode.last;                  \
         if(dropPacketN##srcNode);                                       \
         else if(udpMetaN##srcNode.their_address==ip_address_n0)         \
-            m_axis_rx_data_n0.write(currWordN##srcNode);                \
-        else                                                            \
-            m_axis_rx_data_n1.write(currWordN##srcNode);                \
+            linkN0.data.write(currWordN##srcNode);                      \
+        else{                                                           \
+            egressDataN1.write(currWordN##srcNode);                     \
+            congestedPortN1.queueDepth++;                               \
+        }                                                               \
         if(currWordN##srcNode.last){                                    \
             udpMetaVldN##srcNode = false;                               \
             dropPacketN##srcNode = false;                               \
@@ -152,6 +164,71 @@ using namespace hls;
 // ------------------------------------------------------------------------------------------------
 // simulate switch behavior with udp packets
 // ------------------------------------------------------------------------------------------------
+
+// Egress port towards n1, drains one beat every drainCycles calls (0 - no bottleneck),
+// packets are ECN marked (RED) on enqueue between ecnKmin and ecnKmax queued beats
+struct simSwitchPort {
+    uint32_t drainCycles = 0;
+    uint32_t ecnKmin = 0;
+    uint32_t ecnKmax = 0; // 0 - no marking
+    // stats
+    uint32_t queueDepth = 0;
+    uint32_t maxQueueDepth = 0;
+    uint32_t pkts = 0;
+    uint32_t markedPkts = 0;
+    uint32_t cnpPkts = 0;
+    uint32_t droppedPkts = 0; // loss injection, both directions
+    uint32_t markAcc = 0;
+    uint32_t latencyCycles = 0; // one-way link delay of both directions, the RTT is twice this
+};
+
+// Link delay, a packet is delivered latencyCycles calls after its meta entered the link
+template <int WIDTH>
+struct simSwitchLink {
+    stream<ipUdpMeta> meta;
+    stream<net_axis<WIDTH> > data;
+    stream<uint32_t> arrival;
+    uint32_t headArrival = 0;
+    bool headVld = false;
+    bool pktVld = false;
+
+    void push(ipUdpMeta& udpMeta, uint32_t cycle) {
+        meta.write(udpMeta);
+        arrival.write(cycle);
+    }
+
+    void pop(stream<ipUdpMeta>& m_meta, stream<net_axis<WIDTH> >& m_data, uint32_t cycle, uint32_t latency) {
+        if (!headVld && !pktVld && !arrival.empty()){
+            headArrival = arrival.read();
+            headVld = true;
+        }
+        if (headVld && cycle - headArrival >= latency){
+            m_meta.write(meta.read());
+            headVld = false;
+            pktVld = true;
+        }
+        if (pktVld && !data.empty()){
+            net_axis<WIDTH> currWord = data.read();
+            m_data.write(currWord);
+            pktVld = !currWord.last;
+        }
+    }
+};
+
+// Deterministic RED, the marking probability grows linearly from Kmin to Kmax
+inline bool markEcn(simSwitchPort& port) {
+    if (port.ecnKmax == 0 || port.queueDepth <= port.ecnKmin)
+        return false;
+    if (port.queueDepth >= port.ecnKmax)
+        return true;
+    port.markAcc += port.queueDepth - port.ecnKmin;
+    if (port.markAcc >= port.ecnKmax - port.ecnKmin) {
+        port.markAcc -= port.ecnKmax - port.ecnKmin;
+        return true;
+    }
+    return false;
+}
+
 template <int WIDTH>
 void simSwitch( 
     // RX - net module
@@ -185,7 +262,8 @@ void simSwitch(
     ap_uint<128> ip_address_n3,
 #endif
 
-    ap_uint<8> dropEveryNPacket // 0 means no drop
+    ap_uint<16> dropEveryNPacket, // 0 means no drop
+    simSwitchPort& congestedPortN1
 ){
 
 #pragma HLS inline off
@@ -195,6 +273,13 @@ void simSwitch(
     static bool udpMetaVldN0, udpMetaVldN1 = false;
     static bool dropPacketN0, dropPacketN1 = false;
     static uint32_t cntPacketN0, cntPacketN1 = 0;    
+    static bool firstWordN0 = true, firstWordN1 = true;
+    static stream<ipUdpMeta> egressMetaN1;
+    static stream<net_axis<WIDTH> > egressDataN1;
+    static bool egressVldN1 = false;
+    static uint32_t egressCntN1 = 0;
+    static simSwitchLink<WIDTH> linkN0, linkN1;
+    static uint32_t simCycle = 0;
 #ifdef N_NODE_4
     static ipUdpMeta udpMetaN2, udpMetaN3;
     static bool udpMetaVldN2, udpMetaVldN3 = false;
@@ -219,12 +304,35 @@ void simSwitch(
 #ifdef N_NODE_4
     FWDDATA(2);
     FWDDATA(3);
+#else
+    // Egress n1
+    if (congestedPortN1.queueDepth > congestedPortN1.maxQueueDepth)
+        congestedPortN1.maxQueueDepth = congestedPortN1.queueDepth;
+
+    if (!egressVldN1 && !egressMetaN1.empty()){
+        ipUdpMeta egressMeta = egressMetaN1.read();
+        linkN1.push(egressMeta, simCycle);
+        egressVldN1 = true;
+    }
+    if (egressCntN1 < congestedPortN1.drainCycles)
+        egressCntN1++;
+    if (egressVldN1 && !egressDataN1.empty() && egressCntN1 >= congestedPortN1.drainCycles){
+        net_axis<WIDTH> currWord = egressDataN1.read();
+        linkN1.data.write(currWord);
+        congestedPortN1.queueDepth--;
+        egressCntN1 = 0;
+        egressVldN1 = !currWord.last;
+    }
+
+    linkN0.pop(m_axis_rx_meta_n0, m_axis_rx_data_n0, simCycle, congestedPortN1.latencyCycles);
+    linkN1.pop(m_axis_rx_meta_n1, m_axis_rx_data_n1, simCycle, congestedPortN1.latencyCycles);
+    simCycle++;
 #endif
 
 }
 
 
-int testSimSwitch(int dropEveryNPacket){
+int testSimSwitch(int dropEveryNPacket, uint32_t drainCycles = 0){
 #pragma HLS inline region off
 
     // RX - net module
@@ -245,6 +353,9 @@ int testSimSwitch(int dropEveryNPacket){
     ip_address_n1(127, 64) = 0xfe80000000000000;
     ip_address_n1(63, 0)   = 0x92e2baff0b01d4d3;
 
+    simSwitchPort congestedPortN1;
+    congestedPortN1.drainCycles = drainCycles;
+
     ipUdpMeta metaN0 = ipUdpMeta(ip_address_n1, PORT_RMT, PORT_LOC, PKT_LEN);
     ipUdpMeta metaN1 = ipUdpMeta(ip_address_n0, PORT_RMT, PORT_LOC, PKT_LEN2);
 
@@ -278,7 +389,8 @@ int testSimSwitch(int dropEveryNPacket){
             m_axis_tx_data_n1,
             ip_address_n0,
             ip_address_n1,
-            dropEveryNPacket
+            dropEveryNPacket,
+            congestedPortN1
         );
 
         // monitor the n1 rx
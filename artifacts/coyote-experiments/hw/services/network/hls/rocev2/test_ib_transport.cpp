@@ -27,6 +27,8 @@
 #include "rocev2.hpp"
 #include <fstream>
 #include <vector>
+#include <map>
+#include <set>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -38,6 +40,7 @@
 
 #include "../axi_utils.hpp" //TODO why is this needed here
 #include "../ib_transport_protocol/ib_transport_protocol.hpp"
+#include "../ib_transport_protocol/dcqcn.hpp"
 #include "rocev2_config.hpp"
 
 using namespace hls;
@@ -53,10 +56,37 @@ using namespace hls;
     static stream<memCmd> m_axis_mem_read_cmd_n##ninst;                  \
     static stream<net_axis<DATA_WIDTH> > m_axis_mem_write_data_n##ninst; \
     static stream<net_axis<DATA_WIDTH> > s_axis_mem_read_data_n##ninst;  \
+    static stream<memCmd> m_axis_ctx_read_cmd_n##ninst;                  \
+    static stream<net_axis<DATA_WIDTH> > s_axis_ctx_read_data_n##ninst;  \
+    static stream<memCmd> m_axis_ctx_write_cmd_n##ninst;                 \
+    static stream<net_axis<DATA_WIDTH> > m_axis_ctx_write_data_n##ninst; \
+    static stream<ap_uint<8> > s_axis_ctx_write_sts_n##ninst;            \
+    static stream<ackEvent> tx_ackEvent_debug_n##ninst;                  \
+    static stream<ap_uint<8> > tx_ibhHeaderFifo_debug_n##ninst;          \
+    static stream<ap_uint<8> > tx_gibh_opcode_debug_n##ninst;            \
+    static stream<gibhPsnDebug> tx_gibh_psn_debug_n##ninst;              \
+    static stream<ap_uint<8> > tx_pibh_opcode_debug_n##ninst;            \
+    static stream<event> tx_gexh_meta_debug_n##ninst;                    \
+    static stream<ap_uint<4> > tx_iumm_fire_debug_n##ninst;              \
+    static stream<pibhDebug> tx_pibh_fire_debug_n##ninst;                \
+    static stream<pibhDebug> tx_lrh_fire_debug_n##ninst;                 \
+    static stream<ibhFsmMeta> tx_ibhfsm_metain_debug_n##ninst;           \
+    static stream<ap_uint<4> > tx_gexh_state_debug_n##ninst;             \
+    static stream<ap_uint<4> > tx_gibh_state_debug_n##ninst;             \
+    static stream<ap_uint<24> > tx_iumm_dstQpFifo_debug_n##ninst;        \
+    static stream<ap_uint<16> > tx_exhfsm_qpn_debug_n##ninst;            \
+    static stream<intrusionDecision> intrusionDecisionIn_n##ninst;       \
+    ap_uint<64> dcqcnCnfg_n##ninst = 0;                                  \
     ap_uint<32> regInvalidPsnDropCount_n##ninst;                         \
     ap_uint<32> regRetransCount_n##ninst;                                \
     ap_uint<32> regValidIbvCountRx_n##ninst;                             \
-    ap_uint<32> regValidIbvCountTx_n##ninst;
+    ap_uint<32> regValidIbvCountTx_n##ninst;                             \
+    ap_uint<32> regDpiRejectCount_n##ninst = 0;                          \
+    ap_uint<32> regDpiMonitorCount_n##ninst = 0;                         \
+    ap_uint<32> regDpiQuarantineCount_n##ninst = 0;                      \
+    ap_uint<32> regDpiQuarantineQpn_n##ninst = 0;                        \
+    ap_uint<32> regQpCacheHitCount_n##ninst = 0;                         \
+    ap_uint<32> regQpCacheMissCount_n##ninst = 0;
 
 #define IBTRUN(ninst)                               \
     ib_transport_protocol<DATA_WIDTH, ninst>(       \
@@ -70,12 +100,39 @@ using namespace hls;
         m_axis_mem_read_cmd_n##ninst,               \
         m_axis_mem_write_data_n##ninst,             \
         s_axis_mem_read_data_n##ninst,              \
+        m_axis_ctx_read_cmd_n##ninst,               \
+        s_axis_ctx_read_data_n##ninst,              \
+        m_axis_ctx_write_cmd_n##ninst,              \
+        m_axis_ctx_write_data_n##ninst,             \
+        s_axis_ctx_write_sts_n##ninst,              \
         s_axis_qp_interface_n##ninst,               \
         s_axis_qp_conn_interface_n##ninst,          \
+        tx_ackEvent_debug_n##ninst,                 \
+        tx_ibhHeaderFifo_debug_n##ninst,            \
+        tx_gibh_opcode_debug_n##ninst,              \
+        tx_gibh_psn_debug_n##ninst,                 \
+        tx_pibh_opcode_debug_n##ninst,              \
+        tx_gexh_meta_debug_n##ninst,                \
+        tx_iumm_fire_debug_n##ninst,                \
+        tx_pibh_fire_debug_n##ninst,                \
+        tx_lrh_fire_debug_n##ninst,                 \
+        tx_ibhfsm_metain_debug_n##ninst,            \
+        tx_gexh_state_debug_n##ninst,               \
+        tx_gibh_state_debug_n##ninst,               \
+        tx_iumm_dstQpFifo_debug_n##ninst,           \
+        tx_exhfsm_qpn_debug_n##ninst,               \
+        intrusionDecisionIn_n##ninst,               \
+        dcqcnCnfg_n##ninst,                         \
         regInvalidPsnDropCount_n##ninst,            \
         regRetransCount_n##ninst,                   \
         regValidIbvCountRx_n##ninst,                \
-        regValidIbvCountTx_n##ninst                 \
+        regValidIbvCountTx_n##ninst,                \
+        regDpiRejectCount_n##ninst,                 \
+        regDpiMonitorCount_n##ninst,                \
+        regDpiQuarantineCount_n##ninst,             \
+        regDpiQuarantineQpn_n##ninst,               \
+        regQpCacheHitCount_n##ninst,                \
+        regQpCacheMissCount_n##ninst                \
     );
 
 #define SWITCHPORT(port)                                    \
@@ -96,7 +153,8 @@ using namespace hls;
         m_axis_tx_data_n1,                          \
         ipAddrN0,                                   \
         ipAddrN1,                                   \
-        dropEveryNPacket                            \
+        dropEveryNPacket,                           \
+        congestedPortN1                             \
     );
 
 #define DRAMRUN(ninst)                                                                    \
@@ -104,6 +162,7 @@ if (!m_axis_mem_write_cmd_n##ninst.empty() && !writeCmdReady[ninst]){
     m_axis_mem_write_cmd_n##ninst.read(writeCmd[ninst]);                                  \
     writeCmdReady[ninst] = true;                                                          \
     writeRemainLen[ninst] = writeCmd[ninst].len;                                          \
+    writeCmdLog[ninst].push_back(writeCmd[ninst]);                                        \
     std::cout << "[Memory]: Write command, address: " << writeCmd[ninst].addr              \
         << ", length: " << std::dec <<writeCmd[ninst].len << std::endl;                   \
 }                                                                                         \
@@ -117,8 +176,22 @@ if (!m_axis_mem_read_cmd_n##ninst.empty()){
     m_axis_mem_read_cmd_n##ninst.read(readCmd[ninst]);                                    \
     memoryN##ninst.processRead(readCmd[ninst], s_axis_mem_read_data_n##ninst);            \
 }                                                                                         \
+if (!m_axis_ctx_read_cmd_n##ninst.empty()){                                               \
+    memCmd ctxCmd = m_axis_ctx_read_cmd_n##ninst.read();                                  \
+    s_axis_ctx_read_data_n##ninst.write(net_axis<DATA_WIDTH>(ctxStore[ninst][ctxCmd.addr], \
+        ~ap_uint<DATA_WIDTH/8>(0), 1));                                                   \
+    ctxReadCount[ninst]++;                                                                \
+}                                                                                         \
+if (!m_axis_ctx_write_cmd_n##ninst.empty() && !m_axis_ctx_write_data_n##ninst.empty()){   \
+    memCmd ctxCmd = m_axis_ctx_write_cmd_n##ninst.read();                                 \
+    ctxStore[ninst][ctxCmd.addr] = m_axis_ctx_write_data_n##ninst.read().data;            \
+    s_axis_ctx_write_sts_n##ninst.write(0x80); /* okay */                                 \
+    ctxWriteCount[ninst]++;                                                               \
+}                                                                                         \
 if (!m_axis_rx_ack_meta_n##ninst.empty()){                                                \
     m_axis_rx_ack_meta_n##ninst.read(ackMeta[ninst]);                                     \
+    if (!ackMeta[ninst].rd) /* set for ACKs of writes, rdma_flow inverts it */            \
+        readCmplCount[ninst]++;                                                           \
     std::cout << "[Ack " << ninst << "]: qpn: " << std::hex <<                            \
         ackMeta[ninst].qpn << std::dec <<                                                 \
         "\tisNak:" << 0 <<                                                                  \
@@ -130,12 +203,21 @@ if (!m_axis_rx_ack_meta_n##ninst.empty()){
  //       << currWord.data << std::dec << std::endl;                                        \
 
 
+// Intrusion decision for the next held packet on a node
+intrusionDecision verdict(bool acceptable, ap_uint<24> qpn) {
+    intrusionDecision d;
+    d.is_acceptable = acceptable;
+    d.qpn = qpn;
+    return d;
+}
+
 int main(int argc, char* argv[]){
     // testSimSwitch(8); // drop one packet for every 8; 0 means no drop
 
     // switch ports
     SWITCHPORT(0);
     SWITCHPORT(1);
+    simSwitchPort congestedPortN1;
 
     // interfaces
     IBTPORT(0);
@@ -149,6 +231,15 @@ int main(int argc, char* argv[]){
     std::vector<memCmd> readCmd(2);
     std::vector<int> writeRemainLen(2);
     std::vector<ackMeta> ackMeta(2);
+    std::vector<std::vector<memCmd> > writeCmdLog(2);
+    // QP context backing store
+    std::vector<std::map<uint64_t, ap_uint<DATA_WIDTH> > > ctxStore(2);
+    std::vector<int> ctxReadCount {0, 0};
+    std::vector<int> ctxWriteCount {0, 0};
+    // Completed READs, what rdma_flow counts against the READ window
+    std::vector<int> readCmplCount {0, 0};
+    uint16_t dropEveryNPacket = 0;
+    int errCount = 0;
 
     // ipAddr
     ap_uint<128> ipAddrN0, ipAddrN1;
@@ -163,59 +254,603 @@ int main(int argc, char* argv[]){
 
     qpContext ctxN10 = qpContext(READY_RECV, 0x00, 0x3a19d6, 0xbc701e, 0, 0x00);
     qpContext ctxN11 = qpContext(READY_RECV, 0x01, 0x2a19d6, 0xac701e, 0, 0x00);
+
+    // DPI policies, qp 2 monitored, qp 3 bypassed
+    qpContext ctxN02 = qpContext(READY_RECV, 0x02, 0xcc701e, 0x4a19d6, 0, 0x00);
+    qpContext ctxN03 = qpContext(READY_RECV, 0x03, 0xdc701e, 0x5a19d6, 0, 0x00);
+    qpContext ctxN12 = qpContext(READY_RECV, 0x02, 0x4a19d6, 0xcc701e, 0, 0x00, DPI_MONITOR);
+    qpContext ctxN13 = qpContext(READY_RECV, 0x03, 0x5a19d6, 0xdc701e, 0, 0x00, DPI_BYPASS);
+
+    // qp 4 quarantined on n1 after two rejected messages
+    qpContext ctxN04 = qpContext(READY_RECV, 0x04, 0xec701e, 0x6a19d6, 0, 0x00);
+    qpContext ctxN14 = qpContext(READY_RECV, 0x04, 0x6a19d6, 0xec701e, 0, 0x00, DPI_ENFORCE, 2);
     
-    ifConnReq connInfoN0 = ifConnReq(1, 0, ipAddrN1, 5000);
-    ifConnReq connInfoN1 = ifConnReq(0, 1, ipAddrN0, 5000);
+    // n0 qp 1 <-> n1 qp 0, n0 qp 0 <-> n1 qp 1
+    ifConnReq connInfoN00 = ifConnReq(0, 1, ipAddrN1, 5000);
+    ifConnReq connInfoN01 = ifConnReq(1, 0, ipAddrN1, 5000);
+    ifConnReq connInfoN10 = ifConnReq(0, 1, ipAddrN0, 5000);
+    ifConnReq connInfoN11 = ifConnReq(1, 0, ipAddrN0, 5000);
+    ifConnReq connInfoN02 = ifConnReq(2, 2, ipAddrN1, 5000);
+    ifConnReq connInfoN03 = ifConnReq(3, 3, ipAddrN1, 5000);
+    ifConnReq connInfoN12 = ifConnReq(2, 2, ipAddrN0, 5000);
+    ifConnReq connInfoN13 = ifConnReq(3, 3, ipAddrN0, 5000);
+    ifConnReq connInfoN04 = ifConnReq(4, 4, ipAddrN1, 5000);
+    ifConnReq connInfoN14 = ifConnReq(4, 4, ipAddrN0, 5000);
 
     s_axis_qp_interface_n0.write(ctxN00);
     s_axis_qp_interface_n0.write(ctxN01);
     s_axis_qp_interface_n1.write(ctxN10);
     s_axis_qp_interface_n1.write(ctxN11);
+    s_axis_qp_interface_n0.write(ctxN02);
+    s_axis_qp_interface_n0.write(ctxN03);
+    s_axis_qp_interface_n1.write(ctxN12);
+    s_axis_qp_interface_n1.write(ctxN13);
+    s_axis_qp_interface_n0.write(ctxN04);
+    s_axis_qp_interface_n1.write(ctxN14);
 
-    s_axis_qp_conn_interface_n0.write(connInfoN0);
-    s_axis_qp_conn_interface_n1.write(connInfoN1);
+    s_axis_qp_conn_interface_n0.write(connInfoN00);
+    s_axis_qp_conn_interface_n0.write(connInfoN01);
+    s_axis_qp_conn_interface_n1.write(connInfoN10);
+    s_axis_qp_conn_interface_n1.write(connInfoN11);
+    s_axis_qp_conn_interface_n0.write(connInfoN02);
+    s_axis_qp_conn_interface_n0.write(connInfoN03);
+    s_axis_qp_conn_interface_n1.write(connInfoN12);
+    s_axis_qp_conn_interface_n1.write(connInfoN13);
+    s_axis_qp_conn_interface_n0.write(connInfoN04);
+    s_axis_qp_conn_interface_n1.write(connInfoN14);
 
     int count = 0;
     //Make sure it is initialized
-    while (count < 10)
+    while (count < 20)
     {
         IBTRUN(0);
         IBTRUN(1);
         count++;
     }
 
-    // issue cmd on n0 sq (RC_RDMA_WRITE_ONLY)
+#define SIMRUN(cycles)          \
+    for (int i = 0; i < (cycles); i++) \
+    {                           \
+        IBTRUN(0);              \
+        IBTRUN(1);              \
+        SWITCHRUN(dropEveryNPacket); \
+        DRAMRUN(0);             \
+        DRAMRUN(1);             \
+        count++;                \
+    }
+
+    // DPI, the write on n1 qp 0 and the send on n1 qp 1 are held for their intrusion decisions (not issued yet)
     ap_uint<512> params;
     params(63,0)    = 0x300;    // laddr
     params(127,64)  = 0x100;    // raddr
-    params(159,128) = 4 * 1024;  // length
+    params(159,128) = 1024;     // length
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x01, 0, 1, 0, params));
+    s_axis_sq_meta_n0.write(txMeta(RC_SEND_ONLY, 0x00, 0, 1, 0, params));
 
-    for (int i=0; i<1; i++) {
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_FIRST, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_MIDDLE, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_MIDDLE, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_LAST, 0x01, 0, 1, 0, params));
+    SIMRUN(20000);
 
-        s_axis_sq_meta_n0.write(txMeta(RC_SEND_ONLY, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_SEND_FIRST, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_SEND_MIDDLE, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_SEND_MIDDLE, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_SEND_LAST, 0x01, 0, 1, 0, params));
+    if (writeCmdLog[1].size() != 0)
+    {
+        std::cout << "[ERROR] packets committed without a decision, n1 write commands: " << writeCmdLog[1].size() << std::endl;
+        errCount++;
+    }
 
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x01, 0, 0, 0, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x01, 0, 0, 1, params));
-        // s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x01, 0, 1, 2, params));
+    // Accept, the held write is committed, the send waits for its own decision
+    intrusionDecisionIn_n1.write(verdict(true, 0x00));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].size() != 1 || writeCmdLog[1][0].addr != 0x100 || writeCmdLog[1][0].pid != 0x00)
+    {
+        std::cout << "[ERROR] accepted write not committed, n1 write commands: " << writeCmdLog[1].size() << std::endl;
+        errCount++;
     }
 
-    while (count < 200000)
+    intrusionDecisionIn_n1.write(verdict(true, 0x01));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].size() != 2 || writeCmdLog[1][1].addr != 0 || writeCmdLog[1][1].pid != 0x01)
     {
-        IBTRUN(0);
-        IBTRUN(1);
-        SWITCHRUN(0);
-        DRAMRUN(0);
-        DRAMRUN(1);
-        count++;
+        std::cout << "[ERROR] accepted send not committed, n1 write commands: " << writeCmdLog[1].size() << std::endl;
+        errCount++;
+    }
+
+    // Reject, NAKed and dropped, the accepted send on the other QP still gets through
+    params(127,64)  = 0x200;
+    intrusionDecisionIn_n1.write(verdict(false, 0x00));
+    intrusionDecisionIn_n1.write(verdict(true, 0x01));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x01, 0, 1, 0, params));
+    s_axis_sq_meta_n0.write(txMeta(RC_SEND_ONLY, 0x00, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    for (int i = 2; i < writeCmdLog[1].size(); i++)
+    {
+        if (writeCmdLog[1][i].addr == 0x200)
+        {
+            std::cout << "[ERROR] rejected write reached memory" << std::endl;
+            errCount++;
+        }
+    }
+    if (writeCmdLog[1].size() < 3 || writeCmdLog[1][2].addr != 0)
+    {
+        std::cout << "[ERROR] send blocked by the rejected write" << std::endl;
+        errCount++;
+    }
+
+    // Monitor, a rejected write is committed and counted
+    params(127,64)  = 0x400;
+    intrusionDecisionIn_n1.write(verdict(false, 0x02));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x02, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].back().addr != 0x400 || regDpiMonitorCount_n1 != 1 || regDpiRejectCount_n1 != 1)
+    {
+        std::cout << "[ERROR] monitored write, monitor count: " << regDpiMonitorCount_n1 << ", reject count: " << regDpiRejectCount_n1 << std::endl;
+        errCount++;
+    }
+
+    // Bypass, committed without an intrusion decision
+    params(127,64)  = 0x500;
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x03, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].back().addr != 0x500)
+    {
+        std::cout << "[ERROR] bypassed write not committed" << std::endl;
+        errCount++;
+    }
+
+    // Rejected send, NAKed and dropped
+    size_t nWrites = writeCmdLog[1].size();
+    intrusionDecisionIn_n1.write(verdict(false, 0x01));
+    s_axis_sq_meta_n0.write(txMeta(RC_SEND_ONLY, 0x00, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].size() != nWrites || regDpiRejectCount_n1 != 2)
+    {
+        std::cout << "[ERROR] rejected send reached memory, reject count: " << regDpiRejectCount_n1 << std::endl;
+        errCount++;
+    }
+
+    // Read responses on n0 qp 1, a rejected one is dropped, an accepted one is committed to laddr
+    params(63,0)    = 0x600;
+    params(127,64)  = 0x100;
+    intrusionDecisionIn_n0.write(verdict(false, 0x01));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x01, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[0].size() != 0 || regDpiRejectCount_n0 != 1)
+    {
+        std::cout << "[ERROR] rejected read response reached memory, reject count: " << regDpiRejectCount_n0 << std::endl;
+        errCount++;
+    }
+
+    params(63,0)    = 0x700;
+    intrusionDecisionIn_n0.write(verdict(true, 0x01));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x01, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[0].size() != 1 || writeCmdLog[0][0].addr != 0x700)
+    {
+        std::cout << "[ERROR] accepted read response not committed, n0 write commands: " << writeCmdLog[0].size() << std::endl;
+        errCount++;
+    }
+
+    // Sticky message verdict, the MIDDLE of a three packet write is rejected, the LAST is dropped despite its acceptance
+    nWrites = writeCmdLog[1].size();
+    params(63,0)    = 0x300;
+    params(127,64)  = 0x800;
+    params(159,128) = 3 * PMTU;
+    intrusionDecisionIn_n1.write(verdict(true, 0x00));
+    intrusionDecisionIn_n1.write(verdict(false, 0x00));
+    intrusionDecisionIn_n1.write(verdict(true, 0x00));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x01, 0, 1, 0, params));
+    SIMRUN(40000);
+
+    if (writeCmdLog[1].size() != nWrites + 1 || writeCmdLog[1].back().addr != 0x800 || regDpiRejectCount_n1 != 3)
+    {
+        std::cout << "[ERROR] failed message, n1 write commands: " << writeCmdLog[1].size() - nWrites << ", reject count: " << regDpiRejectCount_n1 << std::endl;
+        errCount++;
+    }
+
+    // Quarantine, the second rejected write on qp 4 reaches the threshold
+    params(127,64)  = 0x900;
+    params(159,128) = 1024;
+    for (int i = 0; i < 2; i++)
+    {
+        intrusionDecisionIn_n1.write(verdict(false, 0x04));
+        s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x04, 0, 1, 0, params));
+        SIMRUN(20000);
+    }
+
+    if (regDpiRejectCount_n1 != 5 || regDpiQuarantineCount_n1 != 1 || regDpiQuarantineQpn_n1 != 0x04)
+    {
+        std::cout << "[ERROR] qp not quarantined, quarantine count: " << regDpiQuarantineCount_n1 << ", qpn: " << regDpiQuarantineQpn_n1 << std::endl;
+        errCount++;
+    }
+
+    // Later packets of the quarantined QP are dropped without a decision, a stale decision of it is discarded
+    nWrites = writeCmdLog[1].size();
+    params(127,64)  = 0xa00;
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x04, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    params(127,64)  = 0xb00;
+    intrusionDecisionIn_n1.write(verdict(true, 0x04));
+    intrusionDecisionIn_n1.write(verdict(true, 0x00));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x01, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[1].size() != nWrites + 1 || writeCmdLog[1].back().addr != 0xb00 || regDpiRejectCount_n1 != 5)
+    {
+        std::cout << "[ERROR] quarantined qp, n1 write commands: " << writeCmdLog[1].size() - nWrites << ", reject count: " << regDpiRejectCount_n1 << std::endl;
+        errCount++;
+    }
+
+    // A READ request of the quarantined QP is dropped, it carries no data beat so the next write keeps its drop flag
+    size_t nReads = writeCmdLog[0].size();
+    nWrites = writeCmdLog[1].size();
+    params(63,0)    = 0xc00;
+    params(127,64)  = 0xc00;
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x04, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    params(127,64)  = 0xd00;
+    intrusionDecisionIn_n1.write(verdict(true, 0x00));
+    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x01, 0, 1, 0, params));
+    SIMRUN(20000);
+
+    if (writeCmdLog[0].size() != nReads || writeCmdLog[1].size() != nWrites + 1 || writeCmdLog[1].back().addr != 0xd00)
+    {
+        std::cout << "[ERROR] quarantined read, n0 write commands: " << writeCmdLog[0].size() - nReads << ", n1 write commands: " << writeCmdLog[1].size() - nWrites << std::endl;
+        errCount++;
+    }
+
+    // Many QPs, writes round robin over 64 QP pairs, more QPs than QP cache lines (ROCE_STACK_QP_CACHE_LINES) miss
+    const int nQps = 64;
+    const int nRounds = 4;
+    for (int q = 0; q < nQps; q++)
+    {
+        ap_uint<24> psnA = 0x100000 + q;
+        ap_uint<24> psnB = 0x200000 + q;
+        s_axis_qp_interface_n0.write(qpContext(READY_RECV, 0x10 + q, psnA, psnB, 0, 0x00));
+        s_axis_qp_interface_n1.write(qpContext(READY_RECV, 0x10 + q, psnB, psnA, 0, 0x00, DPI_BYPASS));
+        s_axis_qp_conn_interface_n0.write(ifConnReq(0x10 + q, 0x10 + q, ipAddrN1, 5000));
+        s_axis_qp_conn_interface_n1.write(ifConnReq(0x10 + q, 0x10 + q, ipAddrN0, 5000));
+    }
+    SIMRUN(20000);
+
+    nWrites = writeCmdLog[1].size();
+    uint64_t hits = regQpCacheHitCount_n1;
+    uint64_t misses = regQpCacheMissCount_n1;
+    params(63,0)    = 0x300;
+    params(159,128) = 64;
+    for (int r = 0; r < nRounds; r++)
+    {
+        for (int q = 0; q < nQps; q++)
+        {
+            params(127,64) = 0x10000 + q * 0x100 + r * 0x40;
+            s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x10 + q, 0, 1, 0, params));
+        }
+    }
+
+    int cycles = 0;
+    while (writeCmdLog[1].size() < nWrites + nQps * nRounds && cycles < 400000)
+    {
+        SIMRUN(1);
+        cycles++;
+    }
+    SIMRUN(20000);
+    hits = regQpCacheHitCount_n1 - hits;
+    misses = regQpCacheMissCount_n1 - misses;
+
+    std::cout << "[QP CACHE] lines: " << QP_CACHE_LINES << ", qps: " << nQps << ", writes: " << nQps * nRounds
+        << ", cycles: " << cycles << ", hits: " << hits << ", misses: " << misses
+        << ", hit rate: " << ((hits + misses) ? 100.0 * hits / (hits + misses) : 100.0) << "%"
+        << ", context reads: " << ctxReadCount[1] << ", write-backs: " << ctxWriteCount[1] << std::endl;
+
+    if (writeCmdLog[1].size() != nWrites + nQps * nRounds)
+    {
+        std::cout << "[ERROR] many qps, n1 write commands: " << writeCmdLog[1].size() - nWrites << std::endl;
+        errCount++;
+    }
+    if ((QP_CACHE_LINES != 0 && QP_CACHE_LINES < nQps) ? (misses == 0 || ctxReadCount[1] != regQpCacheMissCount_n1) : (misses != 0))
+    {
+        std::cout << "[ERROR] many qps, qp cache misses: " << misses << ", context reads: " << ctxReadCount[1] << std::endl;
+        errCount++;
+    }
+
+    // DCQCN, n1 egress drains at half the line rate, the sender has to back off on the CNPs to keep the queue short
+    const int nDcqcnWrites = 400;
+    s_axis_qp_interface_n0.write(qpContext(READY_RECV, 0x08, 0xfc701e, 0x7a19d6, 0, 0x00));
+    s_axis_qp_interface_n1.write(qpContext(READY_RECV, 0x08, 0x7a19d6, 0xfc701e, 0, 0x00, DPI_BYPASS));
+    s_axis_qp_conn_interface_n0.write(ifConnReq(0x08, 0x08, ipAddrN1, 5000));
+    s_axis_qp_conn_interface_n1.write(ifConnReq(0x08, 0x08, ipAddrN0, 5000));
+    SIMRUN(20000);
+
+    congestedPortN1.drainCycles = 2;
+    congestedPortN1.ecnKmin = 64;
+    congestedPortN1.ecnKmax = 512;
+    nWrites = writeCmdLog[1].size();
+    params(63,0)    = 0x300;
+    params(159,128) = PMTU;
+    for (int i = 0; i < nDcqcnWrites; i++)
+    {
+        params(127,64) = 0x100000 + i * PMTU;
+        s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x08, 0, 1, 0, params));
+    }
+
+    const uint32_t totalBeats = nDcqcnWrites * (PMTU / (DATA_WIDTH/8));
+    cycles = 0;
+    while (writeCmdLog[1].size() < nWrites + nDcqcnWrites && cycles < 8 * totalBeats)
+    {
+        SIMRUN(1);
+        cycles++;
+    }
+    SIMRUN(20000);
+
+    std::cout << "[DCQCN] writes: " << nDcqcnWrites << ", beats: " << totalBeats << ", cycles: " << cycles
+        << ", packets: " << congestedPortN1.pkts << ", marked: " << congestedPortN1.markedPkts
+        << ", CNPs: " << congestedPortN1.cnpPkts << ", max queue: " << congestedPortN1.maxQueueDepth << " beats" << std::endl;
+
+    if (writeCmdLog[1].size() != nWrites + nDcqcnWrites)
+    {
+        std::cout << "[ERROR] dcqcn, n1 write commands: " << writeCmdLog[1].size() - nWrites << std::endl;
+        errCount++;
+    }
+    if (congestedPortN1.markedPkts == 0 || congestedPortN1.cnpPkts == 0 || congestedPortN1.maxQueueDepth >= totalBeats / 4)
+    {
+        std::cout << "[ERROR] dcqcn, marked: " << congestedPortN1.markedPkts << ", CNPs: " << congestedPortN1.cnpPkts
+            << ", max queue: " << congestedPortN1.maxQueueDepth << " beats" << std::endl;
+        errCount++;
+    }
+
+    // DCQCN pacer at the min. rate, a WRITE of twice the credit of a capped gap (1 << 20 cycles) holds back the next
+    // request of its QP until the rate has paid for it, and no longer
+    {
+        static stream<txMeta> pacerIn;
+        static stream<dcqcnRateUpd> pacerUpd;
+        static stream<txMeta> pacerOut;
+        static stream<ap_uint<16> > pacerByteCnt;
+        const ap_uint<64> pacerCnfg = 0;
+        const dcqcnParams pacerParams(pacerCnfg);
+        const uint32_t bigLen = 2 * (1 << 20) * (DATA_WIDTH/8) / 256;
+        const uint64_t bigCycles = ((uint64_t)bigLen << DCQCN_CREDIT_FRAC_BITS) / (pacerParams.minRate * (DATA_WIDTH/8));
+        uint64_t outCycle[2] = {0, 0};
+        int nOut = 0;
+        txMeta pacedMeta;
+        ap_uint<16> byteCntQpn;
+
+        pacerUpd.write(dcqcnRateUpd(0x0c, pacerParams.minRate));
+        dcqcn_pacer<DATA_WIDTH, 2>(pacerIn, pacerUpd, pacerOut, pacerByteCnt, pacerCnfg);
+
+        params(159,128) = bigLen;
+        pacerIn.write(txMeta(RC_RDMA_WRITE_ONLY, 0x0c, 0, 1, 0, params));
+        params(159,128) = PMTU;
+        pacerIn.write(txMeta(RC_RDMA_WRITE_ONLY, 0x0c, 0, 1, 0, params));
+
+        for (uint64_t c = 0; nOut < 2 && c < 2 * bigCycles; c++)
+        {
+            dcqcn_pacer<DATA_WIDTH, 2>(pacerIn, pacerUpd, pacerOut, pacerByteCnt, pacerCnfg);
+            if (!pacerOut.empty())
+            {
+                pacerOut.read(pacedMeta);
+                outCycle[nOut++] = c;
+            }
+            if (!pacerByteCnt.empty())
+            {
+                pacerByteCnt.read(byteCntQpn);
+            }
+        }
+
+        std::cout << "[DCQCN PACER] min. rate " << pacerParams.minRate << ", length: " << bigLen << ", expected hold: " << bigCycles
+            << " cycles, held: " << outCycle[1] - outCycle[0] << " cycles" << std::endl;
+
+        if (nOut != 2 || outCycle[1] - outCycle[0] < bigCycles - 4 || outCycle[1] - outCycle[0] > bigCycles + 4)
+        {
+            std::cout << "[ERROR] dcqcn pacer, requests out: " << nOut << std::endl;
+            errCount++;
+        }
+    }
+
+    // Loss, the switch drops every n-th packet in both directions (0.1 - 1%), a NAK resends from the missing PSN on
+    const int nLossWrites = 2000;
+    const uint32_t lossLen = 256;
+    const uint16_t lossEveryN[] = {1000, 300, 100};
+    s_axis_qp_interface_n0.write(qpContext(READY_RECV, 0x09, 0x0c701e, 0x8a19d6, 0, 0x00));
+    s_axis_qp_interface_n1.write(qpContext(READY_RECV, 0x09, 0x8a19d6, 0x0c701e, 0, 0x00, DPI_BYPASS));
+    s_axis_qp_conn_interface_n0.write(ifConnReq(0x09, 0x09, ipAddrN1, 5000));
+    s_axis_qp_conn_interface_n1.write(ifConnReq(0x09, 0x09, ipAddrN0, 5000));
+    congestedPortN1.drainCycles = 0;
+    congestedPortN1.ecnKmax = 0;
+    SIMRUN(20000);
+
+    params(63,0)    = 0x300;
+    params(159,128) = lossLen;
+    for (uint16_t everyN : lossEveryN)
+    {
+        nWrites = writeCmdLog[1].size();
+        uint32_t retrans = regRetransCount_n0;
+        uint32_t dropped = congestedPortN1.droppedPkts;
+        for (int i = 0; i < nLossWrites; i++)
+        {
+            params(127,64) = 0x400000 + i * lossLen;
+            s_axis_sq_meta_n0.write(txMeta(RC_RDMA_WRITE_ONLY, 0x09, 0, 1, 0, params));
+        }
+
+        dropEveryNPacket = everyN;
+        cycles = 0;
+        while (writeCmdLog[1].size() < nWrites + nLossWrites && cycles < 400000)
+        {
+            SIMRUN(1);
+            cycles++;
+        }
+        dropEveryNPacket = 0;
+        SIMRUN(20000);
+        retrans = regRetransCount_n0 - retrans;
+        dropped = congestedPortN1.droppedPkts - dropped;
+
+        std::cout << "[LOSS] 1/" << std::dec << everyN << ", writes: " << nLossWrites << ", cycles: " << cycles
+            << ", dropped: " << dropped << ", resent: " << retrans
+            << ", goodput: " << 100.0 * nLossWrites * lossLen / (cycles * (DATA_WIDTH/8)) << "% of line rate" << std::endl;
+
+        if (writeCmdLog[1].size() != nWrites + nLossWrites || (dropped != 0 && retrans == 0))
+        {
+            std::cout << "[ERROR] loss 1/" << everyN << ", n1 write commands: " << writeCmdLog[1].size() - nWrites
+                << ", resent: " << retrans << std::endl;
+            errCount++;
+        }
+    }
+
+    // READ window, the testbench keeps up to window READs outstanding (as rdma_flow does) over a link with a one-way delay,
+    // the READ throughput is bound by window * length / RTT until it reaches the line rate
+    const int nWndReads = 1024;
+    const uint32_t wndLen = 256;
+    const uint32_t wndLatency[] = {50, 250, 1000};
+    const int wndSize[] = {16, 64, 256};
+    s_axis_qp_interface_n0.write(qpContext(READY_RECV, 0x0a, 0x1c701e, 0x9a19d6, 0, 0x00, DPI_BYPASS));
+    s_axis_qp_interface_n1.write(qpContext(READY_RECV, 0x0a, 0x9a19d6, 0x1c701e, 0, 0x00, DPI_BYPASS));
+    s_axis_qp_conn_interface_n0.write(ifConnReq(0x0a, 0x0a, ipAddrN1, 5000));
+    s_axis_qp_conn_interface_n1.write(ifConnReq(0x0a, 0x0a, ipAddrN0, 5000));
+    SIMRUN(20000);
+
+    params(127,64)  = 0x100;
+    params(159,128) = wndLen;
+    for (uint32_t latency : wndLatency)
+    {
+        double prevGoodput = 0;
+        congestedPortN1.latencyCycles = latency;
+        for (int window : wndSize)
+        {
+            nWrites = writeCmdLog[0].size();
+            int cmplBase = readCmplCount[0];
+            int issued = 0;
+            cycles = 0;
+            while (readCmplCount[0] - cmplBase < nWndReads && cycles < 1000000)
+            {
+                while (issued < nWndReads && issued - (readCmplCount[0] - cmplBase) < window)
+                {
+                    params(63,0) = 0x800000 + issued * wndLen;
+                    s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, 0x0a, 0, 1, 0, params));
+                    issued++;
+                }
+                SIMRUN(1);
+                cycles++;
+            }
+            SIMRUN(20000);
+            double goodput = 100.0 * nWndReads * wndLen / (cycles * (DATA_WIDTH/8));
+
+            std::cout << "[READ WINDOW] one-way delay: " << std::dec << latency << ", window: " << window
+                << ", reads: " << nWndReads << ", cycles: " << cycles
+                << ", goodput: " << goodput << "% of line rate" << std::endl;
+
+            if (readCmplCount[0] - cmplBase != nWndReads || writeCmdLog[0].size() != nWrites + nWndReads)
+            {
+                std::cout << "[ERROR] read window " << window << ", completions: " << readCmplCount[0] - cmplBase
+                    << ", n0 write commands: " << writeCmdLog[0].size() - nWrites << std::endl;
+                errCount++;
+            }
+            // A larger window must not be slower, it has to pay off once the RTT dominates
+            if (goodput < 0.9 * prevGoodput)
+            {
+                std::cout << "[ERROR] read window " << window << " slower than the smaller one" << std::endl;
+                errCount++;
+            }
+            prevGoodput = goodput;
+        }
+    }
+    congestedPortN1.latencyCycles = 0;
+
+    // Path MTU, qp 0x0b negotiates 1024 bytes on both ends while qp 0x0a uses the stack PMTU, a READ response takes
+    // one packet and PSN per path MTU, WRITEs come segmented by the QP path MTU (as rdma_pmtu_seg does)
+    const int nMtuMsgs = 16;
+    const uint32_t mtuLen = 16 * 1024;
+    const uint32_t mtuNeg = (PMTU < 1024) ? PMTU : 1024;
+    qpContext ctxMtuN0 = qpContext(READY_RECV, 0x0b, 0x2c701e, 0xaa19d6, 0, 0x00, DPI_BYPASS);
+    qpContext ctxMtuN1 = qpContext(READY_RECV, 0x0b, 0xaa19d6, 0x2c701e, 0, 0x00, DPI_BYPASS);
+    ctxMtuN0.pmtu = 3;
+    ctxMtuN1.pmtu = 3;
+    s_axis_qp_interface_n0.write(ctxMtuN0);
+    s_axis_qp_interface_n1.write(ctxMtuN1);
+    s_axis_qp_conn_interface_n0.write(ifConnReq(0x0b, 0x0b, ipAddrN1, 5000));
+    s_axis_qp_conn_interface_n1.write(ifConnReq(0x0b, 0x0b, ipAddrN0, 5000));
+    SIMRUN(20000);
+
+    const ap_uint<24> mtuQpn[] = {0x0a, 0x0b};
+    const uint32_t mtuBytes[] = {PMTU, mtuNeg};
+    for (int q = 0; q < 2; q++)
+    {
+        // READs, n1 answers in packets of the path MTU, n0 lands each of them at its own offset
+        nWrites = writeCmdLog[0].size();
+        int cmplBase = readCmplCount[0];
+        params(127,64)  = 0x100;
+        params(159,128) = mtuLen;
+        for (int i = 0; i < nMtuMsgs; i++)
+        {
+            params(63,0) = 0x1000000 + i * mtuLen;
+            s_axis_sq_meta_n0.write(txMeta(RC_RDMA_READ_REQUEST, mtuQpn[q], 0, 1, 0, params));
+        }
+        cycles = 0;
+        while (readCmplCount[0] - cmplBase < nMtuMsgs && cycles < 200000)
+        {
+            SIMRUN(1);
+            cycles++;
+        }
+        SIMRUN(20000);
+
+        std::set<uint64_t> rspAddr;
+        bool rspSize = true;
+        for (size_t i = nWrites; i < writeCmdLog[0].size(); i++)
+        {
+            rspAddr.insert(writeCmdLog[0][i].addr);
+            rspSize &= (writeCmdLog[0][i].len == mtuBytes[q]);
+        }
+
+        // WRITEs, FIRST, MIDDLE.., LAST of the path MTU each
+        nWrites = writeCmdLog[1].size();
+        params(63,0) = 0x300;
+        for (int i = 0; i < nMtuMsgs; i++)
+        {
+            for (uint32_t offs = 0; offs < mtuLen; offs += mtuBytes[q])
+            {
+                ibOpCode op = (offs == 0) ? RC_RDMA_WRITE_FIRST : (offs + mtuBytes[q] >= mtuLen) ? RC_RDMA_WRITE_LAST : RC_RDMA_WRITE_MIDDLE;
+                params(127,64)  = 0x2000000 + i * mtuLen + offs;
+                params(159,128) = mtuBytes[q];
+                s_axis_sq_meta_n0.write(txMeta(op, mtuQpn[q], 0, 1, 0, params));
+            }
+        }
+        SIMRUN(100000);
+
+        bool wrSize = true;
+        for (size_t i = nWrites; i < writeCmdLog[1].size(); i++)
+        {
+            wrSize &= (writeCmdLog[1][i].len == mtuBytes[q]);
+        }
+
+        std::cout << "[PMTU] qpn: " << std::hex << mtuQpn[q] << std::dec << ", path MTU: " << mtuBytes[q]
+            << ", READ response packets: " << rspAddr.size() << ", WRITE packets: " << writeCmdLog[1].size() - nWrites
+            << ", READ cycles: " << cycles << std::endl;
+
+        if (readCmplCount[0] - cmplBase != nMtuMsgs || rspAddr.size() != nMtuMsgs * (mtuLen / mtuBytes[q]) || !rspSize)
+        {
+            std::cout << "[ERROR] pmtu " << mtuBytes[q] << ", read completions: " << readCmplCount[0] - cmplBase
+                << ", response packets: " << rspAddr.size() << std::endl;
+            errCount++;
+        }
+        if (writeCmdLog[1].size() - nWrites != nMtuMsgs * (mtuLen / mtuBytes[q]) || !wrSize)
+        {
+            std::cout << "[ERROR] pmtu " << mtuBytes[q] << ", n1 write commands: " << writeCmdLog[1].size() - nWrites << std::endl;
+            errCount++;
+        }
+    }
+
+    if (errCount == 0)
+    {
+        std::cout << "[PASSED]" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAILED] " << errCount << " errors" << std::endl;
     }
 
-    return 0;
+    return errCount;
 }
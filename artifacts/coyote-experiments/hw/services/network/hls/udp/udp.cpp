@@ -190,7 +190,7 @@ void merge_rx_meta(	stream<ipMeta>&		ipMetaIn,
 		udpMetaIn.read(meta1);
 		if (meta1.valid)
 		{
-			metaOut.write(ipUdpMeta(meta0.their_address, meta1.their_port, meta1.my_port, meta1.length));
+			metaOut.write(ipUdpMeta(meta0.their_address, meta1.their_port, meta1.my_port, meta1.length, meta0.ecn));
 		}
 	}
 }
@@ -0,0 +1,196 @@
+`timescale 1ns / 1ps
+
+// Payload extraction and classification of all opcodes carrying payload (WRITE, SEND, READ RESPONSE).
+// The same sample payload is sent through every opcode, the extracted payload has to match byte by byte
+// and the decision has to be the one of the RDMA WRITE. Packets of a quarantined QP are not extracted.
+module dpi_opcodes_tb();
+
+localparam integer N_OPS = 10;
+localparam integer N_LENS = 2;
+
+// Clock and Reset
+logic clk;
+logic rst;
+
+// Inputs to the payload extractor
+logic [511:0] input_tdata;
+logic [63:0] input_tkeep;
+logic input_tvalid;
+logic input_tlast;
+
+logic [31:0] meta_output;
+logic quarantine_valid;
+logic [9:0] quarantine_qpn;
+metaIntf #(.STYPE(logic [24:0])) ml_decision ();
+AXI4S #(.AXI4S_DATA_BITS(512)) payload_output();
+
+int n_err = 0;
+
+// Collected output
+logic [7:0] out_bytes[$];
+logic [24:0] decisions[$];
+
+payload_extractor dut_sim_1(
+    .nclk(clk),
+    .nresetn(rst),
+    .m_axis_rx_data_i(input_tdata),
+    .m_axis_rx_keep_i(input_tkeep),
+    .m_axis_rx_valid_i(input_tvalid),
+    .m_axis_rx_last_i(input_tlast),
+    .m_axis_payload_tx(payload_output),
+    .meta_tx_o(meta_output),
+    .policy_valid_i(1'b0),
+    .policy_qpn_i(10'b0),
+    .policy_mode_i(2'b0),
+    .quarantine_valid_i(quarantine_valid),
+    .quarantine_qpn_i(quarantine_qpn)
+);
+
+intrusion_detection_decider dut_sim_2(
+    .nclk(clk),
+    .nresetn(rst),
+    .s_axis_payload_rx(payload_output),
+    .meta_rx_i(meta_output),
+    .m_rdma_intrusion_decision(ml_decision)
+);
+
+initial begin
+    clk = 1'b0;
+    forever #1 clk = !clk;
+end
+
+// Extracted payload, the extractor reverses the byte order of the data for the model (not the keep)
+always @(posedge clk) begin
+    if(payload_output.tvalid) begin
+        for(int i = 0; i < 64; i++) begin
+            if(payload_output.tkeep[i]) out_bytes.push_back(payload_output.tdata[8*(63-i)+:8]);
+        end
+    end
+    if(ml_decision.valid) decisions.push_back(ml_decision.data);
+end
+
+// Sample payload, second beat of the write in intrusion_detection_tb
+localparam logic [511:0] sample = 512'h52f724d8d0046341b5c9baebaf7b2b65d20c9ec2176e293bd17e19e26b7cd6718754f1547c213ed5251e893fc54ff1a6758eef9aeba639bcd7103e86afc34f20;
+
+function automatic logic [7:0] payload_byte(input int i);
+    return sample[8*(i%64)+:8];
+endfunction
+
+function automatic int hdr_bytes(input logic [7:0] opcode);
+    case(opcode)
+        8'h06, 8'h0a: return 56; // RETH
+        8'h0d, 8'h0f, 8'h10: return 44; // AETH
+        default: return 40; // BTH only
+    endcase
+endfunction
+
+// [IPv4][UDP][BTH][ExH][payload][ICRC] in 64 byte beats
+task automatic send_pkt(input logic [7:0] opcode, input logic [23:0] qpn, input int len);
+    logic [7:0] pkt[$];
+    int hdr = hdr_bytes(opcode);
+    int n;
+
+    for(int i = 0; i < hdr; i++) pkt.push_back(8'h00);
+    pkt[0] = 8'h45;
+    pkt[1] = 8'h02;
+    pkt[9] = 8'h11;
+    pkt[28] = opcode;
+    {pkt[35], pkt[34], pkt[33]} = qpn;
+    for(int i = 0; i < len; i++) pkt.push_back(payload_byte(i));
+    for(int i = 0; i < 4; i++) pkt.push_back(8'hcc);
+
+    for(int b = 0; b < pkt.size(); b += 64) begin
+        n = (pkt.size() - b < 64) ? pkt.size() - b : 64;
+        input_tdata <= 0;
+        for(int i = 0; i < n; i++) input_tdata[8*i+:8] <= pkt[b+i];
+        input_tkeep <= (n == 64) ? ~64'h0 : ((64'h1 << n) - 1);
+        input_tvalid <= 1'b1;
+        input_tlast <= (b + 64 >= pkt.size());
+        @(posedge clk);
+    end
+    input_tvalid <= 1'b0;
+    input_tlast <= 1'b0;
+    input_tdata <= 0;
+    input_tkeep <= 0;
+
+    // Model and side channel pipeline
+    repeat(64) @(posedge clk);
+endtask
+
+logic [7:0] ops[N_OPS] = '{8'h0a, 8'h06, 8'h07, 8'h04, 8'h00, 8'h01, 8'h10, 8'h0d, 8'h0e, 8'h0f};
+int lens[N_LENS] = '{160, 200}; // last payload fits the open register / spills over
+logic ref_decision[N_LENS];
+
+initial begin
+    input_tvalid <= 1'b0;
+    input_tlast <= 1'b0;
+    input_tdata <= 512'b0;
+    input_tkeep <= 64'h0;
+    quarantine_valid <= 1'b0;
+    quarantine_qpn <= 0;
+    rst <= 1'b0;
+
+    #20
+    rst <= 1'b1;
+
+    #20
+
+    for(int l = 0; l < N_LENS; l++) begin
+        for(int o = 0; o < N_OPS; o++) begin
+            out_bytes.delete();
+            decisions.delete();
+            send_pkt(ops[o], o + 1, lens[l]);
+
+            if(out_bytes.size() != lens[l]) begin
+                $display("ERR: opcode %h, length %0d, extracted %0d bytes", ops[o], lens[l], out_bytes.size());
+                n_err++;
+            end else begin
+                for(int i = 0; i < lens[l]; i++) begin
+                    if(out_bytes[i] !== payload_byte(i)) begin
+                        $display("ERR: opcode %h, length %0d, byte %0d is %h, expected %h", ops[o], lens[l], i, out_bytes[i], payload_byte(i));
+                        n_err++;
+                        break;
+                    end
+                end
+            end
+
+            if(decisions.size() != 1 || decisions[0][24:1] !== o + 1) begin
+                $display("ERR: opcode %h, length %0d, %0d decisions", ops[o], lens[l], decisions.size());
+                n_err++;
+            end else if(o == 0) begin
+                ref_decision[l] = decisions[0][0];
+            end else if(decisions[0][0] !== ref_decision[l]) begin
+                $display("ERR: opcode %h, length %0d, decision %0d differs from the write", ops[o], lens[l], decisions[0][0]);
+                n_err++;
+            end
+        end
+    end
+
+    // Quarantine qp 1, skipped, qp 2 still inspected
+    quarantine_valid <= 1'b1;
+    quarantine_qpn <= 1;
+    @(posedge clk);
+    quarantine_valid <= 1'b0;
+
+    for(int q = 1; q <= 2; q++) begin
+        out_bytes.delete();
+        decisions.delete();
+        send_pkt(ops[0], q, lens[0]);
+
+        if(q == 1 && (out_bytes.size() != 0 || decisions.size() != 0)) begin
+            $display("ERR: quarantined qp, extracted %0d bytes, %0d decisions", out_bytes.size(), decisions.size());
+            n_err++;
+        end else if(q == 2 && (out_bytes.size() != lens[0] || decisions.size() != 1)) begin
+            $display("ERR: qp next to a quarantined one, extracted %0d bytes, %0d decisions", out_bytes.size(), decisions.size());
+            n_err++;
+        end
+    end
+
+    if(n_err == 0)
+        $display("dpi_opcodes_tb passed");
+    else
+        $display("dpi_opcodes_tb failed, %0d errors", n_err);
+    $finish;
+end
+
+endmodule
@@ -30,7 +30,12 @@ payload_extractor dut_sim_1(
     .m_axis_rx_valid_i(input_tvalid), 
     .m_axis_rx_last_i(input_tlast), 
     .m_axis_payload_tx(payload_output), 
-    .meta_tx_o(meta_output)
+    .meta_tx_o(meta_output), 
+    .policy_valid_i(1'b0), 
+    .policy_qpn_i(10'b0), 
+    .policy_mode_i(2'b0), 
+    .quarantine_valid_i(1'b0), 
+    .quarantine_qpn_i(10'b0)
 ); 
 
 // Initialize the intrusion_detection_decider as dut_2 and connect it accordingly
@@ -0,0 +1,222 @@
+`timescale 1ns / 1ps
+
+import lynxTypes::*;
+
+// Path MTU segmentation, WRITE and SEND requests longer than the path MTU of their QP are split with the opcodes
+// remapped (ONLY - FIRST, MIDDLE.., LAST), READs and short requests pass. A WRITE advances both vaddrs, a SEND only
+// the local one. All requests are sent back to back, once with a free output (no idle cycle between the packets)
+// and once back pressured every other cycle.
+module rdma_pmtu_seg_tb();
+
+localparam integer MTU = (1024 > PMTU_BYTES) ? PMTU_BYTES : 1024; // QP 1, pmtu 3
+localparam integer N_PKTS = 16;
+
+typedef struct {
+    logic [RDMA_OPCODE_BITS-1:0] opcode;
+    logic [RDMA_QPN_BITS-1:0] qpn;
+    logic last;
+    logic [RDMA_VADDR_BITS-1:0] lvaddr;
+    logic [RDMA_VADDR_BITS-1:0] rvaddr;
+    logic [RDMA_LEN_BITS-1:0] len;
+} pkt_t;
+
+// Clock and Reset
+logic clk;
+logic rst;
+
+metaIntf #(.STYPE(rdma_req_t)) s_req ();
+metaIntf #(.STYPE(rdma_req_t)) m_req ();
+logic pmtu_valid;
+logic [RDMA_QPN_BITS-1:0] pmtu_qpn;
+logic [RDMA_PMTU_BITS-1:0] pmtu_enc;
+
+int n_err = 0;
+int cyc = 0;
+logic bp;
+logic toggle;
+
+// Expected packets, cycles of the first and the last packet out
+pkt_t exp_q[$];
+int first_out;
+int last_out;
+int n_out;
+
+rdma_pmtu_seg dut_sim_1 (
+    .aclk(clk),
+    .aresetn(rst),
+    .s_req(s_req),
+    .m_req(m_req),
+    .pmtu_valid(pmtu_valid),
+    .pmtu_qpn(pmtu_qpn),
+    .pmtu_enc(pmtu_enc)
+);
+
+initial begin
+    clk = 1'b0;
+    forever #1 clk = !clk;
+end
+
+always @(posedge clk) begin
+    cyc <= cyc + 1;
+    toggle <= ~toggle;
+end
+
+assign m_req.ready = !bp || toggle;
+
+function automatic rdma_req_t req(input logic [RDMA_OPCODE_BITS-1:0] opcode, input logic [RDMA_QPN_BITS-1:0] qpn,
+    input logic last, input logic [RDMA_VADDR_BITS-1:0] lvaddr, input logic [RDMA_VADDR_BITS-1:0] rvaddr, input logic [RDMA_LEN_BITS-1:0] len);
+    rdma_req_t r = 0;
+    r.opcode = opcode;
+    r.qpn = qpn;
+    r.last = last;
+    r.msg[RDMA_LVADDR_OFFS+:RDMA_VADDR_BITS] = lvaddr;
+    r.msg[RDMA_RVADDR_OFFS+:RDMA_VADDR_BITS] = rvaddr;
+    r.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS] = len;
+    return r;
+endfunction
+
+function automatic pkt_t pkt(input logic [RDMA_OPCODE_BITS-1:0] opcode, input logic [RDMA_QPN_BITS-1:0] qpn,
+    input logic last, input logic [RDMA_VADDR_BITS-1:0] lvaddr, input logic [RDMA_VADDR_BITS-1:0] rvaddr, input logic [RDMA_LEN_BITS-1:0] len);
+    pkt_t p;
+    p.opcode = opcode;
+    p.qpn = qpn;
+    p.last = last;
+    p.lvaddr = lvaddr;
+    p.rvaddr = rvaddr;
+    p.len = len;
+    return p;
+endfunction
+
+task send(input rdma_req_t r);
+    s_req.valid <= 1'b1;
+    s_req.data <= r;
+    @(posedge clk);
+    while(!s_req.ready) @(posedge clk);
+    s_req.valid <= 1'b0;
+endtask
+
+task set_pmtu(input logic [RDMA_QPN_BITS-1:0] qpn, input logic [RDMA_PMTU_BITS-1:0] enc);
+    pmtu_valid <= 1'b1;
+    pmtu_qpn <= qpn;
+    pmtu_enc <= enc;
+    @(posedge clk);
+    pmtu_valid <= 1'b0;
+endtask
+
+// Monitor
+always @(posedge clk) begin
+    if(rst && m_req.valid && m_req.ready) begin
+        pkt_t e;
+        if(n_out == 0) first_out = cyc;
+        last_out = cyc;
+        n_out++;
+
+        if(exp_q.size() == 0) begin
+            $display("ERR: unexpected packet, opcode %0h", m_req.data.opcode);
+            n_err++;
+        end
+        else begin
+            e = exp_q.pop_front();
+            if(m_req.data.opcode !== e.opcode || m_req.data.qpn !== e.qpn || m_req.data.last !== e.last ||
+               m_req.data.msg[RDMA_LVADDR_OFFS+:RDMA_VADDR_BITS] !== e.lvaddr ||
+               m_req.data.msg[RDMA_RVADDR_OFFS+:RDMA_VADDR_BITS] !== e.rvaddr ||
+               m_req.data.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS] !== e.len) begin
+                $display("ERR: packet %0d, opcode %0h qpn %0d last %0d lvaddr %0h rvaddr %0h len %0d, expected opcode %0h qpn %0d last %0d lvaddr %0h rvaddr %0h len %0d",
+                    n_out - 1, m_req.data.opcode, m_req.data.qpn, m_req.data.last, m_req.data.msg[RDMA_LVADDR_OFFS+:RDMA_VADDR_BITS],
+                    m_req.data.msg[RDMA_RVADDR_OFFS+:RDMA_VADDR_BITS], m_req.data.msg[RDMA_LEN_OFFS+:RDMA_LEN_BITS],
+                    e.opcode, e.qpn, e.last, e.lvaddr, e.rvaddr, e.len);
+                n_err++;
+            end
+        end
+    end
+end
+
+// All requests back to back
+task burst();
+    n_out = 0;
+
+    // WRITE ONLY split in three, FIRST, MIDDLE, LAST
+    exp_q.push_back(pkt(RC_RDMA_WRITE_FIRST, 1, 1'b0, 'h1000, 'h8000, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h1000 + MTU, 'h8000 + MTU, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_LAST, 1, 1'b1, 'h1000 + 2*MTU, 'h8000 + 2*MTU, 100));
+
+    // Packets of the request parser, a FIRST stays FIRST then MIDDLE, a MIDDLE only MIDDLEs, a LAST ends in LAST
+    exp_q.push_back(pkt(RC_RDMA_WRITE_FIRST, 1, 1'b0, 'h2000, 'h9000, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h2000 + MTU, 'h9000 + MTU, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h3000, 'ha000, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h3000 + MTU, 'ha000 + MTU, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h4000, 'hb000, MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_LAST, 1, 1'b1, 'h4000 + MTU, 'hb000 + MTU, 8));
+
+    // SEND ONLY, the remote vaddr stays
+    exp_q.push_back(pkt(RC_SEND_FIRST, 1, 1'b0, 'h5000, 'hc000, MTU));
+    exp_q.push_back(pkt(RC_SEND_MIDDLE, 1, 1'b0, 'h5000 + MTU, 'hc000, MTU));
+    exp_q.push_back(pkt(RC_SEND_LAST, 1, 1'b1, 'h5000 + 2*MTU, 'hc000, 4));
+
+    // READ and a WRITE of exactly the path MTU pass
+    exp_q.push_back(pkt(RC_RDMA_READ_REQUEST, 1, 1'b1, 'h6000, 'hd000, 4*MTU));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_ONLY, 1, 1'b1, 'h7000, 'he000, MTU));
+
+    // QP 2 without a path MTU takes PMTU_BYTES
+    exp_q.push_back(pkt(RC_RDMA_WRITE_FIRST, 2, 1'b0, 'h10000, 'h20000, PMTU_BYTES));
+    exp_q.push_back(pkt(RC_RDMA_WRITE_LAST, 2, 1'b1, 'h10000 + PMTU_BYTES, 'h20000 + PMTU_BYTES, PMTU_BYTES));
+
+    send(req(RC_RDMA_WRITE_ONLY, 1, 1'b1, 'h1000, 'h8000, 2*MTU + 100));
+    send(req(RC_RDMA_WRITE_FIRST, 1, 1'b0, 'h2000, 'h9000, 2*MTU));
+    send(req(RC_RDMA_WRITE_MIDDLE, 1, 1'b0, 'h3000, 'ha000, 2*MTU));
+    send(req(RC_RDMA_WRITE_LAST, 1, 1'b1, 'h4000, 'hb000, MTU + 8));
+    send(req(RC_SEND_ONLY, 1, 1'b1, 'h5000, 'hc000, 2*MTU + 4));
+    send(req(RC_RDMA_READ_REQUEST, 1, 1'b1, 'h6000, 'hd000, 4*MTU));
+    send(req(RC_RDMA_WRITE_ONLY, 1, 1'b1, 'h7000, 'he000, MTU));
+    send(req(RC_RDMA_WRITE_ONLY, 2, 1'b1, 'h10000, 'h20000, 2*PMTU_BYTES));
+
+    for(int i = 0; i < 200 && exp_q.size() != 0; i++) @(posedge clk);
+    repeat(4) @(posedge clk);
+
+    if(exp_q.size() != 0 || n_out != N_PKTS) begin
+        $display("ERR: %0d packets out, %0d missing", n_out, exp_q.size());
+        n_err++;
+        exp_q.delete();
+    end
+endtask
+
+initial begin
+    // Initial reset (low active reset)
+    s_req.valid <= 1'b0;
+    s_req.data <= 0;
+    pmtu_valid <= 1'b0;
+    pmtu_qpn <= 0;
+    pmtu_enc <= 0;
+    bp <= 1'b0;
+    toggle <= 1'b0;
+    rst <= 1'b0;
+
+    #20
+
+    rst <= 1'b1;
+
+    #20
+
+    // Path MTUs with the QP contexts
+    set_pmtu(1, 3);
+    set_pmtu(2, 0);
+
+    // Free output, the next request is taken with the last packet of the previous one
+    burst();
+    if(last_out - first_out != N_PKTS - 1) begin
+        $display("ERR: %0d packets took %0d cycles", N_PKTS, last_out - first_out + 1);
+        n_err++;
+    end
+
+    // Back pressured output
+    bp <= 1'b1;
+    burst();
+
+    if(n_err == 0)
+        $display("rdma_pmtu_seg_tb passed");
+    else
+        $display("rdma_pmtu_seg_tb failed, %0d errors", n_err);
+    $finish;
+end
+
+endmodule
@@ -0,0 +1,145 @@
+`timescale 1ns / 1ps
+
+import lynxTypes::*;
+
+module tlb_controller_tb();
+
+localparam integer TLB_ORDER = 4;
+localparam integer PG_BITS = 12;
+localparam integer N_ASSOC = 4;
+localparam integer TAG_BITS = VADDR_BITS - TLB_ORDER - PG_BITS;
+localparam integer VPN_BITS = TLB_ORDER + TAG_BITS;
+
+localparam logic [1:0] CMD_INV_SINGLE = 2'b00;
+localparam logic [1:0] CMD_INV_RANGE = 2'b01;
+localparam logic [1:0] CMD_INV_CPID = 2'b10;
+
+// Clock and Reset
+logic clk;
+logic rst;
+
+// Mappings in, lookups
+AXI4S #(.AXI4S_DATA_BITS(AXI_TLB_BITS)) tlb_input();
+tlbIntf TLB ();
+logic done_map;
+logic [31:0] inv_cnt;
+
+int n_err = 0;
+
+tlb_controller #(
+    .TLB_ORDER(TLB_ORDER),
+    .PG_BITS(PG_BITS),
+    .N_ASSOC(N_ASSOC)
+) dut_sim_1 (
+    .aclk(clk),
+    .aresetn(rst),
+    .s_axis(tlb_input),
+    .TLB(TLB),
+    .done_map(done_map),
+    .inv_cnt(inv_cnt)
+);
+
+initial begin
+    clk = 1'b0;
+    forever #1 clk = !clk;
+end
+
+// Entry {cmd | len/paddr, valid | pid | vpn}
+function automatic logic [AXI_TLB_BITS-1:0] entry(input logic [VPN_BITS-1:0] vpn, input logic [PID_BITS-1:0] pid,
+    input logic valid, input logic [1:0] cmd, input logic [31:0] len);
+    logic [AXI_TLB_BITS-1:0] e = 0;
+    e[0+:VPN_BITS] = vpn;
+    e[VPN_BITS+:PID_BITS] = pid;
+    e[VPN_BITS+PID_BITS] = valid;
+    e[64+:32] = valid ? vpn + 32'h100 : len;
+    e[126+:2] = cmd;
+    return e;
+endfunction
+
+task send(input logic [AXI_TLB_BITS-1:0] e);
+    tlb_input.tvalid <= 1'b1;
+    tlb_input.tlast <= 1'b1;
+    tlb_input.tdata <= e;
+    @(posedge clk);
+    while(!tlb_input.tready) @(posedge clk);
+    tlb_input.tvalid <= 1'b0;
+    tlb_input.tlast <= 1'b0;
+    @(posedge done_map);
+    @(posedge clk);
+endtask
+
+task check(input logic [VPN_BITS-1:0] vpn, input logic [PID_BITS-1:0] pid, input logic exp);
+    TLB.valid <= 1'b1;
+    TLB.wr <= 1'b0;
+    TLB.pid <= pid;
+    TLB.addr <= vpn << PG_BITS;
+    repeat(4) @(posedge clk);
+    if(TLB.hit !== exp) begin
+        $display("ERR: vpn %0d, pid %0d, hit %0d, expected %0d", vpn, pid, TLB.hit, exp);
+        n_err++;
+    end
+    TLB.valid <= 1'b0;
+endtask
+
+initial begin
+    // Initial reset (low active reset)
+    tlb_input.tvalid <= 1'b0;
+    tlb_input.tlast <= 1'b0;
+    tlb_input.tdata <= 0;
+    tlb_input.tkeep <= ~0;
+    TLB.valid <= 1'b0;
+    TLB.wr <= 1'b0;
+    TLB.pid <= 0;
+    TLB.addr <= 0;
+    rst <= 1'b0;
+
+    #20
+
+    rst <= 1'b1;
+
+    #20
+
+    // Map, pid 1 pages 0-39, pid 2 pages 0-7 (all 4 ways of the first 8 sets)
+    for(int i = 0; i < 40; i++) send(entry(i, 1, 1'b1, CMD_INV_SINGLE, 0));
+    for(int i = 0; i < 8; i++) send(entry(i, 2, 1'b1, CMD_INV_SINGLE, 0));
+    for(int i = 0; i < 40; i++) check(i, 1, 1'b1);
+    for(int i = 0; i < 8; i++) check(i, 2, 1'b1);
+
+    // Range, pid 1 pages 10-29 (wraps the sets)
+    send(entry(10, 1, 1'b0, CMD_INV_RANGE, 20));
+    for(int i = 0; i < 40; i++) check(i, 1, (i < 10 || i >= 30));
+    for(int i = 0; i < 8; i++) check(i, 2, 1'b1);
+
+    // Empty range
+    send(entry(0, 1, 1'b0, CMD_INV_RANGE, 0));
+    check(0, 1, 1'b1);
+
+    // Cpid, pid 2
+    send(entry(0, 2, 1'b0, CMD_INV_CPID, 0));
+    for(int i = 0; i < 8; i++) check(i, 2, 1'b0);
+    for(int i = 30; i < 40; i++) check(i, 1, 1'b1);
+
+    // Single
+    send(entry(35, 1, 1'b0, CMD_INV_SINGLE, 0));
+    check(35, 1, 1'b0);
+    check(34, 1, 1'b1);
+    check(36, 1, 1'b1);
+
+    // Range larger than the TLB
+    send(entry(0, 1, 1'b0, CMD_INV_RANGE, 1000));
+    for(int i = 0; i < 40; i++) check(i, 1, 1'b0);
+
+    // Completed commands, range, empty range, cpid, range (single removals are not counted)
+    if(inv_cnt !== 4) begin
+        $display("ERR: inv_cnt %0d, expected 4", inv_cnt);
+        n_err++;
+    end
+
+    if(n_err == 0)
+        $display("tlb_controller_tb passed");
+    else
+        $display("tlb_controller_tb failed, %0d errors", n_err);
+    $finish;
+end
+
+endmodule
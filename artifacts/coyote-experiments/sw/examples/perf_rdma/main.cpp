@@ -45,6 +45,7 @@ constexpr auto const defNRepsLat = 100;
 constexpr auto const defMinSize = 128;
 constexpr auto const defMaxSize = 32 * 1024;
 constexpr auto const defOper = 0;
+constexpr auto const defPmtu = 0; // stack PMTU
 
 int main(int argc, char *argv[])  
 {
@@ -68,7 +69,8 @@ int main(int argc, char *argv[])
         ("repsl,l", boost::program_options::value<uint32_t>(), "Number of latency repetitions within a run")
         ("mins,n", boost::program_options::value<uint32_t>(), "Minimum transfer size")
         ("maxs,x", boost::program_options::value<uint32_t>(), "Maximum transfer size")
-        ("oper,w", boost::program_options::value<bool>(), "Read or Write");
+        ("oper,w", boost::program_options::value<bool>(), "Read or Write")
+        ("pmtu,m", boost::program_options::value<uint32_t>(), "Path MTU (256 - 4096), the smaller one of both ends is used");
     
     boost::program_options::variables_map commandLineArgs;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programDescription), commandLineArgs);
@@ -83,6 +85,7 @@ int main(int argc, char *argv[])
     uint32_t max_size = defMaxSize;
     uint32_t old_mem_content = 1; 
     bool oper = defOper;
+    uint32_t pmtu = defPmtu;
     bool mstr = true;
 
     char const* env_var_ip = std::getenv("DEVICE_1_IP_ADDRESS_0");
@@ -101,6 +104,7 @@ int main(int argc, char *argv[])
     if(commandLineArgs.count("mins") > 0) min_size = commandLineArgs["mins"].as<uint32_t>();
     if(commandLineArgs.count("maxs") > 0) max_size = commandLineArgs["maxs"].as<uint32_t>();
     if(commandLineArgs.count("oper") > 0) oper = commandLineArgs["oper"].as<bool>();
+    if(commandLineArgs.count("pmtu") > 0) pmtu = commandLineArgs["pmtu"].as<uint32_t>();
 
     uint32_t n_pages = (max_size + hugePageSize - 1) / hugePageSize;
     uint32_t size = min_size;
@@ -112,12 +116,14 @@ int main(int argc, char *argv[])
     std::cout << (oper ? "Write operation" : "Read operation") << std::endl;
     std::cout << "Min size: " << min_size << std::endl;
     std::cout << "Max size: " << max_size << std::endl;
+    std::cout << "Path MTU: " << pmtu << std::endl;
     std::cout << "Number of throughput reps: " << n_reps_thr << std::endl;
     std::cout << "Number of latency reps: " << n_reps_lat << std::endl;
     
     // Create  queue pairs
     ibvQpMap ictx;
     ictx.addQpair(qpId, targetRegion, ibv_ip, n_pages);
+    ictx.getQpairConn(qpId)->getQpairStruct()->local.pmtu = pmtu;
     mstr ? ictx.exchangeQpMaster(port) : ictx.exchangeQpSlave(tcp_mstr_ip.c_str(), port);
     ibvQpConn *iqp = ictx.getQpairConn(qpId);
     cProcess *cproc = iqp->getCProc();
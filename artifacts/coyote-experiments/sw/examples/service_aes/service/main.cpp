@@ -46,7 +46,7 @@ int main(void)
     cService *cservice = cService::getInstance(targetRegion);
 
     // Load AES service task
-    cservice->addTask(opIdAes, [] (cProcess *cproc, std::vector<uint64_t> params) -> int32_t { // addr, len, keyLow, keyHigh
+    cservice->addTask(opIdAes, [] (cProcess *cproc, const cTaskArgs& params) -> int32_t { // addr, len, keyLow, keyHigh
         // Map
         cproc->userMap((void*)params[0], (uint32_t) params[1]);
         
@@ -65,17 +65,22 @@ int main(int argc, char *argv[])
     /* Args */
     boost::program_options::options_description programDescription("Options:");
     programDescription.add_options()
-        ("vfid,i", boost::program_options::value<uint32_t>(), "Target vFPGA");
+        ("vfid,i", boost::program_options::value<uint32_t>(), "Target vFPGA")
+        ("edf,e", boost::program_options::value<bool>(), "Earliest deadline first scheduling")
+        ("stats,s", boost::program_options::value<std::string>(), "Prometheus text file of the scheduler statistics (absolute path)");
 
     boost::program_options::variables_map commandLineArgs;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programDescription), commandLineArgs);
     boost::program_options::notify(commandLineArgs);
 
     uint32_t vfid = defTargetRegion;
+    bool edf = false;
     if(commandLineArgs.count("vfid") > 0) vfid = commandLineArgs["vfid"].as<uint32_t>();
+    if(commandLineArgs.count("edf") > 0) edf = commandLineArgs["edf"].as<bool>();
     
     /* Create a daemon */
-    cService *cservice = cService::getInstance(vfid);
+    cService *cservice = cService::getInstance(vfid, true, true, edf);
+    if(commandLineArgs.count("stats") > 0) cservice->setStatsFile(commandLineArgs["stats"].as<std::string>());
 
     /**
      * @brief Load all operators
@@ -86,7 +91,7 @@ int main(int argc, char *argv[])
     cservice->addBitstream("part_bstream_c0_" + std::to_string(vfid) + ".bin", opIdAddMul);
 
     // Load addmul task
-    cservice->addTask(opIdAddMul, [] (cProcess *cproc, std::vector<uint64_t> params) -> int32_t { // addr, len, mul, add
+    cservice->addTask(opIdAddMul, [] (cProcess *cproc, const cTaskArgs& params) -> int32_t { // addr, len, mul, add
         // Lock vFPGA
         cproc->pLock(opIdAddMul, opPriority);
         
@@ -113,7 +118,7 @@ int main(int argc, char *argv[])
     cservice->addBitstream("part_bstream_c1_" + std::to_string(vfid) + ".bin", opIdMinMax);
 
     // Load minmax task
-    cservice->addTask(opIdMinMax, [] (cProcess *cproc, std::vector<uint64_t> params) -> int32_t { // addr, len
+    cservice->addTask(opIdMinMax, [] (cProcess *cproc, const cTaskArgs& params) -> int32_t { // addr, len
         // Lock vFPGA
         cproc->pLock(opIdMinMax, opPriority);
         
@@ -142,7 +147,7 @@ int main(int argc, char *argv[])
     cservice->addBitstream("part_bstream_c2_" + std::to_string(vfid) + ".bin", opIdRotate);
 
     // Load rotate task
-    cservice->addTask(opIdRotate, [] (cProcess *cproc, std::vector<uint64_t> params) -> int32_t { // addr, len
+    cservice->addTask(opIdRotate, [] (cProcess *cproc, const cTaskArgs& params) -> int32_t { // addr, len
         // Lock vFPGA
         cproc->pLock(opIdRotate, opPriority);
         
@@ -165,7 +170,7 @@ int main(int argc, char *argv[])
     cservice->addBitstream("part_bstream_c3_" + std::to_string(vfid) + ".bin", opIdSelect);
 
     // Load select task
-    cservice->addTask(opIdSelect, [] (cProcess *cproc, std::vector<uint64_t> params) { // addr, len, type, cond
+    cservice->addTask(opIdSelect, [] (cProcess *cproc, const cTaskArgs& params) { // addr, len, type, cond
         // Lock vFPGA
         cproc->pLock(opIdSelect, opPriority);
         
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <atomic>
+#include <unistd.h>
+#include <boost/program_options.hpp>
+
+#include "cStats.hpp"
+
+using namespace std;
+using namespace fpga;
+
+/* Def params */
+constexpr auto const targetRegion = 0;
+constexpr auto const defInterval = 1000;
+
+std::atomic<bool> stalled(false);
+void gotInt(int) { stalled.store(true); }
+
+/**
+ * @brief Counter exporter
+ * 
+ */
+int main(int argc, char *argv[])  
+{
+    // ---------------------------------------------------------------
+    // Args 
+    // ---------------------------------------------------------------
+    boost::program_options::options_description programDescription("Options:");
+    programDescription.add_options()
+        ("vfid,i", boost::program_options::value<uint32_t>(), "Target vFPGA (DMA and RDMA status registers)")
+        ("interval,t", boost::program_options::value<uint32_t>(), "Sampling interval [ms]")
+        ("prom,p", boost::program_options::value<std::string>(), "Prometheus text file")
+        ("shm,m", boost::program_options::value<std::string>(), "Shared memory snapshot name");
+    
+    boost::program_options::variables_map commandLineArgs;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programDescription), commandLineArgs);
+    boost::program_options::notify(commandLineArgs);
+
+    int32_t vfid = -1;
+    uint32_t interval = defInterval;
+    if(commandLineArgs.count("vfid") > 0) vfid = commandLineArgs["vfid"].as<uint32_t>();
+    if(commandLineArgs.count("interval") > 0) interval = commandLineArgs["interval"].as<uint32_t>();
+
+    PR_HEADER("PARAMS");
+    std::cout << "vFPGA ID: " << vfid << std::endl;
+    std::cout << "Interval: " << interval << " ms" << std::endl;
+
+    // ---------------------------------------------------------------
+    // Init 
+    // ---------------------------------------------------------------
+    std::unique_ptr<cProcess> cproc;
+    if(vfid >= 0) 
+        cproc = std::make_unique<cProcess>(vfid, getpid());
+
+    cStats cstats(std::chrono::milliseconds(interval), cproc.get());
+    if(commandLineArgs.count("prom") > 0) cstats.setPrometheusFile(commandLineArgs["prom"].as<std::string>());
+    if(commandLineArgs.count("shm") > 0) cstats.setShm(commandLineArgs["shm"].as<std::string>());
+
+    // ---------------------------------------------------------------
+    // Runs 
+    // ---------------------------------------------------------------
+    signal(SIGINT, gotInt);
+    cstats.start();
+
+    // Print out, exports are refreshed by the sampling thread
+    PR_HEADER("COUNTERS");
+    while(!stalled) {
+        sleep((interval + 999) / 1000);
+        std::cout << cstats.getPrometheus() << std::endl;
+    }
+
+    cstats.stop();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+
+#include "cStats.hpp"
+
+using namespace std;
+using namespace fpga;
+
+/* Canned sysfs dumps, as printed by the driver (cyt_attr_nstats_q0, cyt_attr_xstats) */
+static const string nstatsDump =
+    "\n -- \033[31m\033[1mNET STATS\033[0m\033[0m QSFP0\n\n"
+    "RX pkgs: 1200\n"
+    "TX pkgs: 1100\n"
+    "ARP RX pkgs: 3\n"
+    "ARP TX pkgs: 2\n"
+    "ICMP RX pkgs: 0\n"
+    "ICMP TX pkgs: 0\n"
+    "TCP RX pkgs: 0\n"
+    "TCP TX pkgs: 0\n"
+    "ROCE RX pkgs: 1197\n"
+    "ROCE TX pkgs: 1098\n"
+    "IBV RX pkgs: 1190\n"
+    "IBV TX pkgs: 1090\n"
+    "PSN drop cnt: 4\n"
+    "Retrans cnt: 7\n"
+    "TCP session cnt: 2\n"
+    "STRM down: 0\n"
+    "DPI reject cnt: 5\n"
+    "DPI monitor cnt: 1\n"
+    "DPI quarantine cnt: 1\n"
+    "DPI quarantine qpn: 4\n"
+    "QP cache hits: 900\n"
+    "QP cache misses: 12\n\n";
+
+static const string xstatsDump =
+    "\n -- \033[31m\033[1mXDMA STATS\033[0m\033[0m\n\n"
+    "CHANNEL 0:\n"
+    "request cnt H2C: 10\n"
+    "request cnt C2H: 20\n"
+    "completion cnt H2C: 10\n"
+    "completion cnt C2H: 19\n"
+    "beat cnt H2C: 640\n"
+    "beat cnt C2H: 1280\n"
+    "CHANNEL 1:\n"
+    "request cnt H2C: 1\n"
+    "request cnt C2H: 2\n"
+    "completion cnt H2C: 1\n"
+    "completion cnt C2H: 2\n"
+    "beat cnt H2C: 64\n"
+    "beat cnt C2H: 128\n\n";
+
+static int errCount = 0;
+
+static void check(bool cond, const string& msg) {
+    if(!cond) {
+        std::cout << "[ERROR] " << msg << std::endl;
+        errCount++;
+    }
+}
+
+static const cCounter* find(const cStatsSample& s, const string& series) {
+    auto it = s.counters.find(series);
+    return it != s.counters.end() ? &it->second : nullptr;
+}
+
+/**
+ * @brief Parser test against canned sysfs dumps
+ * 
+ */
+int main(int argc, char *argv[])  
+{
+    // Net stats, one series per line, escapes and the banner are skipped
+    cStatsSample net;
+    uint32_t n = cStats::parseSysfs(nstatsDump, "coyote_net", "qsfp=\"0\"", net);
+    check(n == 22, "net stats, parsed " + to_string(n) + " counters");
+
+    auto rx = find(net, "coyote_net_rx_pkgs{qsfp=\"0\"}");
+    check(rx && rx->value == 1200 && !rx->gauge, "net stats, rx pkgs");
+    auto rej = find(net, "coyote_net_dpi_reject_cnt{qsfp=\"0\"}");
+    check(rej && rej->value == 5, "net stats, dpi reject cnt");
+    auto sess = find(net, "coyote_net_tcp_session_cnt{qsfp=\"0\"}");
+    check(sess && sess->gauge, "net stats, tcp session cnt is a gauge");
+    auto qpn = find(net, "coyote_net_dpi_quarantine_qpn{qsfp=\"0\"}");
+    check(qpn && qpn->gauge && qpn->value == 4, "net stats, quarantine qpn is a gauge");
+
+    // XDMA stats, channel headers become a label
+    cStatsSample xdma;
+    n = cStats::parseSysfs(xstatsDump, "coyote_xdma", "", xdma);
+    check(n == 12, "xdma stats, parsed " + to_string(n) + " counters");
+
+    auto beat = find(xdma, "coyote_xdma_beat_cnt_c2h{channel=\"1\"}");
+    check(beat && beat->value == 128, "xdma stats, channel 1 beat cnt c2h");
+    auto cmpl = find(xdma, "coyote_xdma_completion_cnt_c2h{channel=\"0\"}");
+    check(cmpl && cmpl->value == 19, "xdma stats, channel 0 completion cnt c2h");
+
+    // Rates, a 32 bit hw counter wraps around between the samples
+    cStatsSample prev, curr;
+    prev.ts_ns = 0;
+    curr.ts_ns = 2000000000;
+    cStats::parseSysfs("RX pkgs: 4294967290\nTX pkgs: 100\n", "coyote_net", "qsfp=\"0\"", prev);
+    cStats::parseSysfs("RX pkgs: 10\nTX pkgs: 300\n", "coyote_net", "qsfp=\"0\"", curr);
+    cStats::computeRates(prev, curr);
+
+    auto rxw = find(curr, "coyote_net_rx_pkgs{qsfp=\"0\"}");
+    check(rxw && rxw->delta == 16, "rates, wrapped rx delta");
+    auto tx = find(curr, "coyote_net_tx_pkgs{qsfp=\"0\"}");
+    check(tx && tx->delta == 200 && tx->rate == 100.0, "rates, tx rate");
+
+    // Prometheus text
+    string prom = cStats::toPrometheus(net);
+    check(prom.find("# TYPE coyote_net_rx_pkgs_total counter\n") != string::npos, "prometheus, counter type");
+    check(prom.find("coyote_net_rx_pkgs_total{qsfp=\"0\"} 1200\n") != string::npos, "prometheus, counter value");
+    check(prom.find("# TYPE coyote_net_tcp_session_cnt gauge\n") != string::npos, "prometheus, gauge type");
+
+    if(errCount)
+        std::cout << "FAILED, " << errCount << " errors" << std::endl;
+    else
+        std::cout << "OK" << std::endl;
+
+    return errCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
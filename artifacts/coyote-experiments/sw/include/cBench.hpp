@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cDefs.hpp"
+#include "cHist.hpp"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -10,7 +11,9 @@
 #include <chrono>
 #include <cmath>
 #include <vector>
+#include <string>
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 #include <iomanip>
 
@@ -21,8 +24,14 @@
 constexpr auto kCalibrate = false;
 constexpr auto kDistribute = false;
 constexpr auto kCyclesRequired = 1e9;
-constexpr auto kNumRunsDist = 1000;
 constexpr auto kNumRunsDef = 100;
+constexpr auto kNumWarmupDef = 0;
+constexpr auto kTscCalibrateNs = 10000000; // 10 ms
+
+/* Environment overrides, picked up by every cBench */
+constexpr auto kEnvBenchOut = "COYOTE_BENCH_OUT"; // export file, .csv or json lines otherwise
+constexpr auto kEnvBenchWarmup = "COYOTE_BENCH_WARMUP"; // warmup runs
+constexpr auto kEnvBenchDuration = "COYOTE_BENCH_DURATION_MS"; // duration based runs
 
 using namespace std::chrono;
 
@@ -33,30 +42,76 @@ class cBench {
     double avg_time = { 0.0 };
     int num_runs = { 0 };
     int num_runs_def = { 0 };
+    int num_warmup = { kNumWarmupDef };
+    int64_t duration = { 0 }; // [ns], run for a fixed time instead of num_runs
+    int64_t interval = { 0 }; // [ns], open loop issue interval
     bool calibrate = { false };
     bool distribute = { false };
 
-    // Accummulated
-    std::vector<double> times;
+    // Export
+    std::string label;
+    std::string out_path;
+    uint32_t n_bench = { 0 };
+
+    // Latency distribution
+    cHist hist;
+
+    // Clock, TSC ticks with a one-time calibration if available
+    static double tscPerNs() {
+#ifdef EN_AVX
+        static const double tsc_per_ns = [] {
+            auto begin_time = std::chrono::steady_clock::now();
+            auto start = rdtscp_tsc();
+            while(std::chrono::steady_clock::now() - begin_time < std::chrono::nanoseconds(kTscCalibrateNs)) ;
+            auto cycles = rdtscp_tsc() - start;
+            auto end_time = std::chrono::steady_clock::now();
+            return (double)cycles / std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - begin_time).count();
+        }();
+        return tsc_per_ns;
+#else
+        return 1.0;
+#endif
+    }
+
+    static inline int64_t now() {
+#ifdef EN_AVX
+        return rdtscp_tsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    inline int64_t toNs(int64_t ticks) { return (int64_t)(ticks / tscPerNs()); }
+    inline int64_t toTicks(int64_t ns) { return (int64_t)(ns * tscPerNs()); }
 
-    void sortBench() { std::sort(times.begin(), times.end()); } 
+    void envOverrides() {
+        if(const char *env = getenv(kEnvBenchOut)) out_path = env;
+        if(const char *env = getenv(kEnvBenchWarmup)) num_warmup = atoi(env);
+        if(const char *env = getenv(kEnvBenchDuration)) duration = atoll(env) * 1000000LL;
+    }
 
 public:
-    cBench(int num_runs = kNumRunsDef, bool calibrate = kCalibrate, bool distribute = kDistribute) { 
-        this->num_runs_def = num_runs; 
-        this->calibrate = calibrate; 
+    cBench(int num_runs = kNumRunsDef, bool calibrate = kCalibrate, bool distribute = kDistribute) {
+        this->num_runs_def = num_runs;
+        this->calibrate = calibrate;
         this->distribute = distribute;
-    } 
+        envOverrides();
+    }
 
     /**
      * Measure the function execution
      */
     template <class Func, typename... Args>
     void runtime(Func const &func, Args... args) {
-        times.clear();
+        hist.reset();
 
-#ifdef EN_AVX    
         // Warm-up
+        for (int i = 0; i < num_warmup; ++i) {
+            func(args...);
+        }
+
+#ifdef EN_AVX
+        // Number of runs
         if (calibrate) {
             num_runs = 1;
             while (num_runs < (1 << 14)) {
@@ -74,53 +129,76 @@ public:
         } else {
 #endif
             num_runs = num_runs_def;
-#ifdef EN_AVX  
+#ifdef EN_AVX
         }
 #endif
 
         //DBG2("Number of bench runs: " << num_runs);
 
-        // Average time
-        auto begin_time = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < num_runs; ++i) {
+        // Every run is recorded, duration based runs ignore num_runs
+        const int64_t interval_ticks = toTicks(interval);
+        const int64_t end_ticks = duration ? now() + toTicks(duration) : 0;
+        int64_t begin_time = now();
+        int64_t sched_time = begin_time;
+        int64_t run_start, run_end = begin_time;
+        int n_runs = 0;
+
+        while (duration ? run_end < end_ticks : n_runs < num_runs) {
+            if (interval_ticks) {
+                // Open loop, latency counts from the intended issue time (coordinated omission)
+                while (now() < sched_time) ;
+                run_start = sched_time;
+                sched_time += interval_ticks;
+            } else {
+                run_start = now();
+            }
+
             func(args...);
+
+            run_end = now();
+            hist.record(toNs(run_end - run_start));
+            n_runs++;
         }
-        auto end_time = std::chrono::high_resolution_clock::now();
 
-        double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - begin_time).count();
-        avg_time = time / num_runs;
+        num_runs = n_runs;
+        avg_time = num_runs ? (double)toNs(run_end - begin_time) / num_runs : 0.0;
+
+        // Export
+        if (!out_path.empty())
+            exportOut(out_path);
 
         // Latency distribution
-        if(distribute) {       
-            for (int i = 0; i < kNumRunsDist; ++i) {
-                begin_time = std::chrono::high_resolution_clock::now();
-                    func(args...);
-                end_time = std::chrono::high_resolution_clock::now();
-                
-                time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - begin_time).count();
-                times.emplace_back(time);
-            }
+        if (distribute)
+            printOut();
 
-            sortBench();
-            printOut(); 
-        }
+        n_bench++;
     }
 
     // Number of runs for the average
     inline auto getNumRuns() { return num_runs; }
-    inline auto setNumRuns(uint32_t n_runs) { num_runs = n_runs; }
+    inline auto setNumRuns(uint32_t n_runs) { num_runs_def = n_runs; }
+
+    // Warmup, duration based runs [ns], open loop interval [ns]
+    inline auto setWarmup(uint32_t n_runs) { num_warmup = n_runs; }
+    inline auto setDuration(std::chrono::nanoseconds d) { duration = d.count(); }
+    inline auto setInterval(std::chrono::nanoseconds i) { interval = i.count(); }
+    inline auto setLabel(std::string l) { label = l; }
 
     // Average run time
     inline auto getAvg() { return avg_time; }
 
     // Statistics
-    inline auto getMin() { if(!times.empty()) return times[0]; else return 0.0; }
-    inline auto getMax() { if(!times.empty()) return times[times.size()-1]; else return 0.0; }
-    inline auto getP25() { if(!times.empty()) return times[(times.size()/4)-1]; else return 0.0; }
-    inline auto getP50() { if(!times.empty()) return times[(times.size()/2)-1]; else return 0.0; }
-    inline auto getP75() { if(!times.empty()) return times[((times.size()*3)/4)-1]; else return 0.0; }
-    inline auto getP95() { if(!times.empty()) return times[((times.size()*95)/100)-1]; else return 0.0; }
-    inline auto getP99() { if(!times.empty()) return times[((times.size()*99)/100)-1]; else return 0.0; }
+    inline auto getHist() -> const cHist& { return hist; }
+    inline auto getPercentile(double p) { return (double)hist.getPercentile(p); }
+    inline auto getMin() { return (double)hist.getMin(); }
+    inline auto getMax() { return (double)hist.getMax(); }
+    inline auto getStddev() { return hist.getStddev(); }
+    inline auto getP25() { return getPercentile(25.0); }
+    inline auto getP50() { return getPercentile(50.0); }
+    inline auto getP75() { return getPercentile(75.0); }
+    inline auto getP95() { return getPercentile(95.0); }
+    inline auto getP99() { return getPercentile(99.0); }
+    inline auto getP999() { return getPercentile(99.9); }
 
     // Print results
     void printOut() {
@@ -134,8 +212,51 @@ public:
         std::cout << "75th: "         << getP75() << " ns" << std::endl;
         std::cout << "95th: "         << getP95() << " ns" << std::endl;
         std::cout << "99th: "         << getP99() << " ns" << std::endl;
+        std::cout << "99.9th: "       << getP999() << " ns" << std::endl;
 
         std::cout.flags( f );
     }
 
+    // Export results, one record per runtime() call
+    void toJson(std::ostream &os) {
+        os << "{\"label\":\"" << (label.empty() ? "bench_" + std::to_string(n_bench) : label) << "\""
+           << ",\"runs\":" << num_runs << ",\"warmup\":" << num_warmup
+           << ",\"interval_ns\":" << interval << ",\"avg_ns\":" << getAvg()
+           << ",\"min_ns\":" << getMin() << ",\"max_ns\":" << getMax() << ",\"stddev_ns\":" << getStddev()
+           << ",\"p25_ns\":" << getP25() << ",\"p50_ns\":" << getP50() << ",\"p75_ns\":" << getP75()
+           << ",\"p95_ns\":" << getP95() << ",\"p99_ns\":" << getP99() << ",\"p999_ns\":" << getP999()
+           << ",\"saturated\":" << hist.getSaturated() << ",\"hist\":[";
+        bool first = true;
+        hist.forEach([&](int64_t value, uint64_t count) {
+            os << (first ? "" : ",") << "[" << value << "," << count << "]";
+            first = false;
+        });
+        os << "]}" << std::endl;
+    }
+
+    void toCsv(std::ostream &os, bool header = false) {
+        if(header)
+            os << "label,runs,warmup,interval_ns,avg_ns,min_ns,max_ns,stddev_ns,p25_ns,p50_ns,p75_ns,p95_ns,p99_ns,p999_ns,saturated" << std::endl;
+        os << (label.empty() ? "bench_" + std::to_string(n_bench) : label) << "," << num_runs << "," << num_warmup << ","
+           << interval << "," << getAvg() << "," << getMin() << "," << getMax() << "," << getStddev() << ","
+           << getP25() << "," << getP50() << "," << getP75() << "," << getP95() << "," << getP99() << "," << getP999() << ","
+           << hist.getSaturated() << std::endl;
+    }
+
+    void exportOut(const std::string &path) {
+        bool csv = path.size() > 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        std::ifstream probe(path);
+        bool empty = !probe.good() || probe.peek() == std::ifstream::traits_type::eof();
+        probe.close();
+
+        std::ofstream os(path, std::ios::app);
+        if(!os) {
+            std::cerr << "ERR:  Bench results could not be exported: " << path << std::endl;
+            return;
+        }
+
+        if(csv) toCsv(os, empty);
+        else toJson(os);
+    }
+
 };
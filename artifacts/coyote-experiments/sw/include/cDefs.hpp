@@ -51,6 +51,7 @@ namespace fpga {
 #define PR_HEADER(msg) std::cout << "\n-- \033[31m\e[1m" << msg << "\033[0m\e[0m" << std::endl << std::string(47, '-') << std::endl;
 
 #define EN_AVX
+//#define EN_TRACE // Event tracing, see cTrace.hpp
 
 /* High low */
 #define HIGH_32(data)                       ((data >> 16) >> 16)
@@ -75,6 +76,8 @@ namespace fpga {
 #define IOCTL_WRITE_CTX                	    _IOW('D', 13, unsigned long)
 #define IOCTL_WRITE_CONN                	_IOW('D', 14, unsigned long)
 #define IOCTL_SET_TCP_OFFS              	_IOW('D', 15, unsigned long)
+#define IOCTL_MAP_USER_VEC              	_IOW('D', 16, unsigned long)
+#define IOCTL_SET_DCQCN                 	_IOW('D', 17, unsigned long)
 #define IOCTL_READ_NET_STATS             	_IOR('D', 33, unsigned long)
 
 #define IOCTL_READ_CNFG                     _IOR('D', 32, unsigned long)
@@ -147,6 +150,13 @@ enum class CoyoteAlloc {
     RCNFG_2M = 3
 };
 
+/* RDMA payload inspection of a queue pair */
+enum class DpiMode {
+    ENFORCE = 0, // rejected writes are NAKed
+    MONITOR = 1, // classified and counted, always accepted
+    BYPASS = 2 // not classified
+};
+
 /* AVX regs */
 enum class CnfgAvxRegs : uint32_t {
     CTRL_REG = 0,
@@ -281,6 +291,10 @@ constexpr auto const nNetRegs = 9;
 constexpr auto const qsfpOffsAvx = 8;
 constexpr auto const qsfpOffsLeg = 16;
 
+constexpr auto const qpContextDpiOffs = 8;
+constexpr auto const qpContextDpiThrOffs = 10;
+constexpr auto const qpContextRdWndOffs = 18;
+constexpr auto const qpContextPmtuOffs = 27;
 constexpr auto const qpContextQpnOffs = 32;
 constexpr auto const qpContextRpsnOffs = 0;
 constexpr auto const qpContextLpsnOffs = 24;
@@ -321,15 +335,48 @@ constexpr auto isSync(CoyoteOper oper) {
     return oper == CoyoteOper::OFFLOAD || oper == CoyoteOper::SYNC;
 }
 
+/* Deadlines - absolute steady clock time [ns], 0 for none */
+inline int64_t deadlineNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int64_t deadlineIn(std::chrono::nanoseconds budget) {
+    return deadlineNow() + budget.count();
+}
+
 /* Daemon */
 constexpr auto const recvBuffSize   = 1024;
-constexpr auto const sleepIntervalDaemon = 5000L;
-constexpr auto const sleepIntervalRequests = 5000L;
-constexpr auto const sleepIntervalCompletion = 2000L;
 constexpr auto const aesOpId = 0;
 constexpr auto const opPrio = 0;
-constexpr auto const maxNumClients = 64;
+constexpr auto const maxNumClients = nCpidMax; // each client registers its own cpid
+constexpr auto const maxEpollEvents = 64;
+constexpr auto const epollTimeoutMs = 100;
 constexpr auto const defOpClose = 0;
+constexpr auto const defOpRegShm = -1;
+constexpr auto const defTidReg = -1; // completion of the client registration
+constexpr auto const cmplInvalid = -1;
+constexpr auto const cmplRefused = -2;
+
+/* Scheduling */
+constexpr auto const schedCostWeight = 0.125; // EWMA weight of the latest cost sample
+
+/* Tasks */
+constexpr auto const maxTaskArgs = 8;
+constexpr auto const maxTaskPayload = maxTaskArgs * sizeof(uint64_t); // request payload, same limit in cLib and cService
+constexpr auto const taskPoolSlabSize = 1024;
+
+/* Tracing */
+constexpr auto const traceRingSize = 64 * 1024; // events per thread
+
+/* Statistics */
+constexpr auto const statsSysfsDir = "/sys/kernel/coyote_cnfg";
+constexpr auto const statsDefInterval = 1000ms;
+constexpr auto const statsMaxEntries = 256;
+constexpr auto const statsNameSize = 96;
+
+/* Shared memory transport */
+constexpr auto const shmRingSize = 256;
+constexpr auto const shmMaxArgs = maxTaskArgs;
 
 // ======-------------------------------------------------------------------------------
 // Structs
@@ -344,6 +391,15 @@ struct csAlloc {
 	uint32_t n_pages = { 0 };
 };
 
+/* Vectored map range, layout shared with the driver */
+struct csMapRange {
+	void *vaddr = { nullptr };
+	uint64_t len = { 0 };
+
+	// Mapped length or -errno, set by the driver
+	int64_t status = { 0 };
+};
+
 /* Invoke struct */
 struct csInvokeAll {
 	// Operation
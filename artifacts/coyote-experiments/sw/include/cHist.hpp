@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+constexpr auto kHistSigDigits = 3;
+constexpr auto kHistMaxValue = 3600000000000LL; // 1 h [ns]
+
+/**
+ * HDR histogram, fixed memory latency recording [ns]
+ *
+ * Values are kept with a constant relative precision (sig_digits), memory is allocated
+ * once on construction and recording never allocates. Values above max_value saturate.
+ */
+class cHist {
+    int64_t max_value;
+    int32_t sub_bucket_count;
+    int32_t sub_bucket_half_count;
+    int32_t sub_bucket_half_count_magnitude;
+    int64_t sub_bucket_mask;
+    int32_t bucket_count;
+
+    std::vector<uint64_t> counts;
+    uint64_t total_count = { 0 };
+    uint64_t saturated = { 0 };
+    int64_t min_value = { INT64_MAX };
+    int64_t max_recorded = { 0 };
+    double sum = { 0.0 };
+
+    inline int32_t bucketIndex(int64_t value) const {
+        int32_t pow2_ceiling = 64 - __builtin_clzll(value | sub_bucket_mask);
+        return pow2_ceiling - (sub_bucket_half_count_magnitude + 1);
+    }
+
+    inline int32_t countsIndex(int64_t value) const {
+        int32_t bucket_idx = bucketIndex(value);
+        int32_t sub_bucket_idx = (int32_t)(value >> bucket_idx);
+        return ((bucket_idx + 1) << sub_bucket_half_count_magnitude) + (sub_bucket_idx - sub_bucket_half_count);
+    }
+
+    inline int64_t valueFromIndex(int32_t idx) const {
+        int32_t bucket_idx = (idx >> sub_bucket_half_count_magnitude) - 1;
+        int32_t sub_bucket_idx = (idx & (sub_bucket_half_count - 1)) + sub_bucket_half_count;
+        if(bucket_idx < 0) {
+            sub_bucket_idx -= sub_bucket_half_count;
+            bucket_idx = 0;
+        }
+        return (int64_t)sub_bucket_idx << bucket_idx;
+    }
+
+    // Highest value equivalent to the one at idx, so percentiles never under-report
+    inline int64_t highestEquivalent(int64_t value) const {
+        int32_t bucket_idx = bucketIndex(value);
+        int32_t sub_bucket_idx = (int32_t)(value >> bucket_idx);
+        int32_t adj_bucket = (sub_bucket_idx >= sub_bucket_count) ? bucket_idx + 1 : bucket_idx;
+        int64_t lowest = (int64_t)sub_bucket_idx << bucket_idx;
+        return lowest + (1LL << adj_bucket) - 1;
+    }
+
+public:
+    cHist(int64_t max_value = kHistMaxValue, int32_t sig_digits = kHistSigDigits) : max_value(max_value) {
+        int64_t largest_single_unit = 2 * (int64_t)std::pow(10, sig_digits);
+        int32_t sub_bucket_count_magnitude = (int32_t)std::ceil(std::log2((double)largest_single_unit));
+        sub_bucket_half_count_magnitude = (sub_bucket_count_magnitude > 1 ? sub_bucket_count_magnitude : 1) - 1;
+        sub_bucket_count = 1 << (sub_bucket_half_count_magnitude + 1);
+        sub_bucket_half_count = sub_bucket_count / 2;
+        sub_bucket_mask = (int64_t)sub_bucket_count - 1;
+
+        int64_t smallest_untrackable = sub_bucket_count;
+        bucket_count = 1;
+        while(smallest_untrackable <= max_value) {
+            if(smallest_untrackable > INT64_MAX / 2) { bucket_count++; break; }
+            smallest_untrackable <<= 1;
+            bucket_count++;
+        }
+
+        counts.resize((bucket_count + 1) * sub_bucket_half_count, 0);
+    }
+
+    /**
+     * Record a single value
+     */
+    inline void record(int64_t value, uint64_t count = 1) {
+        if(value < 0) value = 0;
+        if(value > max_value) { value = max_value; saturated += count; }
+
+        counts[countsIndex(value)] += count;
+        total_count += count;
+        sum += (double)value * count;
+        if(value < min_value) min_value = value;
+        if(value > max_recorded) max_recorded = value;
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total_count = 0; saturated = 0; sum = 0.0;
+        min_value = INT64_MAX; max_recorded = 0;
+    }
+
+    void merge(const cHist& other) {
+        for(int32_t i = 0; i < (int32_t)other.counts.size(); i++)
+            if(other.counts[i]) record(other.valueFromIndex(i), other.counts[i]);
+    }
+
+    /**
+     * Value at percentile (0 - 100], highest equivalent value of the bucket
+     */
+    int64_t getPercentile(double percentile) const {
+        if(total_count == 0) return 0;
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+
+        uint64_t target = (uint64_t)std::ceil((percentile / 100.0) * total_count);
+        if(target == 0) target = 1;
+
+        uint64_t acc = 0;
+        for(int32_t i = 0; i < (int32_t)counts.size(); i++) {
+            acc += counts[i];
+            if(acc >= target)
+                return std::min(highestEquivalent(valueFromIndex(i)), max_recorded);
+        }
+        return max_recorded;
+    }
+
+    // Getters
+    inline auto getCount() const { return total_count; }
+    inline auto getSaturated() const { return saturated; }
+    inline auto getMin() const { return total_count ? min_value : 0; }
+    inline auto getMax() const { return max_recorded; }
+    inline auto getMean() const { return total_count ? sum / total_count : 0.0; }
+
+    double getStddev() const {
+        if(total_count == 0) return 0.0;
+        double mean = getMean(), acc = 0.0;
+        for(int32_t i = 0; i < (int32_t)counts.size(); i++) {
+            if(counts[i]) {
+                double dev = (double)valueFromIndex(i) - mean;
+                acc += dev * dev * counts[i];
+            }
+        }
+        return std::sqrt(acc / total_count);
+    }
+
+    // Non-empty buckets (value, count)
+    template <class Func>
+    void forEach(Func const &func) const {
+        for(int32_t i = 0; i < (int32_t)counts.size(); i++)
+            if(counts[i]) func(valueFromIndex(i), counts[i]);
+    }
+};
@@ -19,6 +19,10 @@
 #include <sstream>
 #include <atomic>
 #include <vector>
+#include <unordered_map>
+#include <sys/mman.h>
+
+#include "cRing.hpp"
 
 namespace fpga {
 
@@ -32,12 +36,14 @@ public:
     int32_t tid;
     int32_t oid;
     std::vector<uint64_t> args;
+    int64_t deadline; // absolute, see deadlineIn(), 0 for none
 
-    cMsg(int32_t oid, std::vector<uint64_t> args) :
-        tid(curr_tid++), oid(oid), args(args) {}
+    cMsg(int32_t oid, std::vector<uint64_t> args, int64_t deadline = 0) :
+        tid(curr_tid++), oid(oid), args(args), deadline(deadline) {}
 
     inline auto getTid() { return tid; }
     inline auto getOid() { return oid; }
+    inline auto getDeadline() { return deadline; }
     inline auto getArgs() { return args.data(); }
     inline auto getArgsSize() { return args.size(); }
 };
@@ -52,16 +58,68 @@ class cLib {
 private:
     int sockfd;
     struct sockaddr_un server;
-    uint8_t opcode;
     char recv_buff[recvBuffSize];
+    uint32_t recv_len = { 0 };
 
     static std::atomic_uint32_t curr_id;
 
+    // Completions received, not yet claimed (tid, code)
+    std::unordered_map<int32_t, int32_t> cmpl_map;
+
+    // Shared memory transport
+    cShmRings *rings = { nullptr };
+    void *shm_mem = { nullptr };
+    uint64_t shm_len = { 0 };
+
+    // Socket transport
+    void sendRequest(cMsg& msg);
+    bool recvCompletions(bool block);
+
+    // Shared memory transport
+    void submitShm(cMsg& msg);
+    bool recvCompletionsShm();
+
 public:
     cLib(const char *sock_name);
     ~cLib();
 
-    // Server comm
+    /**
+     * @brief Switch to the shared memory transport. Requests are passed through rings,
+     * buffers within the returned data region are mapped once and passed as offsets.
+     * 
+     * @param n_pages - number of hugepages in the data region
+     * @return void* - data region
+     */
+    void* shmInit(uint32_t n_pages);
+    inline auto getShmMem() { return shm_mem; }
+
+    /**
+     * @brief Submit a task without waiting for it. Any number of tasks can be outstanding,
+     * the service completes them in any order.
+     * 
+     * @param msg - task
+     * @return int32_t - ticket (tid) to poll or wait on
+     */
+    int32_t submit(cMsg msg);
+
+    /**
+     * @brief Check whether a submitted task completed, doesn't block
+     * 
+     * @param tid - ticket
+     * @param code - completion code, valid if completed
+     * @return true if completed
+     */
+    bool poll(int32_t tid, int32_t& code);
+
+    /**
+     * @brief Wait for a submitted task to complete
+     * 
+     * @param tid - ticket
+     * @return int32_t - completion code
+     */
+    int32_t wait(int32_t tid);
+
+    // Server comm, synchronous
     int32_t task(cMsg msg);
 };
 
@@ -95,8 +153,10 @@ cLib::cLib(const char *sock_name) {
 
 cLib::~cLib() {
     // Close conn
-    opcode = defOpClose;
-    if(write(sockfd, &opcode, sizeof(int32_t)) != sizeof(int32_t)) {
+    int32_t req[2];
+    req[0] = -1;
+    req[1] = defOpClose;
+    if(write(sockfd, &req, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
         std::cout << "ERR:  Failed to send a request" << std::endl;
         exit(EXIT_FAILURE);
     }
@@ -104,46 +164,214 @@ cLib::~cLib() {
     std::cout << "Sent close" << std::endl;
 
     close(sockfd);
+
+    // Shared memory
+    if(rings != nullptr) 
+        munmap(rings, sizeof(cShmRings));
+    if(shm_mem != nullptr)
+        munmap(shm_mem, shm_len);
 }
 
-int32_t cLib::task(cMsg msg) {
-    // Send request
-    int32_t req[2];
-    req[0] = msg.getTid();
-    req[1] = msg.getOid();
+void* cLib::shmInit(uint32_t n_pages) {
+    if(rings != nullptr)
+        return shm_mem;
 
-    // Send tid and opcode
-    if(write(sockfd, &req, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-        std::cout << "ERR:  Failed to send a request" << std::endl;
+    // Data region
+    shm_len = static_cast<uint64_t>(n_pages) * hugePageSize;
+    if(shm_len > 0) {
+        shm_mem = mmap(NULL, shm_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(shm_mem == MAP_FAILED) {
+            std::cout << "ERR:  Failed to allocate the shared data region" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Rings, named after the registration request
+    cMsg msg(defOpRegShm, {reinterpret_cast<uint64_t>(shm_mem), shm_len});
+    std::string name = shmRingsName(getpid(), msg.getTid());
+
+    int shmfd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(shmfd == -1 || ftruncate(shmfd, sizeof(cShmRings)) == -1) {
+        std::cout << "ERR:  Failed to create the shared rings" << std::endl;
         exit(EXIT_FAILURE);
     }
-    
-    // Send payload size
-    int32_t msg_size = msg.getArgsSize() * sizeof(uint64_t);
 
-    if(write(sockfd, &msg_size, sizeof(int32_t)) != sizeof(int32_t)) {
-        std::cout << "ERR:  Failed to send a request" << std::endl;
+    void *mem = mmap(NULL, sizeof(cShmRings), PROT_READ | PROT_WRITE, MAP_SHARED, shmfd, 0);
+    close(shmfd);
+    if(mem == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        std::cout << "ERR:  Failed to map the shared rings" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    cShmRings *tmp_rings = reinterpret_cast<cShmRings*>(mem);
+    tmp_rings->sq.init();
+    tmp_rings->cq.init();
+
+    // Register, the service keeps its own mapping of the rings
+    sendRequest(msg);
+    int32_t code = wait(msg.getTid());
+    shm_unlink(name.c_str());
+
+    if(code != 0) {
+        std::cout << "ERR:  Shared memory registration refused" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // Send payload
-    if(write(sockfd, msg.getArgs(), msg_size) != msg_size) {
+    rings = tmp_rings;
+
+    std::cout << "Registered shared memory" << std::endl;
+    return shm_mem;
+}
+
+void cLib::sendRequest(cMsg& msg) {
+    // Request: tid, opcode, payload size, deadline, payload
+    char req[3 * sizeof(int32_t) + sizeof(int64_t) + maxTaskPayload];
+    int32_t msg_size = msg.getArgsSize() * sizeof(uint64_t);
+    if(msg_size > maxTaskPayload) {
+        std::cout << "ERR:  Request payload too large, max. " << maxTaskArgs << " arguments" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int32_t hdr[3] = { msg.getTid(), msg.getOid(), msg_size };
+    int64_t deadline = msg.getDeadline();
+    memcpy(req, hdr, 3 * sizeof(int32_t));
+    memcpy(req + 3 * sizeof(int32_t), &deadline, sizeof(int64_t));
+    memcpy(req + 3 * sizeof(int32_t) + sizeof(int64_t), msg.getArgs(), msg_size);
+
+    // Single write, the service parses pipelined requests
+    ssize_t req_size = 3 * sizeof(int32_t) + sizeof(int64_t) + msg_size;
+    if(write(sockfd, req, req_size) != req_size) {
         std::cout << "ERR:  Failed to send a request" << std::endl;
         exit(EXIT_FAILURE);
     }
-    std::cout << "Sent payload" << std::endl;
+}
 
-    // Wait for completion
+bool cLib::recvCompletions(bool block) {
+    bool received = false;
     int32_t cmpl[2];
 
-    if(read(sockfd, recv_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-        std::cout << "ERR:  Failed to receive completion event" << std::endl;
+    do {
+        ssize_t n = recv(sockfd, recv_buff + recv_len, recvBuffSize - recv_len, block ? 0 : MSG_DONTWAIT);
+        if(n <= 0) {
+            if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                break;
+            std::cout << "ERR:  Failed to receive completion event" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        recv_len += n;
+
+        // Completions: tid, code
+        uint32_t offs = 0;
+        while(recv_len - offs >= 2 * sizeof(int32_t)) {
+            memcpy(&cmpl, recv_buff + offs, 2 * sizeof(int32_t));
+            offs += 2 * sizeof(int32_t);
+
+            if(cmpl[0] == defTidReg) {
+                std::cout << "ERR:  Registration refused by the service" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            cmpl_map[cmpl[0]] = cmpl[1];
+            received = true;
+            DBG3("Received completion event, tid: " << cmpl[0]);
+        }
+
+        recv_len -= offs;
+        memmove(recv_buff, recv_buff + offs, recv_len);
+    } while(block && !received);
+
+    return received;
+}
+
+void cLib::submitShm(cMsg& msg) {
+    cSqe sqe;
+
+    if(msg.getArgsSize() > shmMaxArgs) {
+        std::cout << "ERR:  Too many arguments for the shared memory transport" << std::endl;
         exit(EXIT_FAILURE);
     }
-    memcpy(&cmpl, recv_buff, 2 * sizeof(int32_t));
 
-    std::cout << "Received completion event, tid: " << cmpl[0] << std::endl;
-    return cmpl[1];
+    sqe.tid = msg.getTid();
+    sqe.oid = msg.getOid();
+    sqe.n_args = msg.getArgsSize();
+    sqe.offs_mask = 0;
+    sqe.deadline = msg.getDeadline();
+
+    // Pointers into the data region are passed as offsets
+    for(int i = 0; i < sqe.n_args; i++) {
+        uint64_t arg = msg.getArgs()[i];
+        uint64_t base = reinterpret_cast<uint64_t>(shm_mem);
+        if(shm_len > 0 && arg >= base && arg < base + shm_len) {
+            sqe.args[i] = arg - base;
+            sqe.offs_mask |= (1U << i);
+        } else {
+            sqe.args[i] = arg;
+        }
+    }
+
+    // No syscalls on this path, keep draining completions while the ring is full
+    while(!rings->sq.push(sqe)) {
+        recvCompletionsShm();
+        _mm_pause();
+    }
+}
+
+bool cLib::recvCompletionsShm() {
+    bool received = false;
+    cCqe cqe;
+
+    while(rings->cq.pop(cqe)) {
+        cmpl_map[cqe.tid] = cqe.code;
+        received = true;
+    }
+
+    return received;
+}
+
+int32_t cLib::submit(cMsg msg) {
+    if(rings != nullptr)
+        submitShm(msg);
+    else
+        sendRequest(msg);
+
+    DBG3("Submitted task, tid: " << msg.getTid() << ", oid: " << msg.getOid());
+    return msg.getTid();
+}
+
+bool cLib::poll(int32_t tid, int32_t& code) {
+    auto it = cmpl_map.find(tid);
+    if(it == cmpl_map.end()) {
+        if(rings != nullptr)
+            recvCompletionsShm();
+        else
+            recvCompletions(false);
+
+        it = cmpl_map.find(tid);
+        if(it == cmpl_map.end())
+            return false;
+    }
+
+    code = it->second;
+    cmpl_map.erase(it);
+    return true;
+}
+
+int32_t cLib::wait(int32_t tid) {
+    int32_t code;
+
+    while(!poll(tid, code)) {
+        if(rings != nullptr)
+            _mm_pause();
+        else
+            recvCompletions(true);
+    }
+
+    return code;
+}
+
+int32_t cLib::task(cMsg msg) {
+    return wait(submit(msg));
 }
 
 }
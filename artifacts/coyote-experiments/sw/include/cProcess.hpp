@@ -1,10 +1,12 @@
     #pragma once
 
 #include "cDefs.hpp"
+#include "cTrace.hpp"
 
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <vector>
 #include <unordered_map> 
 #include <unordered_set> 
 #include <boost/functional/hash.hpp>
@@ -66,6 +68,7 @@ protected:
 
     /* Scheduler */
     cSched *csched = { nullptr };
+    int64_t deadline = { 0 }; // deadline of the current task
 
 	/* Used markers */
 	uint32_t rd_cmd_cnt = { 0 };
@@ -121,14 +124,23 @@ public:
 	inline auto getVfid() const { return vfid; }
 	inline auto getCpid() const { return cpid; }
 	inline auto getPid()  const { return pid; }
+	inline auto getDeadline() const { return deadline; }
+	inline auto setDeadline(int64_t deadline) { this->deadline = deadline; }
 
 	/**
 	 * @brief External locks
 	 * 
 	 */
 	void pLock(int32_t oid, uint32_t priority);
+	void pLock(int32_t oid, uint32_t priority, int64_t deadline);
 	void pUnlock();
 
+	/**
+	 * @brief Deadline admission (always admitted without a scheduler)
+	 * 
+	 */
+	bool admit(int32_t oid, int64_t deadline);
+
 	/**
 	 * @brief Explicit TLB mapping of user allocated memory
 	 * 
@@ -136,6 +148,14 @@ public:
 	 * @param len : length to map
 	 */
 	void userMap(void *vaddr, uint32_t len);
+
+	/**
+	 * @brief Vectored TLB mapping, all ranges are pinned and programmed in a single call
+	 * 
+	 * @param ranges : ranges to map, status is filled in per range (mapped length or -errno)
+	 * @return uint32_t : number of ranges mapped
+	 */
+	uint32_t userMap(std::vector<csMapRange>& ranges);
 	void userUnmap(void *vaddr);
 
 	/**
@@ -208,6 +228,13 @@ public:
 	 */
 	void netDrop(bool clr, bool dir, uint32_t packet_id);
 
+	/**
+	 * @brief DCQCN congestion control parameters of the RDMA stack
+	 * 
+	 * @param cnfg - [0] disable, [7:4] g, [11:8] F, [31:16] AI, [47:32] HAI, [55:48] min rate, [63:56] timer period (0 - default)
+	 */
+	void setDcqcn(uint64_t cnfg);
+
 
 	/**
 	 * @brief TCP Open Connection
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "cDefs.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+namespace fpga {
+
+/**
+ * @brief Submission queue entry
+ *
+ * Arguments flagged in offs_mask are offsets into the registered shared data region,
+ * the service translates them before the task is scheduled.
+ *
+ */
+struct cSqe {
+    int32_t tid;
+    int32_t oid;
+    uint32_t n_args;
+    uint32_t offs_mask;
+    int64_t deadline; // absolute steady clock [ns], 0 for none
+    uint64_t args[shmMaxArgs];
+};
+
+/**
+ * @brief Completion queue entry
+ *
+ */
+struct cCqe {
+    int32_t tid;
+    int32_t code;
+};
+
+/**
+ * @brief Single producer, single consumer ring
+ *
+ * Lives in memory shared between a cLib client and the cService.
+ * Head and tail sit on separate cache lines, no syscalls on either side.
+ *
+ */
+template<typename T, uint32_t N>
+struct cRing {
+    static_assert((N & (N - 1)) == 0, "Ring size has to be a power of 2");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Ring indices have to be lock free");
+
+    alignas(64) std::atomic<uint32_t> head; // consumer
+    alignas(64) std::atomic<uint32_t> tail; // producer
+    alignas(64) T entries[N];
+
+    void init() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_release);
+    }
+
+    bool push(const T& entry) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == N)
+            return false;
+        entries[t & (N - 1)] = entry;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& entry) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+            return false;
+        entry = entries[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline auto empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+};
+
+/**
+ * @brief Per-client ring pair, one shared memory object
+ *
+ */
+struct cShmRings {
+    cRing<cSqe, shmRingSize> sq; // client -> service
+    cRing<cCqe, shmRingSize> cq; // service -> client
+};
+
+/* Shared memory object name of the rings, created by the client, opened by the service */
+inline std::string shmRingsName(pid_t pid, int32_t tid) {
+    return "/coyote-rings-" + std::to_string(pid) + "-" + std::to_string(tid);
+}
+
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "cDefs.hpp"
+#include "cTrace.hpp"
 
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <map>
 #include <unordered_map> 
 #include <unordered_set> 
 #include <boost/functional/hash.hpp>
@@ -49,6 +51,15 @@ struct cLoad {
     int32_t cpid;
     int32_t oid;
     uint32_t priority;
+    int64_t deadline; // absolute [ns], 0 for none
+    int64_t cost; // estimated [ns], accounted while pending
+};
+
+/* Deadline statistics */
+struct cDeadlineStats {
+    uint64_t met = { 0 };
+    uint64_t missed = { 0 };
+    uint64_t refused = { 0 };
 };
 
 /* Schedule reordering */
@@ -56,22 +67,33 @@ class taskCmprSched {
 private:
     bool priority;
     bool reorder;
+    bool edf;
 
 public: 
-    taskCmprSched(const bool& priority, const bool& reorder) {
+    taskCmprSched(const bool& priority, const bool& reorder, const bool& edf = false) {
         this->priority = priority;
         this->reorder = reorder;
+        this->edf = edf;
     }
 
-    bool operator()(const std::unique_ptr<cLoad>& req1, const std::unique_ptr<cLoad>& req2) {
+    bool operator()(const cLoad& req1, const cLoad& req2) {
+        // Earliest deadline first, tasks without a deadline go last
+        if(edf) {
+            if(req1.deadline != req2.deadline) {
+                if(req1.deadline == 0) return true;
+                if(req2.deadline == 0) return false;
+                return req1.deadline > req2.deadline;
+            }
+        }
+
         // Comparison
         if(priority) {
-            if(req1->priority < req2->priority) return true;
+            if(req1.priority < req2.priority) return true;
         }
 
         if(reorder) {
-            if(req1->priority == req2->priority) {
-                if(req1->oid > req2->oid)
+            if(req1.priority == req2.priority) {
+                if(req1.oid > req2.oid)
                     return true;
             }
         }
@@ -101,6 +123,7 @@ protected:
     /* Scheduling */
     const bool priority;
     const bool reorder;
+    const bool edf;
 
     /* Thread */
     bool run;
@@ -109,7 +132,7 @@ protected:
     /* Scheduler queue */
     condition_variable cv_queue;
     mutex mtx_queue;
-    priority_queue<std::unique_ptr<cLoad>, vector<std::unique_ptr<cLoad>>, taskCmprSched> request_queue;
+    priority_queue<cLoad, vector<cLoad>, taskCmprSched> request_queue; // by value, no allocation per task
     
     /* Scheduling and completion */
     condition_variable cv_rcnfg;
@@ -120,6 +143,18 @@ protected:
     mutex mtx_cmplt;
     bool curr_run = { false };
 
+    /* Deadlines - cost estimates per operator [ns], queued deadline tasks (deadline, cost), the running task */
+    std::unordered_map<int32_t, int64_t> rcnfg_cost;
+    std::unordered_map<int32_t, int64_t> exec_cost;
+    std::multimap<int64_t, int64_t> pending_dl;
+    int64_t running_cost = { 0 };
+    int64_t running_start = { 0 };
+    int32_t loaded_oid = { -1 };
+    cDeadlineStats dl_stats;
+
+    int64_t estimateCost(int32_t oid);
+    void updateCost(std::unordered_map<int32_t, int64_t>& cost, int32_t oid, int64_t sample);
+
 	/* Bitstream memory */
 	std::unordered_map<void*, mappedVal> mapped_pages;
 
@@ -148,7 +183,7 @@ public:
 	 * @brief Ctor, Dtor
 	 * 
 	 */
-	cSched(int32_t vfid, bool priority = true, bool reorder = true);
+	cSched(int32_t vfid, bool priority = true, bool reorder = true, bool edf = false);
 	~cSched();
 
     /**
@@ -173,16 +208,35 @@ public:
 	void removeBitstream(int32_t oid);	
 	bool checkBitstream(int32_t oid); 
 
+    /**
+     * @brief Deadline admission, checks whether a task can still meet its deadline.
+     * Accounts for the rest of the running task, the queued tasks with an earlier or equal deadline
+     * (these run first), the reconfiguration and the execution cost of the operator.
+     * 
+     * @param oid - operator id
+     * @param deadline - absolute deadline [ns]
+     * @return true if admitted, refused tasks are counted
+     */
+    bool admit(int32_t oid, int64_t deadline);
+
     /**
      * @brief Schedule operation
      * 
      * @param cpid - Coyote id
      * @param oid - operator id
      * @param priority - task priority
+     * @param deadline - absolute deadline [ns], 0 for none
      */
-    void pLock(int32_t cpid, int32_t oid, uint32_t priority);
+    void pLock(int32_t cpid, int32_t oid, uint32_t priority, int64_t deadline = 0);
     void pUnlock(int32_t cpid);
 
+    /**
+     * @brief Deadline statistics
+     * 
+     */
+    inline auto isEdf() const { return edf; }
+    cDeadlineStats getDeadlineStats();
+
 };
 
 } /* namespace fpga */
@@ -25,17 +25,76 @@
 #include <wait.h>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <condition_variable>
 #include <any>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 
 #include "cSched.hpp"
 #include "cThread.hpp"
+#include "cRing.hpp"
+#include "cStats.hpp"
 
 using namespace std;
 
 namespace fpga {
 
+/**
+ * @brief Client connection state
+ * 
+ * Each connection walks through these states while its request stream is parsed.
+ * A client first registers its pid, afterwards requests (tid, opcode), (size), (payload) are pipelined.
+ * 
+ */
+enum class ConnState : uint8_t {
+    REGISTER = 0,
+    HEADER = 1,
+    PAYLOAD_SIZE = 2,
+    PAYLOAD = 3
+};
+
+/**
+ * @brief Client connection
+ * 
+ * Per-client state machine, holds partially received requests and not yet sent completions.
+ * 
+ */
+struct cConn {
+    int connfd = { -1 };
+    pid_t rpid = { 0 };
+    ConnState state = { ConnState::REGISTER };
+
+    // Current request
+    int32_t tid = { 0 };
+    int32_t opcode = { 0 };
+    int32_t msg_size = { 0 };
+    int64_t deadline = { 0 };
+    bool invalid = { false }; // payload is skipped, completed with cmplInvalid
+
+    // Receive buffer, holds bytes not yet consumed by the state machine
+    char rx_buf[recvBuffSize];
+    uint32_t rx_len = { 0 };
+
+    // Transmit buffer, holds completions the socket could not take yet
+    std::vector<char> tx_buf;
+    uint32_t tx_offs = { 0 };
+    bool tx_armed = { false };
+
+    // Shared memory transport - rings and the client data region (client virtual addresses)
+    cShmRings *rings = { nullptr };
+    uint64_t shm_vaddr = { 0 };
+    uint64_t shm_len = { 0 };
+    std::atomic<bool> shm_polled = { false };
+    std::vector<cCqe> cq_backlog;
+
+    // Execution
+    std::unique_ptr<cThread> cthread;
+};
+
 /**
  * @brief Coyote service
  * 
@@ -54,41 +113,68 @@ private:
     int32_t vfid = { -1 };
     string service_id;
 
-    // Threads for request and response: Both actual threads and booleans to store interaction with them
+    // Event loop thread: Both the actual thread and a boolean to store interaction with it
     bool run_req = { false };
     thread thread_req;
-    bool run_rsp = { false };
-    thread thread_rsp;
 
     // Connection - Sockets. Socket name, file descriptor and current ID. 
     string socket_name;
-    int sockfd;
+    int sockfd = { -1 };
     int curr_id = { 0 };
 
-    // Clients - map of clients (which are cThreads via cProcesses) and a mutex to make their accesses safe
-    mutex mtx_cli;
-    unordered_map<int, std::unique_ptr<cThread>> clients;
+    // Event loop - epoll instance and an eventfd used to wake the loop (completions, termination)
+    int epfd = { -1 };
+    int evfd = { -1 };
 
-    // Task map - holds functions that return int32 and take a cProcess and a vector as input
-    unordered_map<int, std::function<int32_t(cProcess*, std::vector<uint64_t>)>> task_map;
+    // Clients - map of client connections (each holds a cThread via a cProcess), only touched by the event loop
+    unordered_map<int, std::unique_ptr<cConn>> clients;
 
-    // Constructor of the class - takes vfid, priority and reorder 
-    cService(int32_t vfid, bool priority = true, bool reorder = true);
+    // Completions - connections with completions pending, filled by the cThreads
+    mutex mtx_cmpl;
+    vector<int> cmpl_conns;
+
+    // Shared memory clients - polled by the event loop
+    unordered_set<int> shm_conns;
+
+    // Task map - holds functions that return int32 and take a cProcess and the task arguments as input.
+    // Scheduled tasks reference the entries, these are never copied.
+    unordered_map<int, cTaskHandler> task_map;
+
+    // Statistics - scheduler deadline counters, exported as Prometheus text if a file is set
+    string stats_path;
+    std::unique_ptr<cStats> cstats;
+
+    // Constructor of the class - takes vfid, priority, reorder and edf (earliest deadline first)
+    cService(int32_t vfid, bool priority = true, bool reorder = true, bool edf = false);
 
     // Actually starts the daemon / cService
     void daemon_init();
 
-    // Inits the socket for networking connections 
+    // Inits the socket for networking connections and the epoll instance
     void socket_init();
 
-    // Accepts incoming connections via the socket 
+    // Accepts all pending incoming connections via the socket 
     void accept_connection();
 
+    // Closes a client connection and releases its cThread
+    void close_connection(int connfd);
+
     // Signal handlers - sig_handler is just the conformal wrapper for my_handler
     static void sig_handler(int signum);
     void my_handler(int signum);
 
-    // Functions to request and close processes / threads. 
+    // Per-connection I/O - drain the socket and run the request state machine, flush pending completions
+    bool recv_requests(cConn *conn);
+    bool parse_requests(cConn *conn);
+    bool send_responses(cConn *conn);
+    void arm_output(cConn *conn, bool arm);
+
+    // Shared memory transport - registration, teardown and ring polling
+    int32_t register_shm(cConn *conn, const cTaskArgs& msg);
+    void release_shm(cConn *conn);
+    bool process_rings();
+
+    // Event loop and completion handling
     void process_requests();
     void process_responses();
 
@@ -102,9 +188,9 @@ public:
      * @param f_rsp - Process responses
      */
 
-    static cService* getInstance(int32_t vfid, bool priority = true, bool reorder = true) {
+    static cService* getInstance(int32_t vfid, bool priority = true, bool reorder = true, bool edf = false) {
         if(cservice == nullptr) 
-            cservice = new cService(vfid, priority, reorder);
+            cservice = new cService(vfid, priority, reorder, edf);
         return cservice;
     }
 
@@ -116,10 +202,20 @@ public:
      */
     void run();
 
+    /**
+     * @brief Scheduler statistics (deadlines met, missed, refused), sampled while the service runs
+     * 
+     * @param path - Prometheus text file, absolute (the daemon runs in /)
+     */
+    void setStatsFile(const std::string& path) { stats_path = path; }
+
     /**
      * @brief Add an arbitrary user task
      * 
      */
+    void addTask(int32_t oid, cTaskHandler task);
+
+    // Legacy task signature, copies the arguments into a vector on each invocation
     void addTask(int32_t oid, std::function<int32_t(cProcess*, std::vector<uint64_t>)> task);
     
     // Remove Task from the service, identified by oid
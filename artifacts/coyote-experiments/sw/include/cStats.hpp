@@ -0,0 +1,143 @@
+#pragma once
+
+#include "cDefs.hpp"
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include "cProcess.hpp"
+#include "cSched.hpp"
+
+namespace fpga {
+
+/* Single counter series */
+struct cCounter {
+    std::string name; // prometheus metric name
+    std::string labels; // k="v",...
+    uint64_t value = { 0 };
+    double rate = { 0.0 }; // per second, counters only
+    uint64_t delta = { 0 };
+    bool gauge = { false };
+};
+
+/* Sample, series keyed by name{labels} */
+struct cStatsSample {
+    int64_t ts_ns = { 0 };
+    std::map<std::string, cCounter> counters;
+};
+
+/**
+ * @brief Shared memory snapshot, seqlock protected (odd seq - write in progress)
+ *
+ */
+struct cStatsShm {
+    std::atomic<uint64_t> seq;
+    int64_t ts_ns;
+    uint32_t n_entries;
+    struct {
+        char series[statsNameSize];
+        uint64_t value;
+        double rate;
+    } entries[statsMaxEntries];
+};
+
+/**
+ * @brief Coyote counter sampling
+ *
+ * Samples the driver sysfs statistics (net, xdma), if a cProcess is attached its DMA completion
+ * and RDMA ack counters and, if a cSched is attached, its deadline statistics at a fixed interval. Deltas and rates are computed
+ * between consecutive samples, the latest sample is exported as Prometheus text or
+ * into a shared memory snapshot.
+ *
+ */
+class cStats {
+private:
+    /* Sources */
+    std::string sysfs_dir;
+    cProcess *cproc = { nullptr };
+    cSched *csched = { nullptr };
+
+    /* Sampling */
+    std::chrono::milliseconds interval;
+    thread s_thread;
+    bool run = { false };
+    mutex mtx_run;
+    condition_variable cv_run;
+
+    /* Samples */
+    mutex mtx_sample;
+    cStatsSample curr;
+    uint64_t n_samples = { 0 };
+
+    /* Exports */
+    std::string prom_path;
+    std::string shm_name;
+    cStatsShm *shm = { nullptr };
+
+    void processRequests();
+    void exportOut(const cStatsSample& sample);
+
+public:
+    cStats(std::chrono::milliseconds interval = statsDefInterval, cProcess *cproc = nullptr, std::string sysfs_dir = statsSysfsDir);
+    ~cStats();
+
+    /**
+     * @brief Parse a sysfs statistics dump (nstats, xstats), canned dumps can be passed for testing
+     *
+     * @param text - sysfs file content
+     * @param prefix - metric name prefix (e.g. coyote_net)
+     * @param labels - labels of every series (e.g. qsfp="0")
+     * @param sample - parsed counters are added here
+     * @return number of counters parsed
+     */
+    static uint32_t parseSysfs(const std::string& text, const std::string& prefix, const std::string& labels, cStatsSample& sample);
+
+    /**
+     * @brief Deltas and rates of sample against prev, 32 bit counter wrap-around is accounted for
+     *
+     */
+    static void computeRates(const cStatsSample& prev, cStatsSample& sample);
+
+    /**
+     * @brief Prometheus text exposition of a sample
+     *
+     */
+    static std::string toPrometheus(const cStatsSample& sample);
+
+    /**
+     * @brief Take a single sample now
+     *
+     */
+    cStatsSample sample();
+
+    /**
+     * @brief Periodic sampling
+     *
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Exports, refreshed on every sample
+     *
+     * @param path - Prometheus text file (e.g. for the node exporter textfile collector), replaced atomically
+     * @param name - shared memory object name
+     */
+    void setPrometheusFile(const std::string& path) { prom_path = path; }
+    void setSched(cSched *csched) { this->csched = csched; }
+    void setShm(const std::string& name);
+
+    // Getters
+    cStatsSample getLast();
+    std::string getPrometheus() { return toPrometheus(getLast()); }
+    inline auto getNumSamples() const { return n_samples; }
+};
+
+}
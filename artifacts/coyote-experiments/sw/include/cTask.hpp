@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cDefs.hpp"
+#include "sLock.hpp"
 
 #include <tuple>
 #include <type_traits>
@@ -8,6 +9,9 @@
 #include <iostream>
 #include <cstddef>
 #include <utility>
+#include <functional>
+#include <vector>
+#include <assert.h>
 
 namespace fpga {
 
@@ -22,16 +26,20 @@ class bTask {
     int32_t tid;
     int32_t oid;
     uint32_t priority;
+    int64_t deadline; // absolute [ns], 0 for none
 
 public:
-    bTask(int32_t tid, int32_t oid, uint32_t priority) : tid(tid), oid(oid), priority(priority) {}
+    bTask(int32_t tid, int32_t oid, uint32_t priority, int64_t deadline = 0) : tid(tid), oid(oid), priority(priority), deadline(deadline) {}
+    virtual ~bTask() = default;
 
     virtual int32_t run(cProcess* cproc) = 0;    
 
-    // Getters
+    // Getters, setters
     inline auto getTid() const { return tid; }
     inline auto getOid() const { return oid; }
     inline auto getPriority() const { return priority; }
+    inline auto getDeadline() const { return deadline; }
+    inline auto setDeadline(int64_t deadline) { this->deadline = deadline; }
 };
 
 /**
@@ -51,7 +59,7 @@ class cTask : public bTask {
 public:
 
     explicit cTask(int32_t tid, int32_t oid, uint32_t priority, Func f, Args... args) 
-        : f(f), args{args...}, bTask(tid, oid, priority) {}
+        : bTask(tid, oid, priority), f(f), args{args...} {}
 
     virtual int32_t run(cProcess* cproc) final {
         int32_t tmp = apply(f, std::tuple_cat(std::make_tuple(cproc), args));
@@ -59,4 +67,99 @@ public:
     }
 };
 
+/**
+ * @brief Task arguments
+ * 
+ * Fixed size, inline argument array. Indexed just like the argument vector.
+ * 
+ */
+struct cTaskArgs {
+    uint32_t n_args = { 0 };
+    uint64_t args[maxTaskArgs];
+
+    inline uint64_t operator[](uint32_t i) const { return args[i]; }
+    inline auto size() const { return n_args; }
+    inline auto data() const { return args; }
+};
+
+/* Registered service task handler */
+using cTaskHandler = std::function<int32_t(cProcess*, const cTaskArgs&)>;
+
+/**
+ * @brief Task pool
+ * 
+ * Fixed size task descriptors, recycled through a free list.
+ * Descriptors are carved out of slabs, slabs are kept for the lifetime of the process.
+ * 
+ */
+template<typename T>
+class cTaskPool {
+    static constexpr size_t entrySize = ((sizeof(T) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+
+    sLock lck;
+    void *free_list = { nullptr };
+    std::vector<std::unique_ptr<char[]>> slabs;
+
+    void grow() {
+        slabs.emplace_back(new char[taskPoolSlabSize * entrySize]);
+        char *slab = slabs.back().get();
+        for(int i = 0; i < taskPoolSlabSize; i++) {
+            *reinterpret_cast<void**>(slab + i * entrySize) = free_list;
+            free_list = slab + i * entrySize;
+        }
+    }
+
+public:
+    static cTaskPool& getInstance() {
+        static cTaskPool pool;
+        return pool;
+    }
+
+    void* alloc() {
+        lck.lock();
+        if(free_list == nullptr) 
+            grow();
+        void *entry = free_list;
+        free_list = *reinterpret_cast<void**>(entry);
+        lck.unlock();
+        return entry;
+    }
+
+    void release(void *entry) {
+        lck.lock();
+        *reinterpret_cast<void**>(entry) = free_list;
+        free_list = entry;
+        lck.unlock();
+    }
+};
+
+/**
+ * @brief Coyote service task
+ * 
+ * Allocation free task used by the cService. Arguments are held inline,
+ * the handler is referenced (registered in the service), not copied.
+ * Descriptors come from the task pool and go back to it on delete,
+ * the pool slots are sized for this class only, hence final.
+ * 
+ */
+class cSvcTask final : public bTask {
+    const cTaskHandler *f;
+    cTaskArgs args;
+
+public:
+    explicit cSvcTask(int32_t tid, int32_t oid, uint32_t priority, int64_t deadline, const cTaskHandler *f, const cTaskArgs& args) 
+        : bTask(tid, oid, priority, deadline), f(f), args(args) {}
+
+    virtual int32_t run(cProcess* cproc) final {
+        return (*f)(cproc, args);
+    }
+
+    static void* operator new(size_t size) {
+        assert(size == sizeof(cSvcTask));
+        (void)size;
+        return cTaskPool<cSvcTask>::getInstance().alloc();
+    }
+    static void operator delete(void *ptr) { cTaskPool<cSvcTask>::getInstance().release(ptr); }
+};
+
 }
@@ -11,6 +11,7 @@
 #include <condition_variable>
 #include <limits>
 #include <unordered_map>
+#include <functional>
 
 #include "cProcess.hpp"
 #include "cTask.hpp"
@@ -50,6 +51,7 @@ private:
     mutex mtx_cmpl;
     queue<cmplEv> cmpl_queue;
     std::atomic<int32_t> cnt_cmpl = { 0 };
+    std::function<void()> cmpl_notify;
 
     void startThread();
     void processRequests();
@@ -79,6 +81,13 @@ public:
      */
     cmplEv getCompletedNext();
 
+    /**
+     * @brief Completion notification, invoked from the cThread each time a task completes
+     * 
+     * @param notify - callback, must not block
+     */
+    inline auto setCompletionNotify(std::function<void()> notify) { cmpl_notify = notify; }
+
     /**
      * @brief Schedule a task
      * 
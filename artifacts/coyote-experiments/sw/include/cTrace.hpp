@@ -0,0 +1,157 @@
+#pragma once
+
+#include "cDefs.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace fpga {
+
+/**
+ * @brief Traced events
+ *
+ */
+enum class TraceEv : uint32_t {
+    INVOKE = 0,         // cProcess::invoke, arg: oper
+    POST_CMD = 1,       // cProcess::postCmd
+    LOCK_WAIT = 2,      // device lock acquisition
+    CREDIT_STALL = 3,   // outstanding command limit reached, arg: 0 rd, 1 wr, 2 rdma
+    CMPL_POLL = 4,      // polling for completion, arg: oper
+    RECONFIG = 5,       // cSched reconfiguration, arg: oid
+    SCHED_WAIT = 6,     // cSched vFPGA lock wait, arg: oid
+    TASK_RUN = 7,       // cThread task dispatch, arg: tid
+    SVC_RECV = 8,       // cService socket requests, arg: connfd
+    SVC_SUBMIT = 9,     // cService task submission, arg: tid
+    SVC_CMPL = 10,      // cService completions, arg: connfd (socket) or tid (rings)
+    N_EVENTS
+};
+
+constexpr const char* traceEvName[] = {
+    "invoke", "post_cmd", "lock_wait", "credit_stall", "cmpl_poll", "reconfig",
+    "sched_wait", "task_run", "svc_recv", "svc_submit", "svc_cmpl"
+};
+
+static_assert(sizeof(traceEvName) / sizeof(traceEvName[0]) == static_cast<uint32_t>(TraceEv::N_EVENTS), "Trace event names");
+
+/* Trace record, complete event (instant if begin == end) */
+struct cTraceRec {
+    uint64_t begin;
+    uint64_t end;
+    TraceEv ev;
+    int32_t arg;
+};
+
+/**
+ * @brief Per-thread trace ring
+ *
+ * Single writer, flight recorder - keeps the latest traceRingSize events.
+ * Readers only run on dump, records written concurrently may be torn.
+ *
+ */
+struct cTraceRing {
+    std::atomic<uint64_t> tail = { 0 };
+    int32_t tid;
+    std::string name;
+    cTraceRec recs[traceRingSize];
+
+    inline void push(uint64_t begin, uint64_t end, TraceEv ev, int32_t arg) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        recs[t & (traceRingSize - 1)] = { begin, end, ev, arg };
+        tail.store(t + 1, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Trace registry
+ *
+ * Rings are registered on the first event of a thread and outlive it, so the
+ * trace can be dumped after the threads exit. Dumped to COYOTE_TRACE_OUT on exit if set.
+ *
+ */
+class cTrace {
+    std::mutex mtx;
+    std::vector<std::shared_ptr<cTraceRing>> rings;
+
+    // Clock reference, TSC to us on dump
+    uint64_t tsc_ref;
+    int64_t ns_ref;
+
+    cTrace();
+    ~cTrace();
+
+public:
+    static cTrace& getInstance() {
+        static cTrace ctrace;
+        return ctrace;
+    }
+
+    static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Thread local ring
+    static inline cTraceRing* ring() {
+        thread_local cTraceRing *tl_ring = getInstance().registerThread();
+        return tl_ring;
+    }
+
+    cTraceRing* registerThread();
+    void setThreadName(const std::string& name);
+
+    /**
+     * @brief Dump all rings as Chrome trace / Perfetto JSON
+     *
+     * @param path - output file
+     */
+    void dump(const std::string& path);
+};
+
+/* Scoped complete event */
+class cTraceScope {
+    cTraceRing *ring = { nullptr };
+    uint64_t begin;
+    TraceEv ev;
+    int32_t arg;
+
+public:
+    cTraceScope(TraceEv ev, int32_t arg = 0, bool enabled = true) : ev(ev), arg(arg) {
+        // Ring first, registration is not accounted to the event
+        if(enabled) {
+            ring = cTrace::ring();
+            begin = cTrace::now();
+        }
+    }
+    ~cTraceScope() {
+        if(ring) ring->push(begin, cTrace::now(), ev, arg);
+    }
+};
+
+}
+
+// ======-------------------------------------------------------------------------------
+// Macros
+// ======-------------------------------------------------------------------------------
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+#ifdef EN_TRACE
+#define TRACE_SCOPE(ev, arg) fpga::cTraceScope TRACE_CAT(trace_scope_, __COUNTER__)(ev, static_cast<int32_t>(arg))
+#define TRACE_SCOPE_IF(cond, ev, arg) fpga::cTraceScope TRACE_CAT(trace_scope_, __COUNTER__)(ev, static_cast<int32_t>(arg), cond)
+#define TRACE_INSTANT(ev, arg) do { uint64_t ts = fpga::cTrace::now(); fpga::cTrace::ring()->push(ts, ts, ev, static_cast<int32_t>(arg)); } while ( false )
+#define TRACE_THREAD_NAME(name) do { fpga::cTrace::getInstance().setThreadName(name); } while ( false )
+#define TRACE_DUMP(path) do { fpga::cTrace::getInstance().dump(path); } while ( false )
+#else
+#define TRACE_SCOPE(ev, arg) do { } while ( false )
+#define TRACE_SCOPE_IF(cond, ev, arg) do { } while ( false )
+#define TRACE_INSTANT(ev, arg) do { } while ( false )
+#define TRACE_THREAD_NAME(name) do { } while ( false )
+#define TRACE_DUMP(path) do { } while ( false )
+#endif
@@ -11,10 +11,16 @@
 
 namespace fpga {
 
+// Layout version of the queue exchanged by ibvQpMap (0x4351 | version), bumped with every layout change
+constexpr auto const ibvQVersion = 0x43510002;
+
 /**
  * Single queue wrapper
  */
 struct ibvQ {
+    // Exchange layout, checked by the remote side
+    uint32_t version = { ibvQVersion };
+
     // Node
     uint32_t ip_addr;
 
@@ -30,6 +36,9 @@ struct ibvQ {
     // Global ID
     char gid[33] = { 0 };
 
+    // Largest path MTU in bytes (power of 2, 256 - 4096), 0 - the PMTU of the stack
+    uint32_t pmtu = { 0 };
+
     uint32_t gidToUint(int idx);
     void uintToGid(int idx, uint32_t ip_addr);
 
@@ -46,10 +55,16 @@ public:
     uint32_t id;
     ibvQ local;
     ibvQ remote;
+    DpiMode dpi_mode = { DpiMode::ENFORCE }; // set before the context is written
+    uint8_t dpi_threshold = { 0 }; // rejected messages until the QP is quarantined, 0 - never
+    uint16_t rd_window = { 0 }; // outstanding READs, 0 - maximum of the stack (N_RDMA_RD_OUTSTANDING)
 
     ibvQp() : id(curr_id++) {}
     inline uint32_t getId() { return id; }
 
+    // Path MTU of both ends, context encoding 1 - 256 .. 5 - 4096, 0 - the PMTU of the stack
+    uint8_t getPmtu();
+
     void print() {
         std::cout << "Queue Pair: "
                   << "id: " << id << std::endl;
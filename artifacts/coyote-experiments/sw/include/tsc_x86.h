@@ -91,5 +91,12 @@ static myInt64 stop_tsc(myInt64 start) {
   return COUNTER_VAL(end) - start;
 }
 
+/* RDTSCP waits for the preceding instructions, lighter than the CPUID fence per sample */
+static inline myInt64 rdtscp_tsc(void) {
+  INT32 lo, hi, aux;
+  ASM VOLATILE("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux));
+  return ((myInt64)hi << 32) | lo;
+}
+
 #endif
 
@@ -46,8 +46,10 @@ cProcess::cProcess(int32_t vfid, pid_t pid, cSched *csched) : vfid(vfid), pid(pi
 	tmp[0] = pid;
 	
 	// register pid
-	if(ioctl(fd, IOCTL_REGISTER_PID, &tmp))
+	if(ioctl(fd, IOCTL_REGISTER_PID, &tmp)) {
+		close(fd);
 		throw std::runtime_error("ioctl_register_pid() failed");
+	}
 
 	DBG3("cProcess:  registered pid: " << pid << ", cpid: " << tmp[1]);
 	cpid = tmp[1];
@@ -211,6 +213,69 @@ void cProcess::userMap(void *vaddr, uint32_t len) {
 	DBG3("Explicit map user mem at: " << std::hex << reinterpret_cast<uint64_t>(vaddr) << std::dec);
 }
 
+/**
+ * @brief Vectored TLB mapping
+ * 
+ * @param ranges - user space ranges, status set per range
+ * @return uint32_t - number of ranges mapped
+ */
+uint32_t cProcess::userMap(std::vector<csMapRange>& ranges) {
+	static_assert(sizeof(csMapRange) == 3 * sizeof(uint64_t), "Map range layout");
+
+	// The driver maps a capped number of pages per range, the rest is issued again
+	std::vector<csMapRange> pending(ranges);
+	std::vector<size_t> pending_idx(ranges.size());
+	for(size_t i = 0; i < ranges.size(); i++) {
+		pending_idx[i] = i;
+		ranges[i].status = 0;
+	}
+
+	uint64_t tmp[3];
+	while(!pending.empty()) {
+		tmp[0] = reinterpret_cast<uint64_t>(pending.data());
+		tmp[1] = static_cast<uint64_t>(pending.size());
+		tmp[2] = static_cast<uint64_t>(cpid);
+
+		if(ioctl(fd, IOCTL_MAP_USER_VEC, &tmp))
+			throw std::runtime_error("ioctl_map_user_vec() failed");
+
+		std::vector<csMapRange> next;
+		std::vector<size_t> next_idx;
+		for(size_t i = 0; i < pending.size(); i++) {
+			auto& chunk = pending[i];
+			auto& range = ranges[pending_idx[i]];
+
+			if(chunk.status > 0) {
+				// Each mapped chunk is released by its own vaddr
+				mapped_upages.emplace(chunk.vaddr);
+				range.status += chunk.status;
+
+				if(static_cast<uint64_t>(chunk.status) < chunk.len) {
+					csMapRange rest;
+					rest.vaddr = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(chunk.vaddr) + chunk.status);
+					rest.len = chunk.len - chunk.status;
+					next.push_back(rest);
+					next_idx.push_back(pending_idx[i]);
+				}
+			} else if(range.status == 0) {
+				range.status = chunk.status;
+			}
+		}
+
+		pending.swap(next);
+		pending_idx.swap(next_idx);
+	}
+
+	uint32_t n_mapped = 0;
+	for(auto& range : ranges) {
+		if(range.status > 0)
+			n_mapped++;
+	}
+
+	DBG3("Explicit vectored map user mem, mapped " << n_mapped << " out of " << ranges.size() << " ranges");
+	return n_mapped;
+}
+
 /**
  * @brief TLB unmap
  * 
@@ -358,9 +423,21 @@ void cProcess::freeMem(void* vaddr) {
  * @param priority - priority
  */
 void cProcess::pLock(int32_t oid, uint32_t priority) 
+{
+    pLock(oid, priority, deadline);
+}
+
+/**
+ * @brief Obtain vFPGA lock with an explicit deadline
+ * 
+ * @param oid - operator id
+ * @param priority - priority
+ * @param deadline - absolute deadline [ns], 0 for none
+ */
+void cProcess::pLock(int32_t oid, uint32_t priority, int64_t deadline) 
 {
     if(csched != nullptr) {
-        csched->pLock(cpid, oid, priority); 
+        csched->pLock(cpid, oid, priority, deadline); 
     } else {
         plock.lock();
     }
@@ -375,6 +452,14 @@ void cProcess::pUnlock()
     }
 }
 
+bool cProcess::admit(int32_t oid, int64_t deadline)
+{
+    if(csched != nullptr) {
+        return csched->admit(oid, deadline);
+    } 
+    return true;
+}
+
 // ======-------------------------------------------------------------------------------
 // Bulk transfers
 // ======-------------------------------------------------------------------------------
@@ -387,12 +472,17 @@ void cProcess::pUnlock()
 void cProcess::invoke(const csInvokeAll& cs_invoke) {
 	if(isSync(cs_invoke.oper)) if(!fcnfg.en_mem) return;
 	if(cs_invoke.oper == CoyoteOper::NOOP) return;
+	TRACE_SCOPE(TraceEv::INVOKE, cs_invoke.oper);
 
 	// Lock
-	dlock.lock();
+	{
+		TRACE_SCOPE(TraceEv::LOCK_WAIT, 0);
+		dlock.lock();
+	}
 	
 	// Check outstanding read
 	if(isRead(cs_invoke.oper)) {
+		TRACE_SCOPE_IF(rd_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr), TraceEv::CREDIT_STALL, 0);
 		while (rd_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr)) {
 #ifdef EN_AVX
 			rd_cmd_cnt = fcnfg.en_avx ? LOW_16(_mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_REG)], 0x0)) :
@@ -407,6 +497,7 @@ void cProcess::invoke(const csInvokeAll& cs_invoke) {
 
 	// Check outstanding write
 	if(isWrite(cs_invoke.oper)) {
+		TRACE_SCOPE_IF(wr_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr), TraceEv::CREDIT_STALL, 1);
 		while (wr_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr)) {
 #ifdef EN_AVX
 			wr_cmd_cnt = fcnfg.en_avx ? HIGH_16(_mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_REG)], 0x0)) : 
@@ -473,6 +564,7 @@ void cProcess::invoke(const csInvokeAll& cs_invoke) {
 
 	// Polling
 	if(cs_invoke.poll) {
+		TRACE_SCOPE(TraceEv::CMPL_POLL, cs_invoke.oper);
 		while(!checkCompleted(cs_invoke.oper)) nanosleep((const struct timespec[]){{0, 100L}}, NULL);
 	}
 }
@@ -720,21 +812,28 @@ void cProcess::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64
 	// std::cout << "-- cProcess.cpp: cmd_fifo_depth: " << cmd_fifo_depth << std::endl; 
 	// std::cout << "-- cProcess.cpp: cmd_fifo_thr: " << cmd_fifo_thr << std::endl;
 	// std::cout << "-- cProcess.cpp: Trying to obtain a lock." << std::endl; 
-    dlock.lock();
+	TRACE_SCOPE(TraceEv::POST_CMD, 0);
+	{
+		TRACE_SCOPE(TraceEv::LOCK_WAIT, 1);
+		dlock.lock();
+	}
 	// std::cout << "-- cProcess.cpp: Obtained a lock." << std::endl;
 
     
     // Check outstanding
-    while (rdma_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr)) {
-		// std::cout << "-- cProcess.cpp: Need to process outstanding RDMA commands first." << std::endl;
+    {
+        TRACE_SCOPE_IF(rdma_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr), TraceEv::CREDIT_STALL, 2);
+        while (rdma_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr)) {
+    		// std::cout << "-- cProcess.cpp: Need to process outstanding RDMA commands first." << std::endl;
 #ifdef EN_AVX
-        rdma_cmd_cnt = fcnfg.en_avx ? _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::RDMA_STAT_REG) + fcnfg.qsfp_offs], 0x0) : 
-                                      cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::RDMA_STAT_CMD_USED_REG) + fcnfg.qsfp_offs];
+            rdma_cmd_cnt = fcnfg.en_avx ? _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::RDMA_STAT_REG) + fcnfg.qsfp_offs], 0x0) : 
+                                          cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::RDMA_STAT_CMD_USED_REG) + fcnfg.qsfp_offs];
 #else
-        rdma_cmd_cnt = cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::RDMA_STAT_CMD_USED_REG) + fcnfg.qsfp_offs];
+            rdma_cmd_cnt = cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::RDMA_STAT_CMD_USED_REG) + fcnfg.qsfp_offs];
 #endif
-        if (rdma_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr))
-            nanosleep((const struct timespec[]){{0, 100L}}, NULL);
+            if (rdma_cmd_cnt > (cmd_fifo_depth - cmd_fifo_thr))
+                nanosleep((const struct timespec[]){{0, 100L}}, NULL);
+        }
     }
 
     // Send
@@ -787,7 +886,7 @@ void cProcess::doArpLookup(uint32_t ip_addr) {
 }
 
 /**
- * @brief Write queue pair context (including Local QPN, rkey, Local / Remote PSN, Virtual Address)
+ * @brief Write queue pair context (including Local QPN, rkey, Local / Remote PSN, Virtual Address, DPI mode, READ window, path MTU)
  * 
  * @param qp - queue pair struct
  */
@@ -797,14 +896,18 @@ void cProcess::writeQpContext(ibvQp *qp) {
 
 		// New register layout:
 		// - offs[0] = fcnfg.qfsp
-		// - offs[1] = local.qpn
+		// - offs[1] = local.qpn & dpi mode & dpi reject threshold & read window & path MTU
 		// - offs[2] = local.psn & remote.psn
 		// - offs[3] = remote.vaddr (rkey stays there for historical reasons)
 		// - offs[4] = remote.rkey
 
 		offs[0] = fcnfg.qsfp;
 
-		offs[1] = (static_cast<uint64_t>(qp->local.qpn) & 0x3ff) << qpContextQpnOffs;
+		offs[1] = ((static_cast<uint64_t>(qp->local.qpn) & 0x3ff) << qpContextQpnOffs) |
+				  ((static_cast<uint64_t>(qp->dpi_mode) & 0x3) << qpContextDpiOffs) |
+				  ((static_cast<uint64_t>(qp->dpi_threshold) & 0xff) << qpContextDpiThrOffs) |
+				  ((static_cast<uint64_t>(qp->rd_window) & 0x1ff) << qpContextRdWndOffs) |
+				  ((static_cast<uint64_t>(qp->getPmtu()) & 0x7) << qpContextPmtuOffs);
 
 		offs[2] = ((static_cast<uint64_t>(qp->local.psn) & 0xffffff) << qpContextLpsnOffs) | 
 				  ((static_cast<uint64_t>(qp->remote.psn) & 0xffffff) << qpContextRpsnOffs);
@@ -959,6 +1062,16 @@ void cProcess::netDrop(bool clr, bool dir, uint32_t packet_id) {
 			throw std::runtime_error("ioctl_net_drop() failed");
 }
 
+void cProcess::setDcqcn(uint64_t cnfg) {
+	uint64_t tmp[2];
+
+	tmp[0] = fcnfg.qsfp;
+	tmp[1] = cnfg;
+
+	if(ioctl(fd, IOCTL_SET_DCQCN, &tmp))
+		throw std::runtime_error("ioctl_set_dcqcn() failed");
+}
+
 // ======-------------------------------------------------------------------------------
 // DEBUG
 // ======-------------------------------------------------------------------------------
@@ -27,12 +27,14 @@ namespace fpga
 	 *
 	 * @param vfid - vFPGA id
 	 * @param priority - 
+	 * @param edf - earliest deadline first ordering with admission control
 	 */
-	cSched::cSched(int32_t vfid, bool priority, bool reorder)
-		: vfid(vfid), priority(priority), reorder(reorder),
-		  mlock(open_or_create, "vpga_mtx_mem_" + vfid),
+	cSched::cSched(int32_t vfid, bool priority, bool reorder, bool edf)
+		: vfid(vfid),
 		  plock(open_or_create, "vpga_mtx_user_" + vfid),
-		  request_queue(taskCmprSched(priority, reorder))
+		  mlock(open_or_create, "vpga_mtx_mem_" + vfid),
+		  priority(priority), reorder(reorder), edf(edf),
+		  request_queue(taskCmprSched(priority, reorder, edf))
 	{
 		DBG3("(DBG!) Acquiring cSched: " << vfid);
 		// Open
@@ -105,7 +107,8 @@ namespace fpga
 		unique_lock<mutex> lck_r(mtx_rcnfg);
 		run = true;
 		bool recIssued = false;
-		int32_t curr_oid = -1;
+		int64_t t_start;
+		TRACE_THREAD_NAME("cSched");
 		cv_queue.notify_one();
 		lck_q.unlock();
 		lck_r.unlock();
@@ -117,8 +120,22 @@ namespace fpga
 			if (!request_queue.empty())
 			{
 				// Grab next reconfig request
-				auto curr_req = std::move(const_cast<std::unique_ptr<cLoad> &>(request_queue.top()));
+				cLoad curr_req = request_queue.top();
 				request_queue.pop();
+				if (curr_req.deadline)
+				{
+					auto range = pending_dl.equal_range(curr_req.deadline);
+					for (auto it = range.first; it != range.second; it++)
+					{
+						if (it->second == curr_req.cost)
+						{
+							pending_dl.erase(it);
+							break;
+						}
+					}
+				}
+				running_cost = curr_req.deadline ? curr_req.cost : estimateCost(curr_req.oid);
+				running_start = deadlineNow();
 				lck_q.unlock();
 
 				// Obtain vFPGA
@@ -127,11 +144,16 @@ namespace fpga
 				// Check whether reconfiguration is needed
 				if (isReconfigurable())
 				{
-					if (curr_oid != curr_req->oid)
+					if (loaded_oid != curr_req.oid)
 					{
-						reconfigure(curr_req->oid);
+						t_start = deadlineNow();
+						reconfigure(curr_req.oid);
 						recIssued = true;
-						curr_oid = curr_req->oid;
+
+						lck_q.lock();
+						updateCost(rcnfg_cost, curr_req.oid, deadlineNow() - t_start);
+						loaded_oid = curr_req.oid;
+						lck_q.unlock();
 					}
 					else
 					{
@@ -140,26 +162,52 @@ namespace fpga
 				}
 
 				// Notify
+				t_start = deadlineNow();
 				lck_r.lock();
-				curr_cpid = curr_req->cpid;
+				curr_cpid = curr_req.cpid;
 				curr_run = true;
 				lck_r.unlock();
 				cv_rcnfg.notify_all();
 
 				// Wait for task completion
 				unique_lock<mutex> lck_c(mtx_cmplt);
-				if (cv_cmplt.wait_for(lck_c, cmplTimeout, [=]
-									  { return curr_run == false; }))
+				bool cmplt = cv_cmplt.wait_for(lck_c, cmplTimeout, [=]
+									  { return curr_run == false; });
+				lck_c.unlock();
+				int64_t t_cmplt = deadlineNow();
+
+				if (cmplt)
 				{
 					syslog(LOG_NOTICE, "Task completed, %s, cpid %d, oid %d, priority %d\n",
-						   (recIssued ? "operator loaded, " : "operator present, "), curr_req->cpid, curr_req->oid, curr_req->priority);
+						   (recIssued ? "operator loaded, " : "operator present, "), curr_req.cpid, curr_req.oid, curr_req.priority);
 				}
 				else
 				{
 					syslog(LOG_NOTICE, "Task failed, cpid %d, oid %d, priority %d\n",
-						   curr_req->cpid, curr_req->oid, curr_req->priority);
+						   curr_req.cpid, curr_req.oid, curr_req.priority);
 				}
 
+				// Costs and deadlines
+				lck_q.lock();
+				if (cmplt)
+					updateCost(exec_cost, curr_req.oid, t_cmplt - t_start);
+
+				running_cost = 0;
+				if (curr_req.deadline)
+				{
+					if (cmplt && t_cmplt <= curr_req.deadline)
+					{
+						dl_stats.met++;
+					}
+					else
+					{
+						dl_stats.missed++;
+						syslog(LOG_NOTICE, "Deadline missed, cpid %d, oid %d, late %" PRId64 " ns\n",
+							   curr_req.cpid, curr_req.oid, t_cmplt - curr_req.deadline);
+					}
+				}
+				lck_q.unlock();
+
 				plock.unlock();
 			}
 			else
@@ -171,12 +219,98 @@ namespace fpga
 		}
 	}
 
-	void cSched::pLock(int32_t cpid, int32_t oid, uint32_t priority)
+	// ======-------------------------------------------------------------------------------
+	// Deadlines
+	// ======-------------------------------------------------------------------------------
+
+	/**
+	 * @brief Estimated cost of a single operator run, reconfiguration included if not loaded
+	 *
+	 * @param oid - operator id
+	 * @return int64_t - cost [ns], called with mtx_queue held
+	 */
+	int64_t cSched::estimateCost(int32_t oid)
+	{
+		int64_t cost = 0;
+
+		auto it = exec_cost.find(oid);
+		if (it != exec_cost.end())
+			cost += it->second;
+
+		if (isReconfigurable() && loaded_oid != oid)
+		{
+			it = rcnfg_cost.find(oid);
+			if (it != rcnfg_cost.end())
+				cost += it->second;
+		}
+
+		return cost;
+	}
+
+	/**
+	 * @brief Update the cost estimate (EWMA)
+	 *
+	 * @param cost - estimate map
+	 * @param oid - operator id
+	 * @param sample - measured cost [ns], called with mtx_queue held
+	 */
+	void cSched::updateCost(std::unordered_map<int32_t, int64_t> &cost, int32_t oid, int64_t sample)
+	{
+		auto it = cost.find(oid);
+		if (it == cost.end())
+			cost.emplace(oid, sample);
+		else
+			it->second += static_cast<int64_t>(schedCostWeight * (sample - it->second));
+	}
+
+	bool cSched::admit(int32_t oid, int64_t deadline)
+	{
+		if (!edf || !deadline)
+			return true;
+
+		unique_lock<std::mutex> lck_q(mtx_queue);
+		int64_t now = deadlineNow();
+		int64_t pending = 0;
+
+		// Not preempted, the running task finishes first
+		if (running_cost > now - running_start)
+			pending += running_cost - (now - running_start);
+
+		// Queued tasks that run ahead of this one
+		for (auto it = pending_dl.begin(); it != pending_dl.upper_bound(deadline); it++)
+			pending += it->second;
+
+		if (now + pending + estimateCost(oid) <= deadline)
+			return true;
+
+		dl_stats.refused++;
+		syslog(LOG_NOTICE, "Deadline refused, oid %d, pending %" PRId64 " ns\n", oid, pending);
+		return false;
+	}
+
+	cDeadlineStats cSched::getDeadlineStats()
 	{
 		unique_lock<std::mutex> lck_q(mtx_queue);
-		request_queue.emplace(std::unique_ptr<cLoad>(new cLoad{cpid, oid, priority}));
+		return dl_stats;
+	}
+
+	// ======-------------------------------------------------------------------------------
+	// Locks
+	// ======-------------------------------------------------------------------------------
+
+	void cSched::pLock(int32_t cpid, int32_t oid, uint32_t priority, int64_t deadline)
+	{
+		unique_lock<std::mutex> lck_q(mtx_queue);
+		int64_t cost = 0;
+		if (deadline)
+		{
+			cost = estimateCost(oid);
+			pending_dl.emplace(deadline, cost);
+		}
+		request_queue.push(cLoad{cpid, oid, priority, deadline, cost});
 		lck_q.unlock();
 
+		TRACE_SCOPE(TraceEv::SCHED_WAIT, oid);
 		unique_lock<std::mutex> lck_r(mtx_rcnfg);
 		cv_rcnfg.wait(lck_r, [=]
 					  { return ((curr_run == true) && (curr_cpid == cpid)); });
@@ -307,6 +441,7 @@ namespace fpga
 	 */
 	void cSched::reconfigure(int32_t oid)
 	{
+		TRACE_SCOPE(TraceEv::RECONFIG, oid);
 		if (bstreams.find(oid) != bstreams.end())
 		{
 			auto bstream = bstreams[oid];
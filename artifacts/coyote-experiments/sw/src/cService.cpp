@@ -15,8 +15,8 @@ cService* cService::cservice = nullptr;
  * @param priority - priority-based scheduling enabled 
  * @param reorder - reordering in scheduling enabled 
  */
-cService::cService(int32_t vfid, bool priority, bool reorder) 
-    : vfid(vfid), cSched(vfid, priority, reorder) 
+cService::cService(int32_t vfid, bool priority, bool reorder, bool edf) 
+    : cSched(vfid, priority, reorder, edf), vfid(vfid)
 {
     // ID - create service- and socket-IDs as strings based on the vfids. 
     service_id = ("coyote-daemon-vfid-" + std::to_string(vfid)).c_str();
@@ -51,12 +51,14 @@ void cService::my_handler(int signum)
         // Remove socket name from the file system 
         unlink(socket_name.c_str());
 
+        // Stop the event loop and wake it up
         run_req = false;
-        run_rsp = false;
+        uint64_t wake = 1;
+        if(write(evfd, &wake, sizeof(uint64_t)) != sizeof(uint64_t))
+            syslog(LOG_ERR, "Event loop could not be woken up");
         
-        // Make sure to finish the two threads 
+        // Make sure to finish the event loop
         thread_req.join();
-        thread_rsp.join();
 
         // Send kill-message to the process identified by pid
         kill(pid, SIGTERM);
@@ -129,6 +131,7 @@ void cService::daemon_init()
 
 /**
  * @brief Initialize listening socket for UNIX filesystem communication (local interprocess communication)
+ * and the epoll instance which drives all client I/O
  * 
  */
 void cService::socket_init() 
@@ -139,8 +142,8 @@ void cService::socket_init()
     struct sockaddr_un server;
     socklen_t len;
 
-    // Create the socket for AF_UNIX communication and check for success 
-    if((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    // Create the non-blocking socket for AF_UNIX communication and check for success 
+    if((sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
         syslog(LOG_ERR, "Error creating a server socket");
         exit(EXIT_FAILURE);
     }
@@ -162,10 +165,37 @@ void cService::socket_init()
         syslog(LOG_ERR, "Error listen()");
         exit(EXIT_FAILURE);
     }
+
+    // Epoll - one instance for the listening socket, the wake-up eventfd and all clients
+    if((epfd = epoll_create1(0)) == -1) {
+        syslog(LOG_ERR, "Error epoll_create1()");
+        exit(EXIT_FAILURE);
+    }
+
+    if((evfd = eventfd(0, EFD_NONBLOCK)) == -1) {
+        syslog(LOG_ERR, "Error eventfd()");
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = sockfd;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) == -1) {
+        syslog(LOG_ERR, "Error epoll_ctl(), listening socket");
+        exit(EXIT_FAILURE);
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.fd = evfd;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev) == -1) {
+        syslog(LOG_ERR, "Error epoll_ctl(), eventfd");
+        exit(EXIT_FAILURE);
+    }
 }
 
 /**
- * @brief Accept connections via the socket for interprocess communication 
+ * @brief Accept all pending connections via the socket for interprocess communication.
+ * The client registration (pid) is handled by the connection state machine.
  * 
  */
 void cService::accept_connection()
@@ -176,161 +206,576 @@ void cService::accept_connection()
 
     // File Descriptor for the connection 
     int connfd;
-    char recv_buf[recvBuffSize];
-    int n;
 
-    // Try to accept an incoming connection 
-    if((connfd = accept(sockfd, (struct sockaddr *)&client, &len)) == -1) {
-        syslog(LOG_NOTICE, "No new connections");
-    } else {
-        syslog(LOG_NOTICE, "Connection accepted, connfd: %d", connfd);
+    while(1) {
+        // Try to accept an incoming connection 
+        if((connfd = accept4(sockfd, (struct sockaddr *)&client, &len, SOCK_NONBLOCK)) == -1) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                syslog(LOG_ERR, "Error accept(), errno: %d", errno);
+            return;
+        }
 
-        pid_t rpid = 0;
-        if(n = read(connfd, recv_buf, sizeof(pid_t)) == sizeof(pid_t)) {
-            memcpy(&rpid, recv_buf, sizeof(pid_t));
-            syslog(LOG_NOTICE, "Registered pid: %d", rpid);
-        } else {
-            syslog(LOG_ERR, "Registration failed, connfd: %d, received: %d", connfd, n);
+        if(clients.size() >= maxNumClients) {
+            syslog(LOG_ERR, "Connection refused, too many clients, connfd: %d", connfd);
+
+            // Best effort, the socket buffer of a new connection is empty
+            int32_t cmpl[2] = { defTidReg, cmplRefused };
+            if(write(connfd, cmpl, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t))
+                syslog(LOG_ERR, "Refusal could not be sent, connfd: %d", connfd);
+            close(connfd);
+            continue;
         }
 
-        mtx_cli.lock();
-        
-        if(clients.find(connfd) == clients.end()) {
-            clients.insert({connfd, std::make_unique<cThread>(vfid, rpid, this)});
-            syslog(LOG_NOTICE, "Connection thread created");
+        auto conn = std::make_unique<cConn>();
+        conn->connfd = connfd;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = connfd;
+        if(epoll_ctl(epfd, EPOLL_CTL_ADD, connfd, &ev) == -1) {
+            syslog(LOG_ERR, "Error epoll_ctl(), connfd: %d", connfd);
+            close(connfd);
+            continue;
         }
 
-        mtx_cli.unlock();
+        clients.insert({connfd, std::move(conn)});
+        syslog(LOG_NOTICE, "Connection accepted, connfd: %d", connfd);
     }
+}
 
-    nanosleep((const struct timespec[]){{0, sleepIntervalDaemon}}, NULL);
+/**
+ * @brief Close a client connection. Outstanding tasks of the client are drained by its cThread.
+ * 
+ * @param connfd - client connection
+ */
+void cService::close_connection(int connfd)
+{
+    epoll_ctl(epfd, EPOLL_CTL_DEL, connfd, NULL);
+    close(connfd);
+
+    // Drain the outstanding tasks before the rings go away
+    auto it = clients.find(connfd);
+    if(it != clients.end()) {
+        it->second->cthread.reset();
+        release_shm(it->second.get());
+        clients.erase(it);
+    }
+    syslog(LOG_NOTICE, "Connection closed, connfd: %d", connfd);
 }
 
 // ======-------------------------------------------------------------------------------
 // Tasks
 // ======-------------------------------------------------------------------------------
-void cService::addTask(int32_t oid, std::function<int32_t(cProcess*, std::vector<uint64_t>)> task) {
+void cService::addTask(int32_t oid, cTaskHandler task) {
     if(task_map.find(oid) == task_map.end()) {
         task_map.insert({oid, task});
     }
 }
 
+void cService::addTask(int32_t oid, std::function<int32_t(cProcess*, std::vector<uint64_t>)> task) {
+    addTask(oid, [task] (cProcess *cproc, const cTaskArgs& args) -> int32_t {
+        return task(cproc, std::vector<uint64_t>(args.data(), args.data() + args.size()));
+    });
+}
+
 void cService::removeTask(int32_t oid) {
     if(bstreams.find(oid) != bstreams.end()) {
 		bstreams.erase(oid);
     }
 }
 
+// ======-------------------------------------------------------------------------------
+// Connection I/O
+// ======-------------------------------------------------------------------------------
+
+/**
+ * @brief Drain the client socket and feed the request state machine
+ * 
+ * @param conn - client connection
+ * @return false if the connection should be closed
+ */
+bool cService::recv_requests(cConn *conn) 
+{
+    while(1) {
+        ssize_t n = read(conn->connfd, conn->rx_buf + conn->rx_len, recvBuffSize - conn->rx_len);
+
+        if(n > 0) {
+            conn->rx_len += n;
+            if(!parse_requests(conn))
+                return false;
+        } else if(n == 0) {
+            // Peer closed
+            return false;
+        } else {
+            if(errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+}
+
+/**
+ * @brief Request state machine, consumes as many complete requests as are buffered (pipelining)
+ * 
+ * @param conn - client connection
+ * @return false if the connection should be closed
+ */
+bool cService::parse_requests(cConn *conn) 
+{
+    uint32_t offs = 0;
+    int32_t request[2];
+    bool done = false;
+
+    while(!done) {
+        uint32_t avail = conn->rx_len - offs;
+
+        switch (conn->state) {
+
+        // Client registration
+        case ConnState::REGISTER:
+            if(avail < sizeof(pid_t)) { done = true; break; }
+
+            memcpy(&conn->rpid, conn->rx_buf + offs, sizeof(pid_t));
+            offs += sizeof(pid_t);
+            syslog(LOG_NOTICE, "Registered pid: %d, connfd: %d", conn->rpid, conn->connfd);
+
+            // Each client holds a cpid, refuse it if the driver has none left
+            try {
+                conn->cthread = std::make_unique<cThread>(vfid, conn->rpid, this);
+            } catch(std::exception& e) {
+                syslog(LOG_ERR, "Registration refused, connfd: %d, %s", conn->connfd, e.what());
+
+                int32_t cmpl[2] = { defTidReg, cmplRefused };
+                conn->tx_buf.insert(conn->tx_buf.end(), (char*)cmpl, (char*)cmpl + 2 * sizeof(int32_t));
+                send_responses(conn);
+                return false;
+            }
+            conn->cthread->setCompletionNotify([this, conn] () {
+                // Shared memory clients are polled
+                if(conn->shm_polled)
+                    return;
+
+                mtx_cmpl.lock();
+                cmpl_conns.push_back(conn->connfd);
+                mtx_cmpl.unlock();
+
+                uint64_t wake = 1;
+                if(write(evfd, &wake, sizeof(uint64_t)) != sizeof(uint64_t))
+                    syslog(LOG_ERR, "Event loop could not be woken up");
+            });
+            syslog(LOG_NOTICE, "Connection thread created");
+
+            conn->state = ConnState::HEADER;
+            break;
+
+        // Tid and opcode
+        case ConnState::HEADER:
+            if(avail < 2 * sizeof(int32_t)) { done = true; break; }
+
+            memcpy(&request, conn->rx_buf + offs, 2 * sizeof(int32_t));
+            offs += 2 * sizeof(int32_t);
+            conn->tid = request[0];
+            conn->opcode = request[1];
+            syslog(LOG_NOTICE, "Client: %d, tid %d, opcode: %d", conn->connfd, conn->tid, conn->opcode);
+
+            // Close connection
+            if(conn->opcode == defOpClose) {
+                syslog(LOG_NOTICE, "Received close connection request, connfd: %d", conn->connfd);
+                return false;
+            }
+
+            conn->state = ConnState::PAYLOAD_SIZE;
+            break;
+
+        // Payload size, deadline
+        case ConnState::PAYLOAD_SIZE:
+            if(avail < sizeof(int32_t) + sizeof(int64_t)) { done = true; break; }
+
+            memcpy(&conn->msg_size, conn->rx_buf + offs, sizeof(int32_t));
+            offs += sizeof(int32_t);
+            memcpy(&conn->deadline, conn->rx_buf + offs, sizeof(int64_t));
+            offs += sizeof(int64_t);
+
+            // Framing is lost, nothing to resync on
+            if(conn->msg_size < 0) {
+                syslog(LOG_ERR, "Request invalid, connfd: %d, msg size: %d", conn->connfd, conn->msg_size);
+                return false;
+            }
+
+            // Skip the payload and complete the request as invalid
+            if(conn->msg_size > maxTaskPayload || conn->msg_size % sizeof(uint64_t)) {
+                syslog(LOG_ERR, "Request invalid, connfd: %d, msg size: %d", conn->connfd, conn->msg_size);
+                conn->invalid = true;
+            }
+
+            conn->state = ConnState::PAYLOAD;
+            break;
+
+        // Payload, schedule the task
+        case ConnState::PAYLOAD:
+            if(conn->invalid) {
+                uint32_t n = std::min(avail, (uint32_t)conn->msg_size);
+                offs += n;
+                conn->msg_size -= n;
+                if(conn->msg_size > 0) { done = true; break; }
+
+                int32_t cmpl[2] = { conn->tid, cmplInvalid };
+                conn->tx_buf.insert(conn->tx_buf.end(), (char*)cmpl, (char*)cmpl + 2 * sizeof(int32_t));
+                if(!send_responses(conn))
+                    return false;
+
+                conn->invalid = false;
+                conn->state = ConnState::HEADER;
+                break;
+            }
+
+            if(avail < conn->msg_size) { done = true; break; }
+
+            {
+                cTaskArgs msg;
+                msg.n_args = conn->msg_size / sizeof(uint64_t);
+                memcpy(msg.args, conn->rx_buf + offs, conn->msg_size);
+                offs += conn->msg_size;
+
+                syslog(LOG_NOTICE, "Received new request, connfd: %d, msg size: %d", conn->connfd, conn->msg_size);
+
+                // Shared memory registration, completed right away
+                if(conn->opcode == defOpRegShm) {
+                    int32_t cmpl[2] = { conn->tid, register_shm(conn, msg) };
+                    conn->tx_buf.insert(conn->tx_buf.end(), (char*)cmpl, (char*)cmpl + 2 * sizeof(int32_t));
+                    if(!send_responses(conn))
+                        return false;
+
+                    conn->state = ConnState::HEADER;
+                    break;
+                }
+
+                // Check bitstreams and task map
+                auto taskIter = task_map.find(conn->opcode);
+                if((isReconfigurable() && !checkBitstream(conn->opcode)) || taskIter == task_map.end()) {
+                    syslog(LOG_ERR, "Opcode invalid, connfd: %d, received: %d", conn->connfd, conn->opcode);
+
+                    // Complete right away, ahead of the tasks still queued
+                    int32_t cmpl[2] = { conn->tid, cmplInvalid };
+                    conn->tx_buf.insert(conn->tx_buf.end(), (char*)cmpl, (char*)cmpl + 2 * sizeof(int32_t));
+                    if(!send_responses(conn))
+                        return false;
+                } else {
+                    // Schedule
+                    TRACE_INSTANT(TraceEv::SVC_SUBMIT, conn->tid);
+                    conn->cthread->scheduleTask(std::unique_ptr<bTask>(new cSvcTask(conn->tid, conn->opcode, 1, conn->deadline, &taskIter->second, msg)));
+                    syslog(LOG_NOTICE, "Task scheduled, client %d, opcode %d", conn->connfd, conn->opcode);
+                }
+            }
+
+            conn->state = ConnState::HEADER;
+            break;
+
+        }
+    }
+
+    // Keep the partial request at the front of the buffer
+    if(offs > 0) {
+        conn->rx_len -= offs;
+        memmove(conn->rx_buf, conn->rx_buf + offs, conn->rx_len);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write out pending completions, arm EPOLLOUT if the socket is full
+ * 
+ * @param conn - client connection
+ * @return false if the connection should be closed
+ */
+bool cService::send_responses(cConn *conn) 
+{
+    while(conn->tx_offs < conn->tx_buf.size()) {
+        ssize_t n = write(conn->connfd, conn->tx_buf.data() + conn->tx_offs, conn->tx_buf.size() - conn->tx_offs);
+
+        if(n > 0) {
+            conn->tx_offs += n;
+        } else {
+            if(n == -1 && errno == EINTR)
+                continue;
+            if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                arm_output(conn, true);
+                return true;
+            }
+            syslog(LOG_ERR, "Completion could not be sent, connfd: %d", conn->connfd);
+            return false;
+        }
+    }
+
+    conn->tx_buf.clear();
+    conn->tx_offs = 0;
+    arm_output(conn, false);
+
+    return true;
+}
+
+/**
+ * @brief (Dis)arm the writability notification of a connection
+ * 
+ * @param conn - client connection
+ * @param arm - wait for EPOLLOUT
+ */
+void cService::arm_output(cConn *conn, bool arm) 
+{
+    if(conn->tx_armed != arm) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (arm ? EPOLLOUT : 0);
+        ev.data.fd = conn->connfd;
+        if(epoll_ctl(epfd, EPOLL_CTL_MOD, conn->connfd, &ev) == -1)
+            syslog(LOG_ERR, "Error epoll_ctl(), connfd: %d", conn->connfd);
+        conn->tx_armed = arm;
+    }
+}
+
+// ======-------------------------------------------------------------------------------
+// Shared memory transport
+// ======-------------------------------------------------------------------------------
+
+/**
+ * @brief Register the shared memory rings and the data region of a client.
+ * The data region is mapped into the client cProcess once, tasks address it through offsets.
+ * 
+ * @param conn - client connection
+ * @param msg - data region virtual address (client), data region length
+ * @return int32_t - completion code, 0 on success
+ */
+int32_t cService::register_shm(cConn *conn, const cTaskArgs& msg) 
+{
+    if(conn->rings != nullptr || msg.size() < 2 || msg[1] > std::numeric_limits<uint32_t>::max()) {
+        syslog(LOG_ERR, "Shared memory registration invalid, connfd: %d", conn->connfd);
+        return -1;
+    }
+
+    // Rings
+    std::string name = shmRingsName(conn->rpid, conn->tid);
+    int shmfd = shm_open(name.c_str(), O_RDWR, 0);
+    if(shmfd == -1) {
+        syslog(LOG_ERR, "Error shm_open(), connfd: %d, name: %s", conn->connfd, name.c_str());
+        return -1;
+    }
+
+    void *mem = mmap(NULL, sizeof(cShmRings), PROT_READ | PROT_WRITE, MAP_SHARED, shmfd, 0);
+    close(shmfd);
+    if(mem == MAP_FAILED) {
+        syslog(LOG_ERR, "Error mmap(), connfd: %d, name: %s", conn->connfd, name.c_str());
+        return -1;
+    }
+
+    // Data region
+    if(msg[1] > 0) {
+        try {
+            conn->cthread->getCprocess()->userMap((void*)msg[0], (uint32_t)msg[1]);
+        } catch(std::exception& e) {
+            syslog(LOG_ERR, "Data region could not be mapped, connfd: %d, %s", conn->connfd, e.what());
+            munmap(mem, sizeof(cShmRings));
+            return -1;
+        }
+    }
+
+    conn->rings = reinterpret_cast<cShmRings*>(mem);
+    conn->shm_vaddr = msg[0];
+    conn->shm_len = msg[1];
+    conn->shm_polled = true;
+    shm_conns.insert(conn->connfd);
+
+    syslog(LOG_NOTICE, "Shared memory registered, connfd: %d, data region: %lx, len: %lu", conn->connfd, conn->shm_vaddr, conn->shm_len);
+    return 0;
+}
+
+/**
+ * @brief Release the shared memory rings of a client. 
+ * The data region mapping is released together with the cProcess.
+ * 
+ * @param conn - client connection
+ */
+void cService::release_shm(cConn *conn) 
+{
+    if(conn->rings != nullptr) {
+        munmap(conn->rings, sizeof(cShmRings));
+        conn->rings = nullptr;
+        shm_conns.erase(conn->connfd);
+    }
+}
+
+/**
+ * @brief Poll the rings of all shared memory clients: schedule submissions, post completions
+ * 
+ * @return true if any work was done
+ */
+bool cService::process_rings() 
+{
+    bool busy = false;
+    cSqe sqe;
+    cmplEv cmpl_ev;
+
+    for(auto connfd : shm_conns) {
+        cConn *conn = clients[connfd].get();
+
+        // Submissions
+        while(conn->rings->sq.pop(sqe)) {
+            busy = true;
+
+            auto taskIter = task_map.find(sqe.oid);
+            bool valid = (sqe.n_args <= shmMaxArgs) && (taskIter != task_map.end()) &&
+                         (!isReconfigurable() || checkBitstream(sqe.oid));
+            
+            if(valid) {
+                // Translate data region offsets
+                cTaskArgs msg;
+                msg.n_args = sqe.n_args;
+                memcpy(msg.args, sqe.args, sqe.n_args * sizeof(uint64_t));
+                for(int i = 0; i < sqe.n_args; i++) {
+                    if(sqe.offs_mask & (1U << i)) {
+                        if(msg.args[i] >= conn->shm_len) valid = false;
+                        msg.args[i] += conn->shm_vaddr;
+                    }
+                }
+
+                if(valid) {
+                    TRACE_INSTANT(TraceEv::SVC_SUBMIT, sqe.tid);
+                    conn->cthread->scheduleTask(std::unique_ptr<bTask>(new cSvcTask(sqe.tid, sqe.oid, 1, sqe.deadline, &taskIter->second, msg)));
+                    continue;
+                }
+            }
+
+            syslog(LOG_ERR, "Ring request invalid, connfd: %d, tid: %d, oid: %d", connfd, sqe.tid, sqe.oid);
+            conn->cq_backlog.push_back({sqe.tid, cmplInvalid});
+        }
+
+        // Completions
+        while(1) {
+            cmpl_ev = conn->cthread->getCompletedNext();
+            if(std::get<0>(cmpl_ev) == -1)
+                break;
+            TRACE_INSTANT(TraceEv::SVC_CMPL, std::get<0>(cmpl_ev));
+            conn->cq_backlog.push_back({std::get<0>(cmpl_ev), std::get<1>(cmpl_ev)});
+        }
+
+        if(!conn->cq_backlog.empty()) {
+            busy = true;
+
+            uint32_t n = 0;
+            while(n < conn->cq_backlog.size() && conn->rings->cq.push(conn->cq_backlog[n])) n++;
+            conn->cq_backlog.erase(conn->cq_backlog.begin(), conn->cq_backlog.begin() + n);
+        }
+    }
+
+    return busy;
+}
+
 // ======-------------------------------------------------------------------------------
 // Threads
 // ======-------------------------------------------------------------------------------
 
+/**
+ * @brief Event loop, handles new connections, requests and completions of all clients
+ * 
+ */
 void cService::process_requests() {
-    char recv_buf[recvBuffSize];
-    memset(recv_buf, 0, recvBuffSize);
-    uint8_t ack_msg;
-    int32_t msg_size;
-    int32_t request[2], opcode, tid;
-    int n;
+    struct epoll_event events[maxEpollEvents];
     run_req = true;
 
+    // Termination is handled by the main thread
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
     syslog(LOG_NOTICE, "Starting thread");
+    TRACE_THREAD_NAME("cService");
 
     while(run_req) {
-        for (auto & el : clients) {
-            mtx_cli.lock();
-            int connfd = el.first;
-
-            if(read(connfd, recv_buf, 2 * sizeof(int32_t)) == 2 * sizeof(int32_t)) {
-                memcpy(&request, recv_buf, 2 * sizeof(int32_t));
-                tid = request[0];
-                opcode = request[1];
-                syslog(LOG_NOTICE, "Client: %d, tid %d, opcode: %d", el.first, tid, opcode);
-
-                switch (opcode) {
-
-                // Close connection
-                case defOpClose:
-                    syslog(LOG_NOTICE, "Received close connection request, connfd: %d", connfd);
-                    close(connfd);
-                    clients.erase(el.first);
-                    break;
+        // Shared memory clients are polled, don't block while there are any
+        int n = epoll_wait(epfd, events, maxEpollEvents, shm_conns.empty() ? epollTimeoutMs : 0);
+        if(n == -1) {
+            if(errno == EINTR)
+                continue;
+            syslog(LOG_ERR, "Error epoll_wait(), errno: %d", errno);
+            break;
+        }
 
-                // Schedule the task
-                default:
-                    // Check bitstreams
-                    if(isReconfigurable()) {
-                        if(!checkBitstream(opcode))
-                            syslog(LOG_ERR, "Opcode invalid, connfd: %d, received: %d", connfd, n);
-                    }
+        for(int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
 
-                    // Check task map
-                    if(task_map.find(opcode) == task_map.end())
-                       syslog(LOG_ERR, "Opcode invalid, connfd: %d, received: %d", connfd, n);
-
-                    auto taskIter = task_map.find(opcode);
-         
-                    
-                    // Read the payload size
-                    if(n = read(connfd, recv_buf, sizeof(int32_t)) == sizeof(int32_t)) {
-                        memcpy(&msg_size, recv_buf, sizeof(int32_t));
-
-                        // Read the payload
-                        if(n = read(connfd, recv_buf, msg_size) == msg_size) {
-                            std::vector<uint64_t> msg(msg_size / sizeof(uint64_t)); 
-                            memcpy(msg.data(), recv_buf, msg_size);
-
-                            syslog(LOG_NOTICE, "Received new request, connfd: %d, msg size: %d",
-                                el.first, msg_size);
-
-                            // Schedule
-                            el.second->scheduleTask(std::unique_ptr<bTask>(new cTask(tid, opcode, 1, taskIter->second, msg)));
-                            syslog(LOG_NOTICE, "Task scheduled, client %d, opcode %d", el.first, opcode);
-                        } else {
-                            syslog(LOG_ERR, "Request invalid, connfd: %d, received: %d", connfd, n);
-                        }
-
-                    } else {
-                        syslog(LOG_ERR, "Payload size not read, connfd: %d, received: %d", connfd, n);
-                    }
-                    break;
+            // New connections
+            if(fd == sockfd) {
+                accept_connection();
+                continue;
+            }
 
-                }
+            // Completions
+            if(fd == evfd) {
+                uint64_t cnt;
+                while(read(evfd, &cnt, sizeof(uint64_t)) == sizeof(uint64_t)) ;
+                process_responses();
+                continue;
             }
 
-            mtx_cli.unlock();
+            // Client I/O
+            auto it = clients.find(fd);
+            if(it == clients.end())
+                continue;
+            cConn *conn = it->second.get();
+
+            bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP)) || (events[i].events & EPOLLIN);
+            if(alive && (events[i].events & EPOLLIN)) {
+                TRACE_SCOPE(TraceEv::SVC_RECV, fd);
+                alive = recv_requests(conn);
+            }
+            if(alive && (events[i].events & EPOLLOUT))
+                alive = send_responses(conn);
+            
+            if(!alive)
+                close_connection(fd);
         }
 
-        nanosleep((const struct timespec[]){{0, sleepIntervalRequests}}, NULL);
+        // Rings
+        if(!shm_conns.empty()) {
+            if(!process_rings() && n == 0)
+                nanosleep(&PAUSE, NULL);
+        }
     }
 }
 
+/**
+ * @brief Collect completions of all clients that signalled them and send them out
+ * 
+ */
 void cService::process_responses() {
-    int n;
-    int ack_msg;
-    run_rsp = true;
     cmplEv cmpl_ev;
     int32_t cmpl[2];
-    
-    while(run_rsp) {
+    vector<int> conns;
+
+    mtx_cmpl.lock();
+    conns.swap(cmpl_conns);
+    mtx_cmpl.unlock();
+
+    for(auto connfd : conns) {
+        auto it = clients.find(connfd);
+        if(it == clients.end() || !it->second->cthread)
+            continue;
+        cConn *conn = it->second.get();
+        TRACE_SCOPE(TraceEv::SVC_CMPL, connfd);
 
-        for (auto & el : clients) {
-            cmpl_ev = el.second->getCompletedNext();
+        while(1) {
+            cmpl_ev = conn->cthread->getCompletedNext();
             cmpl[0] = std::get<0>(cmpl_ev);
             cmpl[1] = std::get<1>(cmpl_ev);
-            if(cmpl[0] != -1) {
-                syslog(LOG_NOTICE, "Running here...");
-                int connfd = el.first;
+            if(cmpl[0] == -1)
+                break;
 
-                if(write(connfd, &cmpl, 2 * sizeof(int32_t)) == 2 * sizeof(int32_t)) {
-                    syslog(LOG_NOTICE, "Sent completion, connfd: %d, tid: %d, code: %d", connfd, cmpl[0], cmpl[1]);
-                } else {
-                    syslog(LOG_ERR, "Completion could not be sent, connfd: %d", connfd);
-                }
-            }
+            conn->tx_buf.insert(conn->tx_buf.end(), (char*)cmpl, (char*)cmpl + 2 * sizeof(int32_t));
+            syslog(LOG_NOTICE, "Completion queued, connfd: %d, tid: %d, code: %d", connfd, cmpl[0], cmpl[1]);
         }
 
-        nanosleep((const struct timespec[]){{0, sleepIntervalCompletion}}, NULL);
+        if(!send_responses(conn))
+            close_connection(connfd);
     }
 }
 
@@ -345,6 +790,14 @@ void cService::run() {
     // Run scheduler
     if(isReconfigurable()) run_sched();
 
+    // Scheduler statistics
+    if(!stats_path.empty()) {
+        cstats = std::make_unique<cStats>();
+        cstats->setSched(this);
+        cstats->setPrometheusFile(stats_path);
+        cstats->start();
+    }
+
     // Init socket
     socket_init();
     
@@ -352,11 +805,10 @@ void cService::run() {
     syslog(LOG_NOTICE, "Thread initialization");
 
     thread_req = std::thread(&cService::process_requests, this);
-    thread_rsp = std::thread(&cService::process_responses, this);
 
-    // Main
+    // Main, wait for termination
     while(1) {
-        accept_connection();
+        pause();
     }
 }
 
@@ -0,0 +1,341 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "cStats.hpp"
+
+using namespace std::chrono;
+
+namespace fpga {
+
+// ======-------------------------------------------------------------------------------
+// Parsing
+// ======-------------------------------------------------------------------------------
+
+namespace {
+
+// Drop terminal escape sequences of the formatted sysfs output
+std::string stripEscapes(const std::string& line) {
+    std::string out;
+    for(size_t i = 0; i < line.size(); i++) {
+        if(line[i] == '\033') {
+            while(i < line.size() && !isalpha(static_cast<unsigned char>(line[i]))) i++;
+            continue;
+        }
+        out += line[i];
+    }
+    return out;
+}
+
+// Metric name, lower case snake
+std::string metricName(const std::string& key) {
+    std::string out;
+    for(char c : key) {
+        if(isalnum(static_cast<unsigned char>(c))) {
+            out += tolower(static_cast<unsigned char>(c));
+        } else if(!out.empty() && out.back() != '_') {
+            out += '_';
+        }
+    }
+    while(!out.empty() && out.back() == '_') out.pop_back();
+    return out;
+}
+
+std::string joinLabels(const std::string& a, const std::string& b) {
+    if(a.empty()) return b;
+    if(b.empty()) return a;
+    return a + "," + b;
+}
+
+// Values that go up and down, everything else is a counter
+bool isGauge(const std::string& name) {
+    return name.find("session_cnt") != std::string::npos || name.find("strm_down") != std::string::npos ||
+           name.find("quarantine_qpn") != std::string::npos;
+}
+
+}
+
+uint32_t cStats::parseSysfs(const std::string& text, const std::string& prefix, const std::string& labels, cStatsSample& sample) {
+    std::istringstream is(text);
+    std::string line, section;
+    uint32_t n = 0;
+
+    while(std::getline(is, line)) {
+        line = stripEscapes(line);
+
+        auto pos = line.find(':');
+        if(pos == std::string::npos)
+            continue;
+
+        std::string key = line.substr(0, pos);
+        std::string val = line.substr(pos + 1);
+        val.erase(0, val.find_first_not_of(" \t"));
+        val.erase(val.find_last_not_of(" \t\r") + 1);
+
+        // Section header (e.g. CHANNEL 0:), becomes a label
+        if(val.empty()) {
+            std::string sec = metricName(key);
+            auto sp = sec.find_last_of('_');
+            section = (sp != std::string::npos) ? sec.substr(0, sp) + "=\"" + sec.substr(sp + 1) + "\"" : "";
+            continue;
+        }
+
+        char *end;
+        errno = 0;
+        uint64_t value = strtoull(val.c_str(), &end, 0);
+        if(errno || end == val.c_str() || *end != '\0')
+            continue;
+
+        cCounter cnt;
+        cnt.name = prefix + "_" + metricName(key);
+        cnt.labels = joinLabels(labels, section);
+        cnt.value = value;
+        cnt.gauge = isGauge(cnt.name);
+        sample.counters[cnt.name + "{" + cnt.labels + "}"] = cnt;
+        n++;
+    }
+
+    return n;
+}
+
+void cStats::computeRates(const cStatsSample& prev, cStatsSample& sample) {
+    double dt = (sample.ts_ns - prev.ts_ns) / 1e9;
+
+    for(auto& it : sample.counters) {
+        cCounter& cnt = it.second;
+        auto prev_it = prev.counters.find(it.first);
+        if(cnt.gauge || prev_it == prev.counters.end())
+            continue;
+
+        uint64_t prev_val = prev_it->second.value;
+        if(cnt.value >= prev_val)
+            cnt.delta = cnt.value - prev_val;
+        else if(prev_val <= UINT32_MAX)
+            cnt.delta = (cnt.value + (1ULL << 32)) - prev_val; // hw counters are 32 bit
+        else
+            cnt.delta = cnt.value; // reset
+
+        cnt.rate = dt > 0 ? cnt.delta / dt : 0.0;
+    }
+}
+
+std::string cStats::toPrometheus(const cStatsSample& sample) {
+    std::ostringstream os;
+    std::string last;
+
+    for(auto& it : sample.counters) {
+        const cCounter& cnt = it.second;
+        std::string name = cnt.gauge ? cnt.name : cnt.name + "_total";
+
+        if(name != last) {
+            os << "# TYPE " << name << (cnt.gauge ? " gauge" : " counter") << "\n";
+            last = name;
+        }
+        os << name << "{" << cnt.labels << "} " << cnt.value << "\n";
+    }
+
+    // Rates
+    last.clear();
+    for(auto& it : sample.counters) {
+        const cCounter& cnt = it.second;
+        if(cnt.gauge)
+            continue;
+
+        std::string name = cnt.name + "_rate";
+        if(name != last) {
+            os << "# TYPE " << name << " gauge\n";
+            last = name;
+        }
+        os << name << "{" << cnt.labels << "} " << cnt.rate << "\n";
+    }
+
+    return os.str();
+}
+
+// ======-------------------------------------------------------------------------------
+// Sampling
+// ======-------------------------------------------------------------------------------
+
+cStats::cStats(std::chrono::milliseconds interval, cProcess *cproc, std::string sysfs_dir)
+    : sysfs_dir(sysfs_dir), cproc(cproc), interval(interval) {}
+
+cStats::~cStats() {
+    stop();
+
+    if(shm) {
+        munmap(shm, sizeof(cStatsShm));
+        shm_unlink(shm_name.c_str());
+    }
+}
+
+cStatsSample cStats::sample() {
+    cStatsSample s;
+    s.ts_ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+
+    // Driver sysfs
+    auto readFile = [&](const std::string& attr, const std::string& prefix, const std::string& labels) {
+        std::ifstream f(sysfs_dir + "/" + attr);
+        if(!f)
+            return;
+        std::stringstream ss;
+        ss << f.rdbuf();
+        parseSysfs(ss.str(), prefix, labels, s);
+    };
+
+    readFile("cyt_attr_nstats_q0", "coyote_net", "qsfp=\"0\"");
+    readFile("cyt_attr_nstats_q1", "coyote_net", "qsfp=\"1\"");
+    readFile("cyt_attr_xstats", "coyote_xdma", "");
+
+    // Status registers of the attached process
+    if(cproc != nullptr) {
+        std::string labels = "vfid=\"" + std::to_string(cproc->getVfid()) + "\",cpid=\"" + std::to_string(cproc->getCpid()) + "\"";
+        auto add = [&](const std::string& name, uint64_t value) {
+            cCounter cnt;
+            cnt.name = name;
+            cnt.labels = labels;
+            cnt.value = value;
+            s.counters[name + "{" + labels + "}"] = cnt;
+        };
+
+        add("coyote_dma_rd_cmpl", cproc->checkCompleted(CoyoteOper::READ));
+        add("coyote_dma_wr_cmpl", cproc->checkCompleted(CoyoteOper::WRITE));
+        add("coyote_ibv_acks", cproc->ibvCheckAcks());
+    }
+
+    // Deadlines of the attached scheduler
+    if(csched != nullptr && csched->isEdf()) {
+        std::string labels = "vfid=\"" + std::to_string(csched->getVfid()) + "\"";
+        cDeadlineStats dl = csched->getDeadlineStats();
+        auto add = [&](const std::string& name, uint64_t value) {
+            cCounter cnt;
+            cnt.name = name;
+            cnt.labels = labels;
+            cnt.value = value;
+            s.counters[name + "{" + labels + "}"] = cnt;
+        };
+
+        add("coyote_sched_deadline_met", dl.met);
+        add("coyote_sched_deadline_missed", dl.missed);
+        add("coyote_sched_deadline_refused", dl.refused);
+    }
+
+    return s;
+}
+
+void cStats::processRequests() {
+    unique_lock<mutex> lck(mtx_run);
+    auto next = steady_clock::now();
+
+    while(run) {
+        lck.unlock();
+
+        cStatsSample s = sample();
+
+        mtx_sample.lock();
+        if(n_samples)
+            computeRates(curr, s);
+        curr = s;
+        n_samples++;
+        mtx_sample.unlock();
+
+        exportOut(s);
+
+        // Fixed rate, not drifting with the sampling cost
+        next += interval;
+        lck.lock();
+        cv_run.wait_until(lck, next, [this] { return !run; });
+    }
+}
+
+void cStats::start() {
+    unique_lock<mutex> lck(mtx_run);
+    if(run)
+        return;
+    run = true;
+    s_thread = thread(&cStats::processRequests, this);
+}
+
+void cStats::stop() {
+    mtx_run.lock();
+    bool running = run;
+    run = false;
+    mtx_run.unlock();
+    cv_run.notify_one();
+
+    if(running)
+        s_thread.join();
+}
+
+cStatsSample cStats::getLast() {
+    std::lock_guard<mutex> lck(mtx_sample);
+    return curr;
+}
+
+// ======-------------------------------------------------------------------------------
+// Exports
+// ======-------------------------------------------------------------------------------
+
+void cStats::setShm(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if(fd == -1)
+        throw std::runtime_error("cStats shared memory could not be created, name: " + name);
+
+    if(ftruncate(fd, sizeof(cStatsShm))) {
+        close(fd);
+        throw std::runtime_error("cStats shared memory could not be sized, name: " + name);
+    }
+
+    void *mem = mmap(NULL, sizeof(cStatsShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED)
+        throw std::runtime_error("cStats shared memory could not be mapped, name: " + name);
+
+    shm = reinterpret_cast<cStatsShm*>(mem);
+    shm->seq.store(0, std::memory_order_relaxed);
+    shm->n_entries = 0;
+    shm_name = name;
+}
+
+void cStats::exportOut(const cStatsSample& sample) {
+    // Shared memory snapshot
+    if(shm) {
+        uint64_t seq = shm->seq.load(std::memory_order_relaxed);
+        shm->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint32_t n = 0;
+        for(auto& it : sample.counters) {
+            if(n == statsMaxEntries)
+                break;
+            strncpy(shm->entries[n].series, it.first.c_str(), statsNameSize - 1);
+            shm->entries[n].series[statsNameSize - 1] = '\0';
+            shm->entries[n].value = it.second.value;
+            shm->entries[n].rate = it.second.rate;
+            n++;
+        }
+        shm->n_entries = n;
+        shm->ts_ns = sample.ts_ns;
+
+        shm->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Prometheus text file
+    if(!prom_path.empty()) {
+        std::string tmp_path = prom_path + ".tmp";
+        std::ofstream f(tmp_path);
+        if(f) {
+            f << toPrometheus(sample);
+            f.close();
+            if(rename(tmp_path.c_str(), prom_path.c_str()))
+                DBG2("cStats:  Prometheus file could not be replaced: " << prom_path);
+        }
+    }
+}
+
+}
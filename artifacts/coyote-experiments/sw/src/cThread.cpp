@@ -58,7 +58,10 @@ cThread::~cThread()
 
     // Thread
     DBG3("cThread:  dtor called");
+    mtx_task.lock();
     run = false;
+    mtx_task.unlock();
+    cv_task.notify_one();
 
     DBG3("cThread:  joining");
     c_thread.join();
@@ -75,9 +78,11 @@ void cThread::processRequests() {
     run = true;
     lck.unlock();
     cv_task.notify_one();
+    TRACE_THREAD_NAME("cThread");
 
     while(run || !task_queue.empty()) {
         lck.lock();
+        cv_task.wait(lck, [this] { return !run || !task_queue.empty(); });
         if(!task_queue.empty()) {
             if(task_queue.front() != nullptr) {
                 // Remove next task from the queue
@@ -88,14 +93,24 @@ void cThread::processRequests() {
                 DBG3("Process task: vfid: " <<  cproc->getVfid() << ", tid: " << curr_task->getTid() 
                     << ", oid: " << curr_task->getOid() << ", prio: " << curr_task->getPriority());
 
-                // Run the task                
-                cmpl_code = curr_task->run(cproc.get());
+                // Run the task, unless its deadline can't be met anymore
+                TRACE_SCOPE(TraceEv::TASK_RUN, curr_task->getTid());
+                if(cproc->admit(curr_task->getOid(), curr_task->getDeadline())) {
+                    cproc->setDeadline(curr_task->getDeadline());
+                    cmpl_code = curr_task->run(cproc.get());
+                    cproc->setDeadline(0);
+                } else {
+                    cmpl_code = cmplRefused;
+                }
 
                 // Completion
                 cnt_cmpl++;
                 mtx_cmpl.lock();
                 cmpl_queue.push({curr_task->getTid(), cmpl_code});
                 mtx_cmpl.unlock();
+
+                if(cmpl_notify) 
+                    cmpl_notify();
                  
             } else {
                 task_queue.pop();
@@ -104,8 +119,6 @@ void cThread::processRequests() {
         } else {
             lck.unlock();
         }
-
-        nanosleep(&PAUSE, NULL);
     }
 }
 
@@ -114,8 +127,8 @@ void cThread::processRequests() {
 // ======-------------------------------------------------------------------------------
 
 cmplEv cThread::getCompletedNext() {
+    lock_guard<mutex> lck(mtx_cmpl);
     if(!cmpl_queue.empty()) {
-        lock_guard<mutex> lck(mtx_cmpl);
         cmplEv cmpl_ev = cmpl_queue.front();
         cmpl_queue.pop();
         return cmpl_ev;
@@ -124,8 +137,11 @@ cmplEv cThread::getCompletedNext() {
 }
 
 void cThread::scheduleTask(std::unique_ptr<bTask> ctask) {
-    lock_guard<mutex> lck2(mtx_task);
-    task_queue.emplace(std::move(ctask));
+    {
+        lock_guard<mutex> lck2(mtx_task);
+        task_queue.emplace(std::move(ctask));
+    }
+    cv_task.notify_one();
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+
+#include "cTrace.hpp"
+
+using namespace std::chrono;
+
+namespace fpga {
+
+// ======-------------------------------------------------------------------------------
+// cTrace management
+// ======-------------------------------------------------------------------------------
+
+cTrace::cTrace() {
+    tsc_ref = now();
+    ns_ref = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+cTrace::~cTrace() {
+    if(const char *path = getenv("COYOTE_TRACE_OUT"))
+        dump(path);
+}
+
+cTraceRing* cTrace::registerThread() {
+    auto ring = std::make_shared<cTraceRing>();
+    ring->tid = static_cast<int32_t>(syscall(SYS_gettid));
+    ring->name = "thread_" + std::to_string(ring->tid);
+
+    std::lock_guard<std::mutex> lck(mtx);
+    rings.emplace_back(ring);
+    return ring.get();
+}
+
+void cTrace::setThreadName(const std::string& name) {
+    auto ring_ptr = ring();
+    std::lock_guard<std::mutex> lck(mtx);
+    ring_ptr->name = name;
+}
+
+// ======-------------------------------------------------------------------------------
+// Dump
+// ======-------------------------------------------------------------------------------
+
+void cTrace::dump(const std::string& path) {
+    std::lock_guard<std::mutex> lck(mtx);
+
+    std::ofstream os(path);
+    if(!os) {
+        std::cerr << "ERR:  Trace could not be dumped: " << path << std::endl;
+        return;
+    }
+
+    // TSC rate against the reference taken on creation
+    uint64_t tsc_now = now();
+    int64_t ns_now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    double tsc_per_us = (ns_now > ns_ref) ? (double)(tsc_now - tsc_ref) * 1000.0 / (ns_now - ns_ref) : 1000.0;
+    auto to_us = [&](uint64_t tsc) { return (double)(int64_t)(tsc - tsc_ref) / tsc_per_us; };
+
+    pid_t pid = getpid();
+    bool first = true;
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for(auto& ring : rings) {
+        // Thread name
+        os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+           << ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+        first = false;
+
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        uint64_t head = tail > traceRingSize ? tail - traceRingSize : 0;
+        for(uint64_t i = head; i < tail; i++) {
+            const cTraceRec& rec = ring->recs[i & (traceRingSize - 1)];
+            uint32_t ev = static_cast<uint32_t>(rec.ev);
+            if(ev >= static_cast<uint32_t>(TraceEv::N_EVENTS))
+                continue;
+
+            os << ",\n{\"name\":\"" << traceEvName[ev] << "\",\"cat\":\"coyote\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+               << ",\"ts\":" << to_us(rec.begin);
+            if(rec.end == rec.begin)
+                os << ",\"ph\":\"i\",\"s\":\"t\"";
+            else
+                os << ",\"ph\":\"X\",\"dur\":" << (double)(rec.end - rec.begin) / tsc_per_us;
+            os << ",\"args\":{\"arg\":" << rec.arg << "}}";
+        }
+
+        if(tail > traceRingSize)
+            DBG2("Trace ring of thread " << ring->tid << " wrapped, " << tail - traceRingSize << " events lost");
+    }
+    os << "\n]}" << std::endl;
+}
+
+}
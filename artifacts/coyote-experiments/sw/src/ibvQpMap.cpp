@@ -46,6 +46,7 @@ ibvQpConn* ibvQpMap::getQpairConn(uint32_t qpid) {
 
 void ibvQpMap::exchangeQpMaster(uint16_t port) {
     uint32_t recv_qpid;
+    uint32_t recv_version;
     uint8_t ack;
     uint32_t n;
     int sockfd = -1, connfd;
@@ -110,6 +111,13 @@ void ibvQpMap::exchangeQpMaster(uint16_t port) {
             throw std::runtime_error("Could not read a remote queue");
         }
 
+        // Older peers send a shorter queue without the version and the path MTU
+        memcpy(&recv_version, recv_buf, sizeof(uint32_t));
+        if (recv_version != ibvQVersion) {
+            ::close(connfd);
+            throw std::runtime_error("Queue pair exchange failed, remote queue layout version mismatch");
+        }
+
         ibvQpConn *ibv_qpair_conn = qpairs[recv_qpid].get();
         ibv_qpair_conn->setConnection(connfd);
 
@@ -136,6 +144,7 @@ void ibvQpMap::exchangeQpMaster(uint16_t port) {
 void ibvQpMap::exchangeQpSlave(const char *trgt_addr, uint16_t port) {
     struct addrinfo *res, *t;
     uint8_t ack;
+    uint32_t recv_version;
     struct addrinfo hints = {};
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_STREAM;
@@ -199,6 +208,12 @@ void ibvQpMap::exchangeQpSlave(const char *trgt_addr, uint16_t port) {
             throw std::runtime_error("Could not read a remote queue");
         }
 
+        memcpy(&recv_version, recv_buf, sizeof(uint32_t));
+        if (recv_version != ibvQVersion) {
+            ::close(sockfd);
+            throw std::runtime_error("Queue pair exchange failed, remote queue layout version mismatch");
+        }
+
         curr_qp_conn->setConnection(sockfd);
 
         ibvQp *qpair = curr_qp_conn->getQpairStruct();
@@ -6,6 +6,8 @@
 #include <iomanip>
 #include <cstring>
 #include <netdb.h>
+#include <algorithm>
+#include <stdexcept>
 
 namespace fpga {
     
@@ -29,8 +31,21 @@ void ibvQ::uintToGid(int idx, uint32_t ip_addr) {
 }
 
 void ibvQ::print(const char *name) {
-    printf("%s: QPN 0x%06x, PSN 0x%06x, RKEY 0x%06x, VADDR %016lx, SIZE %08x, IP 0x%08x,\n",
-         name, qpn, psn, rkey, (uint64_t)vaddr, size, ip_addr);
+    printf("%s: QPN 0x%06x, PSN 0x%06x, RKEY 0x%06x, VADDR %016lx, SIZE %08x, IP 0x%08x, PMTU %u,\n",
+         name, qpn, psn, rkey, (uint64_t)vaddr, size, ip_addr, pmtu);
+}
+
+uint8_t ibvQp::getPmtu() {
+    uint32_t pmtu = (local.pmtu && remote.pmtu) ? std::min(local.pmtu, remote.pmtu) : (local.pmtu | remote.pmtu);
+    if(pmtu == 0)
+        return 0;
+    if(pmtu < 256 || pmtu > 4096 || (pmtu & (pmtu - 1)))
+        throw std::runtime_error("Path MTU has to be a power of 2 in 256 - 4096, received " + std::to_string(pmtu));
+
+    uint8_t code = 1;
+    while((256u << (code - 1)) < pmtu)
+        code++;
+    return code;
 }
 
 ibvQpPool::ibvQpPool(int32_t n_el) {
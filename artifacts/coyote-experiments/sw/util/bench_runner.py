@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""
+Coyote benchmark runner
+
+Builds and runs the benchmark suites of a declarative config (see bench_suites.json),
+collects the cBench records (COYOTE_BENCH_OUT) with host and bitstream metadata and
+compares them against a stored baseline with a Mann-Whitney U test.
+
+Suites without cBench records (e.g. csim testbenches) are timed as a whole per repetition.
+Network suites run as clients against the peer in their args, the server side has to be started
+there first. A suite "timeout" [s] fails the run instead of waiting on a missing peer.
+
+usage: bench_runner.py <config> [-s suite ...] [-o results.json] [-b baseline.json]
+                                [--save-baseline baseline.json] [--no-build]
+"""
+
+import argparse
+import datetime
+import hashlib
+import json
+import math
+import os
+import platform
+import shlex
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+SW_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+DEF_ALPHA = 0.01
+DEF_THRESHOLD = 0.05 # relative median change below which a significant shift is not reported
+DEF_REPS = 1
+
+# ======-------------------------------------------------------------------------------
+# Metadata
+# ======-------------------------------------------------------------------------------
+
+def sh(cmd, cwd=None):
+    try:
+        return subprocess.run(cmd, shell=True, cwd=cwd, capture_output=True, text=True).stdout.strip()
+    except OSError:
+        return ""
+
+def sha256(path):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            h.update(chunk)
+    return h.hexdigest()
+
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor()
+
+def host_meta():
+    return {
+        "host": socket.gethostname(),
+        "kernel": platform.release(),
+        "cpu": cpu_model(),
+        "n_cpus": os.cpu_count(),
+        "commit": sh("git rev-parse HEAD", SW_DIR),
+        "dirty": sh("git status --porcelain -- .", SW_DIR) != "",
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+    }
+
+def bitstream_meta(suite):
+    meta = {"backend": suite.get("backend", "hw")}
+    bstream = suite.get("bitstream")
+    if bstream:
+        bstream = os.path.join(SW_DIR, bstream)
+        meta["bitstream"] = bstream
+        meta["bitstream_sha256"] = sha256(bstream) if os.path.isfile(bstream) else None
+    return meta
+
+# ======-------------------------------------------------------------------------------
+# Build and run
+# ======-------------------------------------------------------------------------------
+
+def build(suite, build_root):
+    target = suite.get("target")
+    if target is None:
+        return None
+
+    build_dir = os.path.join(build_root, suite["name"])
+    defs = " ".join("-D{}={}".format(k, v) for k, v in suite.get("cmake", {}).items())
+    for cmd in ("cmake -S {} -B {} -DTARGET_DIR={} {}".format(SW_DIR, build_dir, target, defs),
+                "cmake --build {} -j{}".format(build_dir, os.cpu_count())):
+        ret = subprocess.run(cmd, shell=True, capture_output=True, text=True)
+        if ret.returncode:
+            sys.exit("ERR:  Build failed, suite {}:\n{}".format(suite["name"], ret.stdout[-4000:] + ret.stderr[-4000:]))
+    return build_dir
+
+def run(suite, build_dir):
+    """Run all repetitions of a suite, returns {label: {"hist": {value: count}, ...}}"""
+    if "command" in suite:
+        cmd = suite["command"]
+    else:
+        cmd = "{} {}".format(os.path.join(build_dir, "main"), suite.get("args", ""))
+
+    results = {}
+    for rep in range(suite.get("reps", DEF_REPS)):
+        with tempfile.NamedTemporaryFile(suffix=".jsonl", delete=False) as tmp:
+            out_path = tmp.name
+
+        env = dict(os.environ)
+        env.update({k: str(v) for k, v in suite.get("env", {}).items()})
+        env["COYOTE_BENCH_OUT"] = out_path
+
+        t_start = time.monotonic_ns()
+        cwd = os.path.join(SW_DIR, suite["cwd"]) if "cwd" in suite else None
+        try:
+            ret = subprocess.run(shlex.split(cmd), env=env, cwd=cwd, capture_output=True, text=True,
+                                 timeout=suite.get("timeout"))
+        except subprocess.TimeoutExpired:
+            os.unlink(out_path)
+            sys.exit("ERR:  Suite {} timed out after {} s, rep {}".format(suite["name"], suite["timeout"], rep))
+        t_run = time.monotonic_ns() - t_start
+
+        if ret.returncode:
+            os.unlink(out_path)
+            sys.exit("ERR:  Suite {} failed, rep {}:\n{}".format(suite["name"], rep, ret.stdout[-4000:] + ret.stderr[-4000:]))
+
+        with open(out_path) as f:
+            records = [json.loads(line) for line in f if line.strip()]
+        os.unlink(out_path)
+
+        # No cBench records, time the whole run
+        if not records:
+            records = [{"label": "wall", "runs": 1, "hist": [[t_run, 1]]}]
+
+        for rec in records:
+            res = results.setdefault(rec["label"], {"hist": {}, "runs": 0})
+            for value, count in rec["hist"]:
+                res["hist"][value] = res["hist"].get(value, 0) + count
+            res["runs"] += rec["runs"]
+
+    # Summary
+    for res in results.values():
+        hist = sorted(res["hist"].items())
+        res["hist"] = [[v, c] for v, c in hist]
+        res["median_ns"] = percentile(hist, 50.0)
+        res["p99_ns"] = percentile(hist, 99.0)
+        res["mean_ns"] = sum(v * c for v, c in hist) / max(1, sum(c for _, c in hist))
+
+    return results
+
+# ======-------------------------------------------------------------------------------
+# Statistics
+# ======-------------------------------------------------------------------------------
+
+def percentile(hist, p):
+    total = sum(c for _, c in hist)
+    if total == 0:
+        return 0
+    target = max(1, math.ceil(p / 100.0 * total))
+    acc = 0
+    for value, count in hist:
+        acc += count
+        if acc >= target:
+            return value
+    return hist[-1][0]
+
+def mann_whitney(hist_a, hist_b):
+    """
+    Two-sided Mann-Whitney U test on weighted samples (value, count).
+    Normal approximation with tie correction, fine for the sample sizes of a bench run.
+    Returns (U of a, p-value, effect size as P(a > b) + 0.5 P(a == b)).
+    """
+    n_a = sum(c for _, c in hist_a)
+    n_b = sum(c for _, c in hist_b)
+    if n_a == 0 or n_b == 0:
+        return 0.0, 1.0, 0.5
+
+    merged = {}
+    for v, c in hist_a:
+        merged.setdefault(v, [0, 0])[0] += c
+    for v, c in hist_b:
+        merged.setdefault(v, [0, 0])[1] += c
+
+    # Average ranks of the tied groups
+    rank_sum_a = 0.0
+    tie_term = 0.0
+    rank = 0
+    for v in sorted(merged):
+        c_a, c_b = merged[v]
+        t = c_a + c_b
+        avg_rank = rank + (t + 1) / 2.0
+        rank_sum_a += c_a * avg_rank
+        tie_term += t ** 3 - t
+        rank += t
+
+    n = n_a + n_b
+    u_a = rank_sum_a - n_a * (n_a + 1) / 2.0
+    mu = n_a * n_b / 2.0
+    sigma = math.sqrt(n_a * n_b / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))) if n > 1 else 0.0
+    if sigma == 0.0:
+        return u_a, 1.0, 0.5
+
+    z = (abs(u_a - mu) - 0.5) / sigma
+    p = math.erfc(max(z, 0.0) / math.sqrt(2.0))
+    return u_a, p, u_a / (n_a * n_b)
+
+def compare(results, baseline, alpha, threshold):
+    """Returns the list of (suite, label, verdict, details), verdict in ok, regression, improvement, new"""
+    report = []
+    for name, suite in results["suites"].items():
+        base_suite = baseline["suites"].get(name, {}).get("results", {})
+        for label, res in suite["results"].items():
+            base = base_suite.get(label)
+            if base is None:
+                report.append((name, label, "new", {}))
+                continue
+
+            u, p, effect = mann_whitney(res["hist"], base["hist"])
+            change = (res["median_ns"] - base["median_ns"]) / base["median_ns"] if base["median_ns"] else 0.0
+            verdict = "ok"
+            if p < alpha and abs(change) >= threshold:
+                verdict = "regression" if change > 0 else "improvement"
+            report.append((name, label, verdict, {"p": p, "effect": effect, "change": change,
+                                                  "median_ns": res["median_ns"], "base_median_ns": base["median_ns"]}))
+    return report
+
+# ======-------------------------------------------------------------------------------
+# Main
+# ======-------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description="Coyote benchmark runner")
+    parser.add_argument("config", help="suite config (json)")
+    parser.add_argument("-s", "--suite", action="append", help="run only the named suites")
+    parser.add_argument("-o", "--out", default="bench_results.json", help="results file")
+    parser.add_argument("-b", "--baseline", help="baseline results to compare against")
+    parser.add_argument("--save-baseline", help="store the results as a new baseline")
+    parser.add_argument("--build-dir", default=os.path.join(SW_DIR, "build_bench"))
+    parser.add_argument("--no-build", action="store_true", help="reuse existing builds")
+    parser.add_argument("--alpha", type=float, help="significance level")
+    parser.add_argument("--threshold", type=float, help="minimal relative median change")
+    args = parser.parse_args()
+
+    with open(args.config) as f:
+        config = json.load(f)
+
+    alpha = args.alpha if args.alpha is not None else config.get("alpha", DEF_ALPHA)
+    threshold = args.threshold if args.threshold is not None else config.get("threshold", DEF_THRESHOLD)
+
+    results = {"meta": host_meta(), "suites": {}}
+    for suite in config["suites"]:
+        if args.suite and suite["name"] not in args.suite:
+            continue
+
+        print("Suite: {}".format(suite["name"]))
+        build_dir = os.path.join(args.build_dir, suite["name"]) if args.no_build else build(suite, args.build_dir)
+        res = run(suite, build_dir)
+        results["suites"][suite["name"]] = {"meta": bitstream_meta(suite), "config": suite, "results": res}
+
+        for label, r in res.items():
+            print("  {:<24} runs: {:>8}, median: {:>12} ns, p99: {:>12} ns".format(label, r["runs"], r["median_ns"], r["p99_ns"]))
+
+    with open(args.out, "w") as f:
+        json.dump(results, f, indent=1)
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            json.dump(results, f, indent=1)
+
+    if not args.baseline:
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressed = False
+    print("Baseline: {} ({})".format(args.baseline, baseline["meta"].get("commit", "?")[:12]))
+    for name, label, verdict, d in compare(results, baseline, alpha, threshold):
+        if verdict == "new":
+            print("  {:<12} {:<24} new".format(name, label))
+            continue
+        print("  {:<12} {:<24} {:<11} median {:>12} -> {:>12} ns ({:+.2%}), p = {:.2e}".format(
+            name, label, verdict, d["base_median_ns"], d["median_ns"], d["change"], d["p"]))
+        regressed |= verdict == "regression"
+
+    return 1 if regressed else 0
+
+if __name__ == "__main__":
+    sys.exit(main())